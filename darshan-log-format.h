@@ -24,7 +24,7 @@
  * log format version, NOT when a new version of a module record is
  * introduced -- we have module-specific versions to handle that
  */
-#define DARSHAN_LOG_VERSION "3.21"
+#define DARSHAN_LOG_VERSION "3.27"
 
 /* magic number for validating output files and checking byte order */
 #define DARSHAN_MAGIC_NR 6567223
@@ -43,12 +43,25 @@
 #define DARSHAN_MOD_FLAG_UNSET(flags, id) flags = (flags & ~(1 << id))
 #define DARSHAN_MOD_FLAG_ISSET(flags, id) (flags & (1 << id))
 
-/* compression method used on darshan log file */
+/* number of time bins in the windowed activity counters of POSIX and
+ * MPI-IO records. Bin i holds the bytes moved by accesses starting in
+ * [i*w, (i+1)*w) seconds after application startup, where w is the
+ * record's bin width. The width doubles, merging pairs of adjacent bins,
+ * whenever an access starts beyond the last bin, so it is always the base
+ * width (see DARSHAN_ACTIVITY_BIN_WIDTH in darshan-runtime) times a power
+ * of two.
+ */
+#define DARSHAN_ACTIVITY_BINS 16
+
+/* compression method used on darshan log file; new methods are only ever
+ * appended, as the value is stored in the log header
+ */
 enum darshan_comp_type
 {
     DARSHAN_ZLIB_COMP,
     DARSHAN_BZIP2_COMP,
     DARSHAN_NO_COMP, 
+    DARSHAN_ZSTD_COMP,
 };
 
 typedef uint64_t darshan_record_id;
@@ -76,6 +89,29 @@ struct darshan_header
     struct darshan_log_map name_map;
     struct darshan_log_map mod_map[DARSHAN_MAX_MODS];
     uint32_t mod_ver[DARSHAN_MAX_MODS];
+    /* runtime memory (in bytes) used for each module's records, taking
+     * the maximum across all processes (added in log version 3.22)
+     */
+    uint64_t mod_mem[DARSHAN_MAX_MODS];
+    /* if nonzero, the period N with which a module sampled the more
+     * expensive parts of its instrumentation (1 in N operations), meaning
+     * some of its counters are estimates (added in log version 3.24)
+     */
+    uint32_t mod_sample[DARSHAN_MAX_MODS];
+    /* flags for the modules whose records are sparse encoded (added in
+     * log version 3.25)
+     */
+    uint32_t sparse_flag;
+    /* flags for the modules whose records are stored in columns (added
+     * in log version 3.26)
+     */
+    uint32_t columnar_flag;
+    /* flags for the modules whose common value counts (e.g.,
+     * POSIX_ACCESS1_COUNT) are estimates, because a record saw more
+     * distinct values than could be tracked exactly (added in log
+     * version 3.27)
+     */
+    uint32_t estimate_flag;
 };
 
 /* job-level metadata stored for this application */
@@ -97,6 +133,24 @@ struct darshan_name_record
     char name[1];
 };
 
+/* name records are stored front coded in the log (as of version 3.23):
+ * each entry stores only the suffix of its name that differs from the
+ * name in the preceding entry, along with the length of the prefix the
+ * two names share. The first entry written by each process always has
+ * a prefix length of 0. Entries are packed back to back with no padding,
+ * so each is DARSHAN_FC_NAME_RECORD_SIZE() bytes long.
+ */
+struct darshan_fc_name_record
+{
+    darshan_record_id id;
+    uint16_t prefix_len;
+    char suffix[1];
+};
+#define DARSHAN_FC_NAME_RECORD_HDR_SIZE \
+    (sizeof(darshan_record_id) + sizeof(uint16_t))
+#define DARSHAN_FC_NAME_RECORD_SIZE(__suffix_len) \
+    (DARSHAN_FC_NAME_RECORD_HDR_SIZE + (__suffix_len) + 1)
+
 /* base record definition that can be used by modules */
 struct darshan_base_record
 {
@@ -104,6 +158,40 @@ struct darshan_base_record
     int64_t rank;
 };
 
+/* records made of a base record followed by C int64_t counters and F
+ * double counters may be stored sparse encoded (as of log version 3.25),
+ * if their module's bit is set in the header's 'sparse_flag'. Each record
+ * is then stored as:
+ * - its base record, unchanged
+ * - a uint32_t giving the length of the rest of the encoded record
+ * - a bitmap of C+F bits, rounded up to whole bytes, with bit i (bit i%8
+ *   of byte i/8) set if counter i is nonzero, counting the int64_t
+ *   counters first and the double counters after them
+ * - each nonzero int64_t counter, zig-zag encoded ((v << 1) ^ (v >> 63))
+ *   as a varint of 7 bits per byte, least significant first, with the
+ *   high bit of every byte but the last one set
+ * - the 8 bytes of each nonzero double counter, unchanged
+ */
+#define DARSHAN_SPARSE_REC_HDR_SIZE \
+    (sizeof(struct darshan_base_record) + sizeof(uint32_t))
+#define DARSHAN_SPARSE_BITMAP_SIZE(__cnt) (((__cnt) + 7) / 8)
+#define DARSHAN_SPARSE_REC_MAX_SIZE(__counter_cnt, __fcounter_cnt) \
+    (DARSHAN_SPARSE_REC_HDR_SIZE + \
+     DARSHAN_SPARSE_BITMAP_SIZE((__counter_cnt) + (__fcounter_cnt)) + \
+     (10 * (__counter_cnt)) + (sizeof(double) * (__fcounter_cnt)))
+
+/* such records may instead be stored in columns (as of log version 3.26),
+ * if their module's bit is set in the header's 'columnar_flag'. Each
+ * process then stores its records, if it has any, in one or more groups.
+ * A group of N records is stored as a uint64_t holding N followed by the
+ * N record ids, the N ranks, the N values of the first int64_t counter,
+ * and so on for every int64_t counter and then every double counter. Values of the same counter tend to be alike, so they
+ * compress better side by side, and readers that need only a few counters
+ * can pick them out without decoding whole records.
+ */
+#define DARSHAN_COLUMNAR_FIELD_CNT(__counter_cnt, __fcounter_cnt) \
+    (2 + (__counter_cnt) + (__fcounter_cnt))
+
 
 /************************************************
  *** module-specific includes and definitions ***
@@ -8,7 +8,7 @@
 #define __DARSHAN_MPIIO_LOG_FORMAT_H
 
 /* current MPI-IO log format version */
-#define DARSHAN_MPIIO_VER 3
+#define DARSHAN_MPIIO_VER 5
 
 /* TODO: maybe use a counter to track cases in which a derived datatype is used? */
 
@@ -87,6 +87,42 @@
     X(MPIIO_FASTEST_RANK_BYTES) \
     X(MPIIO_SLOWEST_RANK) \
     X(MPIIO_SLOWEST_RANK_BYTES) \
+    /* number of ranks this record covers (more than 1 if rank is -1) */\
+    X(MPIIO_SHARED_RANKS) \
+    /* bytes read by accesses starting in each activity time bin */\
+    X(MPIIO_ACTIVITY_READ_0) \
+    X(MPIIO_ACTIVITY_READ_1) \
+    X(MPIIO_ACTIVITY_READ_2) \
+    X(MPIIO_ACTIVITY_READ_3) \
+    X(MPIIO_ACTIVITY_READ_4) \
+    X(MPIIO_ACTIVITY_READ_5) \
+    X(MPIIO_ACTIVITY_READ_6) \
+    X(MPIIO_ACTIVITY_READ_7) \
+    X(MPIIO_ACTIVITY_READ_8) \
+    X(MPIIO_ACTIVITY_READ_9) \
+    X(MPIIO_ACTIVITY_READ_10) \
+    X(MPIIO_ACTIVITY_READ_11) \
+    X(MPIIO_ACTIVITY_READ_12) \
+    X(MPIIO_ACTIVITY_READ_13) \
+    X(MPIIO_ACTIVITY_READ_14) \
+    X(MPIIO_ACTIVITY_READ_15) \
+    /* bytes written by accesses starting in each activity time bin */\
+    X(MPIIO_ACTIVITY_WRITE_0) \
+    X(MPIIO_ACTIVITY_WRITE_1) \
+    X(MPIIO_ACTIVITY_WRITE_2) \
+    X(MPIIO_ACTIVITY_WRITE_3) \
+    X(MPIIO_ACTIVITY_WRITE_4) \
+    X(MPIIO_ACTIVITY_WRITE_5) \
+    X(MPIIO_ACTIVITY_WRITE_6) \
+    X(MPIIO_ACTIVITY_WRITE_7) \
+    X(MPIIO_ACTIVITY_WRITE_8) \
+    X(MPIIO_ACTIVITY_WRITE_9) \
+    X(MPIIO_ACTIVITY_WRITE_10) \
+    X(MPIIO_ACTIVITY_WRITE_11) \
+    X(MPIIO_ACTIVITY_WRITE_12) \
+    X(MPIIO_ACTIVITY_WRITE_13) \
+    X(MPIIO_ACTIVITY_WRITE_14) \
+    X(MPIIO_ACTIVITY_WRITE_15) \
     /* end of counters */\
     X(MPIIO_NUM_INDICES)
 
@@ -124,6 +160,8 @@
     /* NOTE: for shared records only */\
     X(MPIIO_F_VARIANCE_RANK_TIME) \
     X(MPIIO_F_VARIANCE_RANK_BYTES) \
+    /* width (in seconds) of each activity time bin */\
+    X(MPIIO_F_ACTIVITY_BIN_WIDTH) \
     /* end of counters*/\
     X(MPIIO_F_NUM_INDICES)
 
@@ -7,7 +7,7 @@
 #define __DARSHAN_POSIX_LOG_FORMAT_H
 
 /* current POSIX log format version */
-#define DARSHAN_POSIX_VER 4
+#define DARSHAN_POSIX_VER 6
 
 #define POSIX_COUNTERS \
     /* count of posix opens (INCLUDING fileno and dup operations) */\
@@ -113,6 +113,42 @@
     X(POSIX_FASTEST_RANK_BYTES) \
     X(POSIX_SLOWEST_RANK) \
     X(POSIX_SLOWEST_RANK_BYTES) \
+    /* number of ranks this record covers (more than 1 if rank is -1) */\
+    X(POSIX_SHARED_RANKS) \
+    /* bytes read by accesses starting in each activity time bin */\
+    X(POSIX_ACTIVITY_READ_0) \
+    X(POSIX_ACTIVITY_READ_1) \
+    X(POSIX_ACTIVITY_READ_2) \
+    X(POSIX_ACTIVITY_READ_3) \
+    X(POSIX_ACTIVITY_READ_4) \
+    X(POSIX_ACTIVITY_READ_5) \
+    X(POSIX_ACTIVITY_READ_6) \
+    X(POSIX_ACTIVITY_READ_7) \
+    X(POSIX_ACTIVITY_READ_8) \
+    X(POSIX_ACTIVITY_READ_9) \
+    X(POSIX_ACTIVITY_READ_10) \
+    X(POSIX_ACTIVITY_READ_11) \
+    X(POSIX_ACTIVITY_READ_12) \
+    X(POSIX_ACTIVITY_READ_13) \
+    X(POSIX_ACTIVITY_READ_14) \
+    X(POSIX_ACTIVITY_READ_15) \
+    /* bytes written by accesses starting in each activity time bin */\
+    X(POSIX_ACTIVITY_WRITE_0) \
+    X(POSIX_ACTIVITY_WRITE_1) \
+    X(POSIX_ACTIVITY_WRITE_2) \
+    X(POSIX_ACTIVITY_WRITE_3) \
+    X(POSIX_ACTIVITY_WRITE_4) \
+    X(POSIX_ACTIVITY_WRITE_5) \
+    X(POSIX_ACTIVITY_WRITE_6) \
+    X(POSIX_ACTIVITY_WRITE_7) \
+    X(POSIX_ACTIVITY_WRITE_8) \
+    X(POSIX_ACTIVITY_WRITE_9) \
+    X(POSIX_ACTIVITY_WRITE_10) \
+    X(POSIX_ACTIVITY_WRITE_11) \
+    X(POSIX_ACTIVITY_WRITE_12) \
+    X(POSIX_ACTIVITY_WRITE_13) \
+    X(POSIX_ACTIVITY_WRITE_14) \
+    X(POSIX_ACTIVITY_WRITE_15) \
     /* end of counters */\
     X(POSIX_NUM_INDICES)
 
@@ -150,6 +186,8 @@
     /* NOTE: for shared records only */\
     X(POSIX_F_VARIANCE_RANK_TIME) \
     X(POSIX_F_VARIANCE_RANK_BYTES) \
+    /* width (in seconds) of each activity time bin */\
+    X(POSIX_F_ACTIVITY_BIN_WIDTH) \
     /* end of counters */\
     X(POSIX_F_NUM_INDICES)
 
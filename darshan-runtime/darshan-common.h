@@ -45,29 +45,81 @@
  *      * 1 GiB+
  */
 #define DARSHAN_BUCKET_INC(__bucket_base_p, __value) do {\
-    if(__value < 101) \
-        *(__bucket_base_p) += 1; \
-    else if(__value < 1025) \
-        *(__bucket_base_p + 1) += 1; \
-    else if(__value < 10241) \
-        *(__bucket_base_p + 2) += 1; \
-    else if(__value < 102401) \
-        *(__bucket_base_p + 3) += 1; \
-    else if(__value < 1048577) \
-        *(__bucket_base_p + 4) += 1; \
-    else if(__value < 4194305) \
-        *(__bucket_base_p + 5) += 1; \
-    else if(__value < 10485761) \
-        *(__bucket_base_p + 6) += 1; \
-    else if(__value < 104857601) \
-        *(__bucket_base_p + 7) += 1; \
-    else if(__value < 1073741825) \
-        *(__bucket_base_p + 8) += 1; \
-    else \
-        *(__bucket_base_p + 9) += 1; \
+    *(__bucket_base_p + darshan_bucket_index(__value)) += 1; \
 } while(0)
 
-/* maximum number of common values that darshan will track per file at runtime */
+/* Each power of two range [2^k, 2^(k+1)) contains at most one of the
+ * bucket boundaries above, so the bucket of a value is the number of
+ * boundaries below its range (darshan_bucket_base[k]), plus one if it
+ * exceeds the boundary inside its range (darshan_bucket_bound[k]). This
+ * avoids the mispredicted branches of a comparison chain when access
+ * sizes vary.
+ */
+static const unsigned char darshan_bucket_base[64] = {
+    0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 3, 3,
+    3, 4, 4, 4, 4, 5, 5, 6, 7, 7, 7, 8, 8, 8, 8, 9,
+    9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+    9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9
+};
+static const int64_t darshan_bucket_bound[64] = {
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, 100LL, INT64_MAX,
+    INT64_MAX, INT64_MAX, 1024LL, INT64_MAX,
+    INT64_MAX, 10240LL, INT64_MAX, INT64_MAX,
+    102400LL, INT64_MAX, INT64_MAX, INT64_MAX,
+    1048576LL, INT64_MAX, 4194304LL, 10485760LL,
+    INT64_MAX, INT64_MAX, 104857600LL, INT64_MAX,
+    INT64_MAX, INT64_MAX, 1073741824LL, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX,
+    INT64_MAX, INT64_MAX, INT64_MAX, INT64_MAX
+};
+
+/* returns the index of the DARSHAN_BUCKET_INC bucket holding 'value' */
+static inline int darshan_bucket_index(int64_t value)
+{
+    int k;
+
+    /* negative values belong in the smallest bucket */
+    value &= ~(value >> 63);
+    k = 63 - __builtin_clzll((uint64_t)value | 1);
+
+    return(darshan_bucket_base[k] + (value > darshan_bucket_bound[k]));
+}
+
+/* returns 1 if the current operation on a record should be sampled, given
+ * the record's countdown to its next sampled operation. The first
+ * operation on each record is always sampled, followed by 1 in 'period'
+ * operations after that: either every 'period'th operation or, if 'rng'
+ * is given, operations separated by gaps drawn uniformly from
+ * [1, 2*period-1] using the (nonzero) xorshift generator state in '*rng'.
+ */
+static inline int darshan_sample_op(int *countdown, int period, uint32_t *rng)
+{
+    if(--(*countdown) > 0)
+        return(0);
+
+    if(rng)
+    {
+        *rng ^= *rng << 13;
+        *rng ^= *rng >> 17;
+        *rng ^= *rng << 5;
+        *countdown = 1 + *rng % (2 * period - 1);
+    }
+    else
+        *countdown = period;
+
+    return(1);
+}
+
+/* maximum number of common values that darshan will track per file at runtime
+ * NOTE: must be a power of two no larger than 128
+ */
 #define DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT 32
 /* maximum number of counters in each common value */
 #define DARSHAN_COMMON_VAL_MAX_NCOUNTERS 12
@@ -89,8 +141,8 @@
 #define DARSHAN_UPDATE_COMMON_VAL_COUNTERS(__val_p, __cnt_p, __vals, __val_size, __val_count, __add_flag) do {\
     int i_; \
     int total_count = __val_count; \
-    int64_t tmp_val[4*DARSHAN_COMMON_VAL_MAX_NCOUNTERS] = {0}; \
-    int64_t tmp_cnt[4] = {0}; \
+    int64_t tmp_val[4*DARSHAN_COMMON_VAL_MAX_NCOUNTERS]; \
+    int64_t tmp_cnt[4]; \
     int tmp_ndx = 0; \
     if(*(int64_t *)__vals == 0) break; \
     for(i_=0; i_<4; i_++) { \
@@ -140,8 +192,21 @@ struct darshan_common_val_counter
     int64_t vals[DARSHAN_COMMON_VAL_MAX_NCOUNTERS];
     int nvals;
     int freq;
+    int err; /* upper bound on the overestimation of freq */
 };
 
+/* marks the common value counts of module __mod_id as estimates in the log
+ * once __cvc (if not NULL) has taken the place of an evicted value, i.e.
+ * its count may be overestimated. __flag is set when this is done, so the
+ * module only does it once.
+ */
+#define DARSHAN_MARK_COMMON_VAL_ESTIMATE(__cvc, __mod_id, __flag) do {\
+    if((__cvc) && (__cvc)->err && !(__flag)) { \
+        (__flag) = 1; \
+        darshan_core_mark_estimated(__mod_id); \
+    } \
+} while(0)
+
 /* i/o type (read or write) */
 enum darshan_io_type
 {
@@ -226,6 +291,90 @@ void darshan_iter_record_refs(
     void (*iter_action)(void *, void *),
     void *user_ptr);
 
+/* darshan_lookup_handle_ref()
+ *
+ * Returns the record reference pointer associated with the non-negative
+ * integer handle 'handle' (e.g., a file descriptor) in the handle table
+ * 'handle_table', or NULL if there is no such handle. Handle tables are
+ * growable arrays directly indexed by handle value, so this is
+ * considerably cheaper than darshan_lookup_record_ref() for dense small
+ * integers. An empty (NULL) table is valid.
+ */
+void *darshan_lookup_handle_ref(
+    void *handle_table,
+    int handle);
+
+/* darshan_add_handle_ref()
+ *
+ * Associates the record reference pointer 'rec_ref_p' with the integer
+ * handle 'handle' in the handle table pointed to by 'handle_table_p',
+ * growing the table if needed and replacing any previous association.
+ * Returns 1 on success, 0 on failure.
+ */
+int darshan_add_handle_ref(
+    void **handle_table_p,
+    int handle,
+    void *rec_ref_p);
+
+/* darshan_delete_handle_ref()
+ *
+ * Removes the integer handle 'handle' from the handle table pointed to by
+ * 'handle_table_p', returning the record reference pointer it was
+ * associated with (or NULL if not found).
+ */
+void *darshan_delete_handle_ref(
+    void **handle_table_p,
+    int handle);
+
+/* darshan_clear_handle_refs()
+ *
+ * Frees the handle table pointed to by 'handle_table_p' and resets it to
+ * an empty table. Record reference pointers are not freed.
+ */
+void darshan_clear_handle_refs(
+    void **handle_table_p);
+
+/* darshan_lookup_ptr_ref()
+ *
+ * Returns the record reference pointer associated with the pointer handle
+ * 'ptr' (e.g., a FILE stream) in the pointer table 'ptr_table', or NULL
+ * if there is no such handle. Pointer tables are open-addressing hash
+ * tables keyed directly on pointer values. An empty (NULL) table is valid.
+ */
+void *darshan_lookup_ptr_ref(
+    void *ptr_table,
+    const void *ptr);
+
+/* darshan_add_ptr_ref()
+ *
+ * Associates the record reference pointer 'rec_ref_p' with the pointer
+ * handle 'ptr' in the pointer table pointed to by 'ptr_table_p', growing
+ * the table if needed and replacing any previous association. Returns 1
+ * on success, 0 on failure.
+ */
+int darshan_add_ptr_ref(
+    void **ptr_table_p,
+    const void *ptr,
+    void *rec_ref_p);
+
+/* darshan_delete_ptr_ref()
+ *
+ * Removes the pointer handle 'ptr' from the pointer table pointed to by
+ * 'ptr_table_p', returning the record reference pointer it was associated
+ * with (or NULL if not found).
+ */
+void *darshan_delete_ptr_ref(
+    void **ptr_table_p,
+    const void *ptr);
+
+/* darshan_clear_ptr_refs()
+ *
+ * Frees the pointer table pointed to by 'ptr_table_p' and resets it to an
+ * empty table. Record reference pointers are not freed.
+ */
+void darshan_clear_ptr_refs(
+    void **ptr_table_p);
+
 /* darshan_clean_file_path()
  *
  * Allocate a new string that contains a new cleaned-up version of
@@ -236,6 +385,24 @@ void darshan_iter_record_refs(
 char* darshan_clean_file_path(
     const char *path);
 
+/* darshan_clean_file_path_buf()
+ *
+ * Same as darshan_clean_file_path(), but writes the cleaned-up path
+ * into the caller-provided buffer 'buf' of size 'buf_len' rather than
+ * allocating a new string. Empty and "." path components are removed,
+ * and relative paths are resolved against a cached copy of the current
+ * working directory. Returns 'buf' on success, or NULL if the path is a
+ * reserved Darshan path or does not fit in 'buf'.
+ * NOTE: ".." components are left in place, as symbolic links are not
+ * followed, so the result may differ from realpath(). The cached working
+ * directory is only refreshed when the application calls chdir() or
+ * fchdir() through Darshan's wrappers.
+ */
+char* darshan_clean_file_path_buf(
+    const char *path,
+    char *buf,
+    size_t buf_len);
+
 /* darshan_record_sort()
  *
  * Sort the records in 'rec_buf' by descending rank to get all
@@ -250,17 +417,36 @@ void darshan_record_sort(
     int rec_count,
     int rec_size);
 
+/* rank given to a process's copies of records that were reduced into
+ * another process's records, which sorts them after all other records
+ */
+#define DARSHAN_REDUCED_RECORD_RANK (-2)
+
+/* darshan_record_compact()
+ *
+ * Sort the records in 'rec_buf' like darshan_record_sort(), then drop
+ * the records marked with rank DARSHAN_REDUCED_RECORD_RANK from the end
+ * of the buffer. Returns the number of records left.
+ * NOTE: this function only works on fixed-length records.
+ */
+int darshan_record_compact(
+    void *rec_buf,
+    int rec_count,
+    int rec_size);
+
 /* darshan_track_common_val_counters()
  *
  * Potentially increment an existing common value counter or allocate
  * a new one to keep track of commonly occuring values. Example use
  * cases would be to track the most frequent access sizes or strides
  * used by a specific module, for instance. 'common_val_root' is the
- * root pointer for the tree which stores common value info, 
- * 'common_val_count' is a pointer to the number of nodes in the 
- * tree (i.e., the number of allocated common value counters), 'vals'
- * is the set of new values to attempt to add, and 'nvals' is the
- * total number of values in the 'vals' pointer.
+ * root pointer for the fixed-size structure which stores common value
+ * info, 'common_val_count' is a pointer to the number of values
+ * currently tracked, 'vals' is the set of new values to attempt to add,
+ * and 'nvals' is the total number of values in the 'vals' pointer.
+ * At most DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT values are tracked; once
+ * that many are tracked, new values replace the least frequent one, so
+ * counts may be overestimated by up to the returned counter's 'err'.
  */
 struct darshan_common_val_counter *darshan_track_common_val_counters(
     void **common_val_root,
@@ -268,6 +454,165 @@ struct darshan_common_val_counter *darshan_track_common_val_counters(
     int nvals,
     int *common_val_count);
 
+/* darshan_add_common_val_counters()
+ *
+ * Same as darshan_track_common_val_counters(), but counts 'freq'
+ * occurences of 'vals' at once (e.g., when merging common values
+ * tracked separately).
+ */
+struct darshan_common_val_counter *darshan_add_common_val_counters(
+    void **common_val_root,
+    int64_t *vals,
+    int nvals,
+    int freq,
+    int *common_val_count);
+
+/* darshan_iter_common_val_counters()
+ *
+ * Calls 'iter_action' for each common value counter tracked in
+ * 'common_val_root', from most to least frequent, passing 'user_ptr'
+ * through. Counters must not be added or cleared while iterating.
+ */
+void darshan_iter_common_val_counters(
+    void *common_val_root,
+    void (*iter_action)(struct darshan_common_val_counter *, void *),
+    void *user_ptr);
+
+/* darshan_clear_common_val_counters()
+ *
+ * Frees the common value counters rooted at 'common_val_root' (as built
+ * by darshan_track_common_val_counters()) and resets the root to an
+ * empty set.
+ */
+void darshan_clear_common_val_counters(
+    void **common_val_root);
+
+/* opaque slab allocator state */
+struct darshan_slab;
+
+/* darshan_slab_create()
+ *
+ * Creates a slab allocator for fixed-size objects of 'obj_size' bytes.
+ * Objects are carved out of large chunks, avoiding per-object malloc()
+ * overhead and heap fragmentation, and are all released at once by
+ * darshan_slab_destroy(). 'name' identifies the slab in memory usage
+ * reports. Slabs are internally locked, so they may be shared by
+ * multiple threads. Returns NULL on failure.
+ */
+struct darshan_slab *darshan_slab_create(
+    const char *name,
+    size_t obj_size);
+
+/* darshan_slab_alloc()
+ *
+ * Returns a zeroed object from the slab 'slab', or NULL on failure.
+ */
+void *darshan_slab_alloc(
+    struct darshan_slab *slab);
+
+/* darshan_slab_free()
+ *
+ * Returns the object 'obj' to the slab 'slab' for reuse. Objects do not
+ * need to be freed individually before destroying their slab.
+ */
+void darshan_slab_free(
+    struct darshan_slab *slab,
+    void *obj);
+
+/* darshan_slab_destroy()
+ *
+ * Frees the slab 'slab' and every object allocated from it.
+ */
+void darshan_slab_destroy(
+    struct darshan_slab *slab);
+
+/* darshan_common_val_slabs_destroy()
+ *
+ * Frees every common value counter of every module at once, along with
+ * the slabs they were allocated from (which are recreated on next use).
+ * Called by darshan-core at shutdown, once modules have cleaned up.
+ */
+void darshan_common_val_slabs_destroy(
+    void);
+
+/* darshan_slab_mem_usage()
+ *
+ * Returns the total number of bytes currently allocated by all slabs.
+ */
+size_t darshan_slab_mem_usage(
+    void);
+
+/* darshan_activity_bins_coarsen()
+ *
+ * Doubles the width '*width' of a record's activity bins ('read_bins' and
+ * 'write_bins', each holding DARSHAN_ACTIVITY_BINS counters), merging
+ * pairs of adjacent bins, as many times as needed for the last bin to
+ * cover time 'tm'.
+ */
+void darshan_activity_bins_coarsen(
+    int64_t *read_bins,
+    int64_t *write_bins,
+    double *width,
+    double tm);
+
+/* darshan_activity_bins_merge()
+ *
+ * Adds the activity bins 'in_read_bins' and 'in_write_bins', which are
+ * 'in_width' seconds wide, to the bins 'read_bins' and 'write_bins', which
+ * are '*width' seconds wide, after coarsening the finer of the two sets to
+ * the width of the other. A width of 0 denotes bins with no activity.
+ */
+void darshan_activity_bins_merge(
+    int64_t *read_bins,
+    int64_t *write_bins,
+    double *width,
+    const int64_t *in_read_bins,
+    const int64_t *in_write_bins,
+    double in_width);
+
+/* darshan_activity_bins_add()
+ *
+ * Adds 'bytes' read (or written, if 'write_flag' is set) by an access
+ * starting at time 'tm' to a record's activity bins, coarsening them
+ * first if 'tm' is beyond the last bin. Bins with no activity yet (a
+ * '*width' of 0) start out 'base_width' seconds wide, and a 'base_width'
+ * of 0 disables activity bins altogether.
+ */
+static inline void darshan_activity_bins_add(
+    int64_t *read_bins,
+    int64_t *write_bins,
+    double *width,
+    double base_width,
+    double tm,
+    int64_t bytes,
+    int write_flag)
+{
+    int64_t bin;
+
+    if(base_width <= 0)
+        return;
+    if(*width == 0)
+        *width = base_width;
+    if(tm < 0)
+        tm = 0;
+
+    bin = (int64_t)(tm / *width);
+    if(bin >= DARSHAN_ACTIVITY_BINS)
+    {
+        darshan_activity_bins_coarsen(read_bins, write_bins, width, tm);
+        bin = (int64_t)(tm / *width);
+        if(bin >= DARSHAN_ACTIVITY_BINS)
+            bin = DARSHAN_ACTIVITY_BINS - 1;
+    }
+
+    if(write_flag)
+        write_bins[bin] += bytes;
+    else
+        read_bins[bin] += bytes;
+
+    return;
+}
+
 #ifdef HAVE_MPI
 /* darshan_variance_reduce()
  *
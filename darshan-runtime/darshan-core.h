@@ -13,6 +13,7 @@
 #include <sys/types.h>
 #include <stdint.h>
 #include <limits.h>
+#include <pthread.h>
 
 #ifdef HAVE_MPI
 #include <mpi.h>
@@ -37,6 +38,75 @@
 /* Environment variable to override memory per module */
 #define DARSHAN_MOD_MEM_OVERRIDE "DARSHAN_MODMEM"
 
+/* Environment variable to override __DARSHAN_TIMER */
+#define DARSHAN_TIMER_OVERRIDE "DARSHAN_TIMER"
+
+/* timer backend used for runtime timestamps if not set at configure time
+ * or in the environment
+ */
+#ifndef __DARSHAN_TIMER
+#define __DARSHAN_TIMER "default"
+#endif
+
+/* length of the busy-wait (in seconds) used to calibrate the TSC timer */
+#define DARSHAN_TSC_CALIBRATION_TIME 0.01
+
+/* Environment variable to set the period N with which modules that
+ * support sampling run the expensive parts of their instrumentation
+ * (1 in N operations); sampling is disabled by default
+ */
+#define DARSHAN_SAMPLE_PERIOD "DARSHAN_SAMPLE_PERIOD"
+
+/* Environment variable to sample operations on a randomized schedule with
+ * the same average period, rather than every Nth operation
+ */
+#define DARSHAN_SAMPLE_RANDOM "DARSHAN_SAMPLE_RANDOM"
+
+/* Environment variable to set the initial width (in seconds) of the time
+ * bins modules use for their windowed activity counters
+ */
+#define DARSHAN_ACTIVITY_BIN_WIDTH "DARSHAN_ACTIVITY_BIN_WIDTH"
+#define DARSHAN_DEF_ACTIVITY_BIN_WIDTH 1.0
+
+/* Environment variable to set the number of threads each process uses to
+ * compress its log data at shutdown
+ */
+#define DARSHAN_COMP_THREADS "DARSHAN_COMP_THREADS"
+
+/* Environment variable to choose the method used to compress log data,
+ * "zlib" (the default) or "zstd" (if Darshan was built with zstd support)
+ */
+#define DARSHAN_LOG_COMPRESSION "DARSHAN_LOG_COMPRESSION"
+
+/* Environment variable to store the records of modules that support it
+ * sparse encoded in the log, leaving out counters that are zero
+ */
+#define DARSHAN_SPARSE_RECORDS "DARSHAN_SPARSE_RECORDS"
+
+/* Environment variable to store the records of modules that support it
+ * in columns (one per counter) in the log; takes precedence over
+ * DARSHAN_SPARSE_RECORDS
+ */
+#define DARSHAN_COLUMNAR_RECORDS "DARSHAN_COLUMNAR_RECORDS"
+
+/* Environment variable to have the processes on each node send their log
+ * data to one process on the node, which writes it to the log on their
+ * behalf
+ */
+#define DARSHAN_NODE_AGGREGATION "DARSHAN_NODE_AGGREGATION"
+
+/* Environment variable to have each process periodically write a snapshot
+ * of its records to a log file of its own while it runs, every given
+ * number of seconds
+ */
+#define DARSHAN_SNAPSHOT_INTERVAL "DARSHAN_SNAPSHOT_INTERVAL"
+
+/* Environment variable to override default snapshot path */
+#define DARSHAN_SNAPSHOT_PATH_OVERRIDE "DARSHAN_SNAPSHOT_PATH"
+
+/* default path for storing snapshots is '/tmp' */
+#define DARSHAN_DEF_SNAPSHOT_PATH "/tmp"
+
 /* Environment variable to enable profiling without MPI */
 #define DARSHAN_ENABLE_NONMPI "DARSHAN_ENABLE_NONMPI" 
 
@@ -46,6 +116,14 @@
 
 /* default path for storing mmap log files is '/tmp' */
 #define DARSHAN_DEF_MMAP_LOG_PATH "/tmp"
+
+/* offset of the first module record slot in mmap log files, which
+ * follows the header, job, and name record regions on a page boundary
+ */
+#define DARSHAN_MMAP_LOG_MOD_OFF(__page_size) \
+    (((sizeof(struct darshan_header) + DARSHAN_JOB_RECORD_SIZE + \
+    DARSHAN_NAME_RECORD_BUF_SIZE + (__page_size) - 1) / (__page_size)) * \
+    (__page_size))
 #endif
 
 /* Maximum runtime memory consumption per process (in MiB) across
@@ -57,9 +135,172 @@
 #define DARSHAN_MOD_MEM_MAX (4 * 1024 * 1024) /* 4 MiB default */
 #endif
 
-/* default name record buf can store 2048 records of size 100 bytes */
+/* module record memory is committed in chunks of (at least) this size,
+ * on demand, from the budget shared by all modules
+ */
+#define DARSHAN_MOD_MEM_CHUNK_SIZE (64 * 1024)
+
+/* the memory granted to a module at registration is reserved for it; past
+ * its grant, a module may only grow into memory no other module has been
+ * granted, and must leave 1/DARSHAN_MOD_MEM_HOLDBACK of the budget for
+ * modules that have yet to register
+ */
+#define DARSHAN_MOD_MEM_HOLDBACK 8
+
+/* default name record buf can store 2048 records of size 100 bytes, or
+ * several times as many once names are front coded
+ */
 #define DARSHAN_NAME_RECORD_BUF_SIZE (2048 * 100)
 
+/* every DARSHAN_NAME_RECORD_RESTART front coded name records, a record
+ * with the full name is stored, bounding the number of records that must
+ * be decoded to look up any one name
+ */
+#define DARSHAN_NAME_RECORD_RESTART 16
+
+/* at shutdown, log regions are compressed in the background by a pool of
+ * at most DARSHAN_MAX_COMP_THREADS threads (by default, no more than there
+ * are cores per process on the node), as each becomes ready, while earlier
+ * regions are written out. Regions larger than DARSHAN_COMP_CHUNK_SIZE are
+ * split into chunks that are compressed independently, each into its own
+ * zlib stream (or zstd frame), which readers decompress back to back.
+ */
+#define DARSHAN_MAX_COMP_THREADS 8
+#define DARSHAN_COMP_CHUNK_SIZE (1024 * 1024)
+
+/* compressed data is streamed into blocks of DARSHAN_COMP_BLOCK_SIZE bytes,
+ * allocated as they fill up, so that the memory used for it follows the
+ * size of the compressed data rather than that of the data compressed.
+ * every block but the last is full.
+ */
+#define DARSHAN_COMP_BLOCK_SIZE (64 * 1024)
+
+/* module records that are sparse encoded or stored in columns are encoded
+ * chunk by chunk as they are compressed, through a buffer of
+ * DARSHAN_COMP_ENC_BUF_SIZE bytes on the compressing thread's stack, so
+ * encoding them takes no memory beyond that of the compressed output
+ */
+#define DARSHAN_COMP_ENC_BUF_SIZE (64 * 1024)
+
+/* how the records of a module region are encoded as they are compressed */
+enum darshan_rec_encoding
+{
+    DARSHAN_REC_DENSE = 0,
+    DARSHAN_REC_SPARSE,
+    DARSHAN_REC_COLUMNAR,
+};
+
+struct darshan_comp_out
+{
+    char **blocks;
+    int block_cnt;
+    int len;        /* total bytes of compressed data */
+};
+
+/* indices of the job and name record regions, which follow the module
+ * regions, in the array of regions compressed at shutdown
+ */
+#define DARSHAN_COMP_JOB_REGION DARSHAN_MAX_MODS
+#define DARSHAN_COMP_NAME_REGION (DARSHAN_MAX_MODS + 1)
+#define DARSHAN_COMP_REGION_CNT (DARSHAN_MAX_MODS + 2)
+
+/* a region of the log (the job record, name records, or a module's
+ * records) to compress at shutdown, and the result
+ */
+struct darshan_comp_region
+{
+    void *pointers[2];
+    int lengths[2];
+    int count;
+    int comp_buf_sz;
+    int ret;
+    enum darshan_rec_encoding enc;      /* encoding of module records */
+    struct darshan_core_module *enc_mod; /* module, if records are encoded */
+    struct darshan_comp_task *tasks;    /* chunks, with the compressed data */
+    int task_cnt;
+    int pending;                        /* chunks not yet compressed */
+};
+
+/* a chunk of a log region to be compressed by the thread pool */
+struct darshan_comp_task
+{
+    void *pointers[2];
+    int lengths[2];
+    int count;
+    int region;
+    struct darshan_comp_out out;
+    int ret;
+    struct darshan_comp_task *next;
+};
+
+/* threads compressing the chunks of log regions queued up at shutdown,
+ * in the order they were queued
+ */
+struct darshan_comp_pool
+{
+    struct darshan_comp_region *regions;
+    struct darshan_comp_task *head;
+    struct darshan_comp_task *tail;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   /* signaled when chunks are queued */
+    pthread_cond_t done_cond;   /* signaled when a region is compressed */
+    pthread_t threads[DARSHAN_MAX_COMP_THREADS];
+    int thread_cnt;
+    double busy_time;           /* spent compressing, summed over threads */
+    double wait_time;           /* spent by shutdown waiting on compression */
+};
+
+/* state of the background thread that writes snapshots of a process's
+ * records, each one replacing the last
+ */
+struct darshan_snapshot
+{
+    pthread_t thread;
+    int running;
+    int stop;
+    int interval;               /* in seconds */
+    pthread_mutex_t lock;
+    pthread_cond_t stop_cond;   /* signaled when the thread should exit */
+    char log_name[PATH_MAX];
+};
+
+/* a record and the modules that accessed it, as exchanged between
+ * processes to find the records that all processes accessed
+ */
+struct darshan_shared_rec
+{
+    darshan_record_id id;
+    uint64_t mod_flags;
+};
+#define DARSHAN_SHARED_REC_TAG 1
+
+#ifdef HAVE_MPI
+/* a set of processes that each accessed some records that not every
+ * process accessed, and a communicator over just those processes for
+ * reducing them
+ */
+struct darshan_shared_group
+{
+    MPI_Comm comm;
+    darshan_record_id *recs;
+    int rec_cnt;
+};
+#define DARSHAN_SHARED_GROUP_TAG 2
+/* each group gets a communicator of its own, created one after another at
+ * shutdown, so groups are only formed among processes that belong to at
+ * most this many of them; records shared by other groups are not reduced
+ */
+#define DARSHAN_SHARED_GROUP_MAX 64
+
+/* with node aggregation, a node's leader gathers and writes the node's
+ * compressed data in batches of up to DARSHAN_NODE_AGG_BATCH_SIZE bytes
+ * (or a single process's data, if larger), to bound its memory use
+ */
+#define DARSHAN_NODE_AGG_BATCH_SIZE (16 * 1024 * 1024)
+#define DARSHAN_NODE_AGG_TAG 3
+#endif
+
 typedef union
 {
     int nompi_fd;
@@ -68,8 +309,48 @@ typedef union
 #endif
 } darshan_core_log_fh;
 
-/* FS mount information */
-#define DARSHAN_MAX_MNTS 64
+/* path exclusion and inclusion prefixes, as well as mount points, are
+ * compiled at startup into tries, stored as an array of nodes linked by
+ * first-child/next-sibling indices, so that checking a path costs
+ * O(path length) regardless of how many prefixes are configured. Entries
+ * containing glob characters are hung off the trie node for their literal
+ * (non-glob) prefix, so they are only evaluated for paths that share that
+ * prefix.
+ */
+#define DARSHAN_PATH_EXCLUDE 0x1
+#define DARSHAN_PATH_INCLUDE 0x2
+struct darshan_path_trie_node
+{
+    int child;      /* index of first child node, or -1 */
+    int sibling;    /* index of next sibling node, or -1 */
+    int glob;       /* index of first glob rooted at this node, or -1 */
+    int mnt;        /* index of mount point ending here, or -1 */
+    char c;         /* character matched by this node */
+    char action;    /* DARSHAN_PATH_* flags for prefixes ending here */
+};
+
+struct darshan_path_glob
+{
+    char *pattern;  /* fnmatch() pattern, with a trailing '*' appended */
+    int next;       /* index of next glob rooted at the same node, or -1 */
+    char action;
+};
+
+struct darshan_path_trie
+{
+    struct darshan_path_trie_node *nodes;
+    int node_cnt;
+    int node_max;
+    struct darshan_path_glob *globs;
+    int glob_cnt;
+    int glob_max;
+    char actions;   /* union of all DARSHAN_PATH_* flags in the trie */
+};
+
+/* FS mount information; the mount table starts with room for
+ * DARSHAN_INIT_MNTS entries and grows as needed
+ */
+#define DARSHAN_INIT_MNTS 64
 #define DARSHAN_MAX_MNT_PATH 256
 #define DARSHAN_MAX_MNT_TYPE 32
 struct darshan_core_mnt_data
@@ -84,16 +365,33 @@ struct darshan_core_module
 {
     void *rec_buf_start;
     void *rec_buf_p;
-    size_t rec_mem_avail;
+    size_t rec_mem_committed;
+    size_t rec_mem_granted;
     darshan_module_funcs mod_funcs;
+    /* layout of the module's records, if they may be sparse encoded or
+     * stored in columns
+     */
+    int counter_cnt;
+    int fcounter_cnt;
+};
+
+/* state for front coding a stream of name records */
+struct darshan_fc_name_state
+{
+    char prev_name[PATH_MAX];   /* name in the previous record */
+    int restart_cnt;            /* records since the last restart */
+    struct darshan_fc_name_record *restart_record;
 };
 
 /* strucutre for keeping a reference to registered name records */
 struct darshan_core_name_record_ref
 {
-    struct darshan_name_record *name_record;
+    darshan_record_id id;
+    struct darshan_fc_name_record *name_record;
+    struct darshan_fc_name_record *restart_record;
     uint64_t mod_flags;
     uint64_t global_mod_flags;
+    int shared_root;    /* rank that writes the name of a shared record */
     UT_hash_handle hlink;
 };
 
@@ -109,16 +407,17 @@ struct darshan_core_runtime
 
     /* darshan-core internal data structures */
     struct darshan_core_module* mod_array[DARSHAN_MAX_MODS];
-    size_t mod_mem_used;
+    size_t mod_mem_used; /* committed across all modules */
     struct darshan_core_name_record_ref *name_hash;
     size_t name_mem_used;
-    double wtime_offset;
-    char *comp_buf;
+    struct darshan_fc_name_state name_fc;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     char mmap_log_name[PATH_MAX];
 #endif
 #ifdef HAVE_MPI
     MPI_Comm mpi_comm;
+    MPI_Comm node_comm; /* processes on this node, if aggregating per node */
+    MPI_Comm log_comm;  /* processes that write the log, or MPI_COMM_NULL */
 #endif
     int pid;
 };
@@ -93,6 +93,20 @@ typedef void (*darshan_module_redux)(
     darshan_record_id *shared_recs, /* list of shared data record ids */
     int shared_rec_count /* count of shared data records */
 );
+/*
+ * module developers _may_ also reduce records shared by only a subset of
+ * processes, by setting 'mod_subset_redux_func' to a 'darshan_module_redux'
+ * function that can be called repeatedly: once for the records shared by
+ * all processes (if any), then once for each group of processes sharing
+ * some records, with a communicator holding just that group. Processes
+ * call it for the groups they belong to in the same order, and rank 0 of
+ * the given communicator should keep the reduced records. This is a
+ * separate hook, rather than a second use of 'mod_redux_func', because
+ * existing reduction functions may assume they are given the job's
+ * communicator (e.g., that its rank 0 is the job's rank 0); modules opt in
+ * by pointing it at a reduction function that makes no such assumption,
+ * which may well be their 'mod_redux_func' itself.
+ */
 #endif
 /*
  * module developers _must_ define a 'darshan_module_output' function
@@ -109,13 +123,28 @@ typedef void (*darshan_module_output)(
  * runtime state (i.e., drop tracked file records and free all memory).
  */
 typedef void (*darshan_module_cleanup)(void);
+/*
+ * module developers _may_ define a 'darshan_module_snapshot' function to
+ * have their records included in the snapshots darshan-core periodically
+ * writes of a running process (see DARSHAN_SNAPSHOT_INTERVAL). It is called
+ * from a background thread, and should copy the module's records out of
+ * its buffer as they stand, allocating the copy with malloc(). Modules
+ * that do not define one are left out of snapshots.
+ */
+typedef void (*darshan_module_snapshot)(
+    void *mod_buf, /* input parameter indicating module's buffer address */
+    void **snap_buf, /* output parameter to save the copy's address */
+    int *snap_buf_sz /* output parameter to save the copy's size */
+);
 typedef struct darshan_module_funcs
 {
 #ifdef HAVE_MPI
     darshan_module_redux mod_redux_func;
+    darshan_module_redux mod_subset_redux_func;
 #endif
     darshan_module_output mod_output_func;
     darshan_module_cleanup mod_cleanup_func;
+    darshan_module_snapshot mod_snapshot_func;
 } darshan_module_funcs;
 
 /* stores FS info from statfs calls for a given mount point */
@@ -153,11 +182,16 @@ void darshan_instrument_fs_data(
  * shutdown functionality (including a possible data reduction step when
  * using MPI). 'inout_mod_buf_size' is an input/output argument, with it
  * being set to the requested amount of module memory on input, and set to
- * the amount allocated by darshan-core on output. If Darshan is built with
- * MPI support, 'rank' is a pointer to an integer which will contain the
- * calling process's MPI rank on return. If given, 'sys_mem_alignment' is a
- * pointer to an integer which will contain the memory alignment value Darshan
- * was configured with on return.
+ * the amount darshan-core reserved for the module on output, bounded by
+ * what is left of the shared memory quota. Memory is only committed as the
+ * module registers records and is returned to the quota when the module
+ * unregisters. A module may grow past its reservation, but only into memory
+ * not reserved for other modules, and not into the share of the quota held
+ * back for modules yet to register. If Darshan is built with MPI support,
+ * 'rank' is a pointer to an integer which will contain the calling
+ * process's MPI rank on return. If given, 'sys_mem_alignment' is a pointer
+ * to an integer which will contain the memory alignment value Darshan was
+ * configured with on return.
  */
 void darshan_core_register_module(
     darshan_module_id mod_id,
@@ -206,10 +240,14 @@ void *darshan_core_register_record(
 
 /* darshan_core_lookup_record_name()
  *
- * Looks up the name associated with a given Darshan record ID.
+ * Looks up the name associated with a given Darshan record ID, copying it
+ * into the buffer 'name' of size 'name_len'. Returns 0 on success, or -1
+ * if the record has no name or the name does not fit in the buffer.
  */
-char *darshan_core_lookup_record_name(
-    darshan_record_id rec_id);
+int darshan_core_lookup_record_name(
+    darshan_record_id rec_id,
+    char *name,
+    int name_len);
 
 /* darshan_core_wtime()
  *
@@ -244,4 +282,55 @@ int darshan_core_excluded_path(
  */
 int darshan_core_disabled_instrumentation(void);
 
+/* darshan_core_sample_period()
+ *
+ * Returns the period N with which modules that support sampling should
+ * run the more expensive parts of their instrumentation (i.e., on 1 in N
+ * operations), or 1 if sampling is disabled. If 'random_flag' is given,
+ * it is set to 1 if operations should instead be sampled on a randomized
+ * schedule with the same average period.
+ */
+int darshan_core_sample_period(
+    int *random_flag);
+
+/* darshan_core_activity_bin_width()
+ *
+ * Returns the width (in seconds) that the activity bins of new records
+ * start out with, or 0 if activity bins are disabled.
+ */
+double darshan_core_activity_bin_width(
+    void);
+
+/* darshan_core_mark_sampled()
+ *
+ * Records in the log that module 'mod_id' skipped the sampled parts of
+ * its instrumentation on some operations, so that readers know which of
+ * its counters are estimates.
+ */
+void darshan_core_mark_sampled(
+    darshan_module_id mod_id);
+
+/* darshan_core_mark_estimated()
+ *
+ * Records in the log that some common value counts of module 'mod_id'
+ * are estimates, as more distinct values occurred in one of its records
+ * than could be tracked exactly.
+ */
+void darshan_core_mark_estimated(
+    darshan_module_id mod_id);
+
+/* darshan_core_register_record_layout()
+ *
+ * Tells darshan-core that each record of module 'mod_id' is a
+ * darshan_base_record followed by 'counter_cnt' int64_t counters and
+ * 'fcounter_cnt' double counters, and nothing else, allowing it to store
+ * the records sparse encoded or in columns in the log (see
+ * DARSHAN_SPARSE_RECORDS and DARSHAN_COLUMNAR_RECORDS). Readers of the log
+ * must then decode them in the module's logutils.
+ */
+void darshan_core_register_record_layout(
+    darshan_module_id mod_id,
+    int counter_cnt,
+    int fcounter_cnt);
+
 #endif /* __DARSHAN_H */
@@ -10,15 +10,27 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <limits.h>
-#include <search.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "uthash.h"
 
 #include "darshan.h"
 
+DARSHAN_FORWARD_DECL(chdir, int, (const char *path));
+DARSHAN_FORWARD_DECL(fchdir, int, (int fd));
+
+/* cached copy of the current working directory, used to convert relative
+ * paths to absolute paths without calling getcwd() on every open. The cache
+ * is invalidated by the chdir() and fchdir() wrappers below.
+ */
+static char darshan_cwd[PATH_MAX];
+static size_t darshan_cwd_len = 0; /* 0 if the cache is invalid */
+static pthread_mutex_t darshan_cwd_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* track opaque record referencre using a hash link */
 struct darshan_record_ref_tracker
 {
@@ -121,65 +133,380 @@ void darshan_iter_record_refs(void *hash_head, void (*iter_action)(void *, void
     return;
 }
 
-char* darshan_clean_file_path(const char* path)
+/* integer handle table: a growable array of record reference pointers
+ * indexed directly by handle value
+ */
+struct darshan_handle_table
 {
-    char* newpath = NULL;
-    char* cwd = NULL;
-    char* filter = NULL;
+    int size;
+    void *refs[];
+};
 
-    /* NOTE: the last check in this if statement is for path strings that
-     * begin with the '<' character.  We assume that these are special
-     * reserved paths used by Darshan, like <STDIN>.
+/* initial number of slots in a handle table */
+#define DARSHAN_DEF_HANDLE_TABLE_SIZE 64
+
+void *darshan_lookup_handle_ref(void *handle_table, int handle)
+{
+    struct darshan_handle_table *table =
+        (struct darshan_handle_table *)handle_table;
+
+    if(!table || handle < 0 || handle >= table->size)
+        return(NULL);
+
+    return(table->refs[handle]);
+}
+
+int darshan_add_handle_ref(void **handle_table_p, int handle, void *rec_ref_p)
+{
+    struct darshan_handle_table *table =
+        *(struct darshan_handle_table **)handle_table_p;
+    struct darshan_handle_table *new_table;
+    int old_size = table ? table->size : 0;
+    int new_size;
+
+    if(handle < 0)
+        return(0);
+
+    if(handle >= old_size)
+    {
+        /* grow the table to the next power of two that fits the handle */
+        new_size = old_size ? old_size : DARSHAN_DEF_HANDLE_TABLE_SIZE;
+        while(handle >= new_size)
+            new_size *= 2;
+
+        new_table = realloc(table, sizeof(*table) + new_size * sizeof(void *));
+        if(!new_table)
+            return(0);
+        memset(&new_table->refs[old_size], 0,
+            (new_size - old_size) * sizeof(void *));
+        new_table->size = new_size;
+        table = new_table;
+        *handle_table_p = table;
+    }
+
+    table->refs[handle] = rec_ref_p;
+    return(1);
+}
+
+void *darshan_delete_handle_ref(void **handle_table_p, int handle)
+{
+    struct darshan_handle_table *table =
+        *(struct darshan_handle_table **)handle_table_p;
+    void *rec_ref_p;
+
+    if(!table || handle < 0 || handle >= table->size)
+        return(NULL);
+
+    rec_ref_p = table->refs[handle];
+    table->refs[handle] = NULL;
+
+    return(rec_ref_p);
+}
+
+void darshan_clear_handle_refs(void **handle_table_p)
+{
+    free(*handle_table_p);
+    *handle_table_p = NULL;
+
+    return;
+}
+
+/* pointer handle table: an open-addressing hash table with linear probing,
+ * keyed on pointer values. Deletions shift subsequent entries back so that
+ * no tombstones are needed.
+ */
+struct darshan_ptr_table_entry
+{
+    const void *ptr;
+    void *rec_ref_p;
+};
+
+struct darshan_ptr_table
+{
+    unsigned long mask; /* number of slots - 1 (a power of two) */
+    unsigned long count;
+    struct darshan_ptr_table_entry slots[];
+};
+
+/* initial number of slots in a pointer table */
+#define DARSHAN_DEF_PTR_TABLE_SIZE 64
+
+static inline unsigned long darshan_ptr_hash(const void *ptr,
+    unsigned long mask)
+{
+    /* multiplicative (Fibonacci) hashing, after dropping the low order bits
+     * that are always zero due to allocation alignment
      */
-    if(!path || strlen(path) < 1 || path[0] == '<')
+    return((((uintptr_t)ptr >> 4) * 11400714819323198485ull) >> 32 & mask);
+}
+
+static struct darshan_ptr_table_entry *darshan_ptr_table_find(
+    struct darshan_ptr_table *table, const void *ptr)
+{
+    unsigned long i;
+
+    for(i = darshan_ptr_hash(ptr, table->mask); table->slots[i].ptr;
+        i = (i + 1) & table->mask)
+    {
+        if(table->slots[i].ptr == ptr)
+            return(&table->slots[i]);
+    }
+
+    return(NULL);
+}
+
+void *darshan_lookup_ptr_ref(void *ptr_table, const void *ptr)
+{
+    struct darshan_ptr_table *table = (struct darshan_ptr_table *)ptr_table;
+    struct darshan_ptr_table_entry *entry;
+
+    if(!table || !ptr)
         return(NULL);
 
-    if(path[0] == '/')
+    entry = darshan_ptr_table_find(table, ptr);
+    return(entry ? entry->rec_ref_p : NULL);
+}
+
+int darshan_add_ptr_ref(void **ptr_table_p, const void *ptr, void *rec_ref_p)
+{
+    struct darshan_ptr_table *table =
+        *(struct darshan_ptr_table **)ptr_table_p;
+    struct darshan_ptr_table *new_table;
+    struct darshan_ptr_table_entry *entry;
+    unsigned long new_size;
+    unsigned long i, j;
+
+    if(!ptr)
+        return(0);
+
+    if(table)
     {
-        /* it is already an absolute path */
-        newpath = malloc(strlen(path)+1);
-        if(newpath)
+        entry = darshan_ptr_table_find(table, ptr);
+        if(entry)
         {
-            strcpy(newpath, path);
+            entry->rec_ref_p = rec_ref_p;
+            return(1);
         }
     }
-    else
+
+    /* keep the load factor at or below 1/2 */
+    if(!table || (table->count + 1) * 2 > table->mask + 1)
     {
-        /* handle relative path */
-        cwd = malloc(PATH_MAX);
-        if(cwd)
+        new_size = table ? (table->mask + 1) * 2 : DARSHAN_DEF_PTR_TABLE_SIZE;
+        new_table = calloc(1, sizeof(*new_table) +
+            new_size * sizeof(struct darshan_ptr_table_entry));
+        if(!new_table)
+            return(0);
+        new_table->mask = new_size - 1;
+
+        /* rehash existing entries into the new table */
+        if(table)
         {
-            if(getcwd(cwd, PATH_MAX))
+            for(i = 0; i <= table->mask; i++)
             {
-                newpath = malloc(strlen(path) + strlen(cwd) + 2);
-                if(newpath)
-                {
-                    sprintf(newpath, "%s/%s", cwd, path);
-                }
+                if(!table->slots[i].ptr)
+                    continue;
+                for(j = darshan_ptr_hash(table->slots[i].ptr, new_table->mask);
+                    new_table->slots[j].ptr; j = (j + 1) & new_table->mask);
+                new_table->slots[j] = table->slots[i];
             }
-            free(cwd);
+            new_table->count = table->count;
+            free(table);
+        }
+        table = new_table;
+        *ptr_table_p = table;
+    }
+
+    for(i = darshan_ptr_hash(ptr, table->mask); table->slots[i].ptr;
+        i = (i + 1) & table->mask);
+    table->slots[i].ptr = ptr;
+    table->slots[i].rec_ref_p = rec_ref_p;
+    table->count++;
+
+    return(1);
+}
+
+void *darshan_delete_ptr_ref(void **ptr_table_p, const void *ptr)
+{
+    struct darshan_ptr_table *table =
+        *(struct darshan_ptr_table **)ptr_table_p;
+    struct darshan_ptr_table_entry *entry;
+    unsigned long i, j, home;
+    void *rec_ref_p;
+
+    if(!table || !ptr)
+        return(NULL);
+
+    entry = darshan_ptr_table_find(table, ptr);
+    if(!entry)
+        return(NULL);
+    rec_ref_p = entry->rec_ref_p;
+
+    /* shift back any subsequent entries in the probe sequence that would
+     * otherwise become unreachable
+     */
+    i = entry - table->slots;
+    for(j = (i + 1) & table->mask; table->slots[j].ptr; j = (j + 1) & table->mask)
+    {
+        home = darshan_ptr_hash(table->slots[j].ptr, table->mask);
+        /* move entry j to the hole at i unless its home slot lies
+         * cyclically in (i, j]
+         */
+        if((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            table->slots[i] = table->slots[j];
+            i = j;
         }
     }
+    table->slots[i].ptr = NULL;
+    table->slots[i].rec_ref_p = NULL;
+    table->count--;
+
+    return(rec_ref_p);
+}
+
+void darshan_clear_ptr_refs(void **ptr_table_p)
+{
+    free(*ptr_table_p);
+    *ptr_table_p = NULL;
+
+    return;
+}
+
+static void darshan_invalidate_cwd(void)
+{
+    pthread_mutex_lock(&darshan_cwd_mutex);
+    darshan_cwd_len = 0;
+    pthread_mutex_unlock(&darshan_cwd_mutex);
+
+    return;
+}
+
+/* copies the (cached) current working directory into buf, returning its
+ * length, or 0 if it is unavailable or does not fit.
+ * NOTE: the cache is only invalidated by the chdir() and fchdir() wrappers,
+ * so it goes stale if the working directory is changed in a way Darshan
+ * does not intercept (e.g., a direct system call, or a call bound before
+ * Darshan was loaded). Relative paths are then resolved against the old
+ * directory.
+ */
+static size_t darshan_get_cwd(char *buf, size_t buf_len)
+{
+    size_t len;
+
+    pthread_mutex_lock(&darshan_cwd_mutex);
+    if(!darshan_cwd_len && getcwd(darshan_cwd, sizeof(darshan_cwd)))
+        darshan_cwd_len = strlen(darshan_cwd);
+    len = darshan_cwd_len;
+    if(len && len < buf_len)
+        memcpy(buf, darshan_cwd, len + 1);
+    else
+        len = 0;
+    pthread_mutex_unlock(&darshan_cwd_mutex);
 
-    if(!newpath)
+    return(len);
+}
+
+int DARSHAN_DECL(chdir)(const char *path)
+{
+    int ret;
+
+    MAP_OR_FAIL(chdir);
+
+    ret = __real_chdir(path);
+    if(ret == 0)
+        darshan_invalidate_cwd();
+
+    return(ret);
+}
+
+int DARSHAN_DECL(fchdir)(int fd)
+{
+    int ret;
+
+    MAP_OR_FAIL(fchdir);
+
+    ret = __real_fchdir(fd);
+    if(ret == 0)
+        darshan_invalidate_cwd();
+
+    return(ret);
+}
+
+char* darshan_clean_file_path_buf(const char* path, char* buf, size_t buf_len)
+{
+    const char *p = path;
+    const char *comp;
+    size_t comp_len;
+    size_t len = 0;
+
+    /* NOTE: the last check in this if statement is for path strings that
+     * begin with the '<' character.  We assume that these are special
+     * reserved paths used by Darshan, like <STDIN>.
+     */
+    if(!path || path[0] == '\0' || path[0] == '<' || buf_len < 2)
         return(NULL);
 
-    /* filter out any double slashes */
-    while((filter = strstr(newpath, "//")))
+    if(path[0] != '/')
     {
-        /* shift down one character */
-        memmove(filter, &filter[1], (strlen(&filter[1]) + 1));
+        /* handle relative path by starting from the cwd, which is already
+         * in canonical form
+         */
+        len = darshan_get_cwd(buf, buf_len);
+        if(!len)
+            return(NULL);
+        if(len == 1)
+            len = 0; /* cwd is "/" */
     }
 
-    /* filter out any /./ instances */
-    while((filter = strstr(newpath, "/./")))
+    /* append each component of the path, skipping empty and "." components.
+     * ".." components are kept as is, since the previous component may be a
+     * symbolic link, whose parent can't be determined without resolving it
+     */
+    while(*p)
     {
-        /* shift down two characters */
-        memmove(filter, &filter[2], (strlen(&filter[2]) + 1));
+        while(*p == '/')
+            p++;
+        if(*p == '\0')
+            break;
+
+        comp = p;
+        while(*p && *p != '/')
+            p++;
+        comp_len = p - comp;
+
+        if(comp_len == 1 && comp[0] == '.')
+            continue;
+
+        if(len + comp_len + 2 > buf_len)
+            return(NULL);
+        buf[len++] = '/';
+        memcpy(&buf[len], comp, comp_len);
+        len += comp_len;
     }
 
-    /* return result */
-    return(newpath);
+    /* preserve a trailing slash, if any */
+    if(len == 0)
+        buf[len++] = '/';
+    else if(p[-1] == '/')
+    {
+        if(len + 2 > buf_len)
+            return(NULL);
+        buf[len++] = '/';
+    }
+    buf[len] = '\0';
+
+    return(buf);
+}
+
+char* darshan_clean_file_path(const char* path)
+{
+    char buf[PATH_MAX];
+
+    if(!darshan_clean_file_path_buf(path, buf, PATH_MAX))
+        return(NULL);
+
+    return(strdup(buf));
 }
 
 /* compare function for sorting file records according to their 
@@ -213,58 +540,520 @@ void darshan_record_sort(void *rec_buf, int rec_count, int rec_size)
     return;
 }
 
-static int darshan_common_vals_compare(const void *a_p, const void *b_p)
+int darshan_record_compact(void *rec_buf, int rec_count, int rec_size)
+{
+    struct darshan_base_record *rec;
+
+    qsort(rec_buf, rec_count, rec_size, darshan_base_record_compare);
+    while(rec_count > 0)
+    {
+        rec = (struct darshan_base_record *)
+            ((char *)rec_buf + ((rec_count - 1) * rec_size));
+        if(rec->rank != DARSHAN_REDUCED_RECORD_RANK)
+            break;
+        rec_count--;
+    }
+
+    return(rec_count);
+}
+
+/* slabs carve fixed-size objects out of chunks of this size */
+#define DARSHAN_SLAB_CHUNK_SIZE (64 * 1024)
+
+/* chunks start with a header linking them together, padded so that the
+ * objects that follow are suitably aligned
+ */
+#define DARSHAN_SLAB_CHUNK_HDR_SIZE 16
+#define DARSHAN_SLAB_OBJ_ALIGN 8
+
+struct darshan_slab
 {
-    const struct darshan_common_val_counter* a = a_p;
-    const struct darshan_common_val_counter* b = b_p;
+    pthread_mutex_t mutex;
+    const char *name;
+    size_t obj_size;
+    size_t chunk_size;
+    void *chunks;       /* list of chunks, linked through their headers */
+    char *next_obj;     /* next never-allocated object in the newest chunk */
+    char *chunk_end;
+    void *free_list;    /* freed objects, linked through their first word */
+};
+
+/* total memory allocated by all slabs, in bytes */
+static size_t darshan_slab_mem = 0;
+
+/* common value counters for all modules are allocated from a shared slab,
+ * created on first use and destroyed, along with every counter in it, by
+ * darshan_common_val_slabs_destroy()
+ */
+static struct darshan_slab *darshan_common_val_slab = NULL;
+static pthread_mutex_t darshan_common_val_slab_mutex =
+    PTHREAD_MUTEX_INITIALIZER;
 
-    return(memcmp(a->vals, b->vals, sizeof(*(a->vals)) * a->nvals));
+struct darshan_slab *darshan_slab_create(const char *name, size_t obj_size)
+{
+    struct darshan_slab *slab;
+
+    slab = malloc(sizeof(*slab));
+    if(!slab)
+        return(NULL);
+    memset(slab, 0, sizeof(*slab));
+
+    pthread_mutex_init(&slab->mutex, NULL);
+    slab->name = name;
+    if(obj_size < sizeof(void *))
+        obj_size = sizeof(void *);
+    slab->obj_size = (obj_size + DARSHAN_SLAB_OBJ_ALIGN - 1) &
+        ~((size_t)DARSHAN_SLAB_OBJ_ALIGN - 1);
+    slab->chunk_size = DARSHAN_SLAB_CHUNK_SIZE;
+    if(slab->chunk_size < DARSHAN_SLAB_CHUNK_HDR_SIZE + slab->obj_size)
+        slab->chunk_size = DARSHAN_SLAB_CHUNK_HDR_SIZE + slab->obj_size;
+
+    return(slab);
 }
 
-struct darshan_common_val_counter *darshan_track_common_val_counters(
-    void **common_val_root, int64_t *vals, int nvals, int *common_val_count)
+void *darshan_slab_alloc(struct darshan_slab *slab)
 {
-    struct darshan_common_val_counter* counter;
-    struct darshan_common_val_counter* found = NULL;
-    struct darshan_common_val_counter tmp_counter;
-    void* tmp;
+    void *obj;
+    void *chunk;
+
+    pthread_mutex_lock(&slab->mutex);
+    if(slab->free_list)
+    {
+        obj = slab->free_list;
+        slab->free_list = *(void **)obj;
+    }
+    else
+    {
+        if(slab->next_obj + slab->obj_size > slab->chunk_end)
+        {
+            chunk = malloc(slab->chunk_size);
+            if(!chunk)
+            {
+                pthread_mutex_unlock(&slab->mutex);
+                return(NULL);
+            }
+            *(void **)chunk = slab->chunks;
+            slab->chunks = chunk;
+            slab->next_obj = (char *)chunk + DARSHAN_SLAB_CHUNK_HDR_SIZE;
+            slab->chunk_end = (char *)chunk + slab->chunk_size;
+            __atomic_add_fetch(&darshan_slab_mem, slab->chunk_size,
+                __ATOMIC_RELAXED);
+        }
+        obj = slab->next_obj;
+        slab->next_obj += slab->obj_size;
+    }
+    pthread_mutex_unlock(&slab->mutex);
+
+    memset(obj, 0, slab->obj_size);
+    return(obj);
+}
+
+void darshan_slab_free(struct darshan_slab *slab, void *obj)
+{
+    if(!obj)
+        return;
+
+    pthread_mutex_lock(&slab->mutex);
+    *(void **)obj = slab->free_list;
+    slab->free_list = obj;
+    pthread_mutex_unlock(&slab->mutex);
+
+    return;
+}
+
+void darshan_slab_destroy(struct darshan_slab *slab)
+{
+    void *chunk, *next;
+
+    if(!slab)
+        return;
+
+    for(chunk = slab->chunks; chunk; chunk = next)
+    {
+        next = *(void **)chunk;
+        free(chunk);
+        __atomic_sub_fetch(&darshan_slab_mem, slab->chunk_size,
+            __ATOMIC_RELAXED);
+    }
+    pthread_mutex_destroy(&slab->mutex);
+    free(slab);
+
+    return;
+}
+
+size_t darshan_slab_mem_usage()
+{
+    return(__atomic_load_n(&darshan_slab_mem, __ATOMIC_RELAXED));
+}
+
+/* common value counters are tracked using the Space-Saving algorithm
+ * (Metwally et al., "Efficient Computation of Frequent and Top-k Elements
+ * in Data Streams"): at most DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT values
+ * are tracked at once, and a value that is not tracked replaces the
+ * least frequent tracked value, inheriting its count. Counts are never
+ * underestimated, and are overestimated by at most the number of
+ * observations divided by the number of tracked values, so any value
+ * occuring more often than that is guaranteed to be tracked.
+ */
+#define DARSHAN_COMMON_VAL_INDEX_SIZE (2 * DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
+
+struct darshan_common_val_sketch
+{
+    int count;
+    /* counter ids, sorted by ascending frequency */
+    unsigned char order[DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT];
+    /* position of each counter id in 'order' */
+    unsigned char pos[DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT];
+    /* open-addressing hash index of counter ids (+1, 0 is empty) */
+    unsigned char index[DARSHAN_COMMON_VAL_INDEX_SIZE];
+    struct darshan_common_val_counter *counters[DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT];
+};
+
+static struct darshan_slab *darshan_common_val_sketch_slab = NULL;
+
+/* returns 0 once the common value slabs exist, -1 if they can't be
+ * created. the counter slab is published last, so seeing it set means
+ * both are ready.
+ */
+static int darshan_common_val_slab_init(void)
+{
+    int ret = 0;
+
+    if(__atomic_load_n(&darshan_common_val_slab, __ATOMIC_ACQUIRE))
+        return(0);
+
+    pthread_mutex_lock(&darshan_common_val_slab_mutex);
+    if(!darshan_common_val_slab)
+    {
+        if(!darshan_common_val_sketch_slab)
+            darshan_common_val_sketch_slab = darshan_slab_create(
+                "common_val_sketches", sizeof(struct darshan_common_val_sketch));
+        if(darshan_common_val_sketch_slab)
+            __atomic_store_n(&darshan_common_val_slab, darshan_slab_create(
+                "common_vals", sizeof(struct darshan_common_val_counter)),
+                __ATOMIC_RELEASE);
+        if(!darshan_common_val_slab)
+            ret = -1;
+    }
+    pthread_mutex_unlock(&darshan_common_val_slab_mutex);
+
+    return(ret);
+}
+
+void darshan_common_val_slabs_destroy(void)
+{
+    pthread_mutex_lock(&darshan_common_val_slab_mutex);
+    darshan_slab_destroy(darshan_common_val_slab);
+    darshan_slab_destroy(darshan_common_val_sketch_slab);
+    __atomic_store_n(&darshan_common_val_slab, NULL, __ATOMIC_RELEASE);
+    darshan_common_val_sketch_slab = NULL;
+    pthread_mutex_unlock(&darshan_common_val_slab_mutex);
+
+    return;
+}
+
+void darshan_clear_common_val_counters(void **common_val_root)
+{
+    struct darshan_common_val_sketch *sketch = *common_val_root;
+    int i;
+
+    if(sketch)
+    {
+        for(i = 0; i < sketch->count; i++)
+            darshan_slab_free(darshan_common_val_slab, sketch->counters[i]);
+        darshan_slab_free(darshan_common_val_sketch_slab, sketch);
+    }
+    *common_val_root = NULL;
+
+    return;
+}
+
+void darshan_iter_common_val_counters(void *common_val_root,
+    void (*iter_action)(struct darshan_common_val_counter *, void *),
+    void *user_ptr)
+{
+    struct darshan_common_val_sketch *sketch = common_val_root;
+    int i;
+
+    if(!sketch)
+        return;
+
+    /* visit counters in order of decreasing frequency */
+    for(i = sketch->count - 1; i >= 0; i--)
+        iter_action(sketch->counters[sketch->order[i]], user_ptr);
+
+    return;
+}
+
+static inline unsigned int darshan_common_val_hash(int64_t *vals, int nvals)
+{
+    uint64_t h = 0;
+    int i;
+
+    for(i = 0; i < nvals; i++)
+        h = (h ^ (uint64_t)vals[i]) * 0x9E3779B97F4A7C15ULL;
+
+    /* the top bits of the product are the best mixed, so keep as many of
+     * them as it takes to index the table
+     */
+    return((unsigned int)(h >> (64 -
+        __builtin_ctz(DARSHAN_COMMON_VAL_INDEX_SIZE))) &
+        (DARSHAN_COMMON_VAL_INDEX_SIZE - 1));
+}
+
+/* returns the index slot holding the given values, or the empty slot
+ * where they would be inserted
+ */
+static int darshan_common_val_find(struct darshan_common_val_sketch *sketch,
+    int64_t *vals, int nvals)
+{
+    struct darshan_common_val_counter *counter;
+    int i;
+
+    for(i = darshan_common_val_hash(vals, nvals); sketch->index[i];
+        i = (i + 1) & (DARSHAN_COMMON_VAL_INDEX_SIZE - 1))
+    {
+        counter = sketch->counters[sketch->index[i] - 1];
+        if(counter->nvals == nvals &&
+           !memcmp(counter->vals, vals, sizeof(*vals) * nvals))
+            break;
+    }
+
+    return(i);
+}
+
+/* removes the given index slot, shifting back later entries in the same
+ * probe sequence so that no lookup stops early on the hole
+ */
+static void darshan_common_val_unindex(struct darshan_common_val_sketch *sketch,
+    int i)
+{
+    struct darshan_common_val_counter *counter;
+    int j, home;
+
+    for(j = (i + 1) & (DARSHAN_COMMON_VAL_INDEX_SIZE - 1); sketch->index[j];
+        j = (j + 1) & (DARSHAN_COMMON_VAL_INDEX_SIZE - 1))
+    {
+        counter = sketch->counters[sketch->index[j] - 1];
+        home = darshan_common_val_hash(counter->vals, counter->nvals);
+        /* move the entry into the hole unless its home slot lies
+         * cyclically in (i, j]
+         */
+        if(((j - home) & (DARSHAN_COMMON_VAL_INDEX_SIZE - 1)) >=
+           ((j - i) & (DARSHAN_COMMON_VAL_INDEX_SIZE - 1)))
+        {
+            sketch->index[i] = sketch->index[j];
+            i = j;
+        }
+    }
+    sketch->index[i] = 0;
+
+    return;
+}
+
+/* adds 'freq' to the given counter and restores the frequency order */
+static void darshan_common_val_inc(struct darshan_common_val_sketch *sketch,
+    int id, int freq)
+{
+    int new_freq = sketch->counters[id]->freq + freq;
+    int p = sketch->pos[id];
+    int lo, hi, mid;
+
+    /* find the first position past p holding a count of at least the
+     * new frequency; everything in between moves down one slot
+     */
+    lo = p + 1;
+    hi = sketch->count;
+    while(lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if(sketch->counters[sketch->order[mid]]->freq < new_freq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    lo--;
+
+    if(freq == 1 && lo > p)
+    {
+        /* the counters in (p, lo] all have this counter's old frequency,
+         * so a single swap keeps the order sorted
+         */
+        sketch->order[p] = sketch->order[lo];
+        sketch->pos[sketch->order[p]] = p;
+    }
+    else
+    {
+        for(; p < lo; p++)
+        {
+            sketch->order[p] = sketch->order[p + 1];
+            sketch->pos[sketch->order[p]] = p;
+        }
+    }
+    sketch->order[lo] = id;
+    sketch->pos[id] = lo;
+    sketch->counters[id]->freq = new_freq;
+
+    return;
+}
+
+struct darshan_common_val_counter *darshan_add_common_val_counters(
+    void **common_val_root, int64_t *vals, int nvals, int freq,
+    int *common_val_count)
+{
+    struct darshan_common_val_sketch *sketch = *common_val_root;
+    struct darshan_common_val_counter *counter;
+    int i, id;
 
     assert(nvals <= DARSHAN_COMMON_VAL_MAX_NCOUNTERS);
 
+    if(darshan_common_val_slab_init() < 0)
+        return(NULL);
+
+    if(!sketch)
+    {
+        sketch = darshan_slab_alloc(darshan_common_val_sketch_slab);
+        if(!sketch)
+            return(NULL);
+        *common_val_root = sketch;
+    }
+
     /* check to see if this val is already recorded */
-    memcpy(tmp_counter.vals, vals, sizeof(*vals) * nvals);
-    tmp_counter.nvals = nvals;
-    tmp_counter.freq = 1;
-    tmp = tfind(&tmp_counter, common_val_root, darshan_common_vals_compare);
-    if(tmp)
+    i = darshan_common_val_find(sketch, vals, nvals);
+    if(sketch->index[i])
     {
-        found = *(struct darshan_common_val_counter**)tmp;
-        found->freq++;
+        id = sketch->index[i] - 1;
     }
-    else if(*common_val_count < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
+    else if(sketch->count < DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT)
     {
         /* we can add a new one as long as we haven't hit the limit */
-        counter = malloc(sizeof(*counter));
+        counter = darshan_slab_alloc(darshan_common_val_slab);
         if(!counter)
-        {
             return(NULL);
-        }
 
         memcpy(counter->vals, vals, sizeof(*vals) * nvals);
         counter->nvals = nvals;
-        counter->freq = 1;
 
-        tmp = tsearch(counter, common_val_root, darshan_common_vals_compare);
-        found = *(struct darshan_common_val_counter**)tmp;
-        /* if we get a new answer out here we are in trouble; this was
-         * already checked with the tfind()
-         */
-        assert(found == counter);
+        /* new counters start out least frequent */
+        id = sketch->count++;
+        memmove(&sketch->order[1], &sketch->order[0], id);
+        sketch->order[0] = id;
+        sketch->pos[id] = 0;
+        for(i = 1; i <= id; i++)
+            sketch->pos[sketch->order[i]] = i;
+        sketch->counters[id] = counter;
+        sketch->index[darshan_common_val_find(sketch, vals, nvals)] = id + 1;
 
         (*common_val_count)++;
     }
+    else
+    {
+        /* otherwise, replace the least frequent value, counting the
+         * occurences of the evicted value as potential error
+         */
+        id = sketch->order[0];
+        counter = sketch->counters[id];
+        darshan_common_val_unindex(sketch,
+            darshan_common_val_find(sketch, counter->vals, counter->nvals));
+        memcpy(counter->vals, vals, sizeof(*vals) * nvals);
+        counter->nvals = nvals;
+        counter->err = counter->freq;
+        sketch->index[darshan_common_val_find(sketch, vals, nvals)] = id + 1;
+    }
+
+    darshan_common_val_inc(sketch, id, freq);
+
+    return(sketch->counters[id]);
+}
+
+struct darshan_common_val_counter *darshan_track_common_val_counters(
+    void **common_val_root, int64_t *vals, int nvals, int *common_val_count)
+{
+    return(darshan_add_common_val_counters(common_val_root, vals, nvals, 1,
+        common_val_count));
+}
+
+/* sum each run of 'factor' adjacent activity bins into a single bin */
+static void darshan_activity_bins_rescale(int64_t *bins, int64_t factor)
+{
+    int64_t sum;
+    int i, j;
+
+    /* a factor of DARSHAN_ACTIVITY_BINS already merges every bin */
+    if(factor > DARSHAN_ACTIVITY_BINS)
+        factor = DARSHAN_ACTIVITY_BINS;
+
+    /* bin i only reads from bins at or after i*factor, so this can be
+     * done in place
+     */
+    for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
+    {
+        sum = 0;
+        for(j = i * factor; j < (i + 1) * factor && j < DARSHAN_ACTIVITY_BINS; j++)
+            sum += bins[j];
+        bins[i] = sum;
+    }
+
+    return;
+}
+
+void darshan_activity_bins_coarsen(int64_t *read_bins, int64_t *write_bins,
+    double *width, double tm)
+{
+    double new_width = *width;
+    int64_t factor;
+
+    while(tm >= new_width * DARSHAN_ACTIVITY_BINS)
+        new_width *= 2;
+    factor = (int64_t)(new_width / *width + 0.5);
+    if(factor <= 1)
+        return;
+
+    darshan_activity_bins_rescale(read_bins, factor);
+    darshan_activity_bins_rescale(write_bins, factor);
+    *width = new_width;
+
+    return;
+}
+
+void darshan_activity_bins_merge(int64_t *read_bins, int64_t *write_bins,
+    double *width, const int64_t *in_read_bins, const int64_t *in_write_bins,
+    double in_width)
+{
+    int64_t factor = 1;
+    int i;
+
+    if(in_width <= 0)
+        return;
+
+    if(*width <= 0)
+    {
+        memcpy(read_bins, in_read_bins, DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        memcpy(write_bins, in_write_bins, DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        *width = in_width;
+        return;
+    }
+
+    if(in_width > *width)
+    {
+        /* coarsen our bins to the width of the input bins */
+        darshan_activity_bins_rescale(read_bins, (int64_t)(in_width / *width + 0.5));
+        darshan_activity_bins_rescale(write_bins, (int64_t)(in_width / *width + 0.5));
+        *width = in_width;
+    }
+    else
+        factor = (int64_t)(*width / in_width + 0.5);
+    if(factor > DARSHAN_ACTIVITY_BINS)
+        factor = DARSHAN_ACTIVITY_BINS;
 
-    return(found);
+    /* add the input bins, merging runs of them if they are finer */
+    for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
+    {
+        read_bins[i / factor] += in_read_bins[i];
+        write_bins[i / factor] += in_write_bins[i];
+    }
+
+    return;
 }
 
 #ifdef HAVE_MPI
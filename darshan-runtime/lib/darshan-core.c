@@ -18,6 +18,8 @@
 #include <time.h>
 #include <limits.h>
 #include <pthread.h>
+#include <signal.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
 #include <dirent.h>
@@ -28,7 +30,16 @@
 #include <sys/time.h>
 #include <sys/vfs.h>
 #include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 #include <assert.h>
+#include <fnmatch.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define DARSHAN_HAVE_TSC
+#endif
 
 #ifdef HAVE_MPI
 #include <mpi.h>
@@ -55,11 +66,68 @@ static int my_rank = 0;
 static int nprocs = 1;
 static int darshan_mem_alignment = 1;
 static size_t darshan_mod_mem_quota = DARSHAN_MOD_MEM_MAX;
+/* every module's records live in a slot of address space large enough to
+ * hold the entire quota, which is only backed by memory (committed) in
+ * chunks as records are registered
+ */
+static size_t darshan_mod_mem_slot_size = 0;
+static size_t darshan_mod_mem_chunk_size = 0;
+static int darshan_sample_period = 1;
+static int darshan_sample_random = 0;
+static double darshan_activity_bin_width = DARSHAN_DEF_ACTIVITY_BIN_WIDTH;
+static enum darshan_comp_type darshan_log_comp_type = DARSHAN_ZLIB_COMP;
+static int darshan_sparse_records = 0;
+static int darshan_columnar_records = 0;
 static int orig_parent_pid = 0;
 static int parent_pid;
 
-static struct darshan_core_mnt_data mnt_data_array[DARSHAN_MAX_MNTS];
+/* the job start time and whether darshan-core is currently enabled are
+ * published once at initialization time, so that darshan_core_wtime() and
+ * darshan_core_disabled_instrumentation() can be called from every wrapper
+ * without acquiring darshan_core_mutex. The offset is only written before
+ * the enabled flag is set, so it is effectively immutable to readers that
+ * observe darshan-core as enabled.
+ */
+static double darshan_core_wtime_offset = 0;
+static int darshan_core_enabled = 0;
+
+/* timer backends available for generating runtime timestamps */
+/* a zlib stream (or zstd frame) being compressed into blocks of output,
+ * with its input fed to it piece by piece
+ */
+struct darshan_comp_stream
+{
+    struct darshan_comp_out *out;
+    z_stream zstream;
+#ifdef HAVE_LIBZSTD
+    ZSTD_CCtx *cctx;
+    ZSTD_outBuffer zout;
+#endif
+};
+
+enum darshan_core_timer_type
+{
+    DARSHAN_TIMER_DEFAULT = 0,  /* PMPI_Wtime() or gettimeofday() */
+    DARSHAN_TIMER_CLOCK,        /* clock_gettime(CLOCK_MONOTONIC) */
+    DARSHAN_TIMER_COARSE,       /* clock_gettime(CLOCK_MONOTONIC_COARSE) */
+    DARSHAN_TIMER_TSC,          /* calibrated time stamp counter */
+};
+
+/* the timer backend is selected once per process; forked children inherit
+ * the parent's selection (and TSC calibration) rather than redoing it
+ */
+static int darshan_core_timer = DARSHAN_TIMER_DEFAULT;
+static int darshan_core_timer_initialized = 0;
+#ifdef DARSHAN_HAVE_TSC
+static uint64_t darshan_core_tsc_base = 0;
+static double darshan_core_tsc_base_time = 0;
+static double darshan_core_tsc_sec_per_tick = 0;
+#endif
+
+static struct darshan_core_mnt_data *mnt_data_array = NULL;
 static int mnt_data_count = 0;
+static int mnt_data_max = 0;
+static struct darshan_path_trie mnt_data_trie = {0};
 
 /* paths prefixed with the following directories are not tracked by darshan */
 char* darshan_path_exclusions[] = {
@@ -84,8 +152,22 @@ char* darshan_path_inclusions[] = {
     NULL
 };
 
-/* allow users to override the path exclusions */
-char** user_darshan_path_exclusions = NULL;
+/* compiled form of the path exclusions and inclusions (or of the user
+ * provided exclusions, which override both) used by
+ * darshan_core_excluded_path()
+ */
+static struct darshan_path_trie darshan_path_trie = {0};
+
+/* periodic snapshots of this process's records, if enabled */
+static struct darshan_snapshot darshan_snapshot = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .stop_cond = PTHREAD_COND_INITIALIZER
+};
+
+/* set by darshan-core's own threads that do I/O while darshan-core is
+ * enabled, so that their I/O is not instrumented
+ */
+static __thread int darshan_core_thread_disabled = 0;
 
 #ifdef DARSHAN_BGQ
 extern void bgq_runtime_initialize();
@@ -123,51 +205,148 @@ static void *darshan_init_mmap_log(
 #endif
 static void darshan_log_record_hints_and_ver(
     struct darshan_core_runtime* core);
+static void darshan_snapshot_start(
+    struct darshan_core_runtime* core, int jobid);
+static void darshan_snapshot_stop(
+    void);
+static void *darshan_snapshot_thread(
+    void *arg);
+static int darshan_snapshot_write(
+    void);
+static int darshan_snapshot_append(
+    int fd, void **pointers, int *lengths, int count, uint64_t *inout_off);
+static void darshan_path_trie_build(
+    char *user_exclusions);
 static void darshan_get_exe_and_mounts(
     struct darshan_core_runtime *core, int argc, char **argv);
 static void darshan_fs_info_from_path(
     const char *path, struct darshan_fs_info *fs_info);
+static int darshan_fc_name_prefix(
+    struct darshan_fc_name_state *fc, const char *name, int name_len);
+static void darshan_fc_name_append(
+    struct darshan_fc_name_state *fc, struct darshan_fc_name_record *rec,
+    darshan_record_id rec_id, const char *name, int name_len,
+    int prefix_len);
 static int darshan_add_name_record_ref(
     struct darshan_core_runtime *core, darshan_record_id rec_id,
     const char *name, darshan_module_id mod_id);
+static int darshan_decode_name_record(
+    struct darshan_core_name_record_ref *ref, char *name, int name_len);
 static void darshan_get_user_name(
     char *user);
 #ifdef HAVE_MPI
 static void darshan_get_shared_records(
     struct darshan_core_runtime *core, darshan_record_id **shared_recs,
     int *shared_rec_cnt);
+static void darshan_get_subset_shared_records(
+    struct darshan_core_runtime *core, struct darshan_shared_group **groups,
+    int *group_cnt);
 #endif
 static void darshan_get_logfile_name(
     char* logfile_name, struct darshan_core_runtime* core);
+#ifdef HAVE_MPI
+static void darshan_log_split_writers(
+    struct darshan_core_runtime *core);
+static int darshan_log_append_all(
+    darshan_core_log_fh log_fh, MPI_Comm comm, void *buf, int count,
+    MPI_Datatype type, uint64_t buf_sz, int ret, uint64_t *inout_off);
+#endif
 static int darshan_log_open(
     char *logfile_name, struct darshan_core_runtime *core,
     darshan_core_log_fh *log_fh);
 static int darshan_log_write_job_record(
     darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    uint64_t *inout_off);
-static int darshan_log_write_name_record_hash(
-    darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    uint64_t *inout_off);
+    struct darshan_comp_region *region, uint64_t *inout_off);
+static void darshan_log_get_name_records(
+    struct darshan_core_runtime *core, void **name_rec_buf,
+    int *name_rec_buf_len);
 static int darshan_log_write_header(
     darshan_core_log_fh log_fh, struct darshan_core_runtime *core);
 static int darshan_log_append(
     darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off);
+    struct darshan_comp_region *region, uint64_t *inout_off);
+static int darshan_log_write_region(
+    darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
+    struct darshan_comp_region *regions, int region_idx, uint64_t *inout_off);
+static const char *darshan_log_region_name(
+    int region_idx);
 void darshan_log_close(
     darshan_core_log_fh log_fh);
 void darshan_log_finalize(
     char *logfile_name, double start_log_time);
-static int darshan_deflate_buffer(
-    void **pointers, int *lengths, int count, char *comp_buf,
-    int *comp_buf_length);
+static int darshan_comp_thread_count(
+    struct darshan_core_runtime *core);
+static void darshan_comp_pool_start(
+    struct darshan_comp_pool *pool, struct darshan_comp_region *regions,
+    int nthreads);
+static void darshan_comp_pool_queue(
+    struct darshan_comp_pool *pool, int region_idx);
+static void darshan_comp_pool_wait(
+    struct darshan_comp_pool *pool, int region_idx);
+static void darshan_comp_pool_stop(
+    struct darshan_comp_pool *pool);
+static void darshan_comp_pool_run_task(
+    struct darshan_comp_pool *pool, struct darshan_comp_task *task);
+static void *darshan_comp_worker(
+    void *arg);
+static void darshan_comp_region_free(
+    struct darshan_comp_region *region);
+static void darshan_comp_out_free(
+    struct darshan_comp_out *out);
+static int darshan_comp_out_pwrite(
+    int fd, struct darshan_comp_out *out, uint64_t off);
+#ifdef HAVE_MPI
+static void darshan_comp_region_type(
+    struct darshan_comp_region *region, void **buf, int *count,
+    MPI_Datatype *type);
+static void darshan_byte_type(
+    uint64_t sz, int *count, MPI_Datatype *type);
+#endif
+static int darshan_comp_region_pwrite(
+    int fd, struct darshan_comp_region *region, uint64_t off);
+static char *darshan_comp_out_grow(
+    struct darshan_comp_out *out);
+static int darshan_compress_buffer(
+    void **pointers, int *lengths, int count, struct darshan_comp_out *out);
+static int darshan_compress_records(
+    enum darshan_rec_encoding enc, struct darshan_core_module *mod,
+    void *buf, int buf_sz, struct darshan_comp_out *out);
+static int darshan_comp_stream_init(
+    struct darshan_comp_stream *stream, struct darshan_comp_out *out);
+static int darshan_comp_stream_feed(
+    struct darshan_comp_stream *stream, void *buf, int len, int final_flag);
+static void darshan_comp_stream_end(
+    struct darshan_comp_stream *stream);
+static int darshan_deflate_feed(
+    struct darshan_comp_stream *stream, void *buf, int len, int final_flag);
+#ifdef HAVE_LIBZSTD
+static int darshan_zstd_feed(
+    struct darshan_comp_stream *stream, void *buf, int len, int final_flag);
+#endif
+static int darshan_sparse_encode_records(
+    struct darshan_comp_stream *stream, struct darshan_core_module *mod,
+    void *buf, int buf_sz);
+static int darshan_columnar_encode_records(
+    struct darshan_comp_stream *stream, struct darshan_core_module *mod,
+    void *buf, int buf_sz);
 static void darshan_core_cleanup(
     struct darshan_core_runtime* core);
+static int darshan_core_grow_mod_mem(
+    struct darshan_core_module *mod, size_t rec_len);
+static void darshan_core_release_mod_mem(
+    struct darshan_core_module *mod);
+static void darshan_core_timer_init(void);
 static double darshan_core_wtime_absolute(void);
 static void darshan_core_fork_child_cb(void);
 
 #define DARSHAN_CORE_LOCK() pthread_mutex_lock(&darshan_core_mutex)
 #define DARSHAN_CORE_UNLOCK() pthread_mutex_unlock(&darshan_core_mutex)
 
+#define DARSHAN_CORE_SET_ENABLED(__flag) \
+    __atomic_store_n(&darshan_core_enabled, __flag, __ATOMIC_RELEASE)
+#define DARSHAN_CORE_ENABLED() \
+    __atomic_load_n(&darshan_core_enabled, __ATOMIC_ACQUIRE)
+
 #define DARSHAN_WARN(__err_str, ...) do { \
     darshan_core_fprintf(stderr, "darshan_library_warning: " \
         __err_str ".\n", ## __VA_ARGS__); \
@@ -287,6 +466,48 @@ void darshan_core_initialize(int argc, char **argv)
             darshan_mod_mem_quota = tmpfloat * 1024 * 1024; /* convert from MiB */
         }
     }
+    tmpval = sysconf(_SC_PAGESIZE);
+    assert(tmpval > 0);
+    darshan_mod_mem_chunk_size =
+        ((DARSHAN_MOD_MEM_CHUNK_SIZE + tmpval - 1) / tmpval) * tmpval;
+    darshan_mod_mem_slot_size =
+        ((darshan_mod_mem_quota + tmpval - 1) / tmpval) * tmpval;
+
+    /* set the sampling period for modules that support sampling */
+    envstr = getenv(DARSHAN_SAMPLE_PERIOD);
+    if(envstr)
+    {
+        ret = sscanf(envstr, "%d", &tmpval);
+        /* silently ignore if the env variable is set poorly */
+        if(ret == 1 && tmpval > 0)
+            darshan_sample_period = tmpval;
+    }
+    if(getenv(DARSHAN_SAMPLE_RANDOM))
+        darshan_sample_random = 1;
+
+    /* set the initial width of activity bins (0 disables them) */
+    envstr = getenv(DARSHAN_ACTIVITY_BIN_WIDTH);
+    if(envstr)
+    {
+        ret = sscanf(envstr, "%lf", &tmpfloat);
+        /* silently ignore if the env variable is set poorly */
+        if(ret == 1 && tmpfloat >= 0)
+            darshan_activity_bin_width = tmpfloat;
+    }
+
+    /* choose the log compression method, silently falling back to zlib
+     * if the method is not known or not supported by this build
+     */
+    envstr = getenv(DARSHAN_LOG_COMPRESSION);
+#ifdef HAVE_LIBZSTD
+    if(envstr && strcmp(envstr, "zstd") == 0)
+        darshan_log_comp_type = DARSHAN_ZSTD_COMP;
+#endif
+
+    if(getenv(DARSHAN_COLUMNAR_RECORDS))
+        darshan_columnar_records = 1;
+    else if(getenv(DARSHAN_SPARSE_RECORDS))
+        darshan_sparse_records = 1;
 
     /* allocate structure to track darshan core runtime information */
     init_core = malloc(sizeof(*init_core));
@@ -301,6 +522,8 @@ void darshan_core_initialize(int argc, char **argv)
             PMPI_Comm_dup(MPI_COMM_WORLD, &init_core->mpi_comm);
             PMPI_Comm_size(init_core->mpi_comm, &nprocs);
             PMPI_Comm_rank(init_core->mpi_comm, &my_rank);
+            init_core->node_comm = MPI_COMM_NULL;
+            init_core->log_comm = init_core->mpi_comm;
         }
 #endif
 
@@ -310,28 +533,42 @@ void darshan_core_initialize(int argc, char **argv)
             pthread_atfork(NULL, NULL, &darshan_core_fork_child_cb);
         }
 
+        /* select the timer backend before recording any timestamps */
+        darshan_core_timer_init();
+
         /* record absolute start time at startup so that we can later
          * generate relative times with this as a reference point.
          */
-        init_core->wtime_offset = darshan_core_wtime_absolute();
+        darshan_core_wtime_offset = darshan_core_wtime_absolute();
 
         /* set PID that initialized Darshan runtime */
         init_core->pid = init_pid;
 
-        /* TODO: do we alloc new memory as we go or just do everything up front? */
-
 #ifndef __DARSHAN_ENABLE_MMAP_LOGS
-        /* just allocate memory for each log file region */
+        /* just allocate memory for each log file region; module record
+         * slots are only reserved here and committed as modules grow
+         */
         init_core->log_hdr_p = malloc(sizeof(struct darshan_header));
         init_core->log_job_p = malloc(sizeof(struct darshan_job));
         init_core->log_exemnt_p = malloc(DARSHAN_EXE_LEN+1);
         init_core->log_name_p = malloc(DARSHAN_NAME_RECORD_BUF_SIZE);
-        init_core->log_mod_p = malloc(darshan_mod_mem_quota);
+        init_core->log_mod_p = mmap(NULL,
+            DARSHAN_MAX_MODS * darshan_mod_mem_slot_size, PROT_NONE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if(init_core->log_mod_p == MAP_FAILED)
+            init_core->log_mod_p = NULL;
 
         if(!(init_core->log_hdr_p) || !(init_core->log_job_p) ||
            !(init_core->log_exemnt_p) || !(init_core->log_name_p) ||
            !(init_core->log_mod_p))
         {
+            free(init_core->log_hdr_p);
+            free(init_core->log_job_p);
+            free(init_core->log_exemnt_p);
+            free(init_core->log_name_p);
+            if(init_core->log_mod_p)
+                munmap(init_core->log_mod_p,
+                    DARSHAN_MAX_MODS * darshan_mod_mem_slot_size);
             free(init_core);
             return;
         }
@@ -340,7 +577,6 @@ void darshan_core_initialize(int argc, char **argv)
         memset(init_core->log_job_p, 0, sizeof(struct darshan_job));
         memset(init_core->log_exemnt_p, 0, DARSHAN_EXE_LEN+1);
         memset(init_core->log_name_p, 0, DARSHAN_NAME_RECORD_BUF_SIZE);
-        memset(init_core->log_mod_p, 0, darshan_mod_mem_quota);
 #else
         /* if mmap logs are enabled, we need to initialize the mmap region
          * before setting the corresponding log file region pointers
@@ -360,8 +596,8 @@ void darshan_core_initialize(int argc, char **argv)
             ((char *)init_core->log_job_p + sizeof(struct darshan_job));
         init_core->log_name_p = (void *)
             ((char *)init_core->log_exemnt_p + DARSHAN_EXE_LEN + 1);
-        init_core->log_mod_p = (void *)
-            ((char *)init_core->log_name_p + DARSHAN_NAME_RECORD_BUF_SIZE);
+        init_core->log_mod_p = (void *)((char *)init_core->log_hdr_p +
+            DARSHAN_MMAP_LOG_MOD_OFF(sysconf(_SC_PAGESIZE)));
 
         /* set header fields needed for the mmap log mechanism */
         init_core->log_hdr_p->comp_type = DARSHAN_NO_COMP;
@@ -399,6 +635,7 @@ void darshan_core_initialize(int argc, char **argv)
          */
         DARSHAN_CORE_LOCK();
         darshan_core = init_core;
+        DARSHAN_CORE_SET_ENABLED(1);
         DARSHAN_CORE_UNLOCK();
 
         i = 0;
@@ -407,6 +644,9 @@ void darshan_core_initialize(int argc, char **argv)
             (*mod_static_init_fns[i])();
             i++;
         }
+
+        /* start taking snapshots, if requested */
+        darshan_snapshot_start(init_core, jobid);
     }
 
     if(internal_timing_flag)
@@ -442,15 +682,26 @@ void darshan_core_shutdown(int write_log)
     double start_log_time;
     int internal_timing_flag = 0;
     double open1 = 0, open2 = 0;
-    double job1 = 0, job2 = 0;
-    double rec1 = 0, rec2 = 0;
     double mod1[DARSHAN_MAX_MODS] = {0};
     double mod2[DARSHAN_MAX_MODS] = {0};
+    double write1;
+    double write_tm[DARSHAN_COMP_REGION_CNT] = {0};
+    double shared1 = 0, shared2 = 0;
     double header1 = 0, header2 = 0;
     double tm_end;
     int active_mods[DARSHAN_MAX_MODS] = {0};
     uint64_t gz_fp = 0;
     char *logfile_name = NULL;
+    struct darshan_comp_region regions[DARSHAN_COMP_REGION_CNT];
+    struct darshan_comp_pool comp_pool;
+    int comp_pool_started = 0;
+    int write_order[DARSHAN_COMP_REGION_CNT];
+    int queued_cnt = 0;
+    int written_cnt = 0;
+    int r;
+    void *name_rec_buf = NULL;
+    int name_rec_buf_len = 0;
+    int comp_threads;
     darshan_core_log_fh log_fh;
     int log_created = 0;
     int meta_remain = 0;
@@ -461,8 +712,14 @@ void darshan_core_shutdown(int write_log)
     darshan_record_id *shared_recs = NULL;
     darshan_record_id *mod_shared_recs = NULL;
     int shared_rec_cnt = 0;
+    int mod_shared_rec_max;
+    struct darshan_shared_group *subset_groups = NULL;
+    int subset_group_cnt = 0;
 #endif
 
+    /* stop taking snapshots before shutting down */
+    darshan_snapshot_stop();
+
     /* disable darhan-core while we shutdown */
     DARSHAN_CORE_LOCK();
     if(!darshan_core)
@@ -472,8 +729,11 @@ void darshan_core_shutdown(int write_log)
     }
     final_core = darshan_core;
     darshan_core = NULL;
+    DARSHAN_CORE_SET_ENABLED(0);
     DARSHAN_CORE_UNLOCK();
 
+    memset(regions, 0, sizeof(regions));
+
     /* skip to cleanup if not writing a log */
     if(!write_log)
         goto cleanup;
@@ -507,9 +767,8 @@ void darshan_core_shutdown(int write_log)
     unlink(final_core->mmap_log_name);
 #endif
 
-    final_core->comp_buf = malloc(darshan_mod_mem_quota);
     logfile_name = malloc(PATH_MAX);
-    if(!final_core->comp_buf || !logfile_name)
+    if(!logfile_name)
         goto cleanup;
 
     /* set which modules were used locally */
@@ -544,10 +803,25 @@ void darshan_core_shutdown(int write_log)
                 1, MPI_INT64_T, MPI_MAX, 0, final_core->mpi_comm);
         }
 
-        /* get a list of records which are shared across all processes */
+        /* get a list of records which are shared across all processes,
+         * then group the records shared by only some of them
+         */
+        if(internal_timing_flag)
+            shared1 = darshan_core_wtime_absolute();
         darshan_get_shared_records(final_core, &shared_recs, &shared_rec_cnt);
+        darshan_get_subset_shared_records(final_core, &subset_groups,
+            &subset_group_cnt);
+        if(internal_timing_flag)
+            shared2 = darshan_core_wtime_absolute();
 
-        mod_shared_recs = malloc(shared_rec_cnt * sizeof(darshan_record_id));
+        mod_shared_rec_max = shared_rec_cnt;
+        for(i = 0; i < subset_group_cnt; i++)
+        {
+            if(subset_groups[i].rec_cnt > mod_shared_rec_max)
+                mod_shared_rec_max = subset_groups[i].rec_cnt;
+        }
+        mod_shared_recs = malloc((mod_shared_rec_max ? mod_shared_rec_max : 1) *
+            sizeof(darshan_record_id));
         assert(mod_shared_recs);
     }
 #endif
@@ -580,6 +854,11 @@ void darshan_core_shutdown(int write_log)
 
     if(internal_timing_flag)
         open1 = darshan_core_wtime_absolute();
+#ifdef HAVE_MPI
+    /* pick the processes that write to the log file */
+    if(using_mpi)
+        darshan_log_split_writers(final_core);
+#endif
     /* open the darshan log file */
     ret = darshan_log_open(logfile_name, final_core, &log_fh);
     if(internal_timing_flag)
@@ -588,32 +867,40 @@ void darshan_core_shutdown(int write_log)
     DARSHAN_CHECK_ERR(ret, "unable to create log file %s", logfile_name);
     log_created = 1;
 
-    if(internal_timing_flag)
-        job1 = darshan_core_wtime_absolute();
-    /* write the the compressed darshan job information */
-    ret = darshan_log_write_job_record(log_fh, final_core, &gz_fp);
-    if(internal_timing_flag)
-        job2 = darshan_core_wtime_absolute();
-    /* error out if unable to write job information */
-    DARSHAN_CHECK_ERR(ret, "unable to write job record to file %s", logfile_name);
-
-    if(internal_timing_flag)
-        rec1 = darshan_core_wtime_absolute();
-    /* write the record name->id hash to the log file */
-    final_core->log_hdr_p->name_map.off = gz_fp;
-    ret = darshan_log_write_name_record_hash(log_fh, final_core, &gz_fp);
-    if(internal_timing_flag)
-        rec2 = darshan_core_wtime_absolute();
-    final_core->log_hdr_p->name_map.len = gz_fp - final_core->log_hdr_p->name_map.off;
-    /* error out if unable to write name records */
-    DARSHAN_CHECK_ERR(ret, "unable to write name records to log file %s", logfile_name);
+    /* gather up the job record and name records to compress */
+#ifdef HAVE_MPI
+    /* only rank 0 writes the job record */
+    if(!using_mpi || my_rank == 0)
+#endif
+    {
+        regions[DARSHAN_COMP_JOB_REGION].pointers[0] = final_core->log_job_p;
+        regions[DARSHAN_COMP_JOB_REGION].lengths[0] = sizeof(struct darshan_job);
+        regions[DARSHAN_COMP_JOB_REGION].pointers[1] = final_core->log_exemnt_p;
+        regions[DARSHAN_COMP_JOB_REGION].lengths[1] =
+            strlen(final_core->log_exemnt_p);
+        regions[DARSHAN_COMP_JOB_REGION].count = 2;
+    }
+    darshan_log_get_name_records(final_core, &name_rec_buf, &name_rec_buf_len);
+    regions[DARSHAN_COMP_NAME_REGION].pointers[0] = name_rec_buf;
+    regions[DARSHAN_COMP_NAME_REGION].lengths[0] = name_rec_buf_len;
+    regions[DARSHAN_COMP_NAME_REGION].count = 1;
+
+    /* compress log regions in the background, as each becomes ready, and
+     * write them out in the order they appear in the log, each one while
+     * the next is prepared and compressed
+     */
+    comp_threads = darshan_comp_thread_count(final_core);
+    darshan_comp_pool_start(&comp_pool, regions, comp_threads);
+    comp_pool_started = 1;
+    darshan_comp_pool_queue(&comp_pool, DARSHAN_COMP_JOB_REGION);
+    write_order[queued_cnt++] = DARSHAN_COMP_JOB_REGION;
+    darshan_comp_pool_queue(&comp_pool, DARSHAN_COMP_NAME_REGION);
+    write_order[queued_cnt++] = DARSHAN_COMP_NAME_REGION;
 
     /* loop over globally used darshan modules and:
-     *      - get final output buffer
-     *      - compress (zlib) provided output buffer
-     *      - append compressed buffer to log file
-     *      - add module map info (file offset/length) to log header
-     *      - shutdown the module
+     *      - reduce shared records
+     *      - get final output buffer to compress
+     *      - write out the regions that were ready before it
      */
     for(i = 0; i < DARSHAN_MAX_MODS; i++)
     {
@@ -642,7 +929,7 @@ void darshan_core_shutdown(int write_log)
             {
                 struct darshan_core_name_record_ref *ref = NULL;
                 int mod_shared_rec_cnt = 0;
-                int j;
+                int j, k;
 
                 /* set the shared record list for this module */
                 for(j = 0; j < shared_rec_cnt; j++)
@@ -664,25 +951,102 @@ void darshan_core_shutdown(int write_log)
                     this_mod->mod_funcs.mod_redux_func(mod_buf, final_core->mpi_comm,
                         mod_shared_recs, mod_shared_rec_cnt);
                 }
+
+                /* then the records shared by each group of processes this
+                 * process belongs to, over the group's communicator
+                 */
+                for(k = 0; k < subset_group_cnt; k++)
+                {
+                    mod_shared_rec_cnt = 0;
+                    for(j = 0; j < subset_groups[k].rec_cnt; j++)
+                    {
+                        HASH_FIND(hlink, final_core->name_hash,
+                            &subset_groups[k].recs[j], sizeof(darshan_record_id),
+                            ref);
+                        assert(ref);
+
+                        if(DARSHAN_MOD_FLAG_ISSET(ref->global_mod_flags, i))
+                        {
+                            mod_shared_recs[mod_shared_rec_cnt++] =
+                                subset_groups[k].recs[j];
+                        }
+                    }
+
+                    if(this_mod->mod_funcs.mod_subset_redux_func &&
+                       (mod_shared_rec_cnt > 0) &&
+                       (!getenv("DARSHAN_DISABLE_SHARED_REDUCTION")))
+                    {
+                        this_mod->mod_funcs.mod_subset_redux_func(mod_buf,
+                            subset_groups[k].comm, mod_shared_recs,
+                            mod_shared_rec_cnt);
+                    }
+                }
             }
 #endif
 
             /* get the final output buffer */
             this_mod->mod_funcs.mod_output_func(&mod_buf, &mod_buf_sz);
+
+            /* sparse encode it or store it in columns if the module
+             * supports it, which is done chunk by chunk as it is compressed
+             */
+            if((darshan_sparse_records || darshan_columnar_records) &&
+               this_mod->counter_cnt > 0)
+            {
+                if(darshan_columnar_records)
+                {
+                    DARSHAN_MOD_FLAG_SET(final_core->log_hdr_p->columnar_flag, i);
+                    regions[i].enc = DARSHAN_REC_COLUMNAR;
+                }
+                else
+                {
+                    DARSHAN_MOD_FLAG_SET(final_core->log_hdr_p->sparse_flag, i);
+                    regions[i].enc = DARSHAN_REC_SPARSE;
+                }
+                regions[i].enc_mod = this_mod;
+            }
         }
 
-        /* append this module's data to the darshan log */
-        final_core->log_hdr_p->mod_map[i].off = gz_fp;
-        ret = darshan_log_append(log_fh, final_core, mod_buf, mod_buf_sz, &gz_fp);
-        final_core->log_hdr_p->mod_map[i].len =
-            gz_fp - final_core->log_hdr_p->mod_map[i].off;
+        regions[i].pointers[0] = mod_buf;
+        regions[i].lengths[0] = mod_buf_sz;
+        regions[i].count = 1;
 
         if(internal_timing_flag)
             mod2[i] = darshan_core_wtime_absolute();
 
-        /* error out if unable to write module data */
-        DARSHAN_CHECK_ERR(ret, "unable to write %s module data to log file %s",
-            darshan_module_names[i], logfile_name);
+        darshan_comp_pool_queue(&comp_pool, i);
+        write_order[queued_cnt++] = i;
+
+        /* write out every region queued before this module's */
+        while(written_cnt < queued_cnt - 1)
+        {
+            r = write_order[written_cnt++];
+            darshan_comp_pool_wait(&comp_pool, r);
+            if(internal_timing_flag)
+                write1 = darshan_core_wtime_absolute();
+            ret = darshan_log_write_region(log_fh, final_core, regions, r,
+                &gz_fp);
+            if(internal_timing_flag)
+                write_tm[r] = darshan_core_wtime_absolute() - write1;
+            DARSHAN_CHECK_ERR(ret, "unable to write %s%s to log file %s",
+                darshan_log_region_name(r),
+                (r < DARSHAN_MAX_MODS) ? " module data" : "", logfile_name);
+        }
+    }
+
+    /* write out the rest */
+    while(written_cnt < queued_cnt)
+    {
+        r = write_order[written_cnt++];
+        darshan_comp_pool_wait(&comp_pool, r);
+        if(internal_timing_flag)
+            write1 = darshan_core_wtime_absolute();
+        ret = darshan_log_write_region(log_fh, final_core, regions, r, &gz_fp);
+        if(internal_timing_flag)
+            write_tm[r] = darshan_core_wtime_absolute() - write1;
+        DARSHAN_CHECK_ERR(ret, "unable to write %s%s to log file %s",
+            darshan_log_region_name(r),
+            (r < DARSHAN_MAX_MODS) ? " module data" : "", logfile_name);
     }
 
     if(internal_timing_flag)
@@ -698,25 +1062,49 @@ void darshan_core_shutdown(int write_log)
     /* finalize log file name and permissions */
     darshan_log_finalize(logfile_name, start_log_time);
 
+    /* the log supersedes this process's last snapshot */
+    if(darshan_snapshot.log_name[0])
+        unlink(darshan_snapshot.log_name);
+
     if(internal_timing_flag)
     {
         double open_tm;
         double header_tm;
         double job_tm;
         double rec_tm;
+        double comp_tm;
+        double comp_wait_tm;
+        double comp_overlap_tm;
+        double shared_tm;
         double mod_tm[DARSHAN_MAX_MODS];
         double all_tm;
+        /* memory held by the runtime's slab allocators; module cleanup
+         * has not run yet, so this is everything allocated for the job
+         */
+        uint64_t slab_mem = darshan_slab_mem_usage();
+        uint64_t slab_mem_max = slab_mem;
+        uint64_t slab_mem_sum = slab_mem;
 
         tm_end = darshan_core_wtime_absolute();
 
         open_tm = open2 - open1;
         header_tm = header2 - header1;
-        job_tm = job2 - job1;
-        rec_tm = rec2 - rec1;
+        job_tm = write_tm[DARSHAN_COMP_JOB_REGION];
+        rec_tm = write_tm[DARSHAN_COMP_NAME_REGION];
+        /* compression time is summed over the pool's threads; the part of
+         * it the shutdown did not have to wait on was overlapped with
+         * module shutdown and log writes (or run in parallel)
+         */
+        comp_tm = comp_pool.busy_time;
+        comp_wait_tm = comp_pool.wait_time;
+        comp_overlap_tm = comp_tm - comp_wait_tm;
+        if(comp_overlap_tm < 0)
+            comp_overlap_tm = 0;
+        shared_tm = shared2 - shared1;
         all_tm = tm_end - start_log_time;
         for(i = 0; i < DARSHAN_MAX_MODS; i++)
         {
-            mod_tm[i] = mod2[i] - mod1[i];
+            mod_tm[i] = (mod2[i] - mod1[i]) + write_tm[i];
         }
 
 #ifdef HAVE_MPI
@@ -732,10 +1120,22 @@ void darshan_core_shutdown(int write_log)
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, &rec_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &comp_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &comp_wait_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &comp_overlap_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &shared_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, &all_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(MPI_IN_PLACE, mod_tm, DARSHAN_MAX_MODS,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &slab_mem_max, 1,
+                    MPI_UINT64_T, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(MPI_IN_PLACE, &slab_mem_sum, 1,
+                    MPI_UINT64_T, MPI_SUM, 0, final_core->mpi_comm);
             }
             else
             {
@@ -747,10 +1147,22 @@ void darshan_core_shutdown(int write_log)
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(&rec_tm, &rec_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&comp_tm, &comp_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&comp_wait_tm, &comp_wait_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&comp_overlap_tm, &comp_overlap_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&shared_tm, &shared_tm, 1,
+                    MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(&all_tm, &all_tm, 1,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
                 PMPI_Reduce(mod_tm, mod_tm, DARSHAN_MAX_MODS,
                     MPI_DOUBLE, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&slab_mem_max, &slab_mem_max, 1,
+                    MPI_UINT64_T, MPI_MAX, 0, final_core->mpi_comm);
+                PMPI_Reduce(&slab_mem_sum, &slab_mem_sum, 1,
+                    MPI_UINT64_T, MPI_SUM, 0, final_core->mpi_comm);
 
                 /* let rank 0 report the timing info */
                 goto cleanup;
@@ -760,8 +1172,12 @@ void darshan_core_shutdown(int write_log)
 
         darshan_core_fprintf(stderr, "#darshan:<op>\t<nprocs>\t<time>\n");
         darshan_core_fprintf(stderr, "darshan:log_open\t%d\t%f\n", nprocs, open_tm);
+        darshan_core_fprintf(stderr, "darshan:shared_detect\t%d\t%f\n", nprocs, shared_tm);
         darshan_core_fprintf(stderr, "darshan:job_write\t%d\t%f\n", nprocs, job_tm);
         darshan_core_fprintf(stderr, "darshan:hash_write\t%d\t%f\n", nprocs, rec_tm);
+        darshan_core_fprintf(stderr, "darshan:log_compress\t%d\t%f\n", nprocs, comp_tm);
+        darshan_core_fprintf(stderr, "darshan:comp_wait\t%d\t%f\n", nprocs, comp_wait_tm);
+        darshan_core_fprintf(stderr, "darshan:comp_overlap\t%d\t%f\n", nprocs, comp_overlap_tm);
         darshan_core_fprintf(stderr, "darshan:header_write\t%d\t%f\n", nprocs, header_tm);
         for(i = 0; i < DARSHAN_MAX_MODS; i++)
         {
@@ -770,18 +1186,38 @@ void darshan_core_shutdown(int write_log)
                     darshan_module_names[i], nprocs, mod_tm[i]);
         }
         darshan_core_fprintf(stderr, "darshan:core_shutdown\t%d\t%f\n", nprocs, all_tm);
+        darshan_core_fprintf(stderr, "#darshan:<mem>\t<nprocs>\t<max bytes>\t<total bytes>\n");
+        darshan_core_fprintf(stderr, "darshan:slab_mem\t%d\t%" PRIu64 "\t%" PRIu64 "\n",
+            nprocs, slab_mem_max, slab_mem_sum);
     }
 
 cleanup:
+    /* stop compressing before any module data is freed */
+    if(comp_pool_started)
+        darshan_comp_pool_stop(&comp_pool);
+    for(i = 0; i < DARSHAN_COMP_REGION_CNT; i++)
+        darshan_comp_region_free(&regions[i]);
     for(i = 0; i < DARSHAN_MAX_MODS; i++)
         if(final_core->mod_array[i])
             final_core->mod_array[i]->mod_funcs.mod_cleanup_func();
+    /* with the modules gone, their common value counters can all be freed
+     * at once (this also runs in forked children, before re-initializing)
+     */
+    darshan_common_val_slabs_destroy();
+    if(name_rec_buf != final_core->log_name_p)
+        free(name_rec_buf);
     darshan_core_cleanup(final_core);
 #ifdef HAVE_MPI
     if(using_mpi)
     {
         free(shared_recs);
         free(mod_shared_recs);
+        for(i = 0; i < subset_group_cnt; i++)
+        {
+            PMPI_Comm_free(&subset_groups[i].comm);
+            free(subset_groups[i].recs);
+        }
+        free(subset_groups);
     }
 #endif
     free(logfile_name);
@@ -809,10 +1245,12 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
     sys_page_size = sysconf(_SC_PAGESIZE);
     assert(sys_page_size > 0);
 
-    mmap_size = sizeof(struct darshan_header) + DARSHAN_JOB_RECORD_SIZE +
-        + DARSHAN_NAME_RECORD_BUF_SIZE + darshan_mod_mem_quota;
-    if(mmap_size % sys_page_size)
-        mmap_size = ((mmap_size / sys_page_size) + 1) * sys_page_size;
+    /* module record slots start on a page boundary, so that they can be
+     * committed independently; the log file is sparse, so slots only use
+     * file system space as modules grow into them
+     */
+    mmap_size = DARSHAN_MMAP_LOG_MOD_OFF(sys_page_size) +
+        DARSHAN_MAX_MODS * darshan_mod_mem_slot_size;
 
     envstr = getenv(DARSHAN_MMAP_LOG_PATH_OVERRIDE);
     if(envstr)
@@ -879,6 +1317,10 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
         return(NULL);
     }
 
+    /* module record slots are committed on demand */
+    mprotect((char *)mmap_p + DARSHAN_MMAP_LOG_MOD_OFF(sys_page_size),
+        DARSHAN_MAX_MODS * darshan_mod_mem_slot_size, PROT_NONE);
+
     /* close darshan log file (this does *not* unmap the log file) */
     close(mmap_fd);
 
@@ -886,6 +1328,269 @@ static void *darshan_init_mmap_log(struct darshan_core_runtime* core, int jobid)
 }
 #endif
 
+/* if DARSHAN_SNAPSHOT_INTERVAL is set, start a thread that periodically
+ * writes a snapshot of this process's records to a log file of its own
+ */
+static void darshan_snapshot_start(struct darshan_core_runtime* core, int jobid)
+{
+    char cuser[L_cuserid] = {0};
+    uint64_t hlevel;
+    char hname[HOST_NAME_MAX];
+    uint64_t logmod;
+    char *envstr;
+    char *snapshot_path;
+    sigset_t sigset, old_sigset;
+    int interval;
+    int ret;
+
+    envstr = getenv(DARSHAN_SNAPSHOT_INTERVAL);
+    if(!envstr)
+        return;
+    ret = sscanf(envstr, "%d", &interval);
+    /* silently ignore if the env variable is set poorly */
+    if(ret != 1 || interval < 1)
+        return;
+
+    envstr = getenv(DARSHAN_SNAPSHOT_PATH_OVERRIDE);
+    if(envstr)
+        snapshot_path = envstr;
+    else
+        snapshot_path = DARSHAN_DEF_SNAPSHOT_PATH;
+
+    darshan_get_user_name(cuser);
+
+    /* as with mmap logs, a random number common to all processes tells
+     * the snapshots of different application runs in a job apart
+     */
+    if(my_rank == 0)
+    {
+        hlevel = darshan_core_wtime_absolute() * 1000000;
+        (void)gethostname(hname, sizeof(hname));
+        logmod = darshan_hash((void*)hname,strlen(hname),hlevel);
+    }
+#ifdef HAVE_MPI
+    if(using_mpi)
+        PMPI_Bcast(&logmod, 1, MPI_UINT64_T, 0, core->mpi_comm);
+#endif
+
+    snprintf(darshan_snapshot.log_name, PATH_MAX,
+        "%s/%s_%s_id%d_snapshot-%" PRIu64 "-%d.darshan",
+        snapshot_path, cuser, __progname, jobid, logmod, my_rank);
+    darshan_snapshot.interval = interval;
+    darshan_snapshot.stop = 0;
+
+    /* keep signals meant for the application away from the thread */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_SETMASK, &sigset, &old_sigset);
+    ret = pthread_create(&darshan_snapshot.thread, NULL,
+        darshan_snapshot_thread, NULL);
+    pthread_sigmask(SIG_SETMASK, &old_sigset, NULL);
+    if(ret != 0)
+    {
+        DARSHAN_WARN("unable to start snapshot thread");
+        darshan_snapshot.log_name[0] = '\0';
+        return;
+    }
+    darshan_snapshot.running = 1;
+
+    return;
+}
+
+static void darshan_snapshot_stop()
+{
+    if(!darshan_snapshot.running)
+        return;
+
+    pthread_mutex_lock(&darshan_snapshot.lock);
+    darshan_snapshot.stop = 1;
+    pthread_cond_signal(&darshan_snapshot.stop_cond);
+    pthread_mutex_unlock(&darshan_snapshot.lock);
+    pthread_join(darshan_snapshot.thread, NULL);
+    darshan_snapshot.running = 0;
+
+    return;
+}
+
+static void *darshan_snapshot_thread(void *arg)
+{
+    struct timespec deadline;
+    int warned = 0;
+    int ret;
+
+    darshan_core_thread_disabled = 1;
+
+    pthread_mutex_lock(&darshan_snapshot.lock);
+    while(!darshan_snapshot.stop)
+    {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += darshan_snapshot.interval;
+        ret = 0;
+        while(!darshan_snapshot.stop && ret != ETIMEDOUT)
+            ret = pthread_cond_timedwait(&darshan_snapshot.stop_cond,
+                &darshan_snapshot.lock, &deadline);
+        if(darshan_snapshot.stop)
+            break;
+
+        pthread_mutex_unlock(&darshan_snapshot.lock);
+        if(darshan_snapshot_write() < 0 && !warned)
+        {
+            DARSHAN_WARN("unable to write snapshot %s",
+                darshan_snapshot.log_name);
+            warned = 1;
+        }
+        pthread_mutex_lock(&darshan_snapshot.lock);
+    }
+    pthread_mutex_unlock(&darshan_snapshot.lock);
+
+    return(NULL);
+}
+
+/* write a snapshot of this process's job data, name records, and the
+ * records of every module that supports snapshots as a log file of its
+ * own. only the copying of records is done under the module (and core)
+ * locks, so instrumented I/O is held up no longer than that takes. the
+ * snapshot is written to a temporary file that then replaces the last
+ * one, so that a complete snapshot is always left behind.
+ */
+static int darshan_snapshot_write()
+{
+    darshan_module_snapshot snap_funcs[DARSHAN_MAX_MODS] = {0};
+    void *mod_bufs[DARSHAN_MAX_MODS];
+    void *snap_bufs[DARSHAN_MAX_MODS] = {0};
+    int snap_buf_szs[DARSHAN_MAX_MODS] = {0};
+    struct darshan_header hdr;
+    struct darshan_job job;
+    char *exemnt = NULL;
+    void *name_buf = NULL;
+    int name_buf_len = 0;
+    void *pointers[2];
+    int lengths[2];
+    char tmp_name[PATH_MAX + sizeof("_partial")];
+    uint64_t off;
+    int fd;
+    int i;
+    int ret = -1;
+
+    DARSHAN_CORE_LOCK();
+    if(!darshan_core)
+    {
+        DARSHAN_CORE_UNLOCK();
+        return(0);
+    }
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(darshan_core->mod_array[i])
+        {
+            snap_funcs[i] =
+                darshan_core->mod_array[i]->mod_funcs.mod_snapshot_func;
+            mod_bufs[i] = darshan_core->mod_array[i]->rec_buf_start;
+        }
+    }
+    DARSHAN_CORE_UNLOCK();
+
+    /* modules take the core lock while holding their own, so they copy
+     * their records without it
+     */
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        if(snap_funcs[i])
+            snap_funcs[i](mod_bufs[i], &snap_bufs[i], &snap_buf_szs[i]);
+    }
+
+    /* names are registered before their records, so the name records
+     * copied now cover every record copied above
+     */
+    DARSHAN_CORE_LOCK();
+    if(darshan_core)
+    {
+        memcpy(&hdr, darshan_core->log_hdr_p, sizeof(hdr));
+        memcpy(&job, darshan_core->log_job_p, sizeof(job));
+        exemnt = strdup(darshan_core->log_exemnt_p);
+        name_buf_len = darshan_core->name_mem_used;
+        name_buf = malloc(name_buf_len ? name_buf_len : 1);
+        if(name_buf)
+            memcpy(name_buf, darshan_core->log_name_p, name_buf_len);
+    }
+    DARSHAN_CORE_UNLOCK();
+    if(!exemnt || !name_buf)
+        goto done;
+
+    job.end_time = time(NULL);
+    hdr.comp_type = darshan_log_comp_type;
+    memset(&hdr.name_map, 0, sizeof(hdr.name_map));
+    memset(hdr.mod_map, 0, sizeof(hdr.mod_map));
+
+    snprintf(tmp_name, sizeof(tmp_name), "%s_partial",
+        darshan_snapshot.log_name);
+    fd = open(tmp_name, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+    if(fd < 0)
+        goto done;
+
+    /* write the log regions in order, leaving room for the header */
+    off = sizeof(struct darshan_header);
+    pointers[0] = &job;
+    lengths[0] = sizeof(struct darshan_job);
+    pointers[1] = exemnt;
+    lengths[1] = strlen(exemnt);
+    ret = darshan_snapshot_append(fd, pointers, lengths, 2, &off);
+    if(ret == 0)
+    {
+        hdr.name_map.off = off;
+        ret = darshan_snapshot_append(fd, &name_buf, &name_buf_len, 1, &off);
+        hdr.name_map.len = off - hdr.name_map.off;
+    }
+    for(i = 0; ret == 0 && i < DARSHAN_MAX_MODS; i++)
+    {
+        /* leave out modules without records to snapshot */
+        if(!snap_buf_szs[i])
+        {
+            hdr.mod_ver[i] = 0;
+            continue;
+        }
+        hdr.mod_map[i].off = off;
+        ret = darshan_snapshot_append(fd, &snap_bufs[i], &snap_buf_szs[i], 1,
+            &off);
+        hdr.mod_map[i].len = off - hdr.mod_map[i].off;
+    }
+    if(ret == 0 &&
+       pwrite(fd, &hdr, sizeof(struct darshan_header), 0) !=
+       sizeof(struct darshan_header))
+        ret = -1;
+    close(fd);
+
+    if(ret == 0)
+        ret = rename(tmp_name, darshan_snapshot.log_name);
+    if(ret < 0)
+        unlink(tmp_name);
+
+done:
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        free(snap_bufs[i]);
+    free(exemnt);
+    free(name_buf);
+    return(ret);
+}
+
+/* compress a snapshot region and write it to the given offset of the
+ * snapshot, updating the offset to the end of the region
+ */
+static int darshan_snapshot_append(int fd, void **pointers, int *lengths,
+    int count, uint64_t *inout_off)
+{
+    struct darshan_comp_out out;
+    int ret;
+
+    memset(&out, 0, sizeof(out));
+    ret = darshan_compress_buffer(pointers, lengths, count, &out);
+    if(ret == 0)
+        ret = darshan_comp_out_pwrite(fd, &out, *inout_off);
+    if(ret == 0)
+        *inout_off += out.len;
+    darshan_comp_out_free(&out);
+
+    return(ret);
+}
+
 /* record any hints used to write the darshan log in the job data */
 static void darshan_log_record_hints_and_ver(struct darshan_core_runtime* core)
 {
@@ -932,19 +1637,6 @@ static void darshan_log_record_hints_and_ver(struct darshan_core_runtime* core)
     return;
 }
 
-static int mnt_data_cmp(const void* a, const void* b)
-{
-    const struct darshan_core_mnt_data *d_a = (const struct darshan_core_mnt_data*)a;
-    const struct darshan_core_mnt_data *d_b = (const struct darshan_core_mnt_data*)b;
-
-    if(strlen(d_a->path) > strlen(d_b->path))
-        return(-1);
-    else if(strlen(d_a->path) < strlen(d_b->path))
-        return(1);
-    else
-        return(0);
-}
-
 /* adds an entry to table of mounted file systems */
 static void add_entry(char* buf, int* space_left, struct mntent* entry)
 {
@@ -952,6 +1644,8 @@ static void add_entry(char* buf, int* space_left, struct mntent* entry)
     int ret;
     char tmp_mnt[256];
     struct statfs statfsbuf;
+    struct darshan_core_mnt_data *tmp_array;
+    int new_max;
 
     /* avoid adding the same mount points multiple times -- to limit
      * storage space and potential statfs, ioctl, etc calls
@@ -963,6 +1657,18 @@ static void add_entry(char* buf, int* space_left, struct mntent* entry)
             return;
     }
 
+    /* grow the mount table if needed */
+    if(mnt_data_count == mnt_data_max)
+    {
+        new_max = mnt_data_max ? mnt_data_max * 2 : DARSHAN_INIT_MNTS;
+        tmp_array = realloc(mnt_data_array, new_max * sizeof(*tmp_array));
+        if(!tmp_array)
+            return;
+        mnt_data_array = tmp_array;
+        mnt_data_max = new_max;
+    }
+    memset(&mnt_data_array[mnt_data_count], 0, sizeof(*mnt_data_array));
+
     strncpy(mnt_data_array[mnt_data_count].path, entry->mnt_dir,
         DARSHAN_MAX_MNT_PATH-1);
     strncpy(mnt_data_array[mnt_data_count].type, entry->mnt_type,
@@ -1026,31 +1732,199 @@ static void add_entry(char* buf, int* space_left, struct mntent* entry)
     return;
 }
 
-/* darshan_get_exe_and_mounts()
- *
- * collects command line and list of mounted file systems into a string that
- * will be stored with the job-level metadata
- */
-static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
-    int argc, char **argv)
+static void darshan_path_trie_destroy(struct darshan_path_trie *trie)
 {
-    FILE* tab;
-    struct mntent *entry;
-    char* exclude;
-    char* truncate_string = "<TRUNCATED>";
-    int truncate_offset;
-    int space_left = DARSHAN_EXE_LEN;
-    FILE *fh;
-    int i, ii;
-    char cmdl[DARSHAN_EXE_LEN];
-    int tmp_index = 0;
-    int skip = 0;
-    char* env_exclusions;
-    char* string;
-    char* token;
+    int i;
 
-    /* skip these fs types */
-    static char* fs_exclusions[] = {
+    for(i = 0; i < trie->glob_cnt; i++)
+        free(trie->globs[i].pattern);
+    free(trie->globs);
+    free(trie->nodes);
+    memset(trie, 0, sizeof(*trie));
+
+    return;
+}
+
+static int darshan_path_trie_new_node(struct darshan_path_trie *trie, char c)
+{
+    struct darshan_path_trie_node *tmp_nodes;
+    int new_max;
+
+    if(trie->node_cnt == trie->node_max)
+    {
+        new_max = trie->node_max ? trie->node_max * 2 : 256;
+        tmp_nodes = realloc(trie->nodes, new_max * sizeof(*tmp_nodes));
+        if(!tmp_nodes)
+            return(-1);
+        trie->nodes = tmp_nodes;
+        trie->node_max = new_max;
+    }
+
+    trie->nodes[trie->node_cnt].child = -1;
+    trie->nodes[trie->node_cnt].sibling = -1;
+    trie->nodes[trie->node_cnt].glob = -1;
+    trie->nodes[trie->node_cnt].mnt = -1;
+    trie->nodes[trie->node_cnt].c = c;
+    trie->nodes[trie->node_cnt].action = 0;
+
+    return(trie->node_cnt++);
+}
+
+static int darshan_path_trie_add_glob(struct darshan_path_trie *trie,
+    int node, const char *pattern, char action)
+{
+    struct darshan_path_glob *tmp_globs;
+    struct darshan_path_glob *glob;
+    size_t len = strlen(pattern);
+    int new_max;
+
+    if(trie->glob_cnt == trie->glob_max)
+    {
+        new_max = trie->glob_max ? trie->glob_max * 2 : 8;
+        tmp_globs = realloc(trie->globs, new_max * sizeof(*tmp_globs));
+        if(!tmp_globs)
+            return(-1);
+        trie->globs = tmp_globs;
+        trie->glob_max = new_max;
+    }
+
+    /* entries are matched as prefixes, so allow anything after the
+     * pattern by appending a trailing wildcard
+     */
+    glob = &trie->globs[trie->glob_cnt];
+    glob->pattern = malloc(len + 2);
+    if(!glob->pattern)
+        return(-1);
+    strcpy(glob->pattern, pattern);
+    if(len == 0 || pattern[len-1] != '*')
+        strcat(glob->pattern, "*");
+    glob->action = action;
+    glob->next = trie->nodes[node].glob;
+    trie->nodes[node].glob = trie->glob_cnt++;
+
+    return(0);
+}
+
+/* walks (and extends) the trie along the first len characters of str,
+ * returning the index of the final node or -1 on allocation failure
+ */
+static int darshan_path_trie_add_prefix(struct darshan_path_trie *trie,
+    const char *str, size_t len)
+{
+    size_t i;
+    int node = 0;
+    int next;
+
+    if(!trie->nodes && darshan_path_trie_new_node(trie, '\0') < 0)
+        return(-1);
+
+    for(i = 0; i < len; i++)
+    {
+        for(next = trie->nodes[node].child; next >= 0;
+            next = trie->nodes[next].sibling)
+        {
+            if(trie->nodes[next].c == str[i])
+                break;
+        }
+        if(next < 0)
+        {
+            next = darshan_path_trie_new_node(trie, str[i]);
+            if(next < 0)
+                return(-1);
+            trie->nodes[next].sibling = trie->nodes[node].child;
+            trie->nodes[node].child = next;
+        }
+        node = next;
+    }
+
+    return(node);
+}
+
+static int darshan_path_trie_insert(struct darshan_path_trie *trie,
+    const char *prefix, char action)
+{
+    size_t lit_len = strcspn(prefix, "*?[");
+    int node;
+
+    node = darshan_path_trie_add_prefix(trie, prefix, lit_len);
+    if(node < 0)
+        return(-1);
+
+    if(prefix[lit_len] == '\0')
+        trie->nodes[node].action |= action;
+    else if(darshan_path_trie_add_glob(trie, node, prefix, action) < 0)
+        return(-1);
+
+    trie->actions |= action;
+    return(0);
+}
+
+/* darshan_path_trie_build()
+ *
+ * compiles the path exclusion trie used by darshan_core_excluded_path().
+ * If the user provided a comma-separated list of exclusions, it overrides
+ * both the default exclusions and the default inclusions.
+ */
+static void darshan_path_trie_build(char *user_exclusions)
+{
+    struct darshan_path_trie *trie = &darshan_path_trie;
+    char *string;
+    char *token;
+    int i;
+
+    /* discard any trie inherited from before a fork */
+    darshan_path_trie_destroy(trie);
+
+    if(user_exclusions)
+    {
+        string = strdup(user_exclusions);
+        if(!string)
+            return;
+        for(token = strtok(string, ","); token; token = strtok(NULL, ","))
+            darshan_path_trie_insert(trie, token, DARSHAN_PATH_EXCLUDE);
+        free(string);
+    }
+    else
+    {
+        for(i = 0; darshan_path_exclusions[i]; i++)
+            darshan_path_trie_insert(trie, darshan_path_exclusions[i],
+                DARSHAN_PATH_EXCLUDE);
+        /* inclusions only matter if there is something to exclude */
+        if(trie->actions)
+        {
+            for(i = 0; darshan_path_inclusions[i]; i++)
+                darshan_path_trie_insert(trie, darshan_path_inclusions[i],
+                    DARSHAN_PATH_INCLUDE);
+        }
+    }
+
+    return;
+}
+
+/* darshan_get_exe_and_mounts()
+ *
+ * collects command line and list of mounted file systems into a string that
+ * will be stored with the job-level metadata
+ */
+static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
+    int argc, char **argv)
+{
+    FILE* tab;
+    struct mntent *entry;
+    char* exclude;
+    char* truncate_string = "<TRUNCATED>";
+    int truncate_offset;
+    int space_left = DARSHAN_EXE_LEN;
+    FILE *fh;
+    int i, ii;
+    int node;
+    char cmdl[DARSHAN_EXE_LEN];
+    int tmp_index = 0;
+    int skip = 0;
+    char* env_exclusions;
+
+    /* skip these fs types */
+    static char* fs_exclusions[] = {
         "tmpfs",
         "proc",
         "sysfs",
@@ -1078,39 +1952,18 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
             if (my_rank == 0)
                 darshan_core_fprintf(stderr, "Darshan info: no system dirs will be excluded\n");
             darshan_path_exclusions[0]=NULL;
+            darshan_path_trie_build(NULL);
         }
         else
         {
             if (my_rank == 0)
                 darshan_core_fprintf(stderr, "Darshan info: the following system dirs will be excluded: %s\n",
                     env_exclusions);
-            string = strdup(env_exclusions);
-            i = 0;
-            /* get the comma separated number of directories */
-            token = strtok(string, ",");
-            while (token != NULL)
-            {
-                i++;
-                token = strtok(NULL, ",");
-            }
-            user_darshan_path_exclusions=(char **)malloc((i+1)*sizeof(char *));
-            assert(user_darshan_path_exclusions);
-
-            i = 0;
-            strcpy(string, env_exclusions);
-            token = strtok(string, ",");
-            while (token != NULL)
-            {
-                user_darshan_path_exclusions[i]=(char *)malloc(strlen(token)+1);
-                assert(user_darshan_path_exclusions[i]);
-                strcpy(user_darshan_path_exclusions[i],token);
-                i++;
-                token = strtok(NULL, ",");
-            }
-            user_darshan_path_exclusions[i]=NULL;
-            free(string);
+            darshan_path_trie_build(env_exclusions);
         }
     }
+    else
+        darshan_path_trie_build(NULL);
 
     /* record exe and arguments */
     for(i=0; i<argc; i++)
@@ -1172,12 +2025,13 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
      * mount points
      */
     mnt_data_count = 0;
+    darshan_path_trie_destroy(&mnt_data_trie);
 
     tab = setmntent("/etc/mtab", "r");
     if(!tab)
         return;
     /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    while((entry = getmntent(tab)) != NULL)
     {
         /* filter out excluded fs types */
         tmp_index = 0;
@@ -1203,7 +2057,7 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
     if(!tab)
         return;
     /* loop through list of mounted file systems */
-    while(mnt_data_count<DARSHAN_MAX_MNTS && (entry = getmntent(tab)) != NULL)
+    while((entry = getmntent(tab)) != NULL)
     {
         if(strcmp(entry->mnt_type, "nfs") != 0)
             continue;
@@ -1212,27 +2066,106 @@ static void darshan_get_exe_and_mounts(struct darshan_core_runtime *core,
     }
     endmntent(tab);
 
-    /* sort mount points in order of longest path to shortest path.  This is
-     * necessary so that if we try to match file paths to mount points later
-     * we don't match on "/" every time.
+    /* build a trie of mount point paths so that file paths can later be
+     * matched to the mount point with the longest matching prefix. If a
+     * path is mounted more than once (add_entry() only drops mounts of the
+     * same path and type), the first mount recorded wins.
      */
-    qsort(mnt_data_array, mnt_data_count, sizeof(mnt_data_array[0]), mnt_data_cmp);
+    for(i=0; i<mnt_data_count; i++)
+    {
+        node = darshan_path_trie_add_prefix(&mnt_data_trie,
+            mnt_data_array[i].path, strlen(mnt_data_array[i].path));
+        if(node >= 0 && mnt_data_trie.nodes[node].mnt < 0)
+            mnt_data_trie.nodes[node].mnt = i;
+    }
+
     return;
 }
 
 static void darshan_fs_info_from_path(const char *path, struct darshan_fs_info *fs_info)
 {
-    int i;
+    struct darshan_path_trie_node *nodes = mnt_data_trie.nodes;
+    const char *p = path;
+    int node = 0;
+    int next;
+    int mnt = -1;
+
     fs_info->fs_type = -1;
     fs_info->block_size = -1;
 
-    for(i=0; i<mnt_data_count; i++)
+    if(!nodes)
+        return;
+
+    /* walk the trie along the path, remembering the deepest mount point
+     * that ends on a path component boundary
+     */
+    while(*p)
     {
-        if(!(strncmp(mnt_data_array[i].path, path, strlen(mnt_data_array[i].path))))
+        for(next = nodes[node].child; next >= 0; next = nodes[next].sibling)
         {
-            *fs_info = mnt_data_array[i].fs_info;
-            return;
+            if(nodes[next].c == *p)
+                break;
         }
+        if(next < 0)
+            break;
+
+        node = next;
+        p++;
+        if(nodes[node].mnt >= 0 && (*p == '/' || *p == '\0' || *(p-1) == '/'))
+            mnt = nodes[node].mnt;
+    }
+
+    if(mnt >= 0)
+        *fs_info = mnt_data_array[mnt].fs_info;
+
+    return;
+}
+
+/* returns the length of the prefix 'name' should share with the previous
+ * name in the front coded stream described by 'fc', which is 0 whenever a
+ * new restart block is due
+ */
+static int darshan_fc_name_prefix(struct darshan_fc_name_state *fc,
+    const char *name, int name_len)
+{
+    int prefix_len = 0;
+
+    /* names too long to keep as the previous name get a block of their own */
+    if(fc->restart_cnt == 0 || name_len >= PATH_MAX)
+        return(0);
+
+    while(fc->prev_name[prefix_len] &&
+          fc->prev_name[prefix_len] == name[prefix_len])
+        prefix_len++;
+
+    return(prefix_len);
+}
+
+/* appends a front coded record for 'name' at 'rec' (if non-NULL) and
+ * advances the stream state in 'fc' past it
+ */
+static void darshan_fc_name_append(struct darshan_fc_name_state *fc,
+    struct darshan_fc_name_record *rec, darshan_record_id rec_id,
+    const char *name, int name_len, int prefix_len)
+{
+    if(rec)
+    {
+        rec->id = rec_id;
+        rec->prefix_len = prefix_len;
+        strcpy(rec->suffix, name + prefix_len);
+    }
+    if(prefix_len == 0)
+        fc->restart_record = rec;
+
+    if(name_len < PATH_MAX)
+    {
+        strcpy(fc->prev_name + prefix_len, name + prefix_len);
+        fc->restart_cnt = (fc->restart_cnt + 1) % DARSHAN_NAME_RECORD_RESTART;
+    }
+    else
+    {
+        fc->prev_name[0] = '\0';
+        fc->restart_cnt = 0;
     }
 
     return;
@@ -1242,8 +2175,13 @@ static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
     darshan_record_id rec_id, const char *name, darshan_module_id mod_id)
 {
     struct darshan_core_name_record_ref *ref;
-    int record_size = sizeof(darshan_record_id) + strlen(name) + 1;
+    struct darshan_fc_name_record *rec;
+    int name_len = strlen(name);
+    int prefix_len;
+    int record_size;
 
+    prefix_len = darshan_fc_name_prefix(&core->name_fc, name, name_len);
+    record_size = DARSHAN_FC_NAME_RECORD_SIZE(name_len - prefix_len);
     if((record_size + core->name_mem_used) > DARSHAN_NAME_RECORD_BUF_SIZE)
         return(0);
 
@@ -1252,17 +2190,18 @@ static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
         return(0);
     memset(ref, 0, sizeof(*ref));
 
-    /* initialize the name record */
-    ref->name_record = (struct darshan_name_record *)
+    /* initialize the name record, front coded against the previous one */
+    rec = (struct darshan_fc_name_record *)
         ((char *)core->log_name_p + core->name_mem_used);
-    memset(ref->name_record, 0, record_size);
-    ref->name_record->id = rec_id;
-    strcpy(ref->name_record->name, name);
+    darshan_fc_name_append(&core->name_fc, rec, rec_id, name, name_len,
+        prefix_len);
+    ref->id = rec_id;
+    ref->name_record = rec;
+    ref->restart_record = core->name_fc.restart_record;
     DARSHAN_MOD_FLAG_SET(ref->mod_flags, mod_id);
 
     /* add the record to the hash table */
-    HASH_ADD(hlink, core->name_hash, name_record->id,
-        sizeof(darshan_record_id), ref);
+    HASH_ADD(hlink, core->name_hash, id, sizeof(darshan_record_id), ref);
     core->name_mem_used += record_size;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     core->log_hdr_p->name_map.len += record_size;
@@ -1271,6 +2210,42 @@ static int darshan_add_name_record_ref(struct darshan_core_runtime *core,
     return(1);
 }
 
+/* decodes the name of the given record into 'name', a buffer of size
+ * 'name_len', returning -1 if it does not fit
+ */
+static int darshan_decode_name_record(
+    struct darshan_core_name_record_ref *ref, char *name, int name_len)
+{
+    struct darshan_fc_name_record *rec = ref->restart_record;
+    int suffix_len;
+
+    suffix_len = strlen(ref->name_record->suffix);
+    if(ref->name_record->prefix_len + suffix_len >= name_len)
+        return(-1);
+
+    /* rebuild each name in this record's restart block, up to and including
+     * its own. earlier names are truncated to the buffer size, which is
+     * safe since each character only depends on those before it
+     */
+    while(1)
+    {
+        suffix_len = strlen(rec->suffix);
+        if(rec->prefix_len < name_len - 1)
+        {
+            if(suffix_len > name_len - 1 - rec->prefix_len)
+                suffix_len = name_len - 1 - rec->prefix_len;
+            memcpy(name + rec->prefix_len, rec->suffix, suffix_len);
+            name[rec->prefix_len + suffix_len] = '\0';
+        }
+        if(rec == ref->name_record)
+            break;
+        rec = (struct darshan_fc_name_record *)((char *)rec +
+            DARSHAN_FC_NAME_RECORD_SIZE(strlen(rec->suffix)));
+    }
+
+    return(0);
+}
+
 static void darshan_get_user_name(char *cuser)
 {
     char* logname_string;
@@ -1311,149 +2286,483 @@ static void darshan_get_user_name(char *cuser)
 }
 
 #ifdef HAVE_MPI
-static void darshan_get_shared_records(struct darshan_core_runtime *core,
-    darshan_record_id **shared_recs, int *shared_rec_cnt)
+static int darshan_shared_rec_cmp(const void *a, const void *b)
 {
-    int i, j;
-    int tmp_cnt = HASH_CNT(hlink, core->name_hash);
-    struct darshan_core_name_record_ref *tmp, *ref;
-    darshan_record_id *id_array;
-    uint64_t *mod_flags;
-    uint64_t *global_mod_flags;
+    darshan_record_id id_a = ((const struct darshan_shared_rec *)a)->id;
+    darshan_record_id id_b = ((const struct darshan_shared_rec *)b)->id;
 
-    /* broadcast root's number of records to all other processes */
-    PMPI_Bcast(&tmp_cnt, 1, MPI_INT, 0, core->mpi_comm);
-
-    /* use root record count to allocate data structures */
-    id_array = malloc(tmp_cnt * sizeof(darshan_record_id));
-    mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    global_mod_flags = malloc(tmp_cnt * sizeof(uint64_t));
-    *shared_recs = malloc(tmp_cnt * sizeof(darshan_record_id));
-    assert(id_array && mod_flags && global_mod_flags && *shared_recs);
+    if(id_a < id_b)
+        return(-1);
+    if(id_a > id_b)
+        return(1);
+    return(0);
+}
 
-    memset(mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(global_mod_flags, 0, tmp_cnt * sizeof(uint64_t));
-    memset(*shared_recs, 0, tmp_cnt * sizeof(darshan_record_id));
+/* intersect two lists of records sorted by id, in place in the first list:
+ * only records in both lists that were accessed by at least one of the
+ * same modules in each are kept. returns the number of records kept.
+ */
+static int darshan_shared_rec_intersect(struct darshan_shared_rec *recs,
+    int rec_cnt, struct darshan_shared_rec *peer_recs, int peer_cnt)
+{
+    int i = 0, j = 0, k = 0;
 
-    /* first, determine list of records root process has opened */
-    if(my_rank == 0)
+    while(i < rec_cnt && j < peer_cnt)
     {
-        i = 0;
-        HASH_ITER(hlink, core->name_hash, ref, tmp)
+        if(recs[i].id < peer_recs[j].id)
+            i++;
+        else if(recs[i].id > peer_recs[j].id)
+            j++;
+        else
         {
-            id_array[i++] = ref->name_record->id;
+            recs[k].id = recs[i].id;
+            recs[k].mod_flags = recs[i].mod_flags & peer_recs[j].mod_flags;
+            if(recs[k].mod_flags)
+                k++;
+            i++;
+            j++;
         }
     }
 
-    /* broadcast root's list of records to all other processes */
-    PMPI_Bcast(id_array, (tmp_cnt * sizeof(darshan_record_id)),
-        MPI_BYTE, 0, core->mpi_comm);
+    return(k);
+}
+
+static void darshan_get_shared_records(struct darshan_core_runtime *core,
+    darshan_record_id **shared_recs, int *shared_rec_cnt)
+{
+    int i;
+    int rec_cnt = HASH_CNT(hlink, core->name_hash);
+    int peer_cnt;
+    int peer_max = 0;
+    int mask;
+    struct darshan_core_name_record_ref *tmp, *ref;
+    struct darshan_shared_rec *recs;
+    struct darshan_shared_rec *peer_recs = NULL;
+    MPI_Status status;
+
+    /* start from the records this process accessed, sorted by id */
+    recs = malloc((rec_cnt ? rec_cnt : 1) * sizeof(*recs));
+    assert(recs);
+    i = 0;
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        recs[i].id = ref->id;
+        recs[i].mod_flags = ref->mod_flags;
+        i++;
+    }
+    qsort(recs, rec_cnt, sizeof(*recs), darshan_shared_rec_cmp);
 
-    /* everyone looks to see if they opened the same records as root */
-    for(i=0; i<tmp_cnt; i++)
+    /* intersect every process's records up a binomial tree rooted at rank
+     * 0, so each process takes part in at most log2(nprocs) exchanges. The
+     * lists only shrink on their way up the tree, and no process needs to
+     * hold any other process's full set of records.
+     */
+    for(mask = 1; mask < nprocs; mask <<= 1)
     {
-        HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-        if(ref)
+        if(my_rank & mask)
+        {
+            PMPI_Send(recs, rec_cnt * 2, MPI_UINT64_T, my_rank - mask,
+                DARSHAN_SHARED_REC_TAG, core->mpi_comm);
+            break;
+        }
+        if(my_rank + mask >= nprocs)
+            continue;
+
+        PMPI_Probe(my_rank + mask, DARSHAN_SHARED_REC_TAG, core->mpi_comm,
+            &status);
+        PMPI_Get_count(&status, MPI_UINT64_T, &peer_cnt);
+        peer_cnt /= 2;
+        if(peer_cnt > peer_max)
         {
-            /* we opened that record too, save the mod_flags */
-            mod_flags[i] = ref->mod_flags;
+            free(peer_recs);
+            peer_max = peer_cnt;
+            peer_recs = malloc(peer_max * sizeof(*peer_recs));
+            assert(peer_recs);
         }
+        PMPI_Recv(peer_recs, peer_cnt * 2, MPI_UINT64_T, my_rank + mask,
+            DARSHAN_SHARED_REC_TAG, core->mpi_comm, &status);
+        rec_cnt = darshan_shared_rec_intersect(recs, rec_cnt, peer_recs,
+            peer_cnt);
     }
+    free(peer_recs);
 
-    /* now allreduce so everyone agrees which records are shared and
-     * which modules accessed them collectively
+    /* rank 0 now has the records accessed by every process, which every
+     * process has room for, since they are a subset of its own records
      */
-    PMPI_Allreduce(mod_flags, global_mod_flags, tmp_cnt,
-        MPI_UINT64_T, MPI_BAND, core->mpi_comm);
+    PMPI_Bcast(&rec_cnt, 1, MPI_INT, 0, core->mpi_comm);
+    PMPI_Bcast(recs, rec_cnt * 2, MPI_UINT64_T, 0, core->mpi_comm);
 
-    j = 0;
-    for(i=0; i<tmp_cnt; i++)
+    *shared_recs = malloc((rec_cnt ? rec_cnt : 1) * sizeof(darshan_record_id));
+    assert(*shared_recs);
+    for(i = 0; i < rec_cnt; i++)
     {
-        if(global_mod_flags[i] != 0)
-        {
-            (*shared_recs)[j++] = id_array[i];
+        (*shared_recs)[i] = recs[i].id;
 
-            /* set global_mod_flags so we know which modules collectively
-             * accessed this module. we need this info to support shared
-             * record reductions
-             */
-            HASH_FIND(hlink, core->name_hash, &id_array[i], sizeof(darshan_record_id), ref);
-            assert(ref);
-            ref->global_mod_flags = global_mod_flags[i];
-        }
+        /* set global_mod_flags so we know which modules collectively
+         * accessed this module. we need this info to support shared
+         * record reductions
+         */
+        HASH_FIND(hlink, core->name_hash, &recs[i].id,
+            sizeof(darshan_record_id), ref);
+        assert(ref);
+        ref->global_mod_flags = recs[i].mod_flags;
     }
-    *shared_rec_cnt = j;
+    *shared_rec_cnt = rec_cnt;
 
-    free(id_array);
-    free(mod_flags);
-    free(global_mod_flags);
+    free(recs);
     return;
 }
-#endif
 
-/* construct the darshan log file name */
-static void darshan_get_logfile_name(
-    char* logfile_name, struct darshan_core_runtime* core)
+/* a record, a process that accessed it, and the modules that did so, as
+ * gathered by the process that owns the record for subset detection
+ */
+struct darshan_subset_rec
 {
-    char* user_logfile_name;
-    char* logpath;
-    char* logpath_override = NULL;
-#ifdef __DARSHAN_LOG_ENV
-    char env_check[256];
-    char* env_tok;
-#endif
-    uint64_t hlevel;
-    char hname[HOST_NAME_MAX];
-    uint64_t logmod;
-    char cuser[L_cuserid] = {0};
-    struct tm *start_tm;
-    int jobid;
-    int pid;
-    time_t start_time;
-    int ret;
+    darshan_record_id id;
+    uint64_t mod_flags;
+    int rank;
+};
 
-#ifdef HAVE_MPI
-    if (using_mpi && my_rank > 0)
-        goto bcast;
-#endif
+static int darshan_subset_rec_cmp(const void *a, const void *b)
+{
+    const struct darshan_subset_rec *rec_a = a;
+    const struct darshan_subset_rec *rec_b = b;
 
-    jobid = core->log_job_p->jobid;
-    pid = core->pid;
-    start_time = core->log_job_p->start_time;
+    if(rec_a->id != rec_b->id)
+        return((rec_a->id < rec_b->id) ? -1 : 1);
+    return(rec_a->rank - rec_b->rank);
+}
 
-    /* first, check if user specifies a complete logpath to use */
-    user_logfile_name = getenv("DARSHAN_LOGFILE");
-    if(user_logfile_name)
+/* compare two subset shared records, each in the form sent back by their
+ * owners (<id> <mod flags> <member count> <members...>), by their members
+ * and then by id
+ */
+static int darshan_subset_reply_cmp(const void *a, const void *b)
+{
+    const uint64_t *reply_a = *(const uint64_t **)a;
+    const uint64_t *reply_b = *(const uint64_t **)b;
+    uint64_t i;
+
+    if(reply_a[2] != reply_b[2])
+        return((reply_a[2] < reply_b[2]) ? -1 : 1);
+    for(i = 0; i < reply_a[2]; i++)
     {
-        if(strlen(user_logfile_name) >= (PATH_MAX-1))
-        {
-            DARSHAN_WARN("user log file name too long");
-            logfile_name[0] = '\0';
-        }
-        else
-        {
-            strcpy(logfile_name, user_logfile_name);
-        }
+        if(reply_a[3+i] != reply_b[3+i])
+            return((reply_a[3+i] < reply_b[3+i]) ? -1 : 1);
     }
-    else
-    {
-        /* otherwise, generate the log path automatically */
+    if(reply_a[0] != reply_b[0])
+        return((reply_a[0] < reply_b[0]) ? -1 : 1);
+    return(0);
+}
 
-        /* Use DARSHAN_LOG_PATH_OVERRIDE for the value or __DARSHAN_LOG_PATH */
-        logpath = getenv(DARSHAN_LOG_PATH_OVERRIDE);
-        if(!logpath)
-        {
-#ifdef __DARSHAN_LOG_PATH
-            logpath = __DARSHAN_LOG_PATH;
-#endif
-        }
+/* exchange variable length lists of 64-bit words with every process */
+static uint64_t *darshan_subset_exchange(struct darshan_core_runtime *core,
+    uint64_t *send_buf, int *send_cnts, int *recv_cnts, int *recv_total)
+{
+    int *send_displs = send_cnts + nprocs;
+    int *recv_displs = recv_cnts + nprocs;
+    uint64_t *recv_buf;
+    int i;
 
-        darshan_get_user_name(cuser);
+    PMPI_Alltoall(send_cnts, 1, MPI_INT, recv_cnts, 1, MPI_INT,
+        core->mpi_comm);
+    send_displs[0] = recv_displs[0] = 0;
+    for(i = 1; i < nprocs; i++)
+    {
+        send_displs[i] = send_displs[i-1] + send_cnts[i-1];
+        recv_displs[i] = recv_displs[i-1] + recv_cnts[i-1];
+    }
+    *recv_total = recv_displs[nprocs-1] + recv_cnts[nprocs-1];
 
-        /* generate a random number to help differentiate the log */
-        hlevel = darshan_core_wtime() * 1000000;
-        (void)gethostname(hname, sizeof(hname));
-        logmod = darshan_hash((void*)hname,strlen(hname),hlevel);
+    recv_buf = malloc((*recv_total ? *recv_total : 1) * sizeof(uint64_t));
+    assert(recv_buf);
+    PMPI_Alltoallv(send_buf, send_cnts, send_displs, MPI_UINT64_T,
+        recv_buf, recv_cnts, recv_displs, MPI_UINT64_T, core->mpi_comm);
+
+    return(recv_buf);
+}
+
+/* find the records that more than one, but not every, process accessed
+ * (with at least one module in common), and group them by the set of
+ * processes that accessed them, creating a communicator for each group.
+ * each record is assigned to an owner process by id, which gathers the
+ * processes that accessed it and reports back to each of them, so no
+ * process handles more than its share of the job's records. to bound the
+ * number of communicators, a group is only formed if none of its members
+ * belongs to more than DARSHAN_SHARED_GROUP_MAX groups.
+ */
+static void darshan_get_subset_shared_records(
+    struct darshan_core_runtime *core, struct darshan_shared_group **groups,
+    int *group_cnt)
+{
+    struct darshan_core_name_record_ref *tmp, *ref;
+    struct darshan_subset_rec *recs;
+    struct darshan_shared_group *group;
+    uint64_t *send_buf, *recv_buf;
+    uint64_t **replies;
+    uint64_t *p;
+    uint64_t flags;
+    int *send_cnts, *recv_cnts, *pos;
+    int send_total, recv_total;
+    int rec_cnt, reply_cnt;
+    int *members;
+    int *member_group_cnts;
+    int local_group_cnt = 0;
+    int i, j, k, m, g;
+    MPI_Group world_group, mpi_group;
+
+    *groups = NULL;
+    *group_cnt = 0;
+
+    /* the second half of each count array holds displacements */
+    send_cnts = calloc(2 * nprocs, sizeof(int));
+    recv_cnts = calloc(2 * nprocs, sizeof(int));
+    pos = malloc(nprocs * sizeof(int));
+    members = malloc(nprocs * sizeof(int));
+    member_group_cnts = malloc(nprocs * sizeof(int));
+    assert(send_cnts && recv_cnts && pos && members && member_group_cnts);
+
+    /* send each record not shared by all processes to its owner */
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        if(!ref->global_mod_flags)
+            send_cnts[ref->id % nprocs] += 2;
+    }
+    for(i = 0, send_total = 0; i < nprocs; i++)
+    {
+        pos[i] = send_total;
+        send_total += send_cnts[i];
+    }
+    send_buf = malloc((send_total ? send_total : 1) * sizeof(uint64_t));
+    assert(send_buf);
+    HASH_ITER(hlink, core->name_hash, ref, tmp)
+    {
+        if(ref->global_mod_flags)
+            continue;
+        k = ref->id % nprocs;
+        send_buf[pos[k]++] = ref->id;
+        send_buf[pos[k]++] = ref->mod_flags;
+    }
+    recv_buf = darshan_subset_exchange(core, send_buf, send_cnts, recv_cnts,
+        &recv_total);
+    free(send_buf);
+
+    /* sort the owned records by id, then by the rank that accessed them */
+    rec_cnt = recv_total / 2;
+    recs = malloc((rec_cnt ? rec_cnt : 1) * sizeof(*recs));
+    assert(recs);
+    for(i = 0, j = 0; i < nprocs; i++)
+    {
+        for(k = 0; k < recv_cnts[i] / 2; k++, j++)
+        {
+            recs[j].id = recv_buf[2*j];
+            recs[j].mod_flags = recv_buf[2*j+1];
+            recs[j].rank = i;
+        }
+    }
+    free(recv_buf);
+    qsort(recs, rec_cnt, sizeof(*recs), darshan_subset_rec_cmp);
+
+    /* for each owned record accessed by more than one process with a
+     * module in common, send the record, those modules, and the list of
+     * processes to each of those processes. the modules in common are
+     * stored in the first entry for the record.
+     */
+    memset(send_cnts, 0, nprocs * sizeof(int));
+    for(j = 0; j < rec_cnt; j = k)
+    {
+        flags = recs[j].mod_flags;
+        for(k = j + 1; k < rec_cnt && recs[k].id == recs[j].id; k++)
+            flags &= recs[k].mod_flags;
+        recs[j].mod_flags = flags;
+        if(k - j < 2 || !flags)
+            continue;
+        for(m = j; m < k; m++)
+            send_cnts[recs[m].rank] += 3 + (k - j);
+    }
+    for(i = 0, send_total = 0; i < nprocs; i++)
+    {
+        pos[i] = send_total;
+        send_total += send_cnts[i];
+    }
+    send_buf = malloc((send_total ? send_total : 1) * sizeof(uint64_t));
+    assert(send_buf);
+    for(j = 0; j < rec_cnt; j = k)
+    {
+        for(k = j + 1; k < rec_cnt && recs[k].id == recs[j].id; k++);
+        if(k - j < 2 || !recs[j].mod_flags)
+            continue;
+        for(m = j; m < k; m++)
+        {
+            p = &send_buf[pos[recs[m].rank]];
+            pos[recs[m].rank] += 3 + (k - j);
+            p[0] = recs[j].id;
+            p[1] = recs[j].mod_flags;
+            p[2] = k - j;
+            for(i = j; i < k; i++)
+                p[3 + i - j] = recs[i].rank;
+        }
+    }
+    free(recs);
+    recv_buf = darshan_subset_exchange(core, send_buf, send_cnts, recv_cnts,
+        &recv_total);
+    free(send_buf);
+
+    /* order this process's subset shared records by the processes that
+     * accessed them, so that every process creates the groups it belongs
+     * to in the same (global) order
+     */
+    for(i = 0, reply_cnt = 0; i < recv_total; i += 3 + recv_buf[i+2])
+        reply_cnt++;
+    replies = malloc((reply_cnt ? reply_cnt : 1) * sizeof(*replies));
+    assert(replies);
+    for(i = 0, j = 0; i < recv_total; i += 3 + recv_buf[i+2])
+        replies[j++] = &recv_buf[i];
+    qsort(replies, reply_cnt, sizeof(*replies), darshan_subset_reply_cmp);
+
+    for(j = 0; j < reply_cnt; j++)
+    {
+        if(j == 0 || replies[j][2] != replies[j-1][2] ||
+            memcmp(&replies[j][3], &replies[j-1][3],
+            replies[j][2] * sizeof(uint64_t)))
+            local_group_cnt++;
+    }
+
+    /* every process learns how many groups each process belongs to, so
+     * that the members of a group all agree on whether to form it
+     */
+    PMPI_Allgather(&local_group_cnt, 1, MPI_INT, member_group_cnts, 1,
+        MPI_INT, core->mpi_comm);
+    if(local_group_cnt)
+    {
+        *groups = calloc(local_group_cnt, sizeof(**groups));
+        assert(*groups);
+        PMPI_Comm_group(core->mpi_comm, &world_group);
+    }
+
+    for(j = 0, g = 0; j < reply_cnt; j = k)
+    {
+        /* records with the same processes are adjacent after sorting */
+        for(k = j + 1; k < reply_cnt; k++)
+        {
+            if(replies[k][2] != replies[j][2] ||
+                memcmp(&replies[k][3], &replies[j][3],
+                replies[j][2] * sizeof(uint64_t)))
+                break;
+        }
+
+        for(i = 0; i < (int)replies[j][2]; i++)
+        {
+            members[i] = replies[j][3+i];
+            if(member_group_cnts[members[i]] > DARSHAN_SHARED_GROUP_MAX)
+                break;
+        }
+        if(i < (int)replies[j][2])
+            continue; /* leave the group's records unreduced */
+
+        group = &(*groups)[g++];
+        group->recs = malloc((k - j) * sizeof(darshan_record_id));
+        assert(group->recs);
+        for(m = j; m < k; m++)
+        {
+            group->recs[group->rec_cnt++] = replies[m][0];
+
+            /* set global_mod_flags so we know which modules collectively
+             * accessed this record within the group
+             */
+            HASH_FIND(hlink, core->name_hash, &replies[m][0],
+                sizeof(darshan_record_id), ref);
+            assert(ref);
+            ref->global_mod_flags = replies[m][1];
+            ref->shared_root = replies[m][3];
+        }
+
+        /* only the members of the group take part in creating its
+         * communicator
+         */
+        PMPI_Group_incl(world_group, replies[j][2], members, &mpi_group);
+        PMPI_Comm_create_group(core->mpi_comm, mpi_group,
+            DARSHAN_SHARED_GROUP_TAG, &group->comm);
+        PMPI_Group_free(&mpi_group);
+    }
+    if(local_group_cnt)
+        PMPI_Group_free(&world_group);
+    *group_cnt = g;
+
+    free(replies);
+    free(recv_buf);
+    free(send_cnts);
+    free(recv_cnts);
+    free(pos);
+    free(members);
+    free(member_group_cnts);
+    return;
+}
+#endif
+
+/* construct the darshan log file name */
+static void darshan_get_logfile_name(
+    char* logfile_name, struct darshan_core_runtime* core)
+{
+    char* user_logfile_name;
+    char* logpath;
+    char* logpath_override = NULL;
+#ifdef __DARSHAN_LOG_ENV
+    char env_check[256];
+    char* env_tok;
+#endif
+    uint64_t hlevel;
+    char hname[HOST_NAME_MAX];
+    uint64_t logmod;
+    char cuser[L_cuserid] = {0};
+    struct tm *start_tm;
+    int jobid;
+    int pid;
+    time_t start_time;
+    int ret;
+
+#ifdef HAVE_MPI
+    if (using_mpi && my_rank > 0)
+        goto bcast;
+#endif
+
+    jobid = core->log_job_p->jobid;
+    pid = core->pid;
+    start_time = core->log_job_p->start_time;
+
+    /* first, check if user specifies a complete logpath to use */
+    user_logfile_name = getenv("DARSHAN_LOGFILE");
+    if(user_logfile_name)
+    {
+        if(strlen(user_logfile_name) >= (PATH_MAX-1))
+        {
+            DARSHAN_WARN("user log file name too long");
+            logfile_name[0] = '\0';
+        }
+        else
+        {
+            strcpy(logfile_name, user_logfile_name);
+        }
+    }
+    else
+    {
+        /* otherwise, generate the log path automatically */
+
+        /* Use DARSHAN_LOG_PATH_OVERRIDE for the value or __DARSHAN_LOG_PATH */
+        logpath = getenv(DARSHAN_LOG_PATH_OVERRIDE);
+        if(!logpath)
+        {
+#ifdef __DARSHAN_LOG_PATH
+            logpath = __DARSHAN_LOG_PATH;
+#endif
+        }
+
+        darshan_get_user_name(cuser);
+
+        /* generate a random number to help differentiate the log */
+        hlevel = darshan_core_wtime() * 1000000;
+        (void)gethostname(hname, sizeof(hname));
+        logmod = darshan_hash((void*)hname,strlen(hname),hlevel);
 
         /* use human readable start time format in log filename */
         start_tm = localtime(&start_time);
@@ -1560,6 +2869,15 @@ static int darshan_log_open(char *logfile_name, struct darshan_core_runtime *cor
 
     if(using_mpi)
     {
+        /* processes whose log data is written by another process on their
+         * node do not open the log file at all
+         */
+        if(core->log_comm == MPI_COMM_NULL)
+        {
+            log_fh->mpi_fh = MPI_FILE_NULL;
+            return(0);
+        }
+
         /* check environment variable to see if the default MPI file hints have
          * been overridden
          */
@@ -1601,7 +2919,7 @@ static int darshan_log_open(char *logfile_name, struct darshan_core_runtime *cor
         }
 
         /* open the darshan log file for writing using MPI */
-        ret = MPI_File_open(core->mpi_comm, logfile_name,
+        ret = MPI_File_open(core->log_comm, logfile_name,
             MPI_MODE_CREATE | MPI_MODE_WRONLY | MPI_MODE_EXCL, info, &log_fh->mpi_fh);
         MPI_Info_free(&info);
         if(ret != MPI_SUCCESS)
@@ -1618,12 +2936,16 @@ static int darshan_log_open(char *logfile_name, struct darshan_core_runtime *cor
 }
 
 static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
-    struct darshan_core_runtime *core, uint64_t *inout_off)
+    struct darshan_core_runtime *core, struct darshan_comp_region *region,
+    uint64_t *inout_off)
 {
-    void *pointers[2] = {core->log_job_p, core->log_exemnt_p};
-    int lengths[2] = {sizeof(struct darshan_job), strlen(core->log_exemnt_p)};
-    int comp_buf_sz = 0;
+    int comp_buf_sz = region->comp_buf_sz;
     int ret;
+#ifdef HAVE_MPI
+    void *buf;
+    int count;
+    MPI_Datatype type;
+#endif
 
 #ifdef HAVE_MPI
     /* only rank 0 writes the job record */
@@ -1631,9 +2953,7 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
         return(0);
 #endif
 
-    /* compress the job info and the trailing mount/exe data */
-    ret = darshan_deflate_buffer(pointers, lengths, 2,
-        core->comp_buf, &comp_buf_sz);
+    ret = region->ret;
     if(ret)
     {
         DARSHAN_WARN("error compressing job record");
@@ -1647,8 +2967,11 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
         MPI_Status status;
         if(using_mpi)
         {
-            ret = PMPI_File_write_at(log_fh.mpi_fh, *inout_off, core->comp_buf,
-                comp_buf_sz, MPI_BYTE, &status);
+            darshan_comp_region_type(region, &buf, &count, &type);
+            ret = PMPI_File_write_at(log_fh.mpi_fh, *inout_off, buf, count,
+                type, &status);
+            if(type != MPI_BYTE)
+                PMPI_Type_free(&type);
             if(ret != MPI_SUCCESS)
             {
                 DARSHAN_WARN("error writing job record");
@@ -1664,8 +2987,8 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
         }
 #endif
 
-        ret = pwrite(log_fh.nompi_fd, core->comp_buf, comp_buf_sz, *inout_off);
-        if(ret != comp_buf_sz)
+        ret = darshan_comp_region_pwrite(log_fh.nompi_fd, region, *inout_off);
+        if(ret < 0)
         {
             DARSHAN_WARN("error writing job record");
             ret = -1;
@@ -1680,101 +3003,117 @@ static int darshan_log_write_job_record(darshan_core_log_fh log_fh,
     return(ret);
 }
 
-static int darshan_log_write_name_record_hash(darshan_core_log_fh log_fh,
-    struct darshan_core_runtime *core, uint64_t *inout_off)
+/* get the buffer of name records this process should write to the log,
+ * which must be freed if it is not the runtime's own name record buffer
+ */
+static void darshan_log_get_name_records(struct darshan_core_runtime *core,
+    void **out_buf, int *out_buf_len)
 {
+    void *name_rec_buf = core->log_name_p;
+    int name_rec_buf_len = core->name_mem_used;
+
+#ifdef HAVE_MPI
     struct darshan_core_name_record_ref *ref;
-    struct darshan_name_record *name_rec;
-    char *my_buf, *shared_buf;
-    char *tmp_p;
+    struct darshan_fc_name_record *rec, *out_rec;
+    struct darshan_fc_name_state *fc = NULL;
+    char *name = NULL;
+    char *rec_name;
     int rec_len;
-    int shared_buf_len;
-    int name_rec_buf_len;
-    int ret;
+    int name_len;
+    int prefix_len;
+    int buf_len;
+    int pass;
 
-    name_rec_buf_len = core->name_mem_used;
-#ifdef HAVE_MPI
     if(using_mpi && (my_rank > 0))
     {
-        /* remove globally shared name records from non-zero ranks */
+        /* remove shared name records from ranks other than the one that
+         * keeps the reduced record (rank 0, for globally shared records)
+         */
 
-        name_rec = core->log_name_p;
-        my_buf = core->log_name_p;
-        shared_buf = core->comp_buf;
-        shared_buf_len = 0;
-        while(name_rec_buf_len > 0)
+        /* since the records left behind must be front coded against each
+         * other rather than against the records they followed, they are
+         * re-encoded into a separate buffer, leaving the runtime's copy
+         * intact so modules can still look up names as they shutdown.
+         * the first pass only sizes this buffer and the second fills it in.
+         * if memory runs short, all of this rank's records are written,
+         * which is harmless since readers ignore duplicate records
+         */
+        fc = malloc(sizeof(*fc));
+        name = malloc(PATH_MAX);
+        for(pass = 0; fc && name && pass < 2; pass++)
         {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
-                sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
-
-            if(ref->global_mod_flags)
+            memset(fc, 0, sizeof(*fc));
+            if(pass == 0)
             {
-                /* this record is shared globally, move to the temporary
-                 * shared record buffer and update hash references
-                 */
-                HASH_DELETE(hlink, core->name_hash, ref);
-                memcpy(shared_buf, name_rec, rec_len);
-                ref->name_record = (struct darshan_name_record *)shared_buf;
-                HASH_ADD(hlink, core->name_hash, name_record->id,
-                    sizeof(darshan_record_id), ref);
-
-                shared_buf += rec_len;
-                shared_buf_len += rec_len;
+                out_rec = NULL;
+                name_rec_buf_len = 0;
             }
             else
+                out_rec = name_rec_buf;
+            rec = core->log_name_p;
+            buf_len = core->name_mem_used;
+            while(buf_len > 0)
             {
-                /* this record is not shared, but we still may need to
-                 * move it forward in our buffer and update hash references
-                 */
-                if(my_buf != (char *)name_rec)
+                /* decode this record's full name */
+                rec_len = strlen(rec->suffix);
+                if(rec->prefix_len == 0 && rec_len >= PATH_MAX)
                 {
-                    HASH_DELETE(hlink, core->name_hash, ref);
-                    memcpy(my_buf, name_rec, rec_len);
-                    ref->name_record =(struct darshan_name_record *)my_buf;
-                    HASH_ADD(hlink, core->name_hash, name_record->id,
-                        sizeof(darshan_record_id), ref);
+                    rec_name = rec->suffix;
+                    name_len = rec_len;
                 }
-                my_buf += rec_len;
-            }
+                else
+                {
+                    strcpy(name + rec->prefix_len, rec->suffix);
+                    rec_name = name;
+                    name_len = rec->prefix_len + rec_len;
+                }
+                rec_len = DARSHAN_FC_NAME_RECORD_SIZE(rec_len);
 
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            name_rec_buf_len -= rec_len;
-        }
-        name_rec_buf_len = core->name_mem_used - shared_buf_len;
+                HASH_FIND(hlink, core->name_hash, &(rec->id),
+                    sizeof(darshan_record_id), ref);
+                assert(ref);
 
-        /* append the shared records back to the end of the name record
-         * buffer and update hash table references so we can still
-         * reference these records as modules shutdown
-         */
-        name_rec = (struct darshan_name_record *)core->comp_buf;
-        while(shared_buf_len > 0)
-        {
-            HASH_FIND(hlink, core->name_hash, &(name_rec->id),
-                sizeof(darshan_record_id), ref);
-            assert(ref);
-            rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+                if(!ref->global_mod_flags || ref->shared_root == my_rank)
+                {
+                    /* this record is not shared (or this rank keeps the
+                     * shared record), so front code it into
+                     * the output buffer
+                     */
+                    prefix_len = darshan_fc_name_prefix(fc, rec_name, name_len);
+                    darshan_fc_name_append(fc, out_rec, rec->id, rec_name,
+                        name_len, prefix_len);
+                    if(out_rec)
+                        out_rec = (struct darshan_fc_name_record *)
+                            ((char *)out_rec +
+                            DARSHAN_FC_NAME_RECORD_SIZE(name_len - prefix_len));
+                    else
+                        name_rec_buf_len +=
+                            DARSHAN_FC_NAME_RECORD_SIZE(name_len - prefix_len);
+                }
 
-            HASH_DELETE(hlink, core->name_hash, ref);
-            memcpy(my_buf, name_rec, rec_len);
-            ref->name_record = (struct darshan_name_record *)my_buf;
-            HASH_ADD(hlink, core->name_hash, name_record->id,
-                sizeof(darshan_record_id), ref);
+                rec = (struct darshan_fc_name_record *)((char *)rec + rec_len);
+                buf_len -= rec_len;
+            }
 
-            tmp_p = (char *)name_rec + rec_len;
-            name_rec = (struct darshan_name_record *)tmp_p;
-            my_buf += rec_len;
-            shared_buf_len -= rec_len;
+            if(pass == 0)
+            {
+                name_rec_buf = malloc(name_rec_buf_len);
+                if(!name_rec_buf)
+                {
+                    name_rec_buf = core->log_name_p;
+                    name_rec_buf_len = core->name_mem_used;
+                    break;
+                }
+            }
         }
+        free(fc);
+        free(name);
     }
 #endif
 
-    /* collectively write out the record hash to the darshan log */
-    ret = darshan_log_append(log_fh, core, core->log_name_p,
-        name_rec_buf_len, inout_off);
-    return(ret);
+    *out_buf = name_rec_buf;
+    *out_buf_len = name_rec_buf_len;
+    return;
 }
 
 static int darshan_log_write_header(darshan_core_log_fh log_fh,
@@ -1782,17 +3121,26 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
 {
     int ret;
 
-    core->log_hdr_p->comp_type = DARSHAN_ZLIB_COMP;
+    core->log_hdr_p->comp_type = darshan_log_comp_type;
 
 #ifdef HAVE_MPI
     MPI_Status status;
     if(using_mpi)
     {
-        /* write out log header, after running 2 reductions on header variables:
+        /* write out log header, after running reductions on header variables:
          *  1) reduce 'partial_flag' variable to determine which modules ran out
          *     of memory for storing data
          *  2) reduce 'mod_ver' array to determine which log format version each
          *     module used for this output log
+         *  3) reduce 'mod_mem' array to determine the most record memory
+         *     any process used for each module
+         *  4) reduce 'mod_sample' array to determine which modules
+         *     sampled operations on any process
+         *  5) reduce 'sparse_flag' and 'columnar_flag' variables to
+         *     determine which modules' records were sparse encoded or
+         *     stored in columns
+         *  6) reduce 'estimate_flag' variable to determine which modules
+         *     estimated common value counts on any process
          */
         if(my_rank == 0)
         {
@@ -1802,6 +3150,21 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
             PMPI_Reduce(
                 MPI_IN_PLACE, &(core->log_hdr_p->mod_ver),
                 DARSHAN_MAX_MODS, MPI_UINT32_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                MPI_IN_PLACE, &(core->log_hdr_p->mod_mem),
+                DARSHAN_MAX_MODS, MPI_UINT64_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                MPI_IN_PLACE, &(core->log_hdr_p->mod_sample),
+                DARSHAN_MAX_MODS, MPI_UINT32_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                MPI_IN_PLACE, &(core->log_hdr_p->sparse_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
+            PMPI_Reduce(
+                MPI_IN_PLACE, &(core->log_hdr_p->columnar_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
+            PMPI_Reduce(
+                MPI_IN_PLACE, &(core->log_hdr_p->estimate_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
         }
         else
         {
@@ -1811,6 +3174,21 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
             PMPI_Reduce(
                 &(core->log_hdr_p->mod_ver), &(core->log_hdr_p->mod_ver),
                 DARSHAN_MAX_MODS, MPI_UINT32_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                &(core->log_hdr_p->mod_mem), &(core->log_hdr_p->mod_mem),
+                DARSHAN_MAX_MODS, MPI_UINT64_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                &(core->log_hdr_p->mod_sample), &(core->log_hdr_p->mod_sample),
+                DARSHAN_MAX_MODS, MPI_UINT32_T, MPI_MAX, 0, core->mpi_comm);
+            PMPI_Reduce(
+                &(core->log_hdr_p->sparse_flag), &(core->log_hdr_p->sparse_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
+            PMPI_Reduce(
+                &(core->log_hdr_p->columnar_flag), &(core->log_hdr_p->columnar_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
+            PMPI_Reduce(
+                &(core->log_hdr_p->estimate_flag), &(core->log_hdr_p->estimate_flag),
+                1, MPI_UINT32_T, MPI_BOR, 0, core->mpi_comm);
             return(0); /* only rank 0 writes the header */
         }
 
@@ -1845,93 +3223,299 @@ static int darshan_log_write_header(darshan_core_log_fh log_fh,
     return(ret);
 }
 
+#ifdef HAVE_MPI
+/* if node aggregation is enabled, split the processes into one group per
+ * node, the first process of which (the node's leader) writes the log
+ * data of the whole node. otherwise, every process writes its own data.
+ */
+static void darshan_log_split_writers(struct darshan_core_runtime *core)
+{
+#if MPI_VERSION >= 3
+    int node_rank;
+
+    if(!getenv(DARSHAN_NODE_AGGREGATION))
+        return;
+
+    /* ordering by rank makes rank 0 the leader of its node, as well as
+     * rank 0 of the leaders, so that it can still write the header and
+     * job record and track the end of the log
+     */
+    PMPI_Comm_split_type(core->mpi_comm, MPI_COMM_TYPE_SHARED, my_rank,
+        MPI_INFO_NULL, &core->node_comm);
+    PMPI_Comm_rank(core->node_comm, &node_rank);
+    PMPI_Comm_split(core->mpi_comm, (node_rank == 0) ? 0 : MPI_UNDEFINED,
+        my_rank, &core->log_comm);
+#endif
+
+    return;
+}
+
+/* write each process's buffer ('count' elements of 'type', making up
+ * 'buf_sz' bytes), back to back in rank order, with a collective write
+ * over the given communicator.
+ * NOTE: inout_off contains the starting offset of this append at the
+ *       beginning of the call, and contains the ending offset at the end
+ *       of the call. This variable is only valid on the root rank (rank 0).
+ */
+static int darshan_log_append_all(darshan_core_log_fh log_fh, MPI_Comm comm,
+    void *buf, int count, MPI_Datatype type, uint64_t buf_sz, int ret,
+    uint64_t *inout_off)
+{
+    MPI_Offset send_off, my_off;
+    MPI_Status status;
+    int comm_rank, comm_size;
+
+    PMPI_Comm_rank(comm, &comm_rank);
+    PMPI_Comm_size(comm, &comm_size);
+
+    /* figure out where everyone is writing using scan */
+    send_off = buf_sz;
+    if(comm_rank == 0)
+    {
+        send_off += *inout_off; /* rank 0 knows the beginning offset */
+    }
+
+    PMPI_Scan(&send_off, &my_off, 1, MPI_OFFSET, MPI_SUM, comm);
+    /* scan is inclusive; subtract local size back out */
+    my_off -= buf_sz;
+
+    if(ret == 0)
+    {
+        /* no compression errors, proceed with the collective write */
+        ret = PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
+            buf, count, type, &status);
+        if(ret != MPI_SUCCESS)
+            ret = -1;
+    }
+    else
+    {
+        /* error during compression. preserve and return error to caller,
+         * but participate in collective write to avoid deadlock.
+         */
+        (void)PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
+            buf, count, type, &status);
+    }
+
+    if(comm_size > 1)
+    {
+        /* send the ending offset from rank (n-1) to rank 0 */
+        if(comm_rank == (comm_size-1))
+        {
+            my_off += buf_sz;
+            PMPI_Send(&my_off, 1, MPI_OFFSET, 0, 0, comm);
+        }
+        if(comm_rank == 0)
+        {
+            PMPI_Recv(&my_off, 1, MPI_OFFSET, (comm_size-1), 0, comm, &status);
+
+            *inout_off = my_off;
+        }
+    }
+    else
+    {
+        *inout_off = my_off + buf_sz;
+    }
+
+    return(ret);
+}
+#endif
+
 /* NOTE: inout_off contains the starting offset of this append at the beginning
  *       of the call, and contains the ending offset at the end of the call.
  *       This variable is only valid on the root rank (rank 0).
  */
 static int darshan_log_append(darshan_core_log_fh log_fh, struct darshan_core_runtime *core,
-    void *buf, int count, uint64_t *inout_off)
+    struct darshan_comp_region *region, uint64_t *inout_off)
 {
-    int comp_buf_sz = 0;
-    int ret;
+    int comp_buf_sz = region->comp_buf_sz;
+    int ret = region->ret;
 
-    /* compress the input buffer */
-    ret = darshan_deflate_buffer((void **)&buf, &count, 1,
-        core->comp_buf, &comp_buf_sz);
+    /* write nothing for regions that failed to compress */
     if(ret < 0)
         comp_buf_sz = 0;
 
 #ifdef HAVE_MPI
-    MPI_Offset send_off, my_off;
+    void *buf;
+    int count;
+    MPI_Datatype type, node_type;
     MPI_Status status;
+    char *node_buf = NULL;
+    uint64_t *node_szs = NULL;
+    uint64_t my_sz = comp_buf_sz;
+    uint64_t batch_sz, batch_max_sz = 0;
+    int batch_cnt = 0, max_batch_cnt;
+    int node_count;
+    int node_rank, node_size;
+    int b, i, j;
 
     if(using_mpi)
     {
-        /* figure out where everyone is writing using scan */
-        send_off = comp_buf_sz;
-        if(my_rank == 0)
+        /* the region's compressed data is written straight out of the
+         * blocks it was compressed into
+         */
+        darshan_comp_region_type(region, &buf, &count, &type);
+
+        if(core->node_comm == MPI_COMM_NULL)
         {
-            send_off += *inout_off; /* rank 0 knows the beginning offset */
+            ret = darshan_log_append_all(log_fh, core->mpi_comm, buf, count,
+                type, comp_buf_sz, ret, inout_off);
+            if(type != MPI_BYTE)
+                PMPI_Type_free(&type);
+            return(ret);
         }
 
-        PMPI_Scan(&send_off, &my_off, 1, MPI_OFFSET, MPI_SUM, core->mpi_comm);
-        /* scan is inclusive; subtract local size back out */
-        my_off -= comp_buf_sz;
+        /* send the compressed data of every process on this node to the
+         * node's leader, which writes it out in rank order, in batches of
+         * bounded size. each process's data is a complete compressed
+         * stream, so the streams can simply be concatenated, and readers
+         * decompress them one after the other.
+         */
+        PMPI_Comm_rank(core->node_comm, &node_rank);
+        PMPI_Comm_size(core->node_comm, &node_size);
+        if(node_rank == 0)
+        {
+            node_szs = malloc(node_size * sizeof(uint64_t));
+            assert(node_szs);
+        }
+        PMPI_Gather(&my_sz, 1, MPI_UINT64_T, node_szs, 1, MPI_UINT64_T, 0,
+            core->node_comm);
 
-        if(ret == 0)
+        /* the leader writes, errors elsewhere are caught by the caller */
+        if(node_rank > 0)
         {
-            /* no compression errors, proceed with the collective write */
-            ret = PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
-                core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
-            if(ret != MPI_SUCCESS)
-                ret = -1;
+            if(comp_buf_sz > 0)
+                PMPI_Send(buf, count, type, 0, DARSHAN_NODE_AGG_TAG,
+                    core->node_comm);
+            if(type != MPI_BYTE)
+                PMPI_Type_free(&type);
+            return(ret);
         }
-        else
+
+        /* split the node's processes into batches, and size the buffer
+         * for the largest one
+         */
+        for(i = 0, batch_sz = 0; i < node_size; i++)
         {
-            /* error during compression. preserve and return error to caller,
-             * but participate in collective write to avoid deadlock.
-             */
-            (void)PMPI_File_write_at_all(log_fh.mpi_fh, my_off,
-                core->comp_buf, comp_buf_sz, MPI_BYTE, &status);
+            if(batch_sz > 0 &&
+               batch_sz + node_szs[i] > DARSHAN_NODE_AGG_BATCH_SIZE)
+            {
+                batch_cnt++;
+                batch_sz = 0;
+            }
+            batch_sz += node_szs[i];
+            if(batch_sz > batch_max_sz)
+                batch_max_sz = batch_sz;
         }
+        if(batch_sz > 0)
+            batch_cnt++;
+        node_buf = malloc(batch_max_sz ? batch_max_sz : 1);
+        assert(node_buf);
 
-        if(nprocs > 1)
+        /* every leader takes part in as many collective writes as the
+         * leader with the most batches
+         */
+        PMPI_Allreduce(&batch_cnt, &max_batch_cnt, 1, MPI_INT, MPI_MAX,
+            core->log_comm);
+        for(b = 0, i = 0; b < max_batch_cnt; b++)
         {
-            /* send the ending offset from rank (n-1) to rank 0 */
-            if(my_rank == (nprocs-1))
+            for(j = i, batch_sz = 0; j < node_size; j++)
             {
-                my_off += comp_buf_sz;
-                PMPI_Send(&my_off, 1, MPI_OFFSET, 0, 0, core->mpi_comm);
+                if(batch_sz > 0 &&
+                   batch_sz + node_szs[j] > DARSHAN_NODE_AGG_BATCH_SIZE)
+                    break;
+                batch_sz += node_szs[j];
             }
-            if(my_rank == 0)
+            for(batch_sz = 0; i < j; i++)
             {
-                PMPI_Recv(&my_off, 1, MPI_OFFSET, (nprocs-1), 0, core->mpi_comm, &status);
-
-                *inout_off = my_off;
+                if(node_szs[i] == 0)
+                    continue;
+                /* sizes are 64-bit, so they may be too large for an int
+                 * count of bytes
+                 */
+                darshan_byte_type(node_szs[i], &node_count, &node_type);
+                if(i == 0)
+                    PMPI_Sendrecv(buf, count, type, 0, DARSHAN_NODE_AGG_TAG,
+                        node_buf, node_count, node_type, 0,
+                        DARSHAN_NODE_AGG_TAG, core->node_comm, &status);
+                else
+                    PMPI_Recv(node_buf + batch_sz, node_count, node_type, i,
+                        DARSHAN_NODE_AGG_TAG, core->node_comm, &status);
+                if(node_type != MPI_BYTE)
+                    PMPI_Type_free(&node_type);
+                batch_sz += node_szs[i];
             }
+            darshan_byte_type(batch_sz, &node_count, &node_type);
+            ret = darshan_log_append_all(log_fh, core->log_comm, node_buf,
+                node_count, node_type, batch_sz, ret, inout_off);
+            if(node_type != MPI_BYTE)
+                PMPI_Type_free(&node_type);
         }
-        else
-        {
-            *inout_off = my_off + comp_buf_sz;
-        }
+        if(type != MPI_BYTE)
+            PMPI_Type_free(&type);
+        free(node_buf);
+        free(node_szs);
 
         return(ret);
     }
 #endif
 
-    ret = pwrite(log_fh.nompi_fd, core->comp_buf, comp_buf_sz, *inout_off);
-    if(ret != comp_buf_sz)
+    if(ret == 0)
+        ret = darshan_comp_region_pwrite(log_fh.nompi_fd, region, *inout_off);
+    if(ret < 0)
         return(-1);
     *inout_off += comp_buf_sz;
     return(0);
 }
 
+/* write a compressed log region out to its place in the log, recording
+ * where it went in the log header
+ */
+static int darshan_log_write_region(darshan_core_log_fh log_fh,
+    struct darshan_core_runtime *core, struct darshan_comp_region *regions,
+    int region_idx, uint64_t *inout_off)
+{
+    struct darshan_log_map *map;
+    int ret;
+
+    if(region_idx == DARSHAN_COMP_JOB_REGION)
+    {
+        ret = darshan_log_write_job_record(log_fh, core, &regions[region_idx],
+            inout_off);
+    }
+    else
+    {
+        if(region_idx == DARSHAN_COMP_NAME_REGION)
+            map = &core->log_hdr_p->name_map;
+        else
+            map = &core->log_hdr_p->mod_map[region_idx];
+
+        map->off = *inout_off;
+        ret = darshan_log_append(log_fh, core, &regions[region_idx], inout_off);
+        map->len = *inout_off - map->off;
+    }
+
+    /* the compressed data is no longer needed once it is written */
+    darshan_comp_region_free(&regions[region_idx]);
+
+    return(ret);
+}
+
+static const char *darshan_log_region_name(int region_idx)
+{
+    if(region_idx == DARSHAN_COMP_JOB_REGION)
+        return("job record");
+    if(region_idx == DARSHAN_COMP_NAME_REGION)
+        return("name records");
+    return(darshan_module_names[region_idx]);
+}
+
 void darshan_log_close(darshan_core_log_fh log_fh)
 {
 #ifdef HAVE_MPI
     if(using_mpi)
     {
-        PMPI_File_close(&log_fh.mpi_fh);
+        if(log_fh.mpi_fh != MPI_FILE_NULL)
+            PMPI_File_close(&log_fh.mpi_fh);
         return;
     }
 #endif
@@ -1984,90 +3568,740 @@ void darshan_log_finalize(char *logfile_name, double start_log_time)
     return;
 }
 
-static int darshan_deflate_buffer(void **pointers, int *lengths, int count,
-    char *comp_buf, int *comp_buf_length)
+/* pick the number of threads used to compress the log at shutdown */
+static int darshan_comp_thread_count(struct darshan_core_runtime *core)
 {
+    long ncpus;
+    int local_procs = 1;
+    int nthreads;
+    char *envstr;
+
+    /* by default, split the node's cores between the processes on it.
+     * NOTE: the processes on the node are counted even if the thread
+     * count is set in the environment, as splitting the communicator is
+     * collective and the setting may differ between processes
+     */
+    ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+#if defined(HAVE_MPI) && MPI_VERSION >= 3
+    if(using_mpi && core->node_comm != MPI_COMM_NULL)
+    {
+        PMPI_Comm_size(core->node_comm, &local_procs);
+    }
+    else if(using_mpi)
+    {
+        MPI_Comm node_comm;
+
+        PMPI_Comm_split_type(core->mpi_comm, MPI_COMM_TYPE_SHARED, 0,
+            MPI_INFO_NULL, &node_comm);
+        PMPI_Comm_size(node_comm, &local_procs);
+        PMPI_Comm_free(&node_comm);
+    }
+#endif
+    envstr = getenv(DARSHAN_COMP_THREADS);
+    if(!envstr || sscanf(envstr, "%d", &nthreads) != 1 || nthreads < 1)
+        nthreads = ncpus / local_procs;
+    if(nthreads < 1)
+        nthreads = 1;
+    else if(nthreads > DARSHAN_MAX_COMP_THREADS)
+        nthreads = DARSHAN_MAX_COMP_THREADS;
+
+    return(nthreads);
+}
+
+/* start a pool of 'nthreads' threads to compress the given log regions in
+ * the background, as they are queued up with darshan_comp_pool_queue()
+ */
+static void darshan_comp_pool_start(struct darshan_comp_pool *pool,
+    struct darshan_comp_region *regions, int nthreads)
+{
+    int i;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->regions = regions;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    /* if threads can't be created, each region is compressed by the
+     * calling thread when it waits on it
+     */
+    for(i = 0; i < nthreads; i++)
+    {
+        if(pthread_create(&pool->threads[pool->thread_cnt], NULL,
+            darshan_comp_worker, pool) == 0)
+            pool->thread_cnt++;
+    }
+
+    return;
+}
+
+/* split a region into chunks and queue them up to be compressed */
+static void darshan_comp_pool_queue(struct darshan_comp_pool *pool,
+    int region_idx)
+{
+    struct darshan_comp_region *region = &pool->regions[region_idx];
+    struct darshan_comp_task *task;
+    int chunk_sz = DARSHAN_COMP_CHUNK_SIZE;
+    int rec_len;
+    int len, off;
+    int i;
+
+    /* records that are encoded as they are compressed are split up into
+     * chunks of whole records
+     */
+    if(region->enc != DARSHAN_REC_DENSE)
+    {
+        rec_len = sizeof(struct darshan_base_record) + sizeof(int64_t) *
+            (region->enc_mod->counter_cnt + region->enc_mod->fcounter_cnt);
+        chunk_sz = (chunk_sz > rec_len) ? (chunk_sz / rec_len) * rec_len :
+            rec_len;
+    }
+
+    /* count up the chunks to compress; the multi-part job region is small
+     * and is never split up
+     */
+    if(region->count == 1)
+        region->task_cnt = (region->lengths[0] + chunk_sz - 1) / chunk_sz;
+    else if(region->count > 1)
+        region->task_cnt = 1;
+    if(region->task_cnt == 0)
+        return;
+
+    region->tasks = calloc(region->task_cnt, sizeof(*region->tasks));
+    if(!region->tasks)
+    {
+        region->task_cnt = 0;
+        region->ret = -1;
+        return;
+    }
+
+    for(i = 0, off = 0; i < region->task_cnt; i++, off += chunk_sz)
+    {
+        task = &region->tasks[i];
+        task->region = region_idx;
+        if(region->count > 1)
+        {
+            memcpy(task->pointers, region->pointers, sizeof(task->pointers));
+            memcpy(task->lengths, region->lengths, sizeof(task->lengths));
+            task->count = region->count;
+        }
+        else
+        {
+            len = region->lengths[0] - off;
+            if(len > chunk_sz)
+                len = chunk_sz;
+            task->pointers[0] = (char *)region->pointers[0] + off;
+            task->lengths[0] = len;
+            task->count = 1;
+        }
+        if(i > 0)
+            region->tasks[i-1].next = task;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    region->pending = region->task_cnt;
+    if(pool->tail)
+        pool->tail->next = &region->tasks[0];
+    else
+        pool->head = &region->tasks[0];
+    pool->tail = &region->tasks[region->task_cnt-1];
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return;
+}
+
+/* wait for a queued region to be compressed, pitching in on its chunks.
+ * On return, the region's comp_buf_sz is the size of its compressed data,
+ * held by its chunks in order, and its ret field is nonzero if any part of
+ * it could not be compressed.
+ */
+static void darshan_comp_pool_wait(struct darshan_comp_pool *pool,
+    int region_idx)
+{
+    struct darshan_comp_region *region = &pool->regions[region_idx];
+    struct darshan_comp_task *task;
+    double start;
+    int i;
+
+    start = darshan_core_wtime_absolute();
+    pthread_mutex_lock(&pool->lock);
+    while(region->pending > 0)
+    {
+        /* regions are waited on in the order they were queued, so any of
+         * this region's chunks not yet started are at the head of the queue
+         */
+        if(pool->head && pool->head->region == region_idx)
+            darshan_comp_pool_run_task(pool, pool->head);
+        else
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pool->wait_time += darshan_core_wtime_absolute() - start;
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i = 0; i < region->task_cnt; i++)
+    {
+        task = &region->tasks[i];
+        if(task->ret)
+            region->ret = -1;
+        else
+            region->comp_buf_sz += task->out.len;
+    }
+
+    return;
+}
+
+/* stop the pool's threads, abandoning any chunks still queued */
+static void darshan_comp_pool_stop(struct darshan_comp_pool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i = 0; i < pool->thread_cnt; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+
+    return;
+}
+
+/* dequeue and compress the given chunk, which must be at the head of the
+ * queue. the pool must be locked, and is unlocked while compressing.
+ */
+static void darshan_comp_pool_run_task(struct darshan_comp_pool *pool,
+    struct darshan_comp_task *task)
+{
+    struct darshan_comp_region *region;
+    double start;
+
+    pool->head = task->next;
+    if(!pool->head)
+        pool->tail = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    region = &pool->regions[task->region];
+    start = darshan_core_wtime_absolute();
+    if(region->enc != DARSHAN_REC_DENSE)
+        task->ret = darshan_compress_records(region->enc, region->enc_mod,
+            task->pointers[0], task->lengths[0], &task->out);
+    else
+        task->ret = darshan_compress_buffer(task->pointers, task->lengths,
+            task->count, &task->out);
+    start = darshan_core_wtime_absolute() - start;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->busy_time += start;
+    if(--pool->regions[task->region].pending == 0)
+        pthread_cond_broadcast(&pool->done_cond);
+
+    return;
+}
+
+static void *darshan_comp_worker(void *arg)
+{
+    struct darshan_comp_pool *pool = (struct darshan_comp_pool *)arg;
+
+    pthread_mutex_lock(&pool->lock);
+    while(!pool->stop)
+    {
+        if(pool->head)
+            darshan_comp_pool_run_task(pool, pool->head);
+        else
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return(NULL);
+}
+
+/* free a region's chunks and their compressed data */
+static void darshan_comp_region_free(struct darshan_comp_region *region)
+{
+    int i;
+
+    for(i = 0; i < region->task_cnt; i++)
+        darshan_comp_out_free(&region->tasks[i].out);
+    free(region->tasks);
+    region->tasks = NULL;
+    region->task_cnt = 0;
+
+    return;
+}
+
+#ifdef HAVE_MPI
+/* describe where a compressed region's data is in memory, for writing it
+ * with MPI: either 'count' (0 or 1) instances of a datatype made up of its
+ * blocks, at MPI_BOTTOM, or nothing. the datatype must be freed by the
+ * caller if it is not MPI_BYTE.
+ */
+static void darshan_comp_region_type(struct darshan_comp_region *region,
+    void **buf, int *count, MPI_Datatype *type)
+{
+    struct darshan_comp_out *out;
+    MPI_Aint *displs;
+    int *lens;
+    int block_cnt = 0;
+    int i, j, k;
+
+    *buf = NULL;
+    *count = 0;
+    *type = MPI_BYTE;
+    if(region->ret < 0 || region->comp_buf_sz == 0)
+        return;
+
+    for(i = 0; i < region->task_cnt; i++)
+        block_cnt += region->tasks[i].out.block_cnt;
+    displs = malloc(block_cnt * sizeof(*displs));
+    lens = malloc(block_cnt * sizeof(*lens));
+    assert(displs && lens);
+
+    for(i = 0, k = 0; i < region->task_cnt; i++)
+    {
+        out = &region->tasks[i].out;
+        for(j = 0; j < out->block_cnt; j++, k++)
+        {
+            PMPI_Get_address(out->blocks[j], &displs[k]);
+            lens[k] = (j < out->block_cnt - 1) ? DARSHAN_COMP_BLOCK_SIZE :
+                out->len - j * DARSHAN_COMP_BLOCK_SIZE;
+        }
+    }
+
+    PMPI_Type_create_hindexed(block_cnt, lens, displs, MPI_BYTE, type);
+    PMPI_Type_commit(type);
+    *buf = MPI_BOTTOM;
+    *count = 1;
+
+    free(displs);
+    free(lens);
+    return;
+}
+
+/* describes 'sz' contiguous bytes as 'count' elements of 'type', which is
+ * MPI_BYTE if 'sz' fits in an int count, or otherwise a committed type
+ * (to be freed by the caller) made of blocks of up to
+ * DARSHAN_NODE_AGG_BATCH_SIZE bytes
+ */
+static void darshan_byte_type(uint64_t sz, int *count, MPI_Datatype *type)
+{
+    MPI_Aint *displs;
+    int *lens;
+    int block_cnt;
+    int i;
+
+    if(sz <= INT_MAX)
+    {
+        *count = (int)sz;
+        *type = MPI_BYTE;
+        return;
+    }
+
+    block_cnt = (sz + DARSHAN_NODE_AGG_BATCH_SIZE - 1) /
+        DARSHAN_NODE_AGG_BATCH_SIZE;
+    displs = malloc(block_cnt * sizeof(*displs));
+    lens = malloc(block_cnt * sizeof(*lens));
+    assert(displs && lens);
+
+    for(i = 0; i < block_cnt; i++)
+    {
+        displs[i] = (MPI_Aint)i * DARSHAN_NODE_AGG_BATCH_SIZE;
+        lens[i] = (i < block_cnt - 1) ? DARSHAN_NODE_AGG_BATCH_SIZE :
+            sz - (uint64_t)i * DARSHAN_NODE_AGG_BATCH_SIZE;
+    }
+
+    PMPI_Type_create_hindexed(block_cnt, lens, displs, MPI_BYTE, type);
+    PMPI_Type_commit(type);
+    *count = 1;
+
+    free(displs);
+    free(lens);
+    return;
+}
+#endif
+
+/* write a compressed region's data to the given offset of a file */
+static int darshan_comp_region_pwrite(int fd, struct darshan_comp_region *region,
+    uint64_t off)
+{
+    int i;
+
+    for(i = 0; i < region->task_cnt; i++)
+    {
+        if(darshan_comp_out_pwrite(fd, &region->tasks[i].out, off) < 0)
+            return(-1);
+        off += region->tasks[i].out.len;
+    }
+
+    return(0);
+}
+
+/* free the blocks of some compressed output */
+static void darshan_comp_out_free(struct darshan_comp_out *out)
+{
+    int i;
+
+    for(i = 0; i < out->block_cnt; i++)
+        free(out->blocks[i]);
+    free(out->blocks);
+    out->blocks = NULL;
+    out->block_cnt = 0;
+
+    return;
+}
+
+/* write some compressed output to the given offset of a file */
+static int darshan_comp_out_pwrite(int fd, struct darshan_comp_out *out,
+    uint64_t off)
+{
+    int len;
+    int i;
+
+    for(i = 0; i < out->block_cnt; i++)
+    {
+        len = (i < out->block_cnt - 1) ? DARSHAN_COMP_BLOCK_SIZE :
+            out->len - i * DARSHAN_COMP_BLOCK_SIZE;
+        if(pwrite(fd, out->blocks[i], len, off) != len)
+            return(-1);
+        off += len;
+    }
+
+    return(0);
+}
+
+/* add a block to the end of some compressed output, returning it */
+static char *darshan_comp_out_grow(struct darshan_comp_out *out)
+{
+    char **blocks;
+    char *block;
+
+    block = malloc(DARSHAN_COMP_BLOCK_SIZE);
+    if(!block)
+        return(NULL);
+    blocks = realloc(out->blocks, (out->block_cnt + 1) * sizeof(*blocks));
+    if(!blocks)
+    {
+        free(block);
+        return(NULL);
+    }
+    blocks[out->block_cnt++] = block;
+    out->blocks = blocks;
+
+    return(block);
+}
+
+static int darshan_compress_buffer(void **pointers, int *lengths, int count,
+    struct darshan_comp_out *out)
+{
+    struct darshan_comp_stream stream;
     int ret = 0;
     int i;
-    int total_target = 0;
-    z_stream tmp_stream;
 
     /* just return if there is no data */
     for(i = 0; i < count; i++)
     {
-        total_target += lengths[i];
+        if(lengths[i])
+            break;
     }
-    if(total_target)
+    if(i == count)
     {
-        total_target = 0;
+        out->len = 0;
+        return(0);
     }
+
+    if(darshan_comp_stream_init(&stream, out) < 0)
+        return(-1);
+
+    /* compress the input pointers into one stream, ending it with the
+     * last one
+     */
+    for(i = 0; i < count && ret == 0; i++)
+        ret = darshan_comp_stream_feed(&stream, pointers[i], lengths[i],
+            (i == count - 1));
+    darshan_comp_stream_end(&stream);
+
+    return(ret);
+}
+
+/* compress 'buf_sz' bytes of records laid out as registered by the given
+ * module, sparse encoding them or storing them in columns as they are
+ * compressed
+ */
+static int darshan_compress_records(enum darshan_rec_encoding enc,
+    struct darshan_core_module *mod, void *buf, int buf_sz,
+    struct darshan_comp_out *out)
+{
+    struct darshan_comp_stream stream;
+    int ret;
+
+    if(darshan_comp_stream_init(&stream, out) < 0)
+        return(-1);
+
+    if(enc == DARSHAN_REC_COLUMNAR)
+        ret = darshan_columnar_encode_records(&stream, mod, buf, buf_sz);
     else
+        ret = darshan_sparse_encode_records(&stream, mod, buf, buf_sz);
+    darshan_comp_stream_end(&stream);
+
+    return(ret);
+}
+
+static int darshan_comp_stream_init(struct darshan_comp_stream *stream,
+    struct darshan_comp_out *out)
+{
+    int ret;
+
+    memset(stream, 0, sizeof(*stream));
+    stream->out = out;
+
+#ifdef HAVE_LIBZSTD
+    if(darshan_log_comp_type == DARSHAN_ZSTD_COMP)
     {
-        *comp_buf_length = 0;
+        stream->cctx = ZSTD_createCCtx();
+        if(!stream->cctx)
+            return(-1);
+        if(ZSTD_isError(ZSTD_CCtx_setParameter(stream->cctx,
+            ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT)))
+        {
+            ZSTD_freeCCtx(stream->cctx);
+            stream->cctx = NULL;
+            return(-1);
+        }
         return(0);
     }
+#endif
 
-    memset(&tmp_stream, 0, sizeof(tmp_stream));
-    tmp_stream.zalloc = Z_NULL;
-    tmp_stream.zfree = Z_NULL;
-    tmp_stream.opaque = Z_NULL;
+    stream->zstream.zalloc = Z_NULL;
+    stream->zstream.zfree = Z_NULL;
+    stream->zstream.opaque = Z_NULL;
 
     /* initialize the zlib compression parameters */
     /* TODO: check these parameters? */
-//    ret = deflateInit2(&tmp_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+//    ret = deflateInit2(&stream->zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
 //        15 + 16, 8, Z_DEFAULT_STRATEGY);
-    ret = deflateInit(&tmp_stream, Z_DEFAULT_COMPRESSION);
+    ret = deflateInit(&stream->zstream, Z_DEFAULT_COMPRESSION);
     if(ret != Z_OK)
-    {
         return(-1);
+
+    return(0);
+}
+
+/* compress 'len' bytes of input into a stream, ending the stream if
+ * 'final_flag' is set
+ */
+static int darshan_comp_stream_feed(struct darshan_comp_stream *stream,
+    void *buf, int len, int final_flag)
+{
+    if(len == 0 && !final_flag)
+        return(0);
+
+#ifdef HAVE_LIBZSTD
+    if(darshan_log_comp_type == DARSHAN_ZSTD_COMP)
+        return(darshan_zstd_feed(stream, buf, len, final_flag));
+#endif
+    return(darshan_deflate_feed(stream, buf, len, final_flag));
+}
+
+/* free a stream's compression state and set the length of its output */
+static void darshan_comp_stream_end(struct darshan_comp_stream *stream)
+{
+#ifdef HAVE_LIBZSTD
+    if(darshan_log_comp_type == DARSHAN_ZSTD_COMP)
+    {
+        ZSTD_freeCCtx(stream->cctx);
+        stream->out->len = stream->out->block_cnt ?
+            (stream->out->block_cnt - 1) * DARSHAN_COMP_BLOCK_SIZE +
+            stream->zout.pos : 0;
+        return;
     }
+#endif
 
-    tmp_stream.next_out = (unsigned char *)comp_buf;
-    tmp_stream.avail_out = darshan_mod_mem_quota;
+    deflateEnd(&stream->zstream);
+    stream->out->len = stream->zstream.total_out;
 
-    /* loop over the input pointers */
-    for(i = 0; i < count; i++)
+    return;
+}
+
+static int darshan_deflate_feed(struct darshan_comp_stream *stream,
+    void *buf, int len, int final_flag)
+{
+    z_stream *tmp_stream = &stream->zstream;
+    int flush = final_flag ? Z_FINISH : Z_NO_FLUSH;
+    int ret;
+
+    /* start a new block of output whenever the last one fills up */
+    tmp_stream->next_in = buf;
+    tmp_stream->avail_in = len;
+    do
     {
-        total_target += lengths[i];
-        tmp_stream.next_in = pointers[i];
-        tmp_stream.avail_in = lengths[i];
-        /* while we have not finished consuming all of the data available to
-         * this point in the loop
-         */
-        while(tmp_stream.total_in < total_target)
+        if(tmp_stream->avail_out == 0)
         {
-            if(tmp_stream.avail_out == 0)
-            {
-                /* We ran out of buffer space for compression.  In theory,
-                 * we could start using some of the file_array buffer space
-                 * without having to malloc again.  In practice, this case 
-                 * is going to be practically impossible to hit.
-                 */
-                deflateEnd(&tmp_stream);
+            tmp_stream->next_out =
+                (unsigned char *)darshan_comp_out_grow(stream->out);
+            if(!tmp_stream->next_out)
                 return(-1);
-            }
+            tmp_stream->avail_out = DARSHAN_COMP_BLOCK_SIZE;
+        }
 
-            /* compress data */
-            ret = deflate(&tmp_stream, Z_NO_FLUSH);
-            if(ret != Z_OK)
-            {
-                deflateEnd(&tmp_stream);
+        /* compress data */
+        ret = deflate(tmp_stream, flush);
+        if(ret != Z_OK && ret != Z_STREAM_END)
+            return(-1);
+    } while((flush == Z_FINISH) ? (ret != Z_STREAM_END) :
+        (tmp_stream->avail_in > 0));
+
+    return(0);
+}
+
+#ifdef HAVE_LIBZSTD
+static int darshan_zstd_feed(struct darshan_comp_stream *stream,
+    void *buf, int len, int final_flag)
+{
+    ZSTD_inBuffer in;
+    ZSTD_EndDirective mode = final_flag ? ZSTD_e_end : ZSTD_e_continue;
+    size_t ret;
+
+    /* start a new block of output whenever the last one fills up */
+    in.src = buf;
+    in.size = len;
+    in.pos = 0;
+    do
+    {
+        if(stream->zout.pos == stream->zout.size)
+        {
+            stream->zout.dst = darshan_comp_out_grow(stream->out);
+            if(!stream->zout.dst)
+                return(-1);
+            stream->zout.size = DARSHAN_COMP_BLOCK_SIZE;
+            stream->zout.pos = 0;
+        }
+
+        ret = ZSTD_compressStream2(stream->cctx, &stream->zout, &in, mode);
+        if(ZSTD_isError(ret))
+            return(-1);
+    } while((mode == ZSTD_e_end) ? (ret != 0) : (in.pos < in.size));
+
+    return(0);
+}
+#endif
+
+/* sparse encode 'buf_sz' bytes of records laid out as registered by the
+ * given module (see darshan-log-format.h for the encoding) into a stream,
+ * ending it after the last record
+ */
+static int darshan_sparse_encode_records(struct darshan_comp_stream *stream,
+    struct darshan_core_module *mod, void *buf, int buf_sz)
+{
+    unsigned char enc_buf[DARSHAN_COMP_ENC_BUF_SIZE];
+    int field_cnt = mod->counter_cnt + mod->fcounter_cnt;
+    int rec_len = sizeof(struct darshan_base_record) +
+        (field_cnt * sizeof(int64_t));
+    int rec_cnt = buf_sz / rec_len;
+    int rec_max_sz = DARSHAN_SPARSE_REC_MAX_SIZE(mod->counter_cnt,
+        mod->fcounter_cnt);
+    int bitmap_sz = DARSHAN_SPARSE_BITMAP_SIZE(field_cnt);
+    unsigned char *out_p;
+    unsigned char *bitmap;
+    char *rec_p;
+    int64_t *fields;
+    uint64_t val;
+    uint32_t len;
+    int i, j;
+
+    assert(buf_sz % rec_len == 0);
+
+    out_p = enc_buf;
+    for(i = 0; i < rec_cnt; i++)
+    {
+        /* pass on the records encoded so far if the next one may not fit */
+        if(out_p - enc_buf > DARSHAN_COMP_ENC_BUF_SIZE - rec_max_sz)
+        {
+            if(darshan_comp_stream_feed(stream, enc_buf, out_p - enc_buf, 0) < 0)
                 return(-1);
+            out_p = enc_buf;
+        }
+
+        rec_p = (char *)buf + (i * rec_len);
+        fields = (int64_t *)(rec_p + sizeof(struct darshan_base_record));
+
+        memcpy(out_p, rec_p, sizeof(struct darshan_base_record));
+        bitmap = out_p + DARSHAN_SPARSE_REC_HDR_SIZE;
+        memset(bitmap, 0, bitmap_sz);
+        out_p = bitmap + bitmap_sz;
+
+        for(j = 0; j < field_cnt; j++)
+        {
+            if(fields[j] == 0)
+                continue;
+            bitmap[j / 8] |= (1 << (j % 8));
+
+            if(j < mod->counter_cnt)
+            {
+                /* zig-zag encode, so small negative values stay short */
+                val = ((uint64_t)fields[j] << 1) ^ (uint64_t)(fields[j] >> 63);
+                while(val >= 0x80)
+                {
+                    *out_p++ = (unsigned char)(val | 0x80);
+                    val >>= 7;
+                }
+                *out_p++ = (unsigned char)val;
+            }
+            else
+            {
+                /* fcounters are kept bit for bit */
+                memcpy(out_p, &fields[j], sizeof(double));
+                out_p += sizeof(double);
             }
         }
+
+        len = out_p - bitmap;
+        memcpy(bitmap - sizeof(uint32_t), &len, sizeof(uint32_t));
     }
 
-    /* flush compression and end */
-    ret = deflate(&tmp_stream, Z_FINISH);
-    if(ret != Z_STREAM_END)
+    return(darshan_comp_stream_feed(stream, enc_buf, out_p - enc_buf, 1));
+}
+
+/* store 'buf_sz' bytes of records laid out as registered by the given
+ * module in columns (see darshan-log-format.h) into a stream, ending it
+ * after the last column. each chunk of records compressed is stored as
+ * its own group of columns.
+ */
+static int darshan_columnar_encode_records(struct darshan_comp_stream *stream,
+    struct darshan_core_module *mod, void *buf, int buf_sz)
+{
+    uint64_t enc_buf[DARSHAN_COMP_ENC_BUF_SIZE / sizeof(uint64_t)];
+    int enc_max = DARSHAN_COMP_ENC_BUF_SIZE / sizeof(uint64_t);
+    int field_cnt = DARSHAN_COLUMNAR_FIELD_CNT(mod->counter_cnt,
+        mod->fcounter_cnt);
+    int rec_cnt = buf_sz / (field_cnt * sizeof(uint64_t));
+    uint64_t *rec_p = (uint64_t *)buf;
+    int enc_cnt = 0;
+    int i, j;
+
+    assert(buf_sz % (field_cnt * sizeof(uint64_t)) == 0);
+
+    enc_buf[enc_cnt++] = rec_cnt;
+    for(j = 0; j < field_cnt; j++)
     {
-        deflateEnd(&tmp_stream);
-        return(-1);
+        for(i = 0; i < rec_cnt; i++)
+        {
+            if(enc_cnt == enc_max)
+            {
+                if(darshan_comp_stream_feed(stream, enc_buf,
+                    sizeof(enc_buf), 0) < 0)
+                    return(-1);
+                enc_cnt = 0;
+            }
+            enc_buf[enc_cnt++] = rec_p[(i * field_cnt) + j];
+        }
     }
-    deflateEnd(&tmp_stream);
 
-    *comp_buf_length = tmp_stream.total_out;
-    return(0);
+    return(darshan_comp_stream_feed(stream, enc_buf,
+        enc_cnt * sizeof(uint64_t), 1));
 }
 
 /* free darshan core data structures to shutdown */
@@ -2096,21 +4330,116 @@ static void darshan_core_cleanup(struct darshan_core_runtime* core)
     free(core->log_job_p);
     free(core->log_exemnt_p);
     free(core->log_name_p);
-    free(core->log_mod_p);
+    munmap(core->log_mod_p, DARSHAN_MAX_MODS * darshan_mod_mem_slot_size);
 #endif
 
 #ifdef HAVE_MPI
     if(using_mpi)
+    {
+        if(core->node_comm != MPI_COMM_NULL)
+        {
+            PMPI_Comm_free(&core->node_comm);
+            if(core->log_comm != MPI_COMM_NULL)
+                PMPI_Comm_free(&core->log_comm);
+        }
         PMPI_Comm_free(&core->mpi_comm);
+    }
 #endif
 
-    if(core->comp_buf)
-        free(core->comp_buf);
     free(core);
 
     return;
 }
 
+/* the module memory quota that is neither committed nor reserved for
+ * registered modules other than 'mod' (darshan-core lock held)
+ */
+static size_t darshan_core_mod_mem_unreserved(struct darshan_core_module *mod)
+{
+    size_t avail = darshan_mod_mem_quota - darshan_core->mod_mem_used;
+    size_t reserved = 0;
+    struct darshan_core_module *m;
+    int i;
+
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+    {
+        m = darshan_core->mod_array[i];
+        if(m && m != mod && m->rec_mem_granted > m->rec_mem_committed)
+            reserved += m->rec_mem_granted - m->rec_mem_committed;
+    }
+
+    return((avail > reserved) ? (avail - reserved) : 0);
+}
+
+/* commit enough memory to the given module to store a record of length
+ * rec_len past its current end (darshan-core lock held)
+ *
+ * returns 0 on success, -1 if the module memory quota is exhausted
+ */
+static int darshan_core_grow_mod_mem(struct darshan_core_module *mod,
+    size_t rec_len)
+{
+    char *commit_p = (char *)mod->rec_buf_start + mod->rec_mem_committed;
+    size_t needed = (char *)mod->rec_buf_p + rec_len - commit_p;
+    size_t avail = darshan_core_mod_mem_unreserved(mod);
+    size_t granted = 0;
+    size_t holdback = darshan_mod_mem_quota / DARSHAN_MOD_MEM_HOLDBACK;
+    size_t grow = darshan_mod_mem_chunk_size;
+    size_t page_size = sysconf(_SC_PAGESIZE);
+
+    /* past the rest of its grant, the module must leave the holdback
+     * to modules that register later
+     */
+    if(mod->rec_mem_granted > mod->rec_mem_committed)
+        granted = mod->rec_mem_granted - mod->rec_mem_committed;
+    if(avail > granted)
+        avail = granted + ((avail - granted > holdback) ?
+            (avail - granted - holdback) : 0);
+
+    /* commit whole chunks where possible, or whatever is left of the
+     * quota (in pages) otherwise
+     */
+    while(grow < needed)
+        grow += darshan_mod_mem_chunk_size;
+    if(grow > avail)
+        grow = (avail / page_size) * page_size;
+    if(grow < needed ||
+       mod->rec_mem_committed + grow > darshan_mod_mem_slot_size)
+        return(-1);
+
+    if(mprotect(commit_p, grow, PROT_READ | PROT_WRITE) < 0)
+        return(-1);
+    mod->rec_mem_committed += grow;
+    darshan_core->mod_mem_used += grow;
+
+    return(0);
+}
+
+/* return all memory committed to the given module to the quota shared by
+ * all modules (darshan-core lock held)
+ */
+static void darshan_core_release_mod_mem(struct darshan_core_module *mod)
+{
+    if(!mod->rec_mem_committed)
+        return;
+
+    /* drop the pages backing the module's records (or, for mmap logs,
+     * the corresponding file blocks, where supported)
+     */
+#ifdef __DARSHAN_ENABLE_MMAP_LOGS
+    (void)madvise(mod->rec_buf_start, mod->rec_mem_committed, MADV_REMOVE);
+#else
+    (void)madvise(mod->rec_buf_start, mod->rec_mem_committed, MADV_DONTNEED);
+#endif
+    mprotect(mod->rec_buf_start, mod->rec_mem_committed, PROT_NONE);
+
+    darshan_core->mod_mem_used -= mod->rec_mem_committed;
+    mod->rec_mem_committed = 0;
+    mod->rec_buf_p = mod->rec_buf_start;
+
+    return;
+}
+
 static void darshan_core_fork_child_cb(void)
 {
     /* hold onto the original parent PID, which we will use as jobid if the user didn't
@@ -2120,6 +4449,13 @@ static void darshan_core_fork_child_cb(void)
     if(!orig_parent_pid)
         orig_parent_pid = parent_pid;
 
+    /* the snapshot thread did not survive the fork, and the last snapshot
+     * belongs to the parent
+     */
+    pthread_mutex_init(&darshan_snapshot.lock, NULL);
+    darshan_snapshot.running = 0;
+    darshan_snapshot.log_name[0] = '\0';
+
     /* shutdown and re-init darshan, making sure to not write out a log file */
     darshan_core_shutdown(0);
     darshan_core_initialize(0, NULL);
@@ -2138,6 +4474,7 @@ void darshan_shutdown_bench(int argc, char **argv)
     /* clear out existing core runtime structure */
     if(darshan_core)
     {
+        DARSHAN_CORE_SET_ENABLED(0);
         darshan_core_cleanup(darshan_core);
         darshan_core = NULL;
     }
@@ -2202,6 +4539,21 @@ void darshan_shutdown_bench(int argc, char **argv)
 
     sleep(1);
 
+    /***********************************************************/
+    /* restart darshan */
+    darshan_core_initialize(argc, argv);
+
+    darshan_posix_shutdown_bench_setup(5);
+    darshan_mpiio_shutdown_bench_setup(5);
+
+    if(my_rank == 0)
+        fprintf(stderr, "# 1020 unique files plus 4 shared files per proc\n");
+    PMPI_Barrier(MPI_COMM_WORLD);
+    darshan_core_shutdown(1);
+    darshan_core = NULL;
+
+    sleep(1);
+
     /***********************************************************/
 
     return;
@@ -2227,6 +4579,7 @@ void darshan_core_register_module(
     struct darshan_core_module* mod;
     size_t mod_mem_req = *inout_mod_buf_size;
     size_t mod_mem_avail;
+    size_t page_size = sysconf(_SC_PAGESIZE);
 
     *inout_mod_buf_size = 0;
 
@@ -2250,26 +4603,30 @@ void darshan_core_register_module(
     }
     memset(mod, 0, sizeof(*mod));
 
-    /* set module's record buffer and max memory usage */
-    mod_mem_avail = darshan_mod_mem_quota - darshan_core->mod_mem_used;
-    if(mod_mem_avail >= mod_mem_req)
-        mod->rec_mem_avail = mod_mem_req;
-    else
-        mod->rec_mem_avail = mod_mem_avail;
-    mod->rec_buf_start = darshan_core->log_mod_p + darshan_core->mod_mem_used;
+    /* set module's record buffer; memory is only committed to the module
+     * as it registers records, but the requested amount (or whatever is
+     * left of the quota) is reserved for it, in whole pages
+     */
+    mod_mem_avail = darshan_core_mod_mem_unreserved(NULL);
+    mod->rec_mem_granted =
+        ((mod_mem_req + page_size - 1) / page_size) * page_size;
+    if(mod->rec_mem_granted > mod_mem_avail)
+        mod->rec_mem_granted = mod_mem_avail;
+    mod->rec_buf_start = (char *)darshan_core->log_mod_p +
+        (mod_id * darshan_mod_mem_slot_size);
     mod->rec_buf_p = mod->rec_buf_start;
     mod->mod_funcs = mod_funcs;
 
     /* register module with darshan */
     darshan_core->mod_array[mod_id] = mod;
-    darshan_core->mod_mem_used += mod->rec_mem_avail;
     darshan_core->log_hdr_p->mod_ver[mod_id] = darshan_module_versions[mod_id];
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     darshan_core->log_hdr_p->mod_map[mod_id].off =
         ((char *)mod->rec_buf_start - (char *)darshan_core->log_hdr_p);
 #endif
 
-    *inout_mod_buf_size = mod->rec_mem_avail;
+    *inout_mod_buf_size = (mod_mem_avail >= mod_mem_req) ?
+        mod_mem_req : mod_mem_avail;
     DARSHAN_CORE_UNLOCK();
 
     /* set the memory alignment and calling process's rank, if desired */
@@ -2281,11 +4638,6 @@ void darshan_core_register_module(
     return;
 }
 
-/* NOTE: we currently don't really have a simple way of returning the
- * memory allocated to this module back to darshan to hand out to
- * other modules, so all we do is disable the module so darshan does
- * not attempt to call into it at shutdown time
- */
 void darshan_core_unregister_module(
     darshan_module_id mod_id)
 {
@@ -2296,10 +4648,15 @@ void darshan_core_unregister_module(
         return;
     }
 
-    /* update darshan internal structures and header */
+    /* return the module's record memory for other modules to use, and
+     * update darshan internal structures and header
+     */
+    if(darshan_core->mod_array[mod_id])
+        darshan_core_release_mod_mem(darshan_core->mod_array[mod_id]);
     free(darshan_core->mod_array[mod_id]);
     darshan_core->mod_array[mod_id] = NULL;
     darshan_core->log_hdr_p->mod_ver[mod_id] = 0;
+    darshan_core->log_hdr_p->mod_mem[mod_id] = 0;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     darshan_core->log_hdr_p->mod_map[mod_id].off =
         darshan_core->log_hdr_p->mod_map[mod_id].len = 0;
@@ -2324,6 +4681,7 @@ void *darshan_core_register_record(
     struct darshan_fs_info *fs_info)
 {
     struct darshan_core_name_record_ref *ref;
+    struct darshan_core_module *mod;
     void *rec_buf;
     int ret;
 
@@ -2334,8 +4692,13 @@ void *darshan_core_register_record(
         return(NULL);
     }
 
-    /* check to see if this module has enough space to store a new record */
-    if(darshan_core->mod_array[mod_id]->rec_mem_avail < rec_len)
+    /* check to see if this module has enough space to store a new record,
+     * committing more memory to it if not
+     */
+    mod = darshan_core->mod_array[mod_id];
+    if(((char *)mod->rec_buf_p + rec_len >
+        (char *)mod->rec_buf_start + mod->rec_mem_committed) &&
+       darshan_core_grow_mod_mem(mod, rec_len) < 0)
     {
         DARSHAN_MOD_FLAG_SET(darshan_core->log_hdr_p->partial_flag, mod_id);
         DARSHAN_CORE_UNLOCK();
@@ -2366,9 +4729,9 @@ void *darshan_core_register_record(
         }
     }
 
-    rec_buf = darshan_core->mod_array[mod_id]->rec_buf_p;
-    darshan_core->mod_array[mod_id]->rec_buf_p += rec_len;
-    darshan_core->mod_array[mod_id]->rec_mem_avail -= rec_len;
+    rec_buf = mod->rec_buf_p;
+    mod->rec_buf_p += rec_len;
+    darshan_core->log_hdr_p->mod_mem[mod_id] += rec_len;
 #ifdef __DARSHAN_ENABLE_MMAP_LOGS
     darshan_core->log_hdr_p->mod_map[mod_id].len += rec_len;
 #endif
@@ -2380,19 +4743,25 @@ void *darshan_core_register_record(
     return(rec_buf);;
 }
 
-char *darshan_core_lookup_record_name(darshan_record_id rec_id)
+int darshan_core_lookup_record_name(darshan_record_id rec_id, char *name,
+    int name_len)
 {
     struct darshan_core_name_record_ref *ref;
-    char *name = NULL;
+    int ret = -1;
 
     DARSHAN_CORE_LOCK();
+    if(!darshan_core)
+    {
+        DARSHAN_CORE_UNLOCK();
+        return(-1);
+    }
     HASH_FIND(hlink, darshan_core->name_hash, &rec_id,
         sizeof(darshan_record_id), ref);
     if(ref)
-        name = ref->name_record->name;
+        ret = darshan_decode_name_record(ref, name, name_len);
     DARSHAN_CORE_UNLOCK();
 
-    return(name);
+    return(ret);
 }
 
 void darshan_instrument_fs_data(int fs_type, const char *path, int fd)
@@ -2419,26 +4788,125 @@ void darshan_instrument_fs_data(int fs_type, const char *path, int fd)
 /* retrieve the wtime relative to execution start time */
 double darshan_core_wtime()
 {
-    double wtime_offset;
+    if(!DARSHAN_CORE_ENABLED())
+        return(0);
 
-    DARSHAN_CORE_LOCK();
-    if(!darshan_core)
-    {
-        DARSHAN_CORE_UNLOCK();
+    return(darshan_core_wtime_absolute() - darshan_core_wtime_offset);
+}
+
+static double darshan_core_clock_seconds(clockid_t clk)
+{
+    struct timespec tp;
+
+    clock_gettime(clk, &tp);
+    return(tp.tv_sec + (tp.tv_nsec / 1000000000.0));
+}
+
+#ifdef DARSHAN_HAVE_TSC
+/* only use the TSC if the processor reports it as invariant, i.e., it ticks
+ * at a constant rate regardless of frequency scaling and sleep states
+ */
+static int darshan_core_tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid_max(0x80000000, NULL) < 0x80000007)
         return(0);
-    }
-    else
+    if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+        return(0);
+
+    return((edx & (1 << 8)) ? 1 : 0);
+}
+
+/* determine the TSC tick rate by timing a short busy-wait against
+ * CLOCK_MONOTONIC, which also serves as the base for TSC timestamps
+ */
+static int darshan_core_tsc_calibrate(void)
+{
+    uint64_t tsc1, tsc2;
+    double time1, time2;
+
+    if(!darshan_core_tsc_invariant())
+        return(-1);
+
+    time1 = darshan_core_clock_seconds(CLOCK_MONOTONIC);
+    tsc1 = __rdtsc();
+    do
+    {
+        time2 = darshan_core_clock_seconds(CLOCK_MONOTONIC);
+    } while(time2 - time1 < DARSHAN_TSC_CALIBRATION_TIME);
+    tsc2 = __rdtsc();
+
+    if(tsc2 <= tsc1)
+        return(-1);
+
+    darshan_core_tsc_sec_per_tick = (time2 - time1) / (double)(tsc2 - tsc1);
+    darshan_core_tsc_base = tsc2;
+    darshan_core_tsc_base_time = time2;
+
+    return(0);
+}
+#endif
+
+/* select the timer backend used for all runtime timestamps, either from
+ * the environment or from the configured default
+ */
+static void darshan_core_timer_init(void)
+{
+    char *envstr;
+
+    if(darshan_core_timer_initialized)
+        return;
+    darshan_core_timer_initialized = 1;
+
+    envstr = getenv(DARSHAN_TIMER_OVERRIDE);
+    if(!envstr)
+        envstr = __DARSHAN_TIMER;
+
+    /* silently fall back to the default timer if the value is not known */
+    if(strcmp(envstr, "clock") == 0)
+        darshan_core_timer = DARSHAN_TIMER_CLOCK;
+    else if(strcmp(envstr, "coarse") == 0)
+        darshan_core_timer = DARSHAN_TIMER_COARSE;
+    else if(strcmp(envstr, "tsc") == 0)
     {
-        wtime_offset = darshan_core->wtime_offset;
+#ifdef DARSHAN_HAVE_TSC
+        if(darshan_core_tsc_calibrate() == 0)
+            darshan_core_timer = DARSHAN_TIMER_TSC;
+        else
+#endif
+        /* use CLOCK_MONOTONIC if the TSC can't be used reliably */
+        darshan_core_timer = DARSHAN_TIMER_CLOCK;
     }
-    DARSHAN_CORE_UNLOCK();
+    else
+        darshan_core_timer = DARSHAN_TIMER_DEFAULT;
 
-    return(darshan_core_wtime_absolute() - wtime_offset);
+    return;
 }
 
 /* retrieve absolute wtime */
 static double darshan_core_wtime_absolute(void)
 {
+    switch(darshan_core_timer)
+    {
+        case DARSHAN_TIMER_CLOCK:
+            return(darshan_core_clock_seconds(CLOCK_MONOTONIC));
+        case DARSHAN_TIMER_COARSE:
+#ifdef CLOCK_MONOTONIC_COARSE
+            return(darshan_core_clock_seconds(CLOCK_MONOTONIC_COARSE));
+#else
+            return(darshan_core_clock_seconds(CLOCK_MONOTONIC));
+#endif
+#ifdef DARSHAN_HAVE_TSC
+        case DARSHAN_TIMER_TSC:
+            return(darshan_core_tsc_base_time +
+                ((int64_t)(__rdtsc() - darshan_core_tsc_base) *
+                darshan_core_tsc_sec_per_tick));
+#endif
+        default:
+            break;
+    }
+
 #ifdef HAVE_MPI
     if(using_mpi)
         return(PMPI_Wtime());
@@ -2468,51 +4936,123 @@ void darshan_core_fprintf(
     return;
 }
 
-int darshan_core_excluded_path(const char *path)
+static char darshan_path_trie_match_globs(struct darshan_path_trie *trie,
+    int node, const char *path)
 {
-    char *exclude, *include;
-    int tmp_index = 0;
-    int tmp_jndex;
+    struct darshan_path_glob *glob;
+    char action = 0;
+    int i;
 
-    /* if user has set DARSHAN_EXCLUDE_DIRS, override the default ones */
-    if (user_darshan_path_exclusions != NULL) {
-        while((exclude = user_darshan_path_exclusions[tmp_index++])) {
-            if(!(strncmp(exclude, path, strlen(exclude))))
-                return(1);
-        }
+    for(i = trie->nodes[node].glob; i >= 0; i = glob->next)
+    {
+        glob = &trie->globs[i];
+        if(!(action & glob->action) && fnmatch(glob->pattern, path, 0) == 0)
+            action |= glob->action;
     }
-    else
+
+    return(action);
+}
+
+int darshan_core_excluded_path(const char *path)
+{
+    struct darshan_path_trie *trie = &darshan_path_trie;
+    struct darshan_path_trie_node *nodes = trie->nodes;
+    const char *p = path;
+    char action = 0;
+    int node = 0;
+    int next;
+
+    if(!trie->actions)
+        return(0);
+
+    if(nodes[0].glob >= 0)
+        action |= darshan_path_trie_match_globs(trie, 0, path);
+
+    /* walk the trie along the path, collecting the actions of every
+     * matching prefix. Any matching inclusion overrides all matching
+     * exclusions, so we can only stop early on an exclusion if there are
+     * no inclusions to check.
+     */
+    while(*p && !(action & DARSHAN_PATH_INCLUDE))
     {
-        /* scan blacklist for paths to exclude */
-        while((exclude = darshan_path_exclusions[tmp_index++])) {
-            if(!(strncmp(exclude, path, strlen(exclude)))) {
-                /* before excluding path, ensure it's not in whitelist */
-                tmp_jndex = 0;
-                while((include = darshan_path_inclusions[tmp_jndex++])) {
-                    if(!(strncmp(include, path, strlen(include))))
-                        return(0); /* whitelist hits are always tracked */
-                }
-                return(1); /* if not in whitelist, then blacklist it */
-            }
+        if((action & DARSHAN_PATH_EXCLUDE) &&
+            !(trie->actions & DARSHAN_PATH_INCLUDE))
+            break;
+
+        for(next = nodes[node].child; next >= 0; next = nodes[next].sibling)
+        {
+            if(nodes[next].c == *p)
+                break;
         }
+        if(next < 0)
+            break;
+
+        node = next;
+        p++;
+        action |= nodes[node].action;
+        if(nodes[node].glob >= 0)
+            action |= darshan_path_trie_match_globs(trie, node, path);
     }
 
-    /* if not in blacklist, no problem */
-    return(0);
+    return((action & DARSHAN_PATH_EXCLUDE) && !(action & DARSHAN_PATH_INCLUDE));
 }
 
 int darshan_core_disabled_instrumentation()
 {
-    int ret;
+    return(!DARSHAN_CORE_ENABLED() || darshan_core_thread_disabled);
+}
+
+int darshan_core_sample_period(int *random_flag)
+{
+    if(random_flag)
+        *random_flag = darshan_sample_random;
+    return(darshan_sample_period);
+}
 
+double darshan_core_activity_bin_width()
+{
+    return(darshan_activity_bin_width);
+}
+
+void darshan_core_mark_sampled(darshan_module_id mod_id)
+{
     DARSHAN_CORE_LOCK();
     if(darshan_core)
-        ret = 0;
-    else
-        ret = 1;
+        darshan_core->log_hdr_p->mod_sample[mod_id] = darshan_sample_period;
     DARSHAN_CORE_UNLOCK();
 
-    return(ret);
+    return;
+}
+
+void darshan_core_mark_estimated(darshan_module_id mod_id)
+{
+    DARSHAN_CORE_LOCK();
+    if(darshan_core)
+        DARSHAN_MOD_FLAG_SET(darshan_core->log_hdr_p->estimate_flag, mod_id);
+    DARSHAN_CORE_UNLOCK();
+
+    return;
+}
+
+void darshan_core_register_record_layout(darshan_module_id mod_id,
+    int counter_cnt, int fcounter_cnt)
+{
+    /* records are sparse encoded through a fixed-size buffer, which must
+     * hold at least one of them
+     */
+    if(DARSHAN_SPARSE_REC_MAX_SIZE(counter_cnt, fcounter_cnt) >
+       DARSHAN_COMP_ENC_BUF_SIZE)
+        return;
+
+    DARSHAN_CORE_LOCK();
+    if(darshan_core && darshan_core->mod_array[mod_id])
+    {
+        darshan_core->mod_array[mod_id]->counter_cnt = counter_cnt;
+        darshan_core->mod_array[mod_id]->fcounter_cnt = fcounter_cnt;
+    }
+    DARSHAN_CORE_UNLOCK();
+
+    return;
 }
 
 /*
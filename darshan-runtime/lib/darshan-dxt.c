@@ -23,6 +23,7 @@
 #include <search.h>
 #include <assert.h>
 #include <libgen.h>
+#include <limits.h>
 #include <pthread.h>
 #include <regex.h>
 
@@ -95,6 +96,8 @@ struct dxt_posix_runtime
     int file_rec_count;
     char *record_buf;
     int record_buf_size;
+    struct darshan_slab *rec_ref_slab;
+    struct darshan_slab *file_rec_slab;
 };
 
 struct dxt_mpiio_runtime
@@ -103,6 +106,8 @@ struct dxt_mpiio_runtime
     int file_rec_count;
     char *record_buf;
     int record_buf_size;
+    struct darshan_slab *rec_ref_slab;
+    struct darshan_slab *file_rec_slab;
 };
 
 enum dxt_trigger_type
@@ -327,6 +332,20 @@ void dxt_posix_runtime_initialize()
         return;
     }
     memset(dxt_posix_runtime, 0, sizeof(*dxt_posix_runtime));
+    dxt_posix_runtime->rec_ref_slab = darshan_slab_create("dxt_posix_rec_refs",
+        sizeof(struct dxt_file_record_ref));
+    dxt_posix_runtime->file_rec_slab = darshan_slab_create("dxt_posix_file_recs",
+        sizeof(struct dxt_file_record));
+    if(!dxt_posix_runtime->rec_ref_slab || !dxt_posix_runtime->file_rec_slab)
+    {
+        darshan_slab_destroy(dxt_posix_runtime->rec_ref_slab);
+        darshan_slab_destroy(dxt_posix_runtime->file_rec_slab);
+        free(dxt_posix_runtime);
+        dxt_posix_runtime = NULL;
+        darshan_core_unregister_module(DXT_POSIX_MOD);
+        DXT_UNLOCK();
+        return;
+    }
     dxt_mem_remaining = dxt_total_mem;
     DXT_UNLOCK();
 
@@ -393,6 +412,20 @@ void dxt_mpiio_runtime_initialize()
         return;
     }
     memset(dxt_mpiio_runtime, 0, sizeof(*dxt_mpiio_runtime));
+    dxt_mpiio_runtime->rec_ref_slab = darshan_slab_create("dxt_mpiio_rec_refs",
+        sizeof(struct dxt_file_record_ref));
+    dxt_mpiio_runtime->file_rec_slab = darshan_slab_create("dxt_mpiio_file_recs",
+        sizeof(struct dxt_file_record));
+    if(!dxt_mpiio_runtime->rec_ref_slab || !dxt_mpiio_runtime->file_rec_slab)
+    {
+        darshan_slab_destroy(dxt_mpiio_runtime->rec_ref_slab);
+        darshan_slab_destroy(dxt_mpiio_runtime->file_rec_slab);
+        free(dxt_mpiio_runtime);
+        dxt_mpiio_runtime = NULL;
+        darshan_core_unregister_module(DXT_MPIIO_MOD);
+        DXT_UNLOCK();
+        return;
+    }
     dxt_mem_remaining = dxt_total_mem; /* XXX is this right? better with memory */
     DXT_UNLOCK();
 
@@ -691,8 +724,9 @@ static void dxt_posix_filter_dynamic_traces_iterator(void *rec_ref_p, void *user
             {
                 free(mpiio_rec_ref->write_traces);
                 free(mpiio_rec_ref->read_traces);
-                free(mpiio_rec_ref->file_rec);
-                free(mpiio_rec_ref);
+                darshan_slab_free(dxt_mpiio_runtime->file_rec_slab,
+                    mpiio_rec_ref->file_rec);
+                darshan_slab_free(dxt_mpiio_runtime->rec_ref_slab, mpiio_rec_ref);
             }
         }
 
@@ -705,8 +739,9 @@ static void dxt_posix_filter_dynamic_traces_iterator(void *rec_ref_p, void *user
             {
                 free(psx_rec_ref->write_traces);
                 free(psx_rec_ref->read_traces);
-                free(psx_rec_ref->file_rec);
-                free(psx_rec_ref);
+                darshan_slab_free(dxt_posix_runtime->file_rec_slab,
+                    psx_rec_ref->file_rec);
+                darshan_slab_free(dxt_posix_runtime->rec_ref_slab, psx_rec_ref);
             }
         }
     }
@@ -759,14 +794,13 @@ static int dxt_should_trace_rank(int my_rank)
 
 static int dxt_should_trace_file(darshan_record_id rec_id)
 {
-    char *rec_name;
+    char rec_name[PATH_MAX];
     int i;
 
     if(!dxt_use_file_triggers)
         return(0);
 
-    rec_name  = darshan_core_lookup_record_name(rec_id);
-    if(rec_name)
+    if(darshan_core_lookup_record_name(rec_id, rec_name, PATH_MAX) == 0)
     {
         /* compare file name against cached triggers to see if we should trace */
         for(i = 0; i < num_dxt_triggers; i++)
@@ -862,30 +896,28 @@ static struct dxt_file_record_ref *dxt_posix_track_new_file_record(
         return(NULL);
     }
 
-    rec_ref = malloc(sizeof(*rec_ref));
+    rec_ref = darshan_slab_alloc(dxt_posix_runtime->rec_ref_slab);
     if(!rec_ref)
     {
         DXT_UNLOCK();
         return(NULL);
     }
-    memset(rec_ref, 0, sizeof(*rec_ref));
 
-    file_rec = malloc(sizeof(*file_rec));
+    file_rec = darshan_slab_alloc(dxt_posix_runtime->file_rec_slab);
     if(!file_rec)
     {
-        free(rec_ref);
+        darshan_slab_free(dxt_posix_runtime->rec_ref_slab, rec_ref);
         DXT_UNLOCK();
         return(NULL);
     }
-    memset(file_rec, 0, sizeof(*file_rec));
 
     /* add a reference to this file record based on record id */
     ret = darshan_add_record_ref(&(dxt_posix_runtime->rec_id_hash), &rec_id,
             sizeof(darshan_record_id), rec_ref);
     if(ret == 0)
     {
-        free(file_rec);
-        free(rec_ref);
+        darshan_slab_free(dxt_posix_runtime->file_rec_slab, file_rec);
+        darshan_slab_free(dxt_posix_runtime->rec_ref_slab, rec_ref);
         DXT_UNLOCK();
         return(NULL);
     }
@@ -920,31 +952,28 @@ static struct dxt_file_record_ref *dxt_mpiio_track_new_file_record(
         return(NULL);
     }
 
-    rec_ref = malloc(sizeof(*rec_ref));
+    rec_ref = darshan_slab_alloc(dxt_mpiio_runtime->rec_ref_slab);
     if(!rec_ref)
-
     {
         DXT_UNLOCK();
         return(NULL);
     }
-    memset(rec_ref, 0, sizeof(*rec_ref));
 
-    file_rec = malloc(sizeof(*file_rec));
+    file_rec = darshan_slab_alloc(dxt_mpiio_runtime->file_rec_slab);
     if(!file_rec)
     {
-        free(rec_ref);
+        darshan_slab_free(dxt_mpiio_runtime->rec_ref_slab, rec_ref);
         DXT_UNLOCK();
         return(NULL);
     }
-    memset(file_rec, 0, sizeof(*file_rec));
 
     /* add a reference to this file record based on record id */
     ret = darshan_add_record_ref(&(dxt_mpiio_runtime->rec_id_hash), &rec_id,
             sizeof(darshan_record_id), rec_ref);
     if(ret == 0)
     {
-        free(file_rec);
-        free(rec_ref);
+        darshan_slab_free(dxt_mpiio_runtime->file_rec_slab, file_rec);
+        darshan_slab_free(dxt_mpiio_runtime->rec_ref_slab, rec_ref);
         DXT_UNLOCK();
         return(NULL);
     }
@@ -969,7 +998,6 @@ static void dxt_free_record_data(void *rec_ref_p, void *user_ptr)
 
     free(dxt_rec_ref->write_traces);
     free(dxt_rec_ref->read_traces);
-    free(dxt_rec_ref->file_rec);
 }
 
 /********************************************************************************
@@ -1093,7 +1121,9 @@ static void dxt_posix_cleanup()
     /* cleanup internal structures used for instrumenting */
     darshan_iter_record_refs(dxt_posix_runtime->rec_id_hash,
         dxt_free_record_data, NULL);
-    darshan_clear_record_refs(&(dxt_posix_runtime->rec_id_hash), 1);
+    darshan_clear_record_refs(&(dxt_posix_runtime->rec_id_hash), 0);
+    darshan_slab_destroy(dxt_posix_runtime->rec_ref_slab);
+    darshan_slab_destroy(dxt_posix_runtime->file_rec_slab);
 
     free(dxt_posix_runtime);
     dxt_posix_runtime = NULL;
@@ -1215,7 +1245,9 @@ static void dxt_mpiio_cleanup()
     /* cleanup internal structures used for instrumenting */
     darshan_iter_record_refs(dxt_mpiio_runtime->rec_id_hash,
         dxt_free_record_data, NULL);
-    darshan_clear_record_refs(&(dxt_mpiio_runtime->rec_id_hash), 1);
+    darshan_clear_record_refs(&(dxt_mpiio_runtime->rec_id_hash), 0);
+    darshan_slab_destroy(dxt_mpiio_runtime->rec_ref_slab);
+    darshan_slab_destroy(dxt_mpiio_runtime->file_rec_slab);
 
     free(dxt_mpiio_runtime);
     dxt_mpiio_runtime = NULL;
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <errno.h>
 #include <search.h>
 #include <assert.h>
@@ -69,6 +70,7 @@ struct hdf5_runtime
     void *rec_id_hash;
     void *hid_hash;
     int rec_count;
+    int common_val_estimated; /* set once common value counts are estimates */
 };
 
 static void hdf5_file_runtime_initialize(
@@ -135,19 +137,14 @@ static int my_rank = -1;
     darshan_record_id __rec_id; \
     struct hdf5_file_record_ref *__rec_ref; \
     char *__newpath; \
-    __newpath = darshan_clean_file_path(__path); \
+    char __newpath_buf[PATH_MAX]; \
+    __newpath = darshan_clean_file_path_buf(__path, __newpath_buf, PATH_MAX); \
     if(!__newpath) __newpath = (char *)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(__newpath)) break; \
     __rec_id = darshan_core_gen_record_id(__newpath); \
     __rec_ref = darshan_lookup_record_ref(hdf5_file_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
     if(!__rec_ref) __rec_ref = hdf5_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    if(!__rec_ref) break; \
     __rec_ref->file_rec->counters[H5F_USE_MPIIO] = __use_mpio; \
     __rec_ref->file_rec->counters[H5F_OPENS] += 1; \
     if(__rec_ref->file_rec->fcounters[H5F_F_OPEN_START_TIMESTAMP] == 0 || \
@@ -157,7 +154,6 @@ static int my_rank = -1;
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[H5F_F_META_TIME], \
         __tm1, __tm2, __rec_ref->last_meta_end); \
     darshan_add_record_ref(&(hdf5_file_runtime->hid_hash), &__ret, sizeof(hid_t), __rec_ref); \
-    if(__newpath != __path) free(__newpath); \
 } while(0)
 
 hid_t DARSHAN_DECL(H5Fcreate)(const char *filename, unsigned flags,
@@ -694,6 +690,8 @@ herr_t DARSHAN_DECL(H5Dread)(hid_t dataset_id, hid_t mem_type_id, hid_t mem_spac
                 &(rec_ref->dataset_rec->counters[H5D_ACCESS1_ACCESS]),
                 &(rec_ref->dataset_rec->counters[H5D_ACCESS1_COUNT]),
                 cvc->vals, cvc->nvals, cvc->freq, 0);
+            DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_H5D_MOD,
+                hdf5_dataset_runtime->common_val_estimated);
 #ifdef DARSHAN_HDF5_PAR_BUILD
             if(xfer_plist_id != H5P_DEFAULT)
             {
@@ -815,6 +813,8 @@ herr_t DARSHAN_DECL(H5Dwrite)(hid_t dataset_id, hid_t mem_type_id, hid_t mem_spa
                 &(rec_ref->dataset_rec->counters[H5D_ACCESS1_ACCESS]),
                 &(rec_ref->dataset_rec->counters[H5D_ACCESS1_COUNT]),
                 cvc->vals, cvc->nvals, cvc->freq, 0);
+            DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_H5D_MOD,
+                hdf5_dataset_runtime->common_val_estimated);
 #ifdef DARSHAN_HDF5_PAR_BUILD
             if(xfer_plist_id != H5P_DEFAULT)
             {
@@ -1086,7 +1086,7 @@ static void hdf5_finalize_dataset_records(void *rec_ref_p, void *user_ptr)
     struct hdf5_dataset_record_ref *rec_ref =
         (struct hdf5_dataset_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
+    darshan_clear_common_val_counters(&rec_ref->access_root);
     return;
 }
 
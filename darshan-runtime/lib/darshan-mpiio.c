@@ -17,6 +17,7 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <errno.h>
 #include <search.h>
 #include <assert.h>
@@ -153,6 +154,8 @@ struct mpiio_runtime
     void *rec_id_hash;
     void *fh_hash;
     int file_rec_count;
+    int redux_flag; /* set once shared records have been reduced */
+    int common_val_estimated; /* set once common value counts are estimates */
 };
 
 static void mpiio_runtime_initialize(
@@ -175,11 +178,16 @@ static void mpiio_output(
     void **mpiio_buf, int *mpiio_buf_sz);
 static void mpiio_cleanup(
     void);
+static void mpiio_snapshot(
+    void *mpiio_buf, void **snap_buf, int *snap_buf_sz);
 
 static struct mpiio_runtime *mpiio_runtime = NULL;
 static pthread_mutex_t mpiio_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 
+/* initial width of the activity bins of new records (0 if disabled) */
+static double mpiio_activity_bin_width = 0;
+
 #define MPIIO_LOCK() pthread_mutex_lock(&mpiio_runtime_mutex)
 #define MPIIO_UNLOCK() pthread_mutex_unlock(&mpiio_runtime_mutex)
 
@@ -203,21 +211,16 @@ static int my_rank = -1;
     darshan_record_id rec_id; \
     struct mpiio_file_record_ref *rec_ref; \
     char *newpath; \
+    char newpath_buf[PATH_MAX]; \
     int comm_size; \
     if(__ret != MPI_SUCCESS) break; \
-    newpath = darshan_clean_file_path(__path); \
+    newpath = darshan_clean_file_path_buf(__path, newpath_buf, PATH_MAX); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(newpath)) break; \
     rec_id = darshan_core_gen_record_id(newpath); \
     rec_ref = darshan_lookup_record_ref(mpiio_runtime->rec_id_hash, &rec_id, sizeof(darshan_record_id)); \
     if(!rec_ref) rec_ref = mpiio_track_new_file_record(rec_id, newpath); \
-    if(!rec_ref) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
+    if(!rec_ref) break; \
     rec_ref->file_rec->counters[MPIIO_MODE] = __mode; \
     PMPI_Comm_size(__comm, &comm_size); \
     if(comm_size == 1) \
@@ -233,7 +236,6 @@ static int my_rank = -1;
     DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[MPIIO_F_META_TIME], \
         __tm1, __tm2, rec_ref->last_meta_end); \
     darshan_add_record_ref(&(mpiio_runtime->fh_hash), &__fh, sizeof(MPI_File), rec_ref); \
-    if(newpath != __path) free(newpath); \
 } while(0)
 
 /* XXX: this check is needed to work around an OpenMPI bug that is triggered by
@@ -269,6 +271,8 @@ static int get_byte_offset = 0;
         &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
         &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]), \
         cvc->vals, 1, cvc->freq, 0); \
+    DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_MPIIO_MOD, \
+        mpiio_runtime->common_val_estimated); \
     rec_ref->file_rec->counters[MPIIO_BYTES_READ] += size; \
     rec_ref->file_rec->counters[__counter] += 1; \
     if(rec_ref->last_io_type == DARSHAN_IO_WRITE) \
@@ -278,6 +282,10 @@ static int get_byte_offset = 0;
      rec_ref->file_rec->fcounters[MPIIO_F_READ_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[MPIIO_F_READ_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[MPIIO_F_READ_END_TIMESTAMP] = __tm2; \
+    darshan_activity_bins_add(&(rec_ref->file_rec->counters[MPIIO_ACTIVITY_READ_0]), \
+        &(rec_ref->file_rec->counters[MPIIO_ACTIVITY_WRITE_0]), \
+        &(rec_ref->file_rec->fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH]), \
+        mpiio_activity_bin_width, __tm1, size, 0); \
     if(rec_ref->file_rec->fcounters[MPIIO_F_MAX_READ_TIME] < __elapsed) { \
         rec_ref->file_rec->fcounters[MPIIO_F_MAX_READ_TIME] = __elapsed; \
         rec_ref->file_rec->counters[MPIIO_MAX_READ_TIME_SIZE] = size; } \
@@ -308,6 +316,8 @@ static int get_byte_offset = 0;
         &(rec_ref->file_rec->counters[MPIIO_ACCESS1_ACCESS]), \
         &(rec_ref->file_rec->counters[MPIIO_ACCESS1_COUNT]), \
         cvc->vals, 1, cvc->freq, 0); \
+    DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_MPIIO_MOD, \
+        mpiio_runtime->common_val_estimated); \
     rec_ref->file_rec->counters[MPIIO_BYTES_WRITTEN] += size; \
     rec_ref->file_rec->counters[__counter] += 1; \
     if(rec_ref->last_io_type == DARSHAN_IO_READ) \
@@ -317,6 +327,10 @@ static int get_byte_offset = 0;
      rec_ref->file_rec->fcounters[MPIIO_F_WRITE_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[MPIIO_F_WRITE_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[MPIIO_F_WRITE_END_TIMESTAMP] = __tm2; \
+    darshan_activity_bins_add(&(rec_ref->file_rec->counters[MPIIO_ACTIVITY_READ_0]), \
+        &(rec_ref->file_rec->counters[MPIIO_ACTIVITY_WRITE_0]), \
+        &(rec_ref->file_rec->fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH]), \
+        mpiio_activity_bin_width, __tm1, size, 1); \
     if(rec_ref->file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] < __elapsed) { \
         rec_ref->file_rec->fcounters[MPIIO_F_MAX_WRITE_TIME] = __elapsed; \
         rec_ref->file_rec->counters[MPIIO_MAX_WRITE_TIME_SIZE] = size; } \
@@ -1169,9 +1183,11 @@ static void mpiio_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
     .mod_redux_func = &mpiio_mpi_redux,
+    .mod_subset_redux_func = &mpiio_mpi_redux,
 #endif
     .mod_output_func = &mpiio_output,
-    .mod_cleanup_func = &mpiio_cleanup
+    .mod_cleanup_func = &mpiio_cleanup,
+    .mod_snapshot_func = &mpiio_snapshot
     };
 
     /* try and store the default number of records for this module */
@@ -1193,6 +1209,12 @@ static void mpiio_runtime_initialize()
     }
     memset(mpiio_runtime, 0, sizeof(*mpiio_runtime));
 
+    mpiio_activity_bin_width = darshan_core_activity_bin_width();
+
+    /* let darshan-core sparse encode our records in the log */
+    darshan_core_register_record_layout(DARSHAN_MPIIO_MOD,
+        MPIIO_NUM_INDICES, MPIIO_F_NUM_INDICES);
+
     /* allow DXT module to initialize if needed */
     dxt_mpiio_runtime_initialize();
 
@@ -1241,6 +1263,7 @@ static struct mpiio_file_record_ref *mpiio_track_new_file_record(
     /* registering this file record was successful, so initialize some fields */
     file_rec->base_rec.id = rec_id;
     file_rec->base_rec.rank = my_rank;
+    file_rec->counters[MPIIO_SHARED_RANKS] = 1;
     rec_ref->file_rec = file_rec;
     mpiio_runtime->file_rec_count++;
 
@@ -1252,7 +1275,7 @@ static void mpiio_finalize_file_records(void *rec_ref_p, void *user_ptr)
     struct mpiio_file_record_ref *rec_ref =
         (struct mpiio_file_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
+    darshan_clear_common_val_counters(&rec_ref->access_root);
     return;
 }
 
@@ -1424,6 +1447,24 @@ static void mpiio_record_reduction_op(void* infile_v, void* inoutfile_v,
                 inoutfile->fcounters[MPIIO_F_SLOWEST_RANK_TIME];
         }
 
+        /* sum */
+        tmp_file.counters[MPIIO_SHARED_RANKS] =
+            infile->counters[MPIIO_SHARED_RANKS] +
+            inoutfile->counters[MPIIO_SHARED_RANKS];
+
+        /* sum, at the coarser of the two bin widths */
+        memcpy(&(tmp_file.counters[MPIIO_ACTIVITY_READ_0]),
+            &(inoutfile->counters[MPIIO_ACTIVITY_READ_0]),
+            2 * DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        tmp_file.fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH] =
+            inoutfile->fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH];
+        darshan_activity_bins_merge(&(tmp_file.counters[MPIIO_ACTIVITY_READ_0]),
+            &(tmp_file.counters[MPIIO_ACTIVITY_WRITE_0]),
+            &(tmp_file.fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH]),
+            &(infile->counters[MPIIO_ACTIVITY_READ_0]),
+            &(infile->counters[MPIIO_ACTIVITY_WRITE_0]),
+            infile->fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH]);
+
         /* update pointers */
         *inoutfile = tmp_file;
         inoutfile++;
@@ -1439,10 +1480,13 @@ static void mpiio_shared_record_variance(MPI_Comm mod_comm,
 {
     MPI_Datatype var_dt;
     MPI_Op var_op;
+    int comm_rank;
     int i;
     struct darshan_variance_dt *var_send_buf = NULL;
     struct darshan_variance_dt *var_recv_buf = NULL;
 
+    PMPI_Comm_rank(mod_comm, &comm_rank);
+
     PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
         MPI_BYTE, &var_dt);
     PMPI_Type_commit(&var_dt);
@@ -1453,7 +1497,7 @@ static void mpiio_shared_record_variance(MPI_Comm mod_comm,
     if(!var_send_buf)
         return;
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
 
@@ -1475,7 +1519,7 @@ static void mpiio_shared_record_variance(MPI_Comm mod_comm,
     PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
         var_dt, var_op, 0, mod_comm);
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         for(i=0; i<shared_rec_count; i++)
         {
@@ -1498,7 +1542,7 @@ static void mpiio_shared_record_variance(MPI_Comm mod_comm,
     PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
         var_dt, var_op, 0, mod_comm);
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         for(i=0; i<shared_rec_count; i++)
         {
@@ -1593,6 +1637,35 @@ void darshan_mpiio_shutdown_bench_setup(int test_case)
                     MPIIO_COLL_WRITES, 1, 2);
             }
             break;
+        case 5: /* 1020 unique files plus 4 shared files per proc */
+            for(i = 0; i < 1024; i++)
+            {
+                if(i < 4)
+                {
+                    snprintf(filepath, 256, "shared-%d", i);
+
+                    MPIIO_RECORD_OPEN(MPI_SUCCESS, filepath, fh_array[i],
+                        MPI_COMM_WORLD, 2, MPI_INFO_NULL, 0, 1);
+                    MPIIO_RECORD_WRITE(MPI_SUCCESS, fh_array[i],
+                        size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                        MPI_BYTE,
+                        offset_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                        MPIIO_COLL_WRITES, 1, 2);
+                }
+                else
+                {
+                    snprintf(filepath, 256, "fpp-%d_rank-%d", i, my_rank);
+
+                    MPIIO_RECORD_OPEN(MPI_SUCCESS, filepath, fh_array[i],
+                        MPI_COMM_SELF, 2, MPI_INFO_NULL, 0, 1);
+                    MPIIO_RECORD_WRITE(MPI_SUCCESS, fh_array[i],
+                        size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                        MPI_BYTE,
+                        offset_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                        MPIIO_INDEP_WRITES, 1, 2);
+                }
+            }
+            break;
         default:
             fprintf(stderr, "Error: invalid Darshan benchmark test case.\n");
             return;
@@ -1615,22 +1688,46 @@ static void mpiio_mpi_redux(
     darshan_record_id *shared_recs,
     int shared_rec_count)
 {
-    int mpiio_rec_count;
     struct mpiio_file_record_ref *rec_ref;
-    struct darshan_mpiio_file *mpiio_rec_buf = (struct darshan_mpiio_file *)mpiio_buf;
     double mpiio_time;
     struct darshan_mpiio_file *red_send_buf = NULL;
     struct darshan_mpiio_file *red_recv_buf = NULL;
     MPI_Datatype red_type;
     MPI_Op red_op;
+    int comm_rank;
     int i;
 
     MPIIO_LOCK();
     assert(mpiio_runtime);
 
-    mpiio_rec_count = mpiio_runtime->file_rec_count;
+    mpiio_runtime->redux_flag = 1;
+    PMPI_Comm_rank(mod_comm, &comm_rank);
 
-    /* necessary initialization of shared records */
+    /* allocate memory for the shared records, and for the reduction output
+     * on the root of the communicator
+     */
+    red_send_buf = malloc(shared_rec_count * sizeof(struct darshan_mpiio_file));
+    if(!red_send_buf)
+    {
+        MPIIO_UNLOCK();
+        return;
+    }
+    if(comm_rank == 0)
+    {
+        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_mpiio_file));
+        if(!red_recv_buf)
+        {
+            free(red_send_buf);
+            MPIIO_UNLOCK();
+            return;
+        }
+    }
+
+    /* copy the shared records, in the order given, into a contiguous
+     * buffer to reduce, after some necessary initialization. Records are
+     * left in place in the module's buffer until output time, since this
+     * may be called again for another group of processes.
+     */
     for(i = 0; i < shared_rec_count; i++)
     {
         rec_ref = darshan_lookup_record_ref(mpiio_runtime->rec_id_hash,
@@ -1663,26 +1760,7 @@ static void mpiio_mpi_redux(
                 rec_ref->file_rec->fcounters[MPIIO_F_FASTEST_RANK_TIME];
 
             rec_ref->file_rec->base_rec.rank = -1;
-    }
-
-    /* sort the array of records so we get all of the shared records
-     * (marked by rank -1) in a contiguous portion at end of the array
-     */
-    darshan_record_sort(mpiio_rec_buf, mpiio_rec_count,
-        sizeof(struct darshan_mpiio_file));
-
-    /* make send_buf point to the shared files at the end of sorted array */
-    red_send_buf = &(mpiio_rec_buf[mpiio_rec_count-shared_rec_count]);
-
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_mpiio_file));
-        if(!red_recv_buf)
-        {
-            MPIIO_UNLOCK();
-            return;
-        }
+            red_send_buf[i] = *(rec_ref->file_rec);
     }
 
     /* construct a datatype for a MPIIO file record.  This is serving no purpose
@@ -1703,21 +1781,22 @@ static void mpiio_mpi_redux(
     mpiio_shared_record_variance(mod_comm, red_send_buf, red_recv_buf,
         shared_rec_count);
 
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = mpiio_rec_count - shared_rec_count;
-        memcpy(&(mpiio_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_mpiio_file));
-        free(red_recv_buf);
-    }
-    else
+    /* update module state to account for shared file reduction: the root
+     * overwrites its shared records with the reduced records, while other
+     * processes mark theirs to be dropped at output time
+     */
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        mpiio_runtime->file_rec_count -= shared_rec_count;
+        rec_ref = darshan_lookup_record_ref(mpiio_runtime->rec_id_hash,
+            &shared_recs[i], sizeof(darshan_record_id));
+        if(comm_rank == 0)
+            *(rec_ref->file_rec) = red_recv_buf[i];
+        else
+            rec_ref->file_rec->base_rec.rank = DARSHAN_REDUCED_RECORD_RANK;
     }
 
+    free(red_send_buf);
+    free(red_recv_buf);
     PMPI_Type_free(&red_type);
     PMPI_Op_free(&red_op);
 
@@ -1735,7 +1814,17 @@ static void mpiio_output(
     MPIIO_LOCK();
     assert(mpiio_runtime);
 
-    /* just pass back our updated total buffer size -- no need to update buffer */
+    /* if shared records were reduced, gather them at the end of the buffer
+     * and drop those that were reduced into another process's records
+     */
+    if(mpiio_runtime->redux_flag)
+    {
+        mpiio_runtime->file_rec_count = darshan_record_compact(*mpiio_buf,
+            mpiio_runtime->file_rec_count, sizeof(struct darshan_mpiio_file));
+        mpiio_runtime->redux_flag = 0;
+    }
+
+    /* pass back our updated total buffer size */
     mpiio_rec_count = mpiio_runtime->file_rec_count;
     *mpiio_buf_sz = mpiio_rec_count * sizeof(struct darshan_mpiio_file);
 
@@ -1743,6 +1832,34 @@ static void mpiio_output(
     return;
 }
 
+static void mpiio_snapshot(
+    void *mpiio_buf,
+    void **snap_buf,
+    int *snap_buf_sz)
+{
+    *snap_buf = NULL;
+    *snap_buf_sz = 0;
+
+    MPIIO_LOCK();
+    if(!mpiio_runtime)
+    {
+        MPIIO_UNLOCK();
+        return;
+    }
+
+    *snap_buf = malloc(mpiio_runtime->file_rec_count *
+        sizeof(struct darshan_mpiio_file));
+    if(*snap_buf)
+    {
+        *snap_buf_sz = mpiio_runtime->file_rec_count *
+            sizeof(struct darshan_mpiio_file);
+        memcpy(*snap_buf, mpiio_buf, *snap_buf_sz);
+    }
+
+    MPIIO_UNLOCK();
+    return;
+}
+
 static void mpiio_cleanup()
 {
     MPIIO_LOCK();
@@ -16,6 +16,7 @@
 #include <string.h>
 #include <time.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <errno.h>
 #include <search.h>
 #include <assert.h>
@@ -83,20 +84,15 @@ static int my_rank = -1;
     darshan_record_id rec_id; \
     struct pnetcdf_file_record_ref *rec_ref; \
     char *newpath; \
+    char newpath_buf[PATH_MAX]; \
     int comm_size; \
-    newpath = darshan_clean_file_path(__path); \
+    newpath = darshan_clean_file_path_buf(__path, newpath_buf, PATH_MAX); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(newpath)) break; \
     rec_id = darshan_core_gen_record_id(newpath); \
     rec_ref = darshan_lookup_record_ref(pnetcdf_runtime->rec_id_hash, &rec_id, sizeof(darshan_record_id)); \
     if(!rec_ref) rec_ref = pnetcdf_track_new_file_record(rec_id, newpath); \
-    if(!rec_ref) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
+    if(!rec_ref) break; \
     PMPI_Comm_size(__comm, &comm_size); \
     if(rec_ref->file_rec->fcounters[PNETCDF_F_OPEN_START_TIMESTAMP] == 0 || \
      rec_ref->file_rec->fcounters[PNETCDF_F_OPEN_START_TIMESTAMP] > __tm1) \
@@ -105,7 +101,6 @@ static int my_rank = -1;
     if(comm_size == 1) rec_ref->file_rec->counters[PNETCDF_INDEP_OPENS] += 1; \
     else rec_ref->file_rec->counters[PNETCDF_COLL_OPENS] += 1; \
     darshan_add_record_ref(&(pnetcdf_runtime->ncid_hash), __ncidp, sizeof(int), rec_ref); \
-    if(newpath != __path) free(newpath); \
 } while(0)
 
 /*********************************************************
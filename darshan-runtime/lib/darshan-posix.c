@@ -142,6 +142,10 @@ struct posix_file_record_ref
     int stride_count;
     struct posix_aio_tracker* aio_list;
     int fs_type; /* same as darshan_fs_info->fs_type */
+    unsigned int seek_gen;
+    int sample_countdown;
+    int64_t sampled_reads;
+    int64_t sampled_writes;
 };
 
 /* The posix_runtime structure maintains necessary state for storing
@@ -151,8 +155,47 @@ struct posix_file_record_ref
 struct posix_runtime
 {
     void *rec_id_hash;
-    void *fd_hash;
+    void *fd_table;
     int file_rec_count;
+    struct darshan_slab *rec_ref_slab;
+    int redux_flag; /* set once shared records have been reduced */
+    int common_val_estimated; /* set once common value counts are estimates */
+};
+
+/* The posix_shard_rec structure tracks a single thread's view of a POSIX
+ * file record when the module is running in sharded mode (enabled with the
+ * DARSHAN_POSIX_SHARDED environment variable).
+ *
+ * RATIONALE: in sharded mode, read and write wrappers do not acquire the
+ * module-wide mutex. Instead, each thread accumulates counter deltas for a
+ * file record in its own posix_shard_rec, which are folded into the shared
+ * darshan_posix_file record when the file is closed and at shutdown time.
+ * 'rec_ref' mirrors a normal posix_file_record_ref, with 'file_rec' pointing
+ * at the private 'delta' record, so that the same instrumentation macros can
+ * be used to update either one. 'parent' is the module-wide record reference
+ * the deltas are eventually merged into, and 'seek_gen' is used to detect
+ * when the parent's file offset has been changed by an open or seek.
+ */
+struct posix_shard_rec
+{
+    struct posix_file_record_ref rec_ref;
+    struct darshan_posix_file delta;
+    struct posix_file_record_ref *parent;
+    unsigned int seek_gen;
+};
+
+/* per-thread shard of POSIX module state. 'rec_id_hash' indexes this
+ * thread's posix_shard_rec structures by record id and 'fd_table' caches
+ * file descriptor lookups, which is invalidated whenever 'fd_gen' falls
+ * behind the module-wide descriptor generation count.
+ */
+struct posix_thread_shard
+{
+    pthread_mutex_t mutex;
+    void *rec_id_hash;
+    void *fd_table;
+    unsigned int fd_gen;
+    struct posix_thread_shard *next;
 };
 
 /* struct to track information about aio operations in flight */
@@ -173,6 +216,22 @@ static struct posix_aio_tracker* posix_aio_tracker_del(
     int fd, void *aiocbp);
 static void posix_finalize_file_records(
     void *rec_ref_p, void *user_ptr);
+static int posix_shard_enter(
+    void);
+static void posix_shard_exit(
+    void);
+static struct posix_file_record_ref *posix_shard_lookup_fd(
+    int fd);
+static void posix_shard_merge_record(
+    struct posix_file_record_ref *rec_ref);
+static void posix_shard_merge_all(
+    void);
+static void posix_shard_clear(
+    void);
+static int posix_sample_op(
+    struct posix_file_record_ref *rec_ref);
+static void posix_estimate_sampled_counters(
+    void *rec_ref_p, void *user_ptr);
 #ifdef HAVE_MPI
 static void posix_record_reduction_op(
     void* infile_v, void* inoutfile_v, int *len, MPI_Datatype *datatype);
@@ -187,18 +246,65 @@ static void posix_output(
     void **posix_buf, int *posix_buf_sz);
 static void posix_cleanup(
     void);
+static void posix_snapshot(
+    void *posix_buf, void **snap_buf, int *snap_buf_sz);
 
 /* extern function def for querying record name from a STDIO stream */
-extern char *darshan_stdio_lookup_record_name(FILE *stream);
+extern int darshan_stdio_lookup_record_name(FILE *stream, char *name,
+    int name_len);
 
 static struct posix_runtime *posix_runtime = NULL;
 static pthread_mutex_t posix_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static int my_rank = -1;
 static int darshan_mem_alignment = 1;
 
+/* sharded mode state. thread shards are never freed, since threads may
+ * still hold references to them after the module has been cleaned up
+ */
+static int posix_shard_mode = -1;
+static unsigned int posix_fd_gen = 0;
+static struct posix_thread_shard *posix_shard_list = NULL;
+static __thread struct posix_thread_shard *posix_my_shard = NULL;
+static __thread int posix_my_shard_held = 0;
+
+/* sampling state: with a period N > 1, only 1 in N reads and writes feed
+ * DXT, the common access size/stride counters, and the I/O time counters,
+ * which are scaled up to estimates at shutdown
+ */
+static int posix_sample_period = 1;
+static int posix_sample_random = 0;
+static int posix_sample_estimated = 0;
+static __thread uint32_t posix_sample_rng = 0;
+
+/* initial width of the activity bins of new records (0 if disabled) */
+static double posix_activity_bin_width = 0;
+
+#define POSIX_SAMPLE_OP(__rec_ref) \
+    (posix_sample_period == 1 || posix_sample_op(__rec_ref))
+
 #define POSIX_LOCK() pthread_mutex_lock(&posix_runtime_mutex)
 #define POSIX_UNLOCK() pthread_mutex_unlock(&posix_runtime_mutex)
 
+/* bump the descriptor generation count whenever the fd_table is modified,
+ * so that per-thread descriptor caches know to revalidate
+ */
+#define POSIX_FD_GEN_INC() \
+    __atomic_add_fetch(&posix_fd_gen, 1, __ATOMIC_RELEASE)
+
+/* bump the seek generation count of a record whenever its offset state is
+ * changed outside of the read/write path
+ */
+#define POSIX_SEEK_GEN_INC(__rec_ref) \
+    __atomic_add_fetch(&(__rec_ref)->seek_gen, 1, __ATOMIC_RELEASE)
+
+/* look up the record reference to instrument for a read or write on the
+ * given fd -- this is the calling thread's shard record if the caller
+ * entered the module using POSIX_PRE_RECORD_RW() in sharded mode
+ */
+#define POSIX_LOOKUP_FD_REF(__fd) \
+    (posix_my_shard_held ? posix_shard_lookup_fd(__fd) : \
+     darshan_lookup_handle_ref(posix_runtime->fd_table, __fd))
+
 #define POSIX_PRE_RECORD() do { \
     POSIX_LOCK(); \
     if(!darshan_core_disabled_instrumentation()) { \
@@ -215,27 +321,42 @@ static int darshan_mem_alignment = 1;
     POSIX_UNLOCK(); \
 } while(0)
 
+/* variants of the pre/post record macros used by read and write wrappers,
+ * which only lock the calling thread's shard when in sharded mode
+ */
+#define POSIX_PRE_RECORD_RW() do { \
+    if(posix_shard_mode < 0) \
+        posix_shard_mode = (getenv("DARSHAN_POSIX_SHARDED") != NULL); \
+    if(posix_shard_mode) { \
+        if(!darshan_core_disabled_instrumentation() && posix_shard_enter()) \
+            break; \
+        return(ret); \
+    } \
+    POSIX_PRE_RECORD(); \
+} while(0)
+
+#define POSIX_POST_RECORD_RW() do { \
+    if(posix_my_shard_held) \
+        posix_shard_exit(); \
+    else \
+        POSIX_UNLOCK(); \
+} while(0)
+
 #define POSIX_RECORD_OPEN(__ret, __path, __mode, __tm1, __tm2) do { \
     darshan_record_id __rec_id; \
     struct posix_file_record_ref *__rec_ref; \
     char *__newpath; \
+    char __newpath_buf[PATH_MAX]; \
     if(__ret < 0) break; \
-    __newpath = darshan_clean_file_path(__path); \
+    __newpath = darshan_clean_file_path_buf(__path, __newpath_buf, PATH_MAX); \
     if(!__newpath) __newpath = (char *)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(__newpath)) break; \
     __rec_id = darshan_core_gen_record_id(__newpath); \
     __rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
     if(!__rec_ref) __rec_ref = posix_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != __path) free(__newpath); \
-        break; \
-    } \
+    if(!__rec_ref) break; \
     _POSIX_RECORD_OPEN(__ret, __rec_ref, __mode, __tm1, __tm2, 1, -1); \
     darshan_instrument_fs_data(__rec_ref->fs_type, __newpath, __ret); \
-    if(__newpath != __path) free(__newpath); \
 } while(0)
 
 #define POSIX_RECORD_REFOPEN(__ret, __rec_ref, __tm1, __tm2, __ref_counter) do { \
@@ -249,6 +370,7 @@ static int darshan_mem_alignment = 1;
         __rec_ref->offset = 0; \
         __rec_ref->last_byte_written = 0; \
         __rec_ref->last_byte_read = 0; \
+        POSIX_SEEK_GEN_INC(__rec_ref); \
     } \
     __rec_ref->file_rec->counters[POSIX_OPENS] += 1; \
     if(__ref_counter >= 0) __rec_ref->file_rec->counters[__ref_counter] += 1; \
@@ -258,7 +380,8 @@ static int darshan_mem_alignment = 1;
     __rec_ref->file_rec->fcounters[POSIX_F_OPEN_END_TIMESTAMP] = __tm2; \
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[POSIX_F_META_TIME], \
         __tm1, __tm2, __rec_ref->last_meta_end); \
-    darshan_add_record_ref(&(posix_runtime->fd_hash), &__ret, sizeof(int), __rec_ref); \
+    darshan_add_handle_ref(&(posix_runtime->fd_table), __ret, __rec_ref); \
+    POSIX_FD_GEN_INC(); \
 } while(0)
 
 #define POSIX_RECORD_READ(__ret, __fd, __pread_flag, __pread_offset, __aligned, __tm1, __tm2) do { \
@@ -268,15 +391,18 @@ static int darshan_mem_alignment = 1;
     int64_t file_alignment; \
     struct darshan_common_val_counter *cvc; \
     double __elapsed = __tm2-__tm1; \
+    int __sampled; \
     if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &(__fd), sizeof(int)); \
+    rec_ref = POSIX_LOOKUP_FD_REF(__fd); \
     if(!rec_ref) break; \
+    __sampled = POSIX_SAMPLE_OP(rec_ref); \
     if(__pread_flag) \
         this_offset = __pread_offset; \
     else \
         this_offset = rec_ref->offset; \
     /* DXT to record detailed read tracing information */ \
-    dxt_posix_read(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
+    if(__sampled) \
+        dxt_posix_read(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
     if(this_offset > rec_ref->last_byte_read) \
         rec_ref->file_rec->counters[POSIX_SEQ_READS] += 1;  \
     if(this_offset == (rec_ref->last_byte_read + 1)) \
@@ -293,18 +419,24 @@ static int darshan_mem_alignment = 1;
     rec_ref->file_rec->counters[POSIX_BYTES_READ] += __ret; \
     rec_ref->file_rec->counters[POSIX_READS] += 1; \
     DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_READ_0_100]), __ret); \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
-    cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
-        &rec_ref->stride_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    if(__sampled) { \
+        cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
+            &rec_ref->access_count); \
+        if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
+            &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
+            &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
+            cvc->vals, 1, cvc->freq, 0); \
+        DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD, \
+            posix_runtime->common_val_estimated); \
+        cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
+            &rec_ref->stride_count); \
+        if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
+            &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
+            &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
+            cvc->vals, 1, cvc->freq, 0); \
+        DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD, \
+            posix_runtime->common_val_estimated); \
+    } \
     if(!__aligned) \
         rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
     file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
@@ -317,11 +449,17 @@ static int darshan_mem_alignment = 1;
      rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP] = __tm2; \
+    darshan_activity_bins_add(&(rec_ref->file_rec->counters[POSIX_ACTIVITY_READ_0]), \
+        &(rec_ref->file_rec->counters[POSIX_ACTIVITY_WRITE_0]), \
+        &(rec_ref->file_rec->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]), \
+        posix_activity_bin_width, __tm1, __ret, 0); \
     if(rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] < __elapsed) { \
         rec_ref->file_rec->fcounters[POSIX_F_MAX_READ_TIME] = __elapsed; \
         rec_ref->file_rec->counters[POSIX_MAX_READ_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_READ_TIME], \
-        __tm1, __tm2, rec_ref->last_read_end); \
+    if(__sampled) { \
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_READ_TIME], \
+            __tm1, __tm2, rec_ref->last_read_end); \
+        rec_ref->sampled_reads += 1; } \
 } while(0)
 
 #define POSIX_RECORD_WRITE(__ret, __fd, __pwrite_flag, __pwrite_offset, __aligned, __tm1, __tm2) do { \
@@ -331,15 +469,18 @@ static int darshan_mem_alignment = 1;
     int64_t file_alignment; \
     struct darshan_common_val_counter *cvc; \
     double __elapsed = __tm2-__tm1; \
+    int __sampled; \
     if(__ret < 0) break; \
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &__fd, sizeof(int)); \
+    rec_ref = POSIX_LOOKUP_FD_REF(__fd); \
     if(!rec_ref) break; \
+    __sampled = POSIX_SAMPLE_OP(rec_ref); \
     if(__pwrite_flag) \
         this_offset = __pwrite_offset; \
     else \
         this_offset = rec_ref->offset; \
     /* DXT to record detailed write tracing information */ \
-    dxt_posix_write(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
+    if(__sampled) \
+        dxt_posix_write(rec_ref->file_rec->base_rec.id, this_offset, __ret, __tm1, __tm2); \
     if(this_offset > rec_ref->last_byte_written) \
         rec_ref->file_rec->counters[POSIX_SEQ_WRITES] += 1; \
     if(this_offset == (rec_ref->last_byte_written + 1)) \
@@ -356,18 +497,24 @@ static int darshan_mem_alignment = 1;
     rec_ref->file_rec->counters[POSIX_BYTES_WRITTEN] += __ret; \
     rec_ref->file_rec->counters[POSIX_WRITES] += 1; \
     DARSHAN_BUCKET_INC(&(rec_ref->file_rec->counters[POSIX_SIZE_WRITE_0_100]), __ret); \
-    cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
-        &rec_ref->access_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
-        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
-    cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
-        &rec_ref->stride_count); \
-    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
-        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
-        cvc->vals, 1, cvc->freq, 0); \
+    if(__sampled) { \
+        cvc = darshan_track_common_val_counters(&rec_ref->access_root, &__ret, 1, \
+            &rec_ref->access_count); \
+        if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
+            &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]), \
+            &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]), \
+            cvc->vals, 1, cvc->freq, 0); \
+        DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD, \
+            posix_runtime->common_val_estimated); \
+        cvc = darshan_track_common_val_counters(&rec_ref->stride_root, &stride, 1, \
+            &rec_ref->stride_count); \
+        if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS( \
+            &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]), \
+            &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]), \
+            cvc->vals, 1, cvc->freq, 0); \
+        DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD, \
+            posix_runtime->common_val_estimated); \
+    } \
     if(!__aligned) \
         rec_ref->file_rec->counters[POSIX_MEM_NOT_ALIGNED] += 1; \
     file_alignment = rec_ref->file_rec->counters[POSIX_FILE_ALIGNMENT]; \
@@ -380,26 +527,29 @@ static int darshan_mem_alignment = 1;
      rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[POSIX_F_WRITE_END_TIMESTAMP] = __tm2; \
+    darshan_activity_bins_add(&(rec_ref->file_rec->counters[POSIX_ACTIVITY_READ_0]), \
+        &(rec_ref->file_rec->counters[POSIX_ACTIVITY_WRITE_0]), \
+        &(rec_ref->file_rec->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]), \
+        posix_activity_bin_width, __tm1, __ret, 1); \
     if(rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] < __elapsed) { \
         rec_ref->file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] = __elapsed; \
         rec_ref->file_rec->counters[POSIX_MAX_WRITE_TIME_SIZE] = __ret; } \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME], \
-        __tm1, __tm2, rec_ref->last_write_end); \
+    if(__sampled) { \
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[POSIX_F_WRITE_TIME], \
+            __tm1, __tm2, rec_ref->last_write_end); \
+        rec_ref->sampled_writes += 1; } \
 } while(0)
 
 #define POSIX_LOOKUP_RECORD_STAT(__path, __statbuf, __tm1, __tm2) do { \
     darshan_record_id rec_id; \
     struct posix_file_record_ref* rec_ref; \
-    char *newpath = darshan_clean_file_path(__path); \
+    char newpath_buf[PATH_MAX]; \
+    char *newpath = darshan_clean_file_path_buf(__path, newpath_buf, PATH_MAX); \
     if(!newpath) newpath = (char *)__path; \
-    if(darshan_core_excluded_path(newpath)) { \
-        if(newpath != __path) free(newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(newpath)) break; \
     rec_id = darshan_core_gen_record_id(newpath); \
     rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash, &rec_id, sizeof(darshan_record_id)); \
     if(!rec_ref) rec_ref = posix_track_new_file_record(rec_id, newpath); \
-    if(newpath != __path) free(newpath); \
     if(rec_ref) { \
         POSIX_RECORD_STAT(rec_ref, __statbuf, __tm1, __tm2); \
     } \
@@ -541,14 +691,13 @@ int DARSHAN_DECL(openat)(int dirfd, const char *pathname, int flags, ...)
     else
     {
         /* construct path relative to dirfd */
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &dirfd, sizeof(dirfd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, dirfd);
         if(rec_ref)
         {
-            dirpath = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
-            if(dirpath)
+            if(darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id,
+                tmp_path, PATH_MAX) == 0)
             {
-                strcat(tmp_path, dirpath);
+                dirpath = tmp_path;
                 if(dirpath[strlen(dirpath)-1] != '/')
                     strcat(tmp_path, "/");
                 strcat(tmp_path, pathname);
@@ -612,14 +761,13 @@ int DARSHAN_DECL(openat64)(int dirfd, const char *pathname, int flags, ...)
     else
     {
         /* construct path relative to dirfd */
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &dirfd, sizeof(dirfd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, dirfd);
         if(rec_ref)
         {
-            dirpath = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
-            if(dirpath)
+            if(darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id,
+                tmp_path, PATH_MAX) == 0)
             {
-                strcat(tmp_path, dirpath);
+                dirpath = tmp_path;
                 if(dirpath[strlen(dirpath)-1] != '/')
                     strcat(tmp_path, "/");
                 strcat(tmp_path, pathname);
@@ -693,8 +841,7 @@ int DARSHAN_DECL(dup)(int oldfd)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -717,8 +864,7 @@ int DARSHAN_DECL(dup2)(int oldfd, int newfd)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -741,8 +887,7 @@ int DARSHAN_DECL(dup3)(int oldfd, int newfd, int flags)
     if(ret >=0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &oldfd, sizeof(oldfd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, oldfd);
         POSIX_RECORD_REFOPEN(ret, rec_ref, tm1, tm2, POSIX_DUPS);
         POSIX_POST_RECORD();
     }
@@ -765,8 +910,8 @@ int DARSHAN_DECL(fileno)(FILE *stream)
 
     if(ret >= 0)
     {
-        char *rec_name = darshan_stdio_lookup_record_name(stream);
-        if(rec_name)
+        char rec_name[PATH_MAX];
+        if(darshan_stdio_lookup_record_name(stream, rec_name, PATH_MAX) == 0)
         {
             rec_id = darshan_core_gen_record_id(rec_name);
 
@@ -869,9 +1014,9 @@ ssize_t DARSHAN_DECL(read)(int fd, void *buf, size_t count)
     ret = __real_read(fd, buf, count);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -890,9 +1035,9 @@ ssize_t DARSHAN_DECL(write)(int fd, const void *buf, size_t count)
     ret = __real_write(fd, buf, count);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -911,9 +1056,9 @@ ssize_t DARSHAN_DECL(pread)(int fd, void *buf, size_t count, off_t offset)
     ret = __real_pread(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -932,9 +1077,9 @@ ssize_t DARSHAN_DECL(pwrite)(int fd, const void *buf, size_t count, off_t offset
     ret = __real_pwrite(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -953,9 +1098,9 @@ ssize_t DARSHAN_DECL(pread64)(int fd, void *buf, size_t count, off64_t offset)
     ret = __real_pread64(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -974,9 +1119,9 @@ ssize_t DARSHAN_DECL(pwrite64)(int fd, const void *buf, size_t count, off64_t of
     ret = __real_pwrite64(fd, buf, count, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1000,9 +1145,9 @@ ssize_t DARSHAN_DECL(readv)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_readv(fd, iov, iovcnt);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1027,9 +1172,9 @@ ssize_t DARSHAN_DECL(preadv)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_preadv(fd, iov, iovcnt, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1053,9 +1198,9 @@ ssize_t DARSHAN_DECL(preadv64)(int fd, const struct iovec *iov, int iovcnt, off6
     ret = __real_preadv64(fd, iov, iovcnt, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1082,9 +1227,9 @@ ssize_t DARSHAN_DECL(preadv2)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_preadv2(fd, iov, iovcnt, offset, flags);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1108,9 +1253,9 @@ ssize_t DARSHAN_DECL(preadv64v2)(int fd, const struct iovec *iov, int iovcnt, of
     ret = __real_preadv64v2(fd, iov, iovcnt, offset, flags);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_READ(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1135,9 +1280,9 @@ ssize_t DARSHAN_DECL(writev)(int fd, const struct iovec *iov, int iovcnt)
     ret = __real_writev(fd, iov, iovcnt);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 0, 0, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1162,9 +1307,9 @@ ssize_t DARSHAN_DECL(pwritev)(int fd, const struct iovec *iov, int iovcnt, off_t
     ret = __real_pwritev(fd, iov, iovcnt, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1188,9 +1333,9 @@ ssize_t DARSHAN_DECL(pwritev64)(int fd, const struct iovec *iov, int iovcnt, off
     ret = __real_pwritev64(fd, iov, iovcnt, offset);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1216,9 +1361,9 @@ ssize_t DARSHAN_DECL(pwritev2)(int fd, const struct iovec *iov, int iovcnt, off_
     ret = __real_pwritev2(fd, iov, iovcnt, offset, flags);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1242,9 +1387,9 @@ ssize_t DARSHAN_DECL(pwritev64v2)(int fd, const struct iovec *iov, int iovcnt, o
     ret = __real_pwritev64v2(fd, iov, iovcnt, offset, flags);
     tm2 = darshan_core_wtime();
 
-    POSIX_PRE_RECORD();
+    POSIX_PRE_RECORD_RW();
     POSIX_RECORD_WRITE(ret, fd, 1, offset, aligned_flag, tm1, tm2);
-    POSIX_POST_RECORD();
+    POSIX_POST_RECORD_RW();
 
     return(ret);
 }
@@ -1266,10 +1411,11 @@ off_t DARSHAN_DECL(lseek)(int fd, off_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
         if(rec_ref)
         {
             rec_ref->offset = ret;
+            POSIX_SEEK_GEN_INC(rec_ref);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -1296,10 +1442,11 @@ off64_t DARSHAN_DECL(lseek64)(int fd, off64_t offset, int whence)
     if(ret >= 0)
     {
         POSIX_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
         if(rec_ref)
         {
             rec_ref->offset = ret;
+            POSIX_SEEK_GEN_INC(rec_ref);
             DARSHAN_TIMER_INC_NO_OVERLAP(
                 rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
                 tm1, tm2, rec_ref->last_meta_end);
@@ -1411,7 +1558,7 @@ int DARSHAN_DECL(__fxstat)(int vers, int fd, struct stat *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1437,7 +1584,7 @@ int DARSHAN_DECL(__fxstat64)(int vers, int fd, struct stat64 *buf)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         POSIX_RECORD_STAT(rec_ref, buf, tm1, tm2);
@@ -1469,7 +1616,7 @@ void* DARSHAN_DECL(mmap)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
@@ -1502,7 +1649,7 @@ void* DARSHAN_DECL(mmap64)(void *addr, size_t length, int prot, int flags,
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         rec_ref->file_rec->counters[POSIX_MMAPS] += 1;
@@ -1529,7 +1676,7 @@ int DARSHAN_DECL(fsync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         DARSHAN_TIMER_INC_NO_OVERLAP(
@@ -1558,7 +1705,7 @@ int DARSHAN_DECL(fdatasync)(int fd)
         return(ret);
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         DARSHAN_TIMER_INC_NO_OVERLAP(
@@ -1584,11 +1731,14 @@ int DARSHAN_DECL(close)(int fd)
     tm2 = darshan_core_wtime();
 
     POSIX_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
+        if(posix_shard_mode > 0)
+            posix_shard_merge_record(rec_ref);
         rec_ref->last_byte_written = 0;
         rec_ref->last_byte_read = 0;
+        POSIX_SEEK_GEN_INC(rec_ref);
         if(rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] == 0 ||
          rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] > tm1)
            rec_ref->file_rec->fcounters[POSIX_F_CLOSE_START_TIMESTAMP] = tm1;
@@ -1596,7 +1746,8 @@ int DARSHAN_DECL(close)(int fd)
         DARSHAN_TIMER_INC_NO_OVERLAP(
             rec_ref->file_rec->fcounters[POSIX_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
-        darshan_delete_record_ref(&(posix_runtime->fd_hash), &fd, sizeof(int));
+        darshan_delete_handle_ref(&(posix_runtime->fd_table), fd);
+        POSIX_FD_GEN_INC();
     }
     POSIX_POST_RECORD();
 
@@ -1879,9 +2030,11 @@ static void posix_runtime_initialize()
     darshan_module_funcs mod_funcs = {
 #ifdef HAVE_MPI
         .mod_redux_func = &posix_mpi_redux,
+        .mod_subset_redux_func = &posix_mpi_redux,
 #endif
         .mod_output_func = &posix_output,
-        .mod_cleanup_func = &posix_cleanup
+        .mod_cleanup_func = &posix_cleanup,
+        .mod_snapshot_func = &posix_snapshot
         };
 
     /* try and store a default number of records for this module */
@@ -1903,6 +2056,30 @@ static void posix_runtime_initialize()
     }
     memset(posix_runtime, 0, sizeof(*posix_runtime));
 
+    posix_runtime->rec_ref_slab = darshan_slab_create("posix_rec_refs",
+        sizeof(struct posix_file_record_ref));
+    if(!posix_runtime->rec_ref_slab)
+    {
+        darshan_core_unregister_module(DARSHAN_POSIX_MOD);
+        free(posix_runtime);
+        posix_runtime = NULL;
+        return;
+    }
+
+    /* note in the log that counters will be estimated from samples */
+    posix_sample_period = darshan_core_sample_period(&posix_sample_random);
+    if(posix_sample_period > 1)
+    {
+        darshan_core_mark_sampled(DARSHAN_POSIX_MOD);
+        darshan_core_mark_sampled(DXT_POSIX_MOD);
+    }
+
+    posix_activity_bin_width = darshan_core_activity_bin_width();
+
+    /* let darshan-core sparse encode our records in the log */
+    darshan_core_register_record_layout(DARSHAN_POSIX_MOD,
+        POSIX_NUM_INDICES, POSIX_F_NUM_INDICES);
+
     /* allow DXT module to initialize if needed */
     dxt_posix_runtime_initialize();
 
@@ -1917,17 +2094,16 @@ static struct posix_file_record_ref *posix_track_new_file_record(
     struct darshan_fs_info fs_info;
     int ret;
 
-    rec_ref = malloc(sizeof(*rec_ref));
+    rec_ref = darshan_slab_alloc(posix_runtime->rec_ref_slab);
     if(!rec_ref)
         return(NULL);
-    memset(rec_ref, 0, sizeof(*rec_ref));
 
     /* add a reference to this file record based on record id */
     ret = darshan_add_record_ref(&(posix_runtime->rec_id_hash), &rec_id,
         sizeof(darshan_record_id), rec_ref);
     if(ret == 0)
     {
-        free(rec_ref);
+        darshan_slab_free(posix_runtime->rec_ref_slab, rec_ref);
         return(NULL);
     }
 
@@ -1945,7 +2121,7 @@ static struct posix_file_record_ref *posix_track_new_file_record(
     {
         darshan_delete_record_ref(&(posix_runtime->rec_id_hash),
             &rec_id, sizeof(darshan_record_id));
-        free(rec_ref);
+        darshan_slab_free(posix_runtime->rec_ref_slab, rec_ref);
         return(NULL);
     }
 
@@ -1954,6 +2130,7 @@ static struct posix_file_record_ref *posix_track_new_file_record(
     file_rec->base_rec.rank = my_rank;
     file_rec->counters[POSIX_MEM_ALIGNMENT] = darshan_mem_alignment;
     file_rec->counters[POSIX_FILE_ALIGNMENT] = fs_info.block_size;
+    file_rec->counters[POSIX_SHARED_RANKS] = 1;
 #ifndef DARSHAN_WRAP_MMAP
     /* set invalid value here if MMAP instrumentation is disabled */
     file_rec->counters[POSIX_MMAPS] = -1;
@@ -1975,7 +2152,7 @@ static struct posix_aio_tracker* posix_aio_tracker_del(int fd, void *aiocbp)
     struct posix_aio_tracker *tracker = NULL, *iter, *tmp;
     struct posix_file_record_ref *rec_ref;
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         LL_FOREACH_SAFE(rec_ref->aio_list, iter, tmp)
@@ -1998,7 +2175,7 @@ static void posix_aio_tracker_add(int fd, void *aiocbp)
     struct posix_aio_tracker* tracker;
     struct posix_file_record_ref *rec_ref;
 
-    rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash, &fd, sizeof(int));
+    rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
     if(rec_ref)
     {
         tracker = malloc(sizeof(*tracker));
@@ -2013,13 +2190,413 @@ static void posix_aio_tracker_add(int fd, void *aiocbp)
     return;
 }
 
+/* decide whether to sample the current read or write on a record */
+static int posix_sample_op(struct posix_file_record_ref *rec_ref)
+{
+    if(!posix_sample_random)
+        return(darshan_sample_op(&rec_ref->sample_countdown,
+            posix_sample_period, NULL));
+
+    /* seed each thread's generator differently */
+    if(posix_sample_rng == 0)
+        posix_sample_rng = ((uint32_t)(uintptr_t)&posix_sample_rng ^
+            ((uint32_t)my_rank << 16)) | 1;
+    return(darshan_sample_op(&rec_ref->sample_countdown,
+        posix_sample_period, &posix_sample_rng));
+}
+
+/* scale counters that were only updated on sampled operations up to
+ * estimates for all operations
+ */
+static void posix_estimate_sampled_counters(void *rec_ref_p, void *user_ptr)
+{
+    struct posix_file_record_ref *rec_ref =
+        (struct posix_file_record_ref *)rec_ref_p;
+    struct darshan_posix_file *file_rec = rec_ref->file_rec;
+
+    /* scale the record's copy in a snapshot of the module buffer instead,
+     * if given the offset of the snapshot from the module buffer
+     */
+    if(user_ptr)
+        file_rec = (struct darshan_posix_file *)((char *)file_rec +
+            *(ptrdiff_t *)user_ptr);
+    int64_t ops = file_rec->counters[POSIX_READS] +
+        file_rec->counters[POSIX_WRITES];
+    int64_t sampled_ops = rec_ref->sampled_reads + rec_ref->sampled_writes;
+    double scale;
+    int i;
+
+    if(rec_ref->sampled_reads > 0)
+        file_rec->fcounters[POSIX_F_READ_TIME] *=
+            (double)file_rec->counters[POSIX_READS] / rec_ref->sampled_reads;
+    if(rec_ref->sampled_writes > 0)
+        file_rec->fcounters[POSIX_F_WRITE_TIME] *=
+            (double)file_rec->counters[POSIX_WRITES] / rec_ref->sampled_writes;
+
+    if(sampled_ops > 0 && sampled_ops < ops)
+    {
+        scale = (double)ops / sampled_ops;
+        for(i = 0; i < 4; i++)
+        {
+            file_rec->counters[POSIX_ACCESS1_COUNT+i] =
+                file_rec->counters[POSIX_ACCESS1_COUNT+i] * scale + 0.5;
+            file_rec->counters[POSIX_STRIDE1_COUNT+i] =
+                file_rec->counters[POSIX_STRIDE1_COUNT+i] * scale + 0.5;
+        }
+    }
+
+    return;
+}
+
 static void posix_finalize_file_records(void *rec_ref_p, void *user_ptr)
 {
     struct posix_file_record_ref *rec_ref =
         (struct posix_file_record_ref *)rec_ref_p;
 
-    tdestroy(rec_ref->access_root, free);
-    tdestroy(rec_ref->stride_root, free);
+    darshan_clear_common_val_counters(&rec_ref->access_root);
+    darshan_clear_common_val_counters(&rec_ref->stride_root);
+    return;
+}
+
+/* returns with the calling thread's shard locked, creating the shard on
+ * first use. returns 0 if the shard could not be entered, in which case
+ * the calling wrapper should not record anything.
+ */
+static int posix_shard_enter()
+{
+    struct posix_thread_shard *shard = posix_my_shard;
+
+    /* avoid self-deadlock if we are re-entered while holding our shard */
+    if(posix_my_shard_held)
+        return(0);
+
+    if(!shard)
+    {
+        shard = malloc(sizeof(*shard));
+        if(!shard)
+            return(0);
+        memset(shard, 0, sizeof(*shard));
+        pthread_mutex_init(&shard->mutex, NULL);
+
+        POSIX_LOCK();
+        shard->next = posix_shard_list;
+        posix_shard_list = shard;
+        POSIX_UNLOCK();
+        posix_my_shard = shard;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    posix_my_shard_held = 1;
+
+    return(1);
+}
+
+static void posix_shard_exit()
+{
+    posix_my_shard_held = 0;
+    pthread_mutex_unlock(&posix_my_shard->mutex);
+    return;
+}
+
+/* pick up offset state from the parent record if it has been changed by an
+ * open, seek, or close since this shard record last looked at it
+ */
+static void posix_shard_sync(struct posix_shard_rec *srec)
+{
+    unsigned int seek_gen;
+
+    seek_gen = __atomic_load_n(&srec->parent->seek_gen, __ATOMIC_ACQUIRE);
+    if(seek_gen != srec->seek_gen)
+    {
+        srec->rec_ref.offset = srec->parent->offset;
+        srec->rec_ref.last_byte_read = srec->parent->last_byte_read;
+        srec->rec_ref.last_byte_written = srec->parent->last_byte_written;
+        srec->seek_gen = seek_gen;
+    }
+
+    return;
+}
+
+static struct posix_shard_rec *posix_shard_track_new_rec(
+    struct posix_thread_shard *shard, struct posix_file_record_ref *parent)
+{
+    struct posix_shard_rec *srec;
+    int ret;
+
+    srec = malloc(sizeof(*srec));
+    if(!srec)
+        return(NULL);
+    memset(srec, 0, sizeof(*srec));
+
+    ret = darshan_add_record_ref(&(shard->rec_id_hash),
+        &(parent->file_rec->base_rec.id), sizeof(darshan_record_id), srec);
+    if(ret == 0)
+    {
+        free(srec);
+        return(NULL);
+    }
+
+    /* copy over the fields the instrumentation macros read from the record */
+    srec->delta.base_rec.id = parent->file_rec->base_rec.id;
+    srec->delta.counters[POSIX_FILE_ALIGNMENT] =
+        parent->file_rec->counters[POSIX_FILE_ALIGNMENT];
+    srec->rec_ref.file_rec = &(srec->delta);
+    srec->rec_ref.fs_type = parent->fs_type;
+    srec->parent = parent;
+    srec->seek_gen = parent->seek_gen - 1;
+
+    return(srec);
+}
+
+/* find the calling thread's shard record for the given fd. the caller must
+ * hold its own shard (i.e., have entered via posix_shard_enter())
+ */
+static struct posix_file_record_ref *posix_shard_lookup_fd(int fd)
+{
+    struct posix_thread_shard *shard = posix_my_shard;
+    struct posix_file_record_ref *rec_ref;
+    struct posix_shard_rec *srec = NULL;
+    unsigned int fd_gen;
+
+    /* fast path: descriptor cache is still valid and has an entry */
+    fd_gen = __atomic_load_n(&posix_fd_gen, __ATOMIC_ACQUIRE);
+    if(shard->fd_gen == fd_gen)
+        srec = darshan_lookup_handle_ref(shard->fd_table, fd);
+
+    if(!srec)
+    {
+        /* slow path: consult the module-wide descriptor table. drop our
+         * shard first so we acquire the locks in the same order as the
+         * merge routines (module, then shard)
+         */
+        pthread_mutex_unlock(&shard->mutex);
+        POSIX_LOCK();
+        pthread_mutex_lock(&shard->mutex);
+
+        if(!posix_runtime && !darshan_core_disabled_instrumentation())
+            posix_runtime_initialize();
+        if(posix_runtime)
+        {
+            fd_gen = __atomic_load_n(&posix_fd_gen, __ATOMIC_ACQUIRE);
+            if(shard->fd_gen != fd_gen)
+            {
+                darshan_clear_handle_refs(&(shard->fd_table));
+                shard->fd_gen = fd_gen;
+            }
+
+            rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
+            if(rec_ref)
+            {
+                srec = darshan_lookup_record_ref(shard->rec_id_hash,
+                    &(rec_ref->file_rec->base_rec.id), sizeof(darshan_record_id));
+                if(!srec)
+                    srec = posix_shard_track_new_rec(shard, rec_ref);
+                if(srec)
+                    darshan_add_handle_ref(&(shard->fd_table), fd, srec);
+            }
+        }
+        POSIX_UNLOCK();
+
+        if(!srec)
+            return(NULL);
+    }
+
+    posix_shard_sync(srec);
+    return(&(srec->rec_ref));
+}
+
+static void posix_shard_merge_access(struct darshan_common_val_counter *in_cvc,
+    void *user_ptr)
+{
+    struct posix_file_record_ref *rec_ref = user_ptr;
+    struct darshan_common_val_counter *cvc;
+
+    cvc = darshan_add_common_val_counters(&rec_ref->access_root,
+        in_cvc->vals, in_cvc->nvals, in_cvc->freq, &rec_ref->access_count);
+    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_ACCESS]),
+        &(rec_ref->file_rec->counters[POSIX_ACCESS1_COUNT]),
+        cvc->vals, 1, cvc->freq, 0);
+    DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD,
+        posix_runtime->common_val_estimated);
+
+    return;
+}
+
+static void posix_shard_merge_stride(struct darshan_common_val_counter *in_cvc,
+    void *user_ptr)
+{
+    struct posix_file_record_ref *rec_ref = user_ptr;
+    struct darshan_common_val_counter *cvc;
+
+    cvc = darshan_add_common_val_counters(&rec_ref->stride_root,
+        in_cvc->vals, in_cvc->nvals, in_cvc->freq, &rec_ref->stride_count);
+    if(cvc) DARSHAN_UPDATE_COMMON_VAL_COUNTERS(
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_STRIDE]),
+        &(rec_ref->file_rec->counters[POSIX_STRIDE1_COUNT]),
+        cvc->vals, 1, cvc->freq, 0);
+    DARSHAN_MARK_COMMON_VAL_ESTIMATE(cvc, DARSHAN_POSIX_MOD,
+        posix_runtime->common_val_estimated);
+
+    return;
+}
+
+/* fold a shard record's accumulated deltas into its parent record and
+ * reset the deltas. the caller must hold the module lock and the lock of
+ * the shard the record belongs to.
+ */
+static void posix_shard_merge_rec(void *srec_p, void *user_ptr)
+{
+    struct posix_shard_rec *srec = (struct posix_shard_rec *)srec_p;
+    struct darshan_posix_file *delta = &(srec->delta);
+    struct darshan_posix_file *file_rec = srec->parent->file_rec;
+    int64_t file_alignment;
+    int i;
+
+    if(delta->counters[POSIX_READS] == 0 && delta->counters[POSIX_WRITES] == 0)
+        return;
+
+    /* additive counters */
+    file_rec->counters[POSIX_READS] += delta->counters[POSIX_READS];
+    file_rec->counters[POSIX_WRITES] += delta->counters[POSIX_WRITES];
+    file_rec->counters[POSIX_BYTES_READ] += delta->counters[POSIX_BYTES_READ];
+    file_rec->counters[POSIX_BYTES_WRITTEN] += delta->counters[POSIX_BYTES_WRITTEN];
+    for(i = POSIX_CONSEC_READS; i <= POSIX_MEM_NOT_ALIGNED; i++)
+        file_rec->counters[i] += delta->counters[i];
+    file_rec->counters[POSIX_FILE_NOT_ALIGNED] +=
+        delta->counters[POSIX_FILE_NOT_ALIGNED];
+    for(i = POSIX_SIZE_READ_0_100; i <= POSIX_SIZE_WRITE_1G_PLUS; i++)
+        file_rec->counters[i] += delta->counters[i];
+    file_rec->fcounters[POSIX_F_READ_TIME] += delta->fcounters[POSIX_F_READ_TIME];
+    file_rec->fcounters[POSIX_F_WRITE_TIME] += delta->fcounters[POSIX_F_WRITE_TIME];
+    darshan_activity_bins_merge(&(file_rec->counters[POSIX_ACTIVITY_READ_0]),
+        &(file_rec->counters[POSIX_ACTIVITY_WRITE_0]),
+        &(file_rec->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]),
+        &(delta->counters[POSIX_ACTIVITY_READ_0]),
+        &(delta->counters[POSIX_ACTIVITY_WRITE_0]),
+        delta->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]);
+
+    /* maximums */
+    if(file_rec->counters[POSIX_MAX_BYTE_READ] < delta->counters[POSIX_MAX_BYTE_READ])
+        file_rec->counters[POSIX_MAX_BYTE_READ] = delta->counters[POSIX_MAX_BYTE_READ];
+    if(file_rec->counters[POSIX_MAX_BYTE_WRITTEN] < delta->counters[POSIX_MAX_BYTE_WRITTEN])
+        file_rec->counters[POSIX_MAX_BYTE_WRITTEN] = delta->counters[POSIX_MAX_BYTE_WRITTEN];
+    if(file_rec->fcounters[POSIX_F_MAX_READ_TIME] < delta->fcounters[POSIX_F_MAX_READ_TIME])
+    {
+        file_rec->fcounters[POSIX_F_MAX_READ_TIME] = delta->fcounters[POSIX_F_MAX_READ_TIME];
+        file_rec->counters[POSIX_MAX_READ_TIME_SIZE] = delta->counters[POSIX_MAX_READ_TIME_SIZE];
+    }
+    if(file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] < delta->fcounters[POSIX_F_MAX_WRITE_TIME])
+    {
+        file_rec->fcounters[POSIX_F_MAX_WRITE_TIME] = delta->fcounters[POSIX_F_MAX_WRITE_TIME];
+        file_rec->counters[POSIX_MAX_WRITE_TIME_SIZE] = delta->counters[POSIX_MAX_WRITE_TIME_SIZE];
+    }
+
+    /* timestamps */
+    if(delta->fcounters[POSIX_F_READ_START_TIMESTAMP] > 0 &&
+       (file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] == 0 ||
+        file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] >
+        delta->fcounters[POSIX_F_READ_START_TIMESTAMP]))
+        file_rec->fcounters[POSIX_F_READ_START_TIMESTAMP] =
+            delta->fcounters[POSIX_F_READ_START_TIMESTAMP];
+    if(delta->fcounters[POSIX_F_WRITE_START_TIMESTAMP] > 0 &&
+       (file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] == 0 ||
+        file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] >
+        delta->fcounters[POSIX_F_WRITE_START_TIMESTAMP]))
+        file_rec->fcounters[POSIX_F_WRITE_START_TIMESTAMP] =
+            delta->fcounters[POSIX_F_WRITE_START_TIMESTAMP];
+    if(file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP] <
+       delta->fcounters[POSIX_F_READ_END_TIMESTAMP])
+        file_rec->fcounters[POSIX_F_READ_END_TIMESTAMP] =
+            delta->fcounters[POSIX_F_READ_END_TIMESTAMP];
+    if(file_rec->fcounters[POSIX_F_WRITE_END_TIMESTAMP] <
+       delta->fcounters[POSIX_F_WRITE_END_TIMESTAMP])
+        file_rec->fcounters[POSIX_F_WRITE_END_TIMESTAMP] =
+            delta->fcounters[POSIX_F_WRITE_END_TIMESTAMP];
+
+    /* counts of sampled operations */
+    srec->parent->sampled_reads += srec->rec_ref.sampled_reads;
+    srec->parent->sampled_writes += srec->rec_ref.sampled_writes;
+    srec->rec_ref.sampled_reads = srec->rec_ref.sampled_writes = 0;
+
+    /* common access sizes and strides */
+    darshan_iter_common_val_counters(srec->rec_ref.access_root,
+        posix_shard_merge_access, srec->parent);
+    darshan_iter_common_val_counters(srec->rec_ref.stride_root,
+        posix_shard_merge_stride, srec->parent);
+    darshan_clear_common_val_counters(&srec->rec_ref.access_root);
+    darshan_clear_common_val_counters(&srec->rec_ref.stride_root);
+    srec->rec_ref.access_count = srec->rec_ref.stride_count = 0;
+
+    /* reset the deltas, keeping the fields copied from the parent */
+    file_alignment = delta->counters[POSIX_FILE_ALIGNMENT];
+    memset(delta->counters, 0, sizeof(delta->counters));
+    memset(delta->fcounters, 0, sizeof(delta->fcounters));
+    delta->counters[POSIX_FILE_ALIGNMENT] = file_alignment;
+
+    return;
+}
+
+/* merge every thread's deltas for the given record (module lock held) */
+static void posix_shard_merge_record(struct posix_file_record_ref *rec_ref)
+{
+    struct posix_thread_shard *shard;
+    struct posix_shard_rec *srec;
+
+    for(shard = posix_shard_list; shard; shard = shard->next)
+    {
+        pthread_mutex_lock(&shard->mutex);
+        srec = darshan_lookup_record_ref(shard->rec_id_hash,
+            &(rec_ref->file_rec->base_rec.id), sizeof(darshan_record_id));
+        if(srec)
+            posix_shard_merge_rec(srec, NULL);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    return;
+}
+
+/* merge every thread's deltas for all records (module lock held) */
+static void posix_shard_merge_all()
+{
+    struct posix_thread_shard *shard;
+
+    for(shard = posix_shard_list; shard; shard = shard->next)
+    {
+        pthread_mutex_lock(&shard->mutex);
+        darshan_iter_record_refs(shard->rec_id_hash, &posix_shard_merge_rec, NULL);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    return;
+}
+
+static void posix_shard_finalize_rec(void *srec_p, void *user_ptr)
+{
+    struct posix_shard_rec *srec = (struct posix_shard_rec *)srec_p;
+
+    darshan_clear_common_val_counters(&srec->rec_ref.access_root);
+    darshan_clear_common_val_counters(&srec->rec_ref.stride_root);
+    return;
+}
+
+/* drop all shard records, leaving the (empty) shards themselves in place
+ * for the threads that own them (module lock held)
+ */
+static void posix_shard_clear()
+{
+    struct posix_thread_shard *shard;
+
+    for(shard = posix_shard_list; shard; shard = shard->next)
+    {
+        pthread_mutex_lock(&shard->mutex);
+        darshan_iter_record_refs(shard->rec_id_hash, &posix_shard_finalize_rec, NULL);
+        darshan_clear_handle_refs(&(shard->fd_table));
+        darshan_clear_record_refs(&(shard->rec_id_hash), 1);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    POSIX_FD_GEN_INC();
+
     return;
 }
 
@@ -2251,6 +2828,24 @@ static void posix_record_reduction_op(void* infile_v, void* inoutfile_v,
                 inoutfile->fcounters[POSIX_F_SLOWEST_RANK_TIME];
         }
 
+        /* sum */
+        tmp_file.counters[POSIX_SHARED_RANKS] =
+            infile->counters[POSIX_SHARED_RANKS] +
+            inoutfile->counters[POSIX_SHARED_RANKS];
+
+        /* sum, at the coarser of the two bin widths */
+        memcpy(&(tmp_file.counters[POSIX_ACTIVITY_READ_0]),
+            &(inoutfile->counters[POSIX_ACTIVITY_READ_0]),
+            2 * DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        tmp_file.fcounters[POSIX_F_ACTIVITY_BIN_WIDTH] =
+            inoutfile->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH];
+        darshan_activity_bins_merge(&(tmp_file.counters[POSIX_ACTIVITY_READ_0]),
+            &(tmp_file.counters[POSIX_ACTIVITY_WRITE_0]),
+            &(tmp_file.fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]),
+            &(infile->counters[POSIX_ACTIVITY_READ_0]),
+            &(infile->counters[POSIX_ACTIVITY_WRITE_0]),
+            infile->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH]);
+
         /* update pointers */
         *inoutfile = tmp_file;
         inoutfile++;
@@ -2266,10 +2861,13 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
 {
     MPI_Datatype var_dt;
     MPI_Op var_op;
+    int comm_rank;
     int i;
     struct darshan_variance_dt *var_send_buf = NULL;
     struct darshan_variance_dt *var_recv_buf = NULL;
 
+    PMPI_Comm_rank(mod_comm, &comm_rank);
+
     PMPI_Type_contiguous(sizeof(struct darshan_variance_dt),
         MPI_BYTE, &var_dt);
     PMPI_Type_commit(&var_dt);
@@ -2280,7 +2878,7 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
     if(!var_send_buf)
         return;
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         var_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_variance_dt));
 
@@ -2302,7 +2900,7 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
     PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
         var_dt, var_op, 0, mod_comm);
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         for(i=0; i<shared_rec_count; i++)
         {
@@ -2325,7 +2923,7 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
     PMPI_Reduce(var_send_buf, var_recv_buf, shared_rec_count,
         var_dt, var_op, 0, mod_comm);
 
-    if(my_rank == 0)
+    if(comm_rank == 0)
     {
         for(i=0; i<shared_rec_count; i++)
         {
@@ -2343,22 +2941,22 @@ static void posix_shared_record_variance(MPI_Comm mod_comm,
 }
 #endif
 
-char *darshan_posix_lookup_record_name(int fd)
+int darshan_posix_lookup_record_name(int fd, char *name, int name_len)
 {
     struct posix_file_record_ref *rec_ref;
-    char *rec_name = NULL;
+    int ret = -1;
 
     POSIX_LOCK();
     if(posix_runtime)
     {
-        rec_ref = darshan_lookup_record_ref(posix_runtime->fd_hash,
-            &fd, sizeof(fd));
+        rec_ref = darshan_lookup_handle_ref(posix_runtime->fd_table, fd);
         if(rec_ref)
-            rec_name = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
+            ret = darshan_core_lookup_record_name(
+                rec_ref->file_rec->base_rec.id, name, name_len);
     }
     POSIX_UNLOCK();
 
-    return(rec_name);
+    return(ret);
 }
 
 static struct darshan_posix_file *darshan_posix_rec_id_to_file(darshan_record_id rec_id)
@@ -2386,6 +2984,11 @@ void darshan_posix_shutdown_bench_setup(int test_case)
 
     posix_runtime_initialize();
 
+    /* the benchmark drives the instrumentation macros directly, which
+     * bypasses the per-thread shards
+     */
+    posix_shard_mode = 0;
+
     srand(my_rank);
     fd_array = malloc(1024 * sizeof(int));
     size_array = malloc(DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT * sizeof(int64_t));
@@ -2433,6 +3036,20 @@ void darshan_posix_shutdown_bench_setup(int test_case)
                     fd_array[i], 0, 0, 1, 1, 2);
             }
 
+            break;
+        case 5: /* 1020 unique files plus 4 shared files per proc */
+            for(i = 0; i < 1024; i++)
+            {
+                if(i < 4)
+                    snprintf(filepath, 256, "shared-%d", i);
+                else
+                    snprintf(filepath, 256, "fpp-%d_rank-%d", i, my_rank);
+
+                POSIX_RECORD_OPEN(fd_array[i], filepath, 777, 0, 1);
+                POSIX_RECORD_WRITE(size_array[i % DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT],
+                    fd_array[i], 0, 0, 1, 1, 2);
+            }
+
             break;
         default:
             fprintf(stderr, "Error: invalid Darshan benchmark test case.\n");
@@ -2456,25 +3073,65 @@ static void posix_mpi_redux(
     darshan_record_id *shared_recs,
     int shared_rec_count)
 {
-    int posix_rec_count;
     struct posix_file_record_ref *rec_ref;
-    struct darshan_posix_file *posix_rec_buf = (struct darshan_posix_file *)posix_buf;
     double posix_time;
     struct darshan_posix_file *red_send_buf = NULL;
     struct darshan_posix_file *red_recv_buf = NULL;
     MPI_Datatype red_type;
     MPI_Op red_op;
+    int comm_rank;
     int i;
 
     POSIX_LOCK();
     assert(posix_runtime);
 
-    /* allow DXT a chance to filter traces based on dynamic triggers */
-    dxt_posix_filter_dynamic_traces(darshan_posix_rec_id_to_file);
+    if(!posix_runtime->redux_flag)
+    {
+        /* fold in any outstanding per-thread deltas before reducing records */
+        if(posix_shard_mode > 0)
+            posix_shard_merge_all();
 
-    posix_rec_count = posix_runtime->file_rec_count;
+        /* scale up sampled counters before they are reduced */
+        if(posix_sample_period > 1)
+        {
+            darshan_iter_record_refs(posix_runtime->rec_id_hash,
+                &posix_estimate_sampled_counters, NULL);
+            posix_sample_estimated = 1;
+        }
+
+        /* allow DXT a chance to filter traces based on dynamic triggers */
+        dxt_posix_filter_dynamic_traces(darshan_posix_rec_id_to_file);
+
+        posix_runtime->redux_flag = 1;
+    }
+
+    PMPI_Comm_rank(mod_comm, &comm_rank);
+
+    /* allocate memory for the shared records, and for the reduction output
+     * on the root of the communicator
+     */
+    red_send_buf = malloc(shared_rec_count * sizeof(struct darshan_posix_file));
+    if(!red_send_buf)
+    {
+        POSIX_UNLOCK();
+        return;
+    }
+    if(comm_rank == 0)
+    {
+        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_posix_file));
+        if(!red_recv_buf)
+        {
+            free(red_send_buf);
+            POSIX_UNLOCK();
+            return;
+        }
+    }
 
-    /* necessary initialization of shared records */
+    /* copy the shared records, in the order given, into a contiguous
+     * buffer to reduce, after some necessary initialization. This may be
+     * called for several groups of processes, so records are not moved
+     * around in the module's buffer until output time.
+     */
     for(i = 0; i < shared_rec_count; i++)
     {
         rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
@@ -2507,26 +3164,7 @@ static void posix_mpi_redux(
             rec_ref->file_rec->fcounters[POSIX_F_FASTEST_RANK_TIME];
 
         rec_ref->file_rec->base_rec.rank = -1;
-    }
-
-    /* sort the array of records so we get all of the shared records
-     * (marked by rank -1) in a contiguous portion at end of the array
-     */
-    darshan_record_sort(posix_rec_buf, posix_rec_count,
-        sizeof(struct darshan_posix_file));
-
-    /* make send_buf point to the shared files at the end of sorted array */
-    red_send_buf = &(posix_rec_buf[posix_rec_count-shared_rec_count]);
-
-    /* allocate memory for the reduction output on rank 0 */
-    if(my_rank == 0)
-    {
-        red_recv_buf = malloc(shared_rec_count * sizeof(struct darshan_posix_file));
-        if(!red_recv_buf)
-        {
-            POSIX_UNLOCK();
-            return;
-        }
+        red_send_buf[i] = *(rec_ref->file_rec);
     }
 
     /* construct a datatype for a POSIX file record.  This is serving no purpose
@@ -2547,21 +3185,22 @@ static void posix_mpi_redux(
     posix_shared_record_variance(mod_comm, red_send_buf, red_recv_buf,
         shared_rec_count);
 
-    /* update module state to account for shared file reduction */
-    if(my_rank == 0)
-    {
-        /* overwrite local shared records with globally reduced records */
-        int tmp_ndx = posix_rec_count - shared_rec_count;
-        memcpy(&(posix_rec_buf[tmp_ndx]), red_recv_buf,
-            shared_rec_count * sizeof(struct darshan_posix_file));
-        free(red_recv_buf);
-    }
-    else
+    /* update module state to account for shared file reduction: the root
+     * overwrites its shared records with the reduced records, while other
+     * processes mark theirs to be dropped at output time
+     */
+    for(i = 0; i < shared_rec_count; i++)
     {
-        /* drop shared records on non-zero ranks */
-        posix_runtime->file_rec_count -= shared_rec_count;
+        rec_ref = darshan_lookup_record_ref(posix_runtime->rec_id_hash,
+            &shared_recs[i], sizeof(darshan_record_id));
+        if(comm_rank == 0)
+            *(rec_ref->file_rec) = red_recv_buf[i];
+        else
+            rec_ref->file_rec->base_rec.rank = DARSHAN_REDUCED_RECORD_RANK;
     }
 
+    free(red_send_buf);
+    free(red_recv_buf);
     PMPI_Type_free(&red_type);
     PMPI_Op_free(&red_op);
 
@@ -2579,7 +3218,28 @@ static void posix_output(
     POSIX_LOCK();
     assert(posix_runtime);
 
-    /* just pass back our updated total buffer size -- no need to update buffer */
+    /* fold in any outstanding per-thread deltas. NOTE: this is a no-op if
+     * the deltas were already merged before the shared record reduction
+     */
+    if(posix_shard_mode > 0)
+        posix_shard_merge_all();
+
+    /* scale up sampled counters, unless already done prior to reduction */
+    if(posix_sample_period > 1 && !posix_sample_estimated)
+        darshan_iter_record_refs(posix_runtime->rec_id_hash,
+            &posix_estimate_sampled_counters, NULL);
+
+    /* if shared records were reduced, gather them at the end of the buffer
+     * and drop those that were reduced into another process's records
+     */
+    if(posix_runtime->redux_flag)
+    {
+        posix_runtime->file_rec_count = darshan_record_compact(*posix_buf,
+            posix_runtime->file_rec_count, sizeof(struct darshan_posix_file));
+        posix_runtime->redux_flag = 0;
+    }
+
+    /* pass back our updated total buffer size */
     posix_rec_count = posix_runtime->file_rec_count;
     *posix_buf_sz = posix_rec_count * sizeof(struct darshan_posix_file);
 
@@ -2587,19 +3247,68 @@ static void posix_output(
     return;
 }
 
+static void posix_snapshot(
+    void *posix_buf,
+    void **snap_buf,
+    int *snap_buf_sz)
+{
+    ptrdiff_t snap_off;
+
+    *snap_buf = NULL;
+    *snap_buf_sz = 0;
+
+    POSIX_LOCK();
+    if(!posix_runtime)
+    {
+        POSIX_UNLOCK();
+        return;
+    }
+
+    /* fold in the per-thread deltas, which is otherwise done at close
+     * and shutdown time
+     */
+    if(posix_shard_mode > 0)
+        posix_shard_merge_all();
+
+    *snap_buf = malloc(posix_runtime->file_rec_count *
+        sizeof(struct darshan_posix_file));
+    if(*snap_buf)
+    {
+        *snap_buf_sz = posix_runtime->file_rec_count *
+            sizeof(struct darshan_posix_file);
+        memcpy(*snap_buf, posix_buf, *snap_buf_sz);
+
+        /* scale up sampled counters in the snapshot, as would be done at
+         * shutdown, so that they are estimates like the log header says
+         */
+        if(posix_sample_period > 1 && !posix_sample_estimated)
+        {
+            snap_off = (char *)*snap_buf - (char *)posix_buf;
+            darshan_iter_record_refs(posix_runtime->rec_id_hash,
+                &posix_estimate_sampled_counters, &snap_off);
+        }
+    }
+
+    POSIX_UNLOCK();
+    return;
+}
+
 static void posix_cleanup()
 {
     POSIX_LOCK();
     assert(posix_runtime);
 
     /* cleanup internal structures used for instrumenting */
+    posix_shard_clear();
     darshan_iter_record_refs(posix_runtime->rec_id_hash,
         &posix_finalize_file_records, NULL);
-    darshan_clear_record_refs(&(posix_runtime->fd_hash), 0);
-    darshan_clear_record_refs(&(posix_runtime->rec_id_hash), 1);
+    darshan_clear_handle_refs(&(posix_runtime->fd_table));
+    darshan_clear_record_refs(&(posix_runtime->rec_id_hash), 0);
+    darshan_slab_destroy(posix_runtime->rec_ref_slab);
 
     free(posix_runtime);
     posix_runtime = NULL;
+    posix_sample_estimated = 0;
 
     POSIX_UNLOCK();
     return;
@@ -130,6 +130,9 @@ struct stdio_file_record_ref
     double last_read_end;
     double last_write_end;
     int fs_type;
+    int sample_countdown;
+    int64_t sampled_reads;
+    int64_t sampled_writes;
 };
 
 /* The stdio_runtime structure maintains necessary state for storing
@@ -139,7 +142,7 @@ struct stdio_file_record_ref
 struct stdio_runtime
 {
     void *rec_id_hash;
-    void *stream_hash;
+    void *stream_table;
     int file_rec_count;
 };
 
@@ -148,10 +151,22 @@ static pthread_mutex_t stdio_runtime_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER
 static int darshan_mem_alignment = 1;
 static int my_rank = -1;
 
+/* sampling state: with a period N > 1, only 1 in N reads and writes are
+ * timed, and the I/O time counters are scaled up to estimates at shutdown
+ */
+static int stdio_sample_period = 1;
+static int stdio_sample_random = 0;
+static int stdio_sample_estimated = 0;
+static __thread uint32_t stdio_sample_rng = 0;
+
 static void stdio_runtime_initialize(
     void);
 static struct stdio_file_record_ref *stdio_track_new_file_record(
     darshan_record_id rec_id, const char *path);
+static int stdio_sample_op(
+    struct stdio_file_record_ref *rec_ref);
+static void stdio_estimate_sampled_counters(
+    void *rec_ref_p, void *user_ptr);
 #ifdef HAVE_MPI
 static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
     int *len, MPI_Datatype *datatype);
@@ -166,9 +181,12 @@ static void stdio_output(
     void **stdio_buf, int *stdio_buf_sz);
 static void stdio_cleanup(
     void);
+static void stdio_snapshot(
+    void *stdio_buf, void **snap_buf, int *snap_buf_sz);
 
 /* extern function def for querying record name from a POSIX fd */
-extern char *darshan_posix_lookup_record_name(int fd);
+extern int darshan_posix_lookup_record_name(int fd, char *name,
+    int name_len);
 
 /* we need access to fileno (defined in POSIX module) for instrumenting fopen calls */
 #ifdef DARSHAN_PRELOAD
@@ -198,26 +216,20 @@ extern int __real_fileno(FILE *stream);
     darshan_record_id __rec_id; \
     struct stdio_file_record_ref *__rec_ref; \
     char *__newpath; \
+    char __newpath_buf[PATH_MAX]; \
     int __fd; \
     MAP_OR_FAIL(fileno); \
     if(!__ret || !__path) break; \
-    __newpath = darshan_clean_file_path(__path); \
+    __newpath = darshan_clean_file_path_buf(__path, __newpath_buf, PATH_MAX); \
     if(!__newpath) __newpath = (char*)__path; \
-    if(darshan_core_excluded_path(__newpath)) { \
-        if(__newpath != (char*)__path) free(__newpath); \
-        break; \
-    } \
+    if(darshan_core_excluded_path(__newpath)) break; \
     __rec_id = darshan_core_gen_record_id(__newpath); \
     __rec_ref = darshan_lookup_record_ref(stdio_runtime->rec_id_hash, &__rec_id, sizeof(darshan_record_id)); \
     if(!__rec_ref) __rec_ref = stdio_track_new_file_record(__rec_id, __newpath); \
-    if(!__rec_ref) { \
-        if(__newpath != (char*)__path) free(__newpath); \
-        break; \
-    } \
+    if(!__rec_ref) break; \
     _STDIO_RECORD_OPEN(__ret, __rec_ref, __tm1, __tm2, 1, -1); \
     __fd = __real_fileno(__ret); \
     darshan_instrument_fs_data(__rec_ref->fs_type, __newpath, __fd); \
-    if(__newpath != (char*)__path) free(__newpath); \
 } while(0)
 
 #define STDIO_RECORD_REFOPEN(__ret, __rec_ref, __tm1, __tm2, __ref_counter) do { \
@@ -234,14 +246,17 @@ extern int __real_fileno(FILE *stream);
         __rec_ref->file_rec->fcounters[STDIO_F_OPEN_START_TIMESTAMP] = __tm1; \
     __rec_ref->file_rec->fcounters[STDIO_F_OPEN_END_TIMESTAMP] = __tm2; \
     DARSHAN_TIMER_INC_NO_OVERLAP(__rec_ref->file_rec->fcounters[STDIO_F_META_TIME], __tm1, __tm2, __rec_ref->last_meta_end); \
-    darshan_add_record_ref(&(stdio_runtime->stream_hash), &(__ret), sizeof(__ret), __rec_ref); \
+    darshan_add_ptr_ref(&(stdio_runtime->stream_table), __ret, __rec_ref); \
 } while(0)
 
 
+#define STDIO_SAMPLE_OP(__rec_ref) \
+    (stdio_sample_period == 1 || stdio_sample_op(__rec_ref))
+
 #define STDIO_RECORD_READ(__fp, __bytes,  __tm1, __tm2) do{ \
     struct stdio_file_record_ref* rec_ref; \
     int64_t this_offset; \
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &(__fp), sizeof(__fp)); \
+    rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, __fp); \
     if(!rec_ref) break; \
     this_offset = rec_ref->offset; \
     rec_ref->offset = this_offset + __bytes; \
@@ -253,13 +268,15 @@ extern int __real_fileno(FILE *stream);
      rec_ref->file_rec->fcounters[STDIO_F_READ_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[STDIO_F_READ_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[STDIO_F_READ_END_TIMESTAMP] = __tm2; \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_READ_TIME], __tm1, __tm2, rec_ref->last_read_end); \
+    if(STDIO_SAMPLE_OP(rec_ref)) { \
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_READ_TIME], __tm1, __tm2, rec_ref->last_read_end); \
+        rec_ref->sampled_reads += 1; } \
 } while(0)
 
 #define STDIO_RECORD_WRITE(__fp, __bytes,  __tm1, __tm2, __fflush_flag) do{ \
     struct stdio_file_record_ref* rec_ref; \
     int64_t this_offset; \
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &(__fp), sizeof(__fp)); \
+    rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, __fp); \
     if(!rec_ref) break; \
     this_offset = rec_ref->offset; \
     rec_ref->offset = this_offset + __bytes; \
@@ -274,7 +291,9 @@ extern int __real_fileno(FILE *stream);
      rec_ref->file_rec->fcounters[STDIO_F_WRITE_START_TIMESTAMP] > __tm1) \
         rec_ref->file_rec->fcounters[STDIO_F_WRITE_START_TIMESTAMP] = __tm1; \
     rec_ref->file_rec->fcounters[STDIO_F_WRITE_END_TIMESTAMP] = __tm2; \
-    DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_WRITE_TIME], __tm1, __tm2, rec_ref->last_write_end); \
+    if(STDIO_SAMPLE_OP(rec_ref)) { \
+        DARSHAN_TIMER_INC_NO_OVERLAP(rec_ref->file_rec->fcounters[STDIO_F_WRITE_TIME], __tm1, __tm2, rec_ref->last_write_end); \
+        rec_ref->sampled_writes += 1; } \
 } while(0)
 
 FILE* DARSHAN_DECL(fopen)(const char *path, const char *mode)
@@ -328,8 +347,8 @@ FILE* DARSHAN_DECL(fdopen)(int fd, const char *mode)
 
     if(ret)
     {
-        char *rec_name = darshan_posix_lookup_record_name(fd);
-        if(rec_name)
+        char rec_name[PATH_MAX];
+        if(darshan_posix_lookup_record_name(fd, rec_name, PATH_MAX) == 0)
         {
             rec_id = darshan_core_gen_record_id(rec_name);
 
@@ -416,7 +435,7 @@ int DARSHAN_DECL(fclose)(FILE *fp)
     tm2 = darshan_core_wtime();
 
     STDIO_PRE_RECORD();
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &fp, sizeof(fp));
+    rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, fp);
     if(rec_ref)
     {
         if(rec_ref->file_rec->fcounters[STDIO_F_CLOSE_START_TIMESTAMP] == 0 ||
@@ -426,7 +445,7 @@ int DARSHAN_DECL(fclose)(FILE *fp)
         DARSHAN_TIMER_INC_NO_OVERLAP(
             rec_ref->file_rec->fcounters[STDIO_F_META_TIME],
             tm1, tm2, rec_ref->last_meta_end);
-        darshan_delete_record_ref(&(stdio_runtime->stream_hash), &fp, sizeof(fp));
+        darshan_delete_ptr_ref(&(stdio_runtime->stream_table), fp);
     }
     STDIO_POST_RECORD();
 
@@ -827,7 +846,7 @@ void DARSHAN_DECL(rewind)(FILE *stream)
         return;
     }
 
-    rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+    rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
 
     if(rec_ref)
     {
@@ -857,7 +876,7 @@ int DARSHAN_DECL(fseek)(FILE *stream, long offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
         {
             rec_ref->offset = ftell(stream);
@@ -887,7 +906,7 @@ int DARSHAN_DECL(fseeko)(FILE *stream, off_t offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
         {
             rec_ref->offset = ftell(stream);
@@ -917,7 +936,7 @@ int DARSHAN_DECL(fseeko64)(FILE *stream, off64_t offset, int whence)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
         {
             rec_ref->offset = ftell(stream);
@@ -947,7 +966,7 @@ int DARSHAN_DECL(fsetpos)(FILE *stream, const fpos_t *pos)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
         {
             rec_ref->offset = ftell(stream);
@@ -977,7 +996,7 @@ int DARSHAN_DECL(fsetpos64)(FILE *stream, const fpos64_t *pos)
     if(ret >= 0)
     {
         STDIO_PRE_RECORD();
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash, &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
         {
             rec_ref->offset = ftell(stream);
@@ -1005,7 +1024,8 @@ static void stdio_runtime_initialize()
     .mod_redux_func = &stdio_mpi_redux,
 #endif
     .mod_output_func = &stdio_output,
-    .mod_cleanup_func = &stdio_cleanup
+    .mod_cleanup_func = &stdio_cleanup,
+    .mod_snapshot_func = &stdio_snapshot
     };
 
     /* try to store default number of records for this module */
@@ -1027,6 +1047,15 @@ static void stdio_runtime_initialize()
     }
     memset(stdio_runtime, 0, sizeof(*stdio_runtime));
 
+    /* note in the log that I/O times will be estimated from samples */
+    stdio_sample_period = darshan_core_sample_period(&stdio_sample_random);
+    if(stdio_sample_period > 1)
+        darshan_core_mark_sampled(DARSHAN_STDIO_MOD);
+
+    /* let darshan-core sparse encode our records in the log */
+    darshan_core_register_record_layout(DARSHAN_STDIO_MOD,
+        STDIO_NUM_INDICES, STDIO_F_NUM_INDICES);
+
     /* instantiate records for stdin, stdout, and stderr */
     STDIO_RECORD_OPEN(stdin, "<STDIN>", 0, 0);
     STDIO_RECORD_OPEN(stdout, "<STDOUT>", 0, 0);
@@ -1083,6 +1112,48 @@ static struct stdio_file_record_ref *stdio_track_new_file_record(
     return(rec_ref);
 }
 
+/* decide whether to time the current read or write on a record */
+static int stdio_sample_op(struct stdio_file_record_ref *rec_ref)
+{
+    if(!stdio_sample_random)
+        return(darshan_sample_op(&rec_ref->sample_countdown,
+            stdio_sample_period, NULL));
+
+    /* seed each thread's generator differently */
+    if(stdio_sample_rng == 0)
+        stdio_sample_rng = ((uint32_t)(uintptr_t)&stdio_sample_rng ^
+            ((uint32_t)my_rank << 16)) | 1;
+    return(darshan_sample_op(&rec_ref->sample_countdown,
+        stdio_sample_period, &stdio_sample_rng));
+}
+
+/* scale I/O times measured on sampled operations up to estimates for all
+ * operations (flushes are timed as writes)
+ */
+static void stdio_estimate_sampled_counters(void *rec_ref_p, void *user_ptr)
+{
+    struct stdio_file_record_ref *rec_ref =
+        (struct stdio_file_record_ref *)rec_ref_p;
+    struct darshan_stdio_file *file_rec = rec_ref->file_rec;
+
+    /* scale the record's copy in a snapshot of the module buffer instead,
+     * if given the offset of the snapshot from the module buffer
+     */
+    if(user_ptr)
+        file_rec = (struct darshan_stdio_file *)((char *)file_rec +
+            *(ptrdiff_t *)user_ptr);
+
+    if(rec_ref->sampled_reads > 0)
+        file_rec->fcounters[STDIO_F_READ_TIME] *=
+            (double)file_rec->counters[STDIO_READS] / rec_ref->sampled_reads;
+    if(rec_ref->sampled_writes > 0)
+        file_rec->fcounters[STDIO_F_WRITE_TIME] *=
+            (double)(file_rec->counters[STDIO_WRITES] +
+            file_rec->counters[STDIO_FLUSHES]) / rec_ref->sampled_writes;
+
+    return;
+}
+
 #ifdef HAVE_MPI
 static void stdio_record_reduction_op(void* infile_v, void* inoutfile_v,
     int *len, MPI_Datatype *datatype)
@@ -1274,22 +1345,22 @@ static void stdio_shared_record_variance(MPI_Comm mod_comm,
 }
 #endif
 
-char *darshan_stdio_lookup_record_name(FILE *stream)
+int darshan_stdio_lookup_record_name(FILE *stream, char *name, int name_len)
 {
     struct stdio_file_record_ref *rec_ref;
-    char *rec_name = NULL;
+    int ret = -1;
 
     STDIO_LOCK();
     if(stdio_runtime)
     {
-        rec_ref = darshan_lookup_record_ref(stdio_runtime->stream_hash,
-            &stream, sizeof(stream));
+        rec_ref = darshan_lookup_ptr_ref(stdio_runtime->stream_table, stream);
         if(rec_ref)
-            rec_name = darshan_core_lookup_record_name(rec_ref->file_rec->base_rec.id);
+            ret = darshan_core_lookup_record_name(
+                rec_ref->file_rec->base_rec.id, name, name_len);
     }
     STDIO_UNLOCK();
 
-    return(rec_name);
+    return(ret);
 }
 
 /************************************************************************
@@ -1316,6 +1387,14 @@ static void stdio_mpi_redux(
     STDIO_LOCK();
     assert(stdio_runtime);
 
+    /* scale up sampled counters before they are reduced */
+    if(stdio_sample_period > 1)
+    {
+        darshan_iter_record_refs(stdio_runtime->rec_id_hash,
+            &stdio_estimate_sampled_counters, NULL);
+        stdio_sample_estimated = 1;
+    }
+
     stdio_rec_count = stdio_runtime->file_rec_count;
 
     /* necessary initialization of shared records */
@@ -1425,6 +1504,11 @@ static void stdio_output(
     STDIO_LOCK();
     assert(stdio_runtime);
 
+    /* scale up sampled counters, unless already done prior to reduction */
+    if(stdio_sample_period > 1 && !stdio_sample_estimated)
+        darshan_iter_record_refs(stdio_runtime->rec_id_hash,
+            &stdio_estimate_sampled_counters, NULL);
+
     stdio_rec_count = stdio_runtime->file_rec_count;
 
     /* filter out any records that have no activity on them; this is
@@ -1466,17 +1550,58 @@ static void stdio_output(
     return;
 }
 
+static void stdio_snapshot(
+    void *stdio_buf,
+    void **snap_buf,
+    int *snap_buf_sz)
+{
+    ptrdiff_t snap_off;
+
+    *snap_buf = NULL;
+    *snap_buf_sz = 0;
+
+    STDIO_LOCK();
+    if(!stdio_runtime)
+    {
+        STDIO_UNLOCK();
+        return;
+    }
+
+    *snap_buf = malloc(stdio_runtime->file_rec_count *
+        sizeof(struct darshan_stdio_file));
+    if(*snap_buf)
+    {
+        *snap_buf_sz = stdio_runtime->file_rec_count *
+            sizeof(struct darshan_stdio_file);
+        memcpy(*snap_buf, stdio_buf, *snap_buf_sz);
+
+        /* scale up sampled counters in the snapshot, as would be done at
+         * shutdown, so that they are estimates like the log header says
+         */
+        if(stdio_sample_period > 1 && !stdio_sample_estimated)
+        {
+            snap_off = (char *)*snap_buf - (char *)stdio_buf;
+            darshan_iter_record_refs(stdio_runtime->rec_id_hash,
+                &stdio_estimate_sampled_counters, &snap_off);
+        }
+    }
+
+    STDIO_UNLOCK();
+    return;
+}
+
 static void stdio_cleanup()
 {
     STDIO_LOCK();
     assert(stdio_runtime);
 
     /* cleanup internal structures used for instrumenting */
-    darshan_clear_record_refs(&(stdio_runtime->stream_hash), 0);
+    darshan_clear_ptr_refs(&(stdio_runtime->stream_table));
     darshan_clear_record_refs(&(stdio_runtime->rec_id_hash), 1);
 
     free(stdio_runtime);
     stdio_runtime = NULL;
+    stdio_sample_estimated = 0;
 
     STDIO_UNLOCK();
     return;
@@ -0,0 +1,133 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the cost of the Darshan timer under thread
+ * contention.  This is an MPI program that uses exactly one process, which
+ * spawns an increasing number of threads (1, 2, 4, ..., max) that each call
+ * darshan_core_wtime() in a tight loop.  Every instrumented wrapper calls
+ * this function at least twice, so its per-call cost bounds the minimum
+ * overhead of each intercepted I/O operation.
+ *
+ * The benchmark must be run with the Darshan runtime library preloaded (or
+ * linked in) so that darshan_core_wtime() can be resolved at run time; if
+ * it cannot be found, MPI_Wtime() is measured instead as a baseline.
+ */
+
+/* Arguments: the number of timer calls each thread should issue, and the
+ * maximum number of threads
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+#include <mpi.h>
+
+typedef double (*wtime_fn)(void);
+
+static wtime_fn timer_fn;
+static int iters;
+
+static double mpi_wtime_fn(void)
+{
+    return(MPI_Wtime());
+}
+
+static void *timer_loop(void *arg)
+{
+    volatile double sink = 0;
+    int i;
+
+    for(i=0; i<iters; i++)
+        sink += timer_fn();
+
+    return(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int nprocs;
+    int mynod;
+    int ret;
+    int nthreads;
+    int max_threads;
+    long i;
+    double time1, time2;
+    pthread_t *threads;
+
+    ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &nthreads);
+    if(ret != MPI_SUCCESS)
+    {
+        fprintf(stderr, "Error: MPI_Init_thread failed.\n");
+        return(-1);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    /* we only want one proc */
+    if(nprocs > 1)
+    {
+        if(mynod == 0)
+        {
+            fprintf(stderr, "Error: this benchmark should be run with exactly one process.\n");
+        }
+        MPI_Finalize();
+        return(-1);
+    }
+
+    if(argc != 3 || sscanf(argv[1], "%d", &iters) != 1 ||
+        sscanf(argv[2], "%d", &max_threads) != 1 || iters < 1 || max_threads < 1)
+    {
+        fprintf(stderr, "Usage: %s <calls per thread> <max threads>\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    timer_fn = (wtime_fn)dlsym(RTLD_DEFAULT, "darshan_core_wtime");
+    if(!timer_fn)
+    {
+        fprintf(stderr, "Warning: darshan_core_wtime() not found, measuring MPI_Wtime() instead.\n");
+        timer_fn = mpi_wtime_fn;
+    }
+
+    threads = malloc(max_threads * sizeof(*threads));
+    if(!threads)
+    {
+        perror("malloc");
+        MPI_Finalize();
+        return(-1);
+    }
+
+    printf("#<threads>\t<calls>\t<total (s)>\t<per op (s)>\t<per op per thread (s)>\n");
+    for(nthreads=1; nthreads<=max_threads; nthreads*=2)
+    {
+        time1 = MPI_Wtime();
+        for(i=0; i<nthreads; i++)
+        {
+            ret = pthread_create(&threads[i], NULL, timer_loop, NULL);
+            if(ret != 0)
+            {
+                fprintf(stderr, "Error: pthread_create failed.\n");
+                MPI_Finalize();
+                return(-1);
+            }
+        }
+        for(i=0; i<nthreads; i++)
+            pthread_join(threads[i], NULL);
+        time2 = MPI_Wtime();
+
+        printf("%d\t%d\t%.9f\t%.9f\t%.9f\n", nthreads, nthreads*iters, time2-time1,
+            (time2-time1)/((double)iters*nthreads),
+            (time2-time1)/(double)iters);
+    }
+
+    free(threads);
+
+    MPI_Finalize();
+    return(0);
+}
@@ -0,0 +1,170 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Microbenchmark to compare the size histogram classification done by
+ * DARSHAN_BUCKET_INC on every instrumented read and write against the
+ * comparison chain it replaced.  This is an MPI program that uses exactly
+ * one process.  It must be compiled with the darshan-runtime source
+ * directory in the include path (e.g., -I../darshan-runtime) so that it
+ * uses the DARSHAN_BUCKET_INC implementation from darshan-common.h.
+ *
+ * Each test phase classifies a precomputed array of access sizes drawn
+ * from one distribution: a fixed size (perfectly predictable), sizes
+ * alternating between small and large requests, and sizes drawn
+ * uniformly on a log scale from 1 byte to 2 GiB.
+ */
+
+/* Arguments: an integer specifying the number of iterations to run of each
+ * test phase
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <mpi.h>
+
+#include "darshan-common.h"
+
+#define NSIZES (1<<16)
+
+/* the comparison chain DARSHAN_BUCKET_INC used previously */
+#define CHAIN_BUCKET_INC(__bucket_base_p, __value) do {\
+    if(__value < 101) \
+        *(__bucket_base_p) += 1; \
+    else if(__value < 1025) \
+        *(__bucket_base_p + 1) += 1; \
+    else if(__value < 10241) \
+        *(__bucket_base_p + 2) += 1; \
+    else if(__value < 102401) \
+        *(__bucket_base_p + 3) += 1; \
+    else if(__value < 1048577) \
+        *(__bucket_base_p + 4) += 1; \
+    else if(__value < 4194305) \
+        *(__bucket_base_p + 5) += 1; \
+    else if(__value < 10485761) \
+        *(__bucket_base_p + 6) += 1; \
+    else if(__value < 104857601) \
+        *(__bucket_base_p + 7) += 1; \
+    else if(__value < 1073741825) \
+        *(__bucket_base_p + 8) += 1; \
+    else \
+        *(__bucket_base_p + 9) += 1; \
+} while(0)
+
+static int64_t sizes[NSIZES];
+
+static void gen_fixed(void)
+{
+    int i;
+
+    for(i=0; i<NSIZES; i++)
+        sizes[i] = 4096;
+
+    return;
+}
+
+static void gen_bimodal(void)
+{
+    int i;
+
+    for(i=0; i<NSIZES; i++)
+    {
+        if(random() % 2)
+            sizes[i] = 64 + random() % 448;
+        else
+            sizes[i] = 1048576 + random() % 7340032;
+    }
+
+    return;
+}
+
+static void gen_log_uniform(void)
+{
+    int i;
+    int shift;
+
+    for(i=0; i<NSIZES; i++)
+    {
+        shift = random() % 31;
+        sizes[i] = ((int64_t)1 << shift) + random() % ((int64_t)1 << shift);
+    }
+
+    return;
+}
+
+static int run_phase(const char *name, void (*gen)(void), int iters)
+{
+    int64_t chain_hist[10] = {0};
+    int64_t hist[10] = {0};
+    double time1, time2, time3;
+    int i, j;
+
+    gen();
+
+    time1 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+        for(j=0; j<NSIZES; j++)
+            CHAIN_BUCKET_INC(chain_hist, sizes[j]);
+    time2 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+        for(j=0; j<NSIZES; j++)
+            DARSHAN_BUCKET_INC(hist, sizes[j]);
+    time3 = MPI_Wtime();
+
+    printf("chain\t%s\t%d\t%.6f\t%.3f\n", name, iters, time2-time1,
+        (time2-time1)*1e9/((double)iters*NSIZES));
+    printf("bucket_inc\t%s\t%d\t%.6f\t%.3f\n", name, iters, time3-time2,
+        (time3-time2)*1e9/((double)iters*NSIZES));
+
+    if(memcmp(chain_hist, hist, sizeof(hist)))
+    {
+        fprintf(stderr, "Error: histograms differ for %s sizes.\n", name);
+        return(-1);
+    }
+
+    return(0);
+}
+
+int main(int argc, char **argv)
+{
+    int nprocs;
+    int mynod;
+    int iters;
+    int ret = 0;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    /* we only want one proc */
+    if(nprocs > 1)
+    {
+        if(mynod == 0)
+        {
+            fprintf(stderr, "Error: this benchmark should be run with exactly one process.\n");
+        }
+        MPI_Finalize();
+        return(-1);
+    }
+
+    if(argc != 2 || sscanf(argv[1], "%d", &iters) != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <number of iterations>\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    srandom(1);
+
+    printf("#<op>\t<sizes>\t<iters>\t<total (s)>\t<per op (ns)>\n");
+    ret |= run_phase("fixed", gen_fixed, iters);
+    ret |= run_phase("bimodal", gen_bimodal, iters);
+    ret |= run_phase("log_uniform", gen_log_uniform, iters);
+
+    MPI_Finalize();
+    return(ret);
+}
@@ -0,0 +1,108 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Microbenchmark to measure the cost of the path canonicalization Darshan
+ * performs on every instrumented open and stat.  This is an MPI program
+ * that uses exactly one process.  It must be run with the Darshan runtime
+ * library preloaded (or linked in) so that darshan_clean_file_path() and
+ * darshan_clean_file_path_buf() can be resolved at run time.
+ *
+ * Each test phase canonicalizes one class of path (absolute, relative, and
+ * "messy" paths with repeated slashes, "." and ".." components) using both
+ * the allocating and the caller-provided buffer variants.
+ */
+
+/* Arguments: an integer specifying the number of iterations to run of each
+ * test phase
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <dlfcn.h>
+
+#include <mpi.h>
+
+typedef char* (*clean_fn)(const char *path);
+typedef char* (*clean_buf_fn)(const char *path, char *buf, size_t buf_len);
+
+static const char *test_paths[][2] = {
+    {"absolute", "/scratch/project/run0042/output/checkpoint.0001.dat"},
+    {"relative", "output/checkpoint.0001.dat"},
+    {"messy", "./output//tmp/.././/checkpoint.0001.dat"},
+    {"messy_absolute", "/scratch//project/./run0042/../run0042/output/checkpoint.0001.dat"},
+};
+
+int main(int argc, char **argv)
+{
+    int nprocs;
+    int mynod;
+    int i, j;
+    int iters;
+    double time1, time2;
+    char buf[PATH_MAX];
+    char *newpath;
+    clean_fn clean;
+    clean_buf_fn clean_buf;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    /* we only want one proc */
+    if(nprocs > 1)
+    {
+        if(mynod == 0)
+        {
+            fprintf(stderr, "Error: this benchmark should be run with exactly one process.\n");
+        }
+        MPI_Finalize();
+        return(-1);
+    }
+
+    if(argc != 2 || sscanf(argv[1], "%d", &iters) != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <number of iterations>\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    clean = (clean_fn)dlsym(RTLD_DEFAULT, "darshan_clean_file_path");
+    clean_buf = (clean_buf_fn)dlsym(RTLD_DEFAULT, "darshan_clean_file_path_buf");
+    if(!clean || !clean_buf)
+    {
+        fprintf(stderr, "Error: Darshan path cleaning functions not found; preload the Darshan runtime library.\n");
+        MPI_Finalize();
+        return(-1);
+    }
+
+    printf("#<op>\t<path>\t<iters>\t<total (s)>\t<per op (s)>\t<result>\n");
+    for(j=0; j<(int)(sizeof(test_paths)/sizeof(test_paths[0])); j++)
+    {
+        time1 = MPI_Wtime();
+        for(i=0; i<iters; i++)
+        {
+            newpath = clean(test_paths[j][1]);
+            free(newpath);
+        }
+        time2 = MPI_Wtime();
+        newpath = clean(test_paths[j][1]);
+        printf("alloc\t%s\t%d\t%.9f\t%.9f\t%s\n", test_paths[j][0], iters,
+            time2-time1, (time2-time1)/(double)iters, newpath ? newpath : "(null)");
+        free(newpath);
+
+        time1 = MPI_Wtime();
+        for(i=0; i<iters; i++)
+            newpath = clean_buf(test_paths[j][1], buf, PATH_MAX);
+        time2 = MPI_Wtime();
+        printf("buf\t%s\t%d\t%.9f\t%.9f\t%s\n", test_paths[j][0], iters,
+            time2-time1, (time2-time1)/(double)iters, newpath ? newpath : "(null)");
+    }
+
+    MPI_Finalize();
+    return(0);
+}
@@ -0,0 +1,380 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to compare the compression methods supported for Darshan log
+ * files (zlib, plus bzip2 and zstd if darshan-util was built with them) on
+ * a set of existing logs.  This is a serial program that must be compiled
+ * against darshan-util, with the top-level, darshan-util source, and
+ * darshan-util build directories in the include path, e.g.:
+ *
+ *   cc -I.. -I../darshan-util -I<util build dir> log-comp-bench.c
+ *      <util build dir>/libdarshan-util.a -lz -lbz2 -lzstd
+ *
+ * Each input log is loaded into memory once.  Then, for each compression
+ * method, the log is rewritten to a temporary file in the output directory
+ * and read back in (job data, name records, and each module's raw data),
+ * checking that the module data round trips intact.  The ratio reported is
+ * that of the uncompressed to compressed module data, which makes up the
+ * bulk of any large log; the file size is also reported.
+ */
+
+/* Arguments: an integer specifying the number of times to write and read
+ * each log with each method, a directory to write temporary logs to, and
+ * one or more Darshan log files
+ */
+
+#include "darshan-util-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "darshan-logutils.h"
+
+static struct
+{
+    const char *name;
+    enum darshan_comp_type type;
+} methods[] =
+{
+    {"zlib", DARSHAN_ZLIB_COMP},
+#ifdef HAVE_LIBBZ2
+    {"bzip2", DARSHAN_BZIP2_COMP},
+#endif
+#ifdef HAVE_LIBZSTD
+    {"zstd", DARSHAN_ZSTD_COMP},
+#endif
+};
+#define NMETHODS ((int)(sizeof(methods) / sizeof(methods[0])))
+
+/* everything needed to rewrite a log */
+struct bench_log
+{
+    int partial_flag;
+    struct darshan_job job;
+    char exe[DARSHAN_EXE_LEN+1];
+    struct darshan_mnt_info *mnts;
+    int mnt_cnt;
+    struct darshan_name_record_ref *name_hash;
+    char *mod_buf[DARSHAN_MAX_MODS];
+    int mod_len[DARSHAN_MAX_MODS];
+    int mod_ver[DARSHAN_MAX_MODS];
+    int64_t mod_bytes;
+};
+
+/* running totals for one method over all logs */
+struct bench_result
+{
+    int64_t raw_bytes;
+    int64_t comp_bytes;
+    int64_t file_bytes;
+    double write_time;
+    double read_time;
+};
+
+static double wtime(void)
+{
+    struct timespec tp;
+
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(tp.tv_sec + tp.tv_nsec / 1e9);
+}
+
+static void free_name_hash(struct darshan_name_record_ref **name_hash)
+{
+    struct darshan_name_record_ref *ref, *tmp;
+
+    HASH_ITER(hlink, *name_hash, ref, tmp)
+    {
+        HASH_DELETE(hlink, *name_hash, ref);
+        free(ref->name_record);
+        free(ref);
+    }
+
+    return;
+}
+
+/* read all of a module's raw (still byte-swapped, if need be) data */
+static int read_mod(darshan_fd fd, int mod_id, char **buf_p, int *len_p)
+{
+    int buf_sz = 1024 * 1024;
+    int len = 0;
+    char *buf = NULL;
+    char *tmp;
+    int ret;
+
+    do
+    {
+        if(len == buf_sz || !buf)
+        {
+            if(buf)
+                buf_sz *= 2;
+            tmp = realloc(buf, buf_sz);
+            if(!tmp)
+            {
+                free(buf);
+                return(-1);
+            }
+            buf = tmp;
+        }
+        ret = darshan_log_get_mod(fd, mod_id, buf + len, buf_sz - len);
+        if(ret < 0)
+        {
+            free(buf);
+            return(-1);
+        }
+        len += ret;
+    } while(len == buf_sz);
+
+    *buf_p = buf;
+    *len_p = len;
+    return(0);
+}
+
+static int load_log(const char *name, struct bench_log *log)
+{
+    darshan_fd fd;
+    int i;
+    int ret;
+
+    memset(log, 0, sizeof(*log));
+
+    fd = darshan_log_open(name);
+    if(!fd)
+        return(-1);
+    log->partial_flag = fd->partial_flag;
+
+    ret = darshan_log_get_job(fd, &log->job);
+    if(ret == 0)
+        ret = darshan_log_get_exe(fd, log->exe);
+    if(ret == 0)
+        ret = darshan_log_get_mounts(fd, &log->mnts, &log->mnt_cnt);
+    if(ret == 0)
+        ret = darshan_log_get_namehash(fd, &log->name_hash);
+
+    for(i = 0; ret == 0 && i < DARSHAN_MAX_MODS; i++)
+    {
+        if(fd->mod_map[i].len == 0)
+            continue;
+        else if(!mod_logutils[i])
+        {
+            fprintf(stderr, "Warning: no log utility handlers defined "
+                "for module %s, SKIPPING.\n", darshan_module_names[i]);
+            continue;
+        }
+        ret = read_mod(fd, i, &log->mod_buf[i], &log->mod_len[i]);
+        log->mod_ver[i] = fd->mod_ver[i];
+        log->mod_bytes += log->mod_len[i];
+    }
+
+    darshan_log_close(fd);
+    return(ret);
+}
+
+static void free_log(struct bench_log *log)
+{
+    int i;
+
+    free(log->mnts);
+    free_name_hash(&log->name_hash);
+    for(i = 0; i < DARSHAN_MAX_MODS; i++)
+        free(log->mod_buf[i]);
+
+    return;
+}
+
+static int write_log(const char *name, struct bench_log *log,
+    enum darshan_comp_type type)
+{
+    darshan_fd fd;
+    int i;
+    int ret;
+
+    fd = darshan_log_create(name, type, log->partial_flag);
+    if(!fd)
+        return(-1);
+
+    ret = darshan_log_put_job(fd, &log->job);
+    if(ret == 0)
+        ret = darshan_log_put_exe(fd, log->exe);
+    if(ret == 0)
+        ret = darshan_log_put_mounts(fd, log->mnts, log->mnt_cnt);
+    if(ret == 0)
+        ret = darshan_log_put_namehash(fd, log->name_hash);
+    for(i = 0; ret == 0 && i < DARSHAN_MAX_MODS; i++)
+    {
+        if(log->mod_len[i] > 0)
+            ret = darshan_log_put_mod(fd, i, log->mod_buf[i], log->mod_len[i],
+                log->mod_ver[i]);
+    }
+
+    darshan_log_close(fd);
+    return(ret);
+}
+
+/* read a rewritten log back in, checking its module data */
+static int check_log(const char *name, struct bench_log *log,
+    int64_t *comp_bytes)
+{
+    darshan_fd fd;
+    struct darshan_job job;
+    char exe[DARSHAN_EXE_LEN+1];
+    struct darshan_mnt_info *mnts = NULL;
+    int mnt_cnt;
+    struct darshan_name_record_ref *name_hash = NULL;
+    char *buf;
+    int len;
+    int i;
+    int ret;
+
+    fd = darshan_log_open(name);
+    if(!fd)
+        return(-1);
+
+    ret = darshan_log_get_job(fd, &job);
+    if(ret == 0)
+        ret = darshan_log_get_exe(fd, exe);
+    if(ret == 0)
+        ret = darshan_log_get_mounts(fd, &mnts, &mnt_cnt);
+    if(ret == 0)
+        ret = darshan_log_get_namehash(fd, &name_hash);
+
+    *comp_bytes = 0;
+    for(i = 0; ret == 0 && i < DARSHAN_MAX_MODS; i++)
+    {
+        if(log->mod_len[i] == 0)
+            continue;
+        *comp_bytes += fd->mod_map[i].len;
+        ret = read_mod(fd, i, &buf, &len);
+        if(ret == 0)
+        {
+            if(len != log->mod_len[i] || memcmp(buf, log->mod_buf[i], len))
+            {
+                fprintf(stderr, "Error: %s module data differs in %s.\n",
+                    darshan_module_names[i], name);
+                ret = -1;
+            }
+            free(buf);
+        }
+    }
+
+    free(mnts);
+    free_name_hash(&name_hash);
+    darshan_log_close(fd);
+    return(ret);
+}
+
+static int run_log(const char *log_name, const char *out_dir, int iters,
+    struct bench_result *totals)
+{
+    struct bench_log log;
+    struct bench_result res;
+    char out_name[PATH_MAX];
+    struct stat statbuf;
+    double time1, time2, time3;
+    int i, j;
+    int ret = 0;
+
+    if(load_log(log_name, &log) < 0)
+    {
+        fprintf(stderr, "Error: unable to load %s.\n", log_name);
+        free_log(&log);
+        return(-1);
+    }
+
+    for(i = 0; i < NMETHODS; i++)
+    {
+        memset(&res, 0, sizeof(res));
+        snprintf(out_name, PATH_MAX, "%s/log-comp-bench-%d.%s", out_dir,
+            (int)getpid(), methods[i].name);
+
+        for(j = 0; j < iters; j++)
+        {
+            unlink(out_name);
+            time1 = wtime();
+            ret = write_log(out_name, &log, methods[i].type);
+            time2 = wtime();
+            if(ret == 0)
+                ret = check_log(out_name, &log, &res.comp_bytes);
+            time3 = wtime();
+            if(ret < 0)
+            {
+                fprintf(stderr, "Error: %s round trip failed for %s.\n",
+                    methods[i].name, log_name);
+                break;
+            }
+            res.write_time += time2 - time1;
+            res.read_time += time3 - time2;
+        }
+        if(ret == 0 && stat(out_name, &statbuf) == 0)
+            res.file_bytes = statbuf.st_size;
+        unlink(out_name);
+        if(ret < 0)
+            break;
+
+        res.raw_bytes = log.mod_bytes;
+        res.write_time /= iters;
+        res.read_time /= iters;
+        printf("%s\t%s\t%" PRId64 "\t%" PRId64 "\t%.3f\t%" PRId64
+            "\t%.6f\t%.6f\n", methods[i].name, log_name, res.raw_bytes,
+            res.comp_bytes, res.comp_bytes ?
+            (double)res.raw_bytes / res.comp_bytes : 0.0, res.file_bytes,
+            res.write_time, res.read_time);
+
+        totals[i].raw_bytes += res.raw_bytes;
+        totals[i].comp_bytes += res.comp_bytes;
+        totals[i].file_bytes += res.file_bytes;
+        totals[i].write_time += res.write_time;
+        totals[i].read_time += res.read_time;
+    }
+
+    free_log(&log);
+    return(ret);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_result totals[NMETHODS];
+    int iters;
+    int i;
+    int ret = 0;
+
+    if(argc < 4 || sscanf(argv[1], "%d", &iters) != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <iterations> <output dir> <log file> [<log file> ...]\n",
+            argv[0]);
+        return(-1);
+    }
+
+    memset(totals, 0, sizeof(totals));
+
+    printf("#<method>\t<log>\t<module bytes>\t<compressed bytes>\t<ratio>"
+        "\t<file bytes>\t<write (s)>\t<read (s)>\n");
+    for(i = 3; i < argc; i++)
+        ret |= run_log(argv[i], argv[2], iters, totals);
+
+    /* totals, with throughput in terms of uncompressed module data */
+    printf("#<method>\t<total module bytes>\t<total compressed bytes>"
+        "\t<ratio>\t<write (MiB/s)>\t<read (MiB/s)>\n");
+    for(i = 0; i < NMETHODS; i++)
+    {
+        printf("# %s\t%" PRId64 "\t%" PRId64 "\t%.3f\t%.2f\t%.2f\n",
+            methods[i].name, totals[i].raw_bytes, totals[i].comp_bytes,
+            totals[i].comp_bytes ?
+            (double)totals[i].raw_bytes / totals[i].comp_bytes : 0.0,
+            totals[i].write_time > 0 ?
+            totals[i].raw_bytes / totals[i].write_time / 1048576.0 : 0.0,
+            totals[i].read_time > 0 ?
+            totals[i].raw_bytes / totals[i].read_time / 1048576.0 : 0.0);
+    }
+
+    return(ret ? -1 : 0);
+}
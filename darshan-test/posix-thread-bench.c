@@ -0,0 +1,140 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure Darshan POSIX module overhead for multithreaded
+ * applications.  This is an MPI program that uses exactly one process,
+ * which spawns an increasing number of threads (1, 2, 4, ..., max) that
+ * each issue small pread() operations on a shared file descriptor.
+ *
+ * Run once with and once without DARSHAN_POSIX_SHARDED set in the
+ * environment to compare the default (module-wide lock) and sharded
+ * instrumentation modes.
+ */
+
+/* Arguments: a file name to read from (e.g., /dev/zero), the number of
+ * reads each thread should issue, and the maximum number of threads
+ */
+
+#define _XOPEN_SOURCE 500
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include <mpi.h>
+
+#define READ_SIZE 64
+
+static int fd;
+static int iters;
+
+static void *reader(void *arg)
+{
+    char buf[READ_SIZE];
+    long rank = (long)arg;
+    int i;
+    ssize_t ret;
+
+    for(i=0; i<iters; i++)
+    {
+        ret = pread(fd, buf, READ_SIZE, (rank * iters + i) * READ_SIZE);
+        if(ret < 0)
+        {
+            perror("pread");
+            exit(-1);
+        }
+    }
+
+    return(NULL);
+}
+
+int main(int argc, char **argv)
+{
+    int nprocs;
+    int mynod;
+    int ret;
+    int nthreads;
+    int max_threads;
+    long i;
+    double time1, time2;
+    pthread_t *threads;
+
+    ret = MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &nthreads);
+    if(ret != MPI_SUCCESS)
+    {
+        fprintf(stderr, "Error: MPI_Init_thread failed.\n");
+        return(-1);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    /* we only want one proc */
+    if(nprocs > 1)
+    {
+        if(mynod == 0)
+        {
+            fprintf(stderr, "Error: this benchmark should be run with exactly one process.\n");
+        }
+        MPI_Finalize();
+        return(-1);
+    }
+
+    if(argc != 4 || sscanf(argv[2], "%d", &iters) != 1 ||
+        sscanf(argv[3], "%d", &max_threads) != 1 || iters < 1 || max_threads < 1)
+    {
+        fprintf(stderr, "Usage: %s <filename> <reads per thread> <max threads>\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    threads = malloc(max_threads * sizeof(*threads));
+    if(!threads)
+    {
+        perror("malloc");
+        MPI_Finalize();
+        return(-1);
+    }
+
+    fd = open(argv[1], O_RDONLY);
+    if(fd < 0)
+    {
+        perror("open");
+        MPI_Finalize();
+        return(-1);
+    }
+
+    printf("#<threads>\t<reads>\t<total (s)>\t<per op (s)>\t<per op per thread (s)>\n");
+    for(nthreads=1; nthreads<=max_threads; nthreads*=2)
+    {
+        time1 = MPI_Wtime();
+        for(i=0; i<nthreads; i++)
+        {
+            ret = pthread_create(&threads[i], NULL, reader, (void *)i);
+            if(ret != 0)
+            {
+                fprintf(stderr, "Error: pthread_create failed.\n");
+                MPI_Finalize();
+                return(-1);
+            }
+        }
+        for(i=0; i<nthreads; i++)
+            pthread_join(threads[i], NULL);
+        time2 = MPI_Wtime();
+
+        printf("%d\t%d\t%.9f\t%.9f\t%.9f\n", nthreads, nthreads*iters, time2-time1,
+            (time2-time1)/((double)iters*nthreads),
+            (time2-time1)/(double)iters);
+    }
+
+    close(fd);
+    free(threads);
+
+    MPI_Finalize();
+    return(0);
+}
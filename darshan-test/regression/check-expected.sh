@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# helpers for checking the counters in darshan-parser output against the
+# values that a test program expected; test cases source this file from
+# $DARSHAN_TESTDIR
+
+# darshan_reported <parser output> <file> <counter pattern>
+#   prints the parser output lines for counters matching the given (perl
+#   regular expression) pattern in the record of the given file
+darshan_reported()
+{
+    grep -P "\t${3}\t" $1 | grep -P "\t${2}\t"
+}
+
+# darshan_check_expected <parser output> <expected file>
+#   checks that every "<file> <counter> <value>" line of the expected file
+#   matches the value reported for that counter in the parser output
+darshan_check_expected()
+{
+    local FILE COUNTER VALUE REPORTED_VALUE
+
+    while read FILE COUNTER VALUE; do
+        REPORTED_VALUE=`darshan_reported $1 $FILE $COUNTER | cut -f 5`
+        if [ "$REPORTED_VALUE" != "$VALUE" ]; then
+            echo "Error: ${COUNTER} of $REPORTED_VALUE for $FILE is incorrect (expected $VALUE)" 1>&2
+            return 1
+        fi
+    done < $2
+
+    return 0
+}
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+PROG=activity-bins-test
+
+source $DARSHAN_TESTDIR/check-expected.sh
+
+# set log file path; remove previous log if present
+export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}.darshan
+rm -f ${DARSHAN_LOGFILE}
+
+# start with bins narrow enough that the wait between writes and reads
+# must coarsen them
+export DARSHAN_ACTIVITY_BIN_WIDTH=0.25
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# execute
+$DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat -w 5
+if [ $? -ne 0 ]; then
+    echo "Error: failed to execute ${PROG}" 1>&2
+    exit 1
+fi
+
+# parse log
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_TMP/${PROG}.darshan.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+    exit 1
+fi
+
+# check results
+darshan_check_expected $DARSHAN_TMP/${PROG}.darshan.txt $DARSHAN_TMP/${PROG}.tmp.dat.expected || exit 1
+
+while read FILE COUNTER VALUE; do
+    # the activity bins must account for every byte
+    if [ "$COUNTER" == "POSIX_BYTES_WRITTEN" ]; then
+        BINS="POSIX_ACTIVITY_WRITE_"
+    else
+        BINS="POSIX_ACTIVITY_READ_"
+    fi
+    BINNED_VALUE=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE "${BINS}[0-9]+" | awk '{s += $5} END {print s}'`
+    if [ "$BINNED_VALUE" != "$VALUE" ]; then
+        echo "Error: ${BINS}* sum of $BINNED_VALUE for $FILE is incorrect (expected $VALUE)" 1>&2
+        exit 1
+    fi
+done < $DARSHAN_TMP/${PROG}.tmp.dat.expected
+
+for FILE in `cut -d ' ' -f 1 $DARSHAN_TMP/${PROG}.tmp.dat.expected | sort -u`; do
+    # the wait must have coarsened the bins
+    WIDTH=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE POSIX_F_ACTIVITY_BIN_WIDTH | cut -f 5`
+    if [ -z "$WIDTH" ] || ! awk "BEGIN {exit !($WIDTH > 0.25)}"; then
+        echo "Error: POSIX_F_ACTIVITY_BIN_WIDTH of $WIDTH for $FILE was not coarsened" 1>&2
+        exit 1
+    fi
+
+    # every write must land in an earlier bin than every read
+    LAST_WRITE=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE "POSIX_ACTIVITY_WRITE_[0-9]+" | awk '$5 > 0 {n = $4; sub(/.*_/, "", n); last = n} END {print last}'`
+    FIRST_READ=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE "POSIX_ACTIVITY_READ_[0-9]+" | awk '$5 > 0 {n = $4; sub(/.*_/, "", n); print n; exit}'`
+    if [ -z "$LAST_WRITE" ] || [ -z "$FIRST_READ" ] || [ "$LAST_WRITE" -ge "$FIRST_READ" ]; then
+        echo "Error: write bin $LAST_WRITE and read bin $FIRST_READ for $FILE are not in order" 1>&2
+        exit 1
+    fi
+done
+
+exit 0
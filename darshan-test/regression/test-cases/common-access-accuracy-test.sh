@@ -0,0 +1,57 @@
+#!/bin/bash
+
+PROG=common-access-accuracy-test
+
+source $DARSHAN_TESTDIR/check-expected.sh
+
+# set log file path; remove previous log if present
+export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}.darshan
+rm -f ${DARSHAN_LOGFILE}
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# execute
+$DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat
+if [ $? -ne 0 ]; then
+    echo "Error: failed to execute ${PROG}" 1>&2
+    exit 1
+fi
+
+# parse log
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_TMP/${PROG}.darshan.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+    exit 1
+fi
+
+# check results
+
+# the program records the exact 4 most common values of each stream it
+# wrote; darshan must report the same values, with counts that are never
+# underestimated and overestimated by no more than the given bound
+while read FILE PREFIX RANK VALUE COUNT BOUND; do
+    REPORTED_VALUE=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE "${PREFIX}${RANK}_(ACCESS|STRIDE)" | cut -f 5`
+    REPORTED_COUNT=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE ${PREFIX}${RANK}_COUNT | cut -f 5`
+    if [ "$REPORTED_VALUE" != "$VALUE" ]; then
+        echo "Error: ${PREFIX}${RANK} of $REPORTED_VALUE for $FILE is incorrect (expected $VALUE)" 1>&2
+        exit 1
+    fi
+    if [ ! "$REPORTED_COUNT" -ge "$COUNT" -o ! "$REPORTED_COUNT" -le $((COUNT+BOUND)) ]; then
+        echo "Error: ${PREFIX}${RANK}_COUNT of $REPORTED_COUNT for $FILE is incorrect (expected $COUNT, error bound $BOUND)" 1>&2
+        exit 1
+    fi
+done < $DARSHAN_TMP/${PROG}.tmp.dat.expected
+
+# the streams hold more distinct values than darshan tracks, so the log
+# must mark the POSIX common value counts as estimates
+if ! grep -q "^# WARNING: POSIX module common value counts are estimates" $DARSHAN_TMP/${PROG}.darshan.txt; then
+    echo "Error: POSIX common value counts are not marked as estimates" 1>&2
+    exit 1
+fi
+
+exit 0
@@ -0,0 +1,46 @@
+#!/bin/bash
+
+PROG=shared-subset-test
+
+source $DARSHAN_TESTDIR/check-expected.sh
+
+# set log file path; remove previous log if present
+export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}.darshan
+rm -f ${DARSHAN_LOGFILE}
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# execute
+$DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat
+if [ $? -ne 0 ]; then
+    echo "Error: failed to execute ${PROG}" 1>&2
+    exit 1
+fi
+
+# parse log
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_TMP/${PROG}.darshan.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+    exit 1
+fi
+
+# check results
+
+# each file must have a single record, reduced from the records of every
+# process that accessed it (rank -1) unless only one process did, whether
+# or not every process accessed it
+darshan_check_expected $DARSHAN_TMP/${PROG}.darshan.txt $DARSHAN_TMP/${PROG}.tmp.dat.expected || exit 1
+while read FILE COUNTER VALUE; do
+    REPORTED_RANK=`darshan_reported $DARSHAN_TMP/${PROG}.darshan.txt $FILE $COUNTER | cut -f 2`
+    if [[ "$COUNTER" == *_SHARED_RANKS && "$VALUE" -gt 1 && "$REPORTED_RANK" != "-1" ]]; then
+        echo "Error: record for $FILE was not reduced (rank $REPORTED_RANK)" 1>&2
+        exit 1
+    fi
+done < $DARSHAN_TMP/${PROG}.tmp.dat.expected
+
+exit 0
@@ -0,0 +1,65 @@
+#!/bin/bash
+
+PROG=snapshot-test
+
+source $DARSHAN_TESTDIR/check-expected.sh
+
+# set log file path; remove previous log if present
+export DARSHAN_LOGFILE=$DARSHAN_TMP/${PROG}.darshan
+rm -f ${DARSHAN_LOGFILE}
+
+# snapshot every second into a directory of our own
+export DARSHAN_SNAPSHOT_INTERVAL=1
+export DARSHAN_SNAPSHOT_PATH=$DARSHAN_TMP/${PROG}.snapshots
+rm -rf ${DARSHAN_SNAPSHOT_PATH}
+mkdir -p ${DARSHAN_SNAPSHOT_PATH}
+rm -f $DARSHAN_TMP/${PROG}.tmp.dat.snapshot.*.darshan
+
+# compile
+$DARSHAN_CC $DARSHAN_TESTDIR/test-cases/src/${PROG}.c -o $DARSHAN_TMP/${PROG}
+if [ $? -ne 0 ]; then
+    echo "Error: failed to compile ${PROG}" 1>&2
+    exit 1
+fi
+
+# execute
+$DARSHAN_RUNJOB $DARSHAN_TMP/${PROG} -f $DARSHAN_TMP/${PROG}.tmp.dat -w 3
+if [ $? -ne 0 ]; then
+    echo "Error: failed to execute ${PROG}" 1>&2
+    exit 1
+fi
+
+# parse log
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_LOGFILE > $DARSHAN_TMP/${PROG}.darshan.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse ${DARSHAN_LOGFILE}" 1>&2
+    exit 1
+fi
+
+# snapshots must be removed once the final log has been written
+if [ -n "`ls -A ${DARSHAN_SNAPSHOT_PATH}`" ]; then
+    echo "Error: snapshots left behind in ${DARSHAN_SNAPSHOT_PATH}" 1>&2
+    exit 1
+fi
+
+# merge the snapshots kept by the test program as if the job had been
+# killed, then parse the merged log
+$DARSHAN_PATH/bin/darshan-merge --shared-redux --output $DARSHAN_TMP/${PROG}.merged.darshan \
+    $DARSHAN_TMP/${PROG}.tmp.dat.snapshot.*.darshan
+if [ $? -ne 0 ]; then
+    echo "Error: failed to merge snapshots" 1>&2
+    exit 1
+fi
+$DARSHAN_PATH/bin/darshan-parser $DARSHAN_TMP/${PROG}.merged.darshan > $DARSHAN_TMP/${PROG}.merged.darshan.txt
+if [ $? -ne 0 ]; then
+    echo "Error: failed to parse merged snapshots" 1>&2
+    exit 1
+fi
+
+# check results
+
+# the merged snapshots must account for every write, which all happened
+# well before the snapshots were kept
+darshan_check_expected $DARSHAN_TMP/${PROG}.merged.darshan.txt $DARSHAN_TMP/${PROG}.tmp.dat.expected || exit 1
+
+exit 0
@@ -0,0 +1,173 @@
+/*
+ * (C) 1995-2001 Clemson University and Argonne National Laboratory.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Has every process write a file of its own and one block of a file
+ * shared by all of them, wait, then read everything back, so that reads
+ * and writes land in distinct activity bins. The wait is long enough for
+ * the bins to be coarsened when DARSHAN_ACTIVITY_BIN_WIDTH is a fraction
+ * of it. The values Darshan should report for each file are written to
+ * "<filename>.expected".
+ *
+ * Each line of the expected file has the form:
+ * <file> <counter> <exact value>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <mpi.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define BLOCK_SIZE 1000
+#define BLOCK_COUNT 10
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_file[256] = "test.out";
+static int     opt_wait = 5;
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+static void posix_io(const char *file, int count, off_t off, int write_flag);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   char file[300];
+   char shared_file[300];
+   char expected_file[300];
+   FILE *expected;
+   int i;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   sprintf(file, "%s.%d", opt_file, mynod);
+   sprintf(shared_file, "%s.all", opt_file);
+
+   posix_io(file, BLOCK_COUNT, 0, 1);
+   posix_io(shared_file, 1, (off_t)mynod * BLOCK_SIZE, 1);
+
+   /* separate the write phase from the read phase */
+   MPI_Barrier(MPI_COMM_WORLD);
+   sleep(opt_wait);
+
+   posix_io(file, BLOCK_COUNT, 0, 0);
+   posix_io(shared_file, 1, (off_t)mynod * BLOCK_SIZE, 0);
+
+   if(mynod == 0)
+   {
+      sprintf(expected_file, "%s.expected", opt_file);
+      expected = fopen(expected_file, "w");
+      if(!expected)
+      {
+         perror("fopen");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+
+      for(i=0; i<nprocs; i++)
+      {
+         fprintf(expected, "%s.%d POSIX_BYTES_WRITTEN %d\n", opt_file, i,
+            BLOCK_COUNT * BLOCK_SIZE);
+         fprintf(expected, "%s.%d POSIX_BYTES_READ %d\n", opt_file, i,
+            BLOCK_COUNT * BLOCK_SIZE);
+      }
+      fprintf(expected, "%s.all POSIX_BYTES_WRITTEN %d\n", opt_file,
+         nprocs * BLOCK_SIZE);
+      fprintf(expected, "%s.all POSIX_BYTES_READ %d\n", opt_file,
+         nprocs * BLOCK_SIZE);
+
+      fclose(expected);
+   }
+
+   MPI_Barrier(MPI_COMM_WORLD);
+   MPI_Finalize();
+   return(0);
+}
+
+/* write (or read) 'count' blocks of the given file, starting at 'off' */
+static void posix_io(const char *file, int count, off_t off, int write_flag)
+{
+   char buffer[BLOCK_SIZE];
+   ssize_t ret;
+   int fd;
+   int i;
+
+   memset(buffer, mynod, BLOCK_SIZE);
+   fd = open(file, write_flag ? (O_WRONLY|O_CREAT) : O_RDONLY,
+      S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+   if(fd<0)
+   {
+      perror("open");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   for(i=0; i<count; i++)
+   {
+      if(write_flag)
+         ret = pwrite(fd, buffer, BLOCK_SIZE, off + i * BLOCK_SIZE);
+      else
+         ret = pread(fd, buffer, BLOCK_SIZE, off + i * BLOCK_SIZE);
+      if(ret != BLOCK_SIZE)
+      {
+         perror(write_flag ? "pwrite" : "pread");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+   close(fd);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "f:w:")) != EOF) {
+      switch (c) {
+         case 'f': /* filename */
+            strncpy(opt_file, optarg, 255);
+            break;
+         case 'w': /* seconds between writes and reads */
+            opt_wait = atoi(optarg);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: activity-bins-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -f       filename prefix [default: test.out]\n");
+    printf(" -w       seconds between writes and reads [default: 5]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
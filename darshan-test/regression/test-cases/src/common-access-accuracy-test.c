@@ -0,0 +1,233 @@
+/*
+ * (C) 1995-2001 Clemson University and Argonne National Laboratory.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Writes access size and stride streams that are adversarial for a
+ * bounded common value tracker (many distinct values, heavy hitters that
+ * only show up late, heavy hitters interleaved with churning noise) to
+ * separate files, and records the exact 4 most common values of each
+ * stream in "<filename>.expected" so that they can be compared with the
+ * POSIX_ACCESS* and POSIX_STRIDE* counters Darshan reports.
+ *
+ * Each line of the expected file has the form:
+ * <file> <counter prefix> <rank> <value> <exact count> <error bound>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/time.h>
+#include <mpi.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+/* must match DARSHAN_COMMON_VAL_MAX_RUNTIME_COUNT in the runtime */
+#define TRACKED_VALS 32
+#define MAX_VAL 4096
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_file[256] = "test.out";
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+static int noisy_prefix(int i);
+static int churn(int i);
+static int late_heavy(int i);
+static int run_stream(FILE *expected, const char *name, int (*gen)(int),
+   int nops, int stride_flag);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+static char buffer[MAX_VAL];
+
+int main(int argc, char **argv)
+{
+   int namelen;
+   char processor_name[MPI_MAX_PROCESSOR_NAME];
+   char expected_file[300];
+   FILE *expected;
+   int ret = 0;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+   MPI_Get_processor_name(processor_name, &namelen);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   if(mynod == 0)
+   {
+      sprintf(expected_file, "%s.expected", opt_file);
+      expected = fopen(expected_file, "w");
+      if(!expected)
+      {
+         perror("fopen");
+         return(-1);
+      }
+
+      ret |= run_stream(expected, "noisy-prefix", noisy_prefix, 1200, 0);
+      ret |= run_stream(expected, "churn", churn, 3000, 0);
+      ret |= run_stream(expected, "late-heavy", late_heavy, 3000, 0);
+      ret |= run_stream(expected, "late-heavy-stride", late_heavy, 3000, 1);
+
+      fclose(expected);
+   }
+   MPI_Finalize();
+   return(ret);
+}
+
+/* 200 distinct sizes once each, then 4 interleaved heavy hitters */
+static int noisy_prefix(int i)
+{
+   static const int heavy[10] = {1000, 2000, 1000, 3000, 1000, 2000, 4000,
+      1000, 2000, 3000};
+
+   if(i < 200)
+      return(i + 1);
+   return(heavy[(i - 200) % 10]);
+}
+
+/* heavy hitters interleaved with noise cycling through 100 values */
+static int churn(int i)
+{
+   static const int slots[24] = {500, 600, 500, 700, 500, 800, 600, 500,
+      700, 0, 500, 600, 800, 0, 500, 700, 600, 0, 500, 800, 700, 0, 500, 600};
+
+   if(slots[i % 24])
+      return(slots[i % 24]);
+   return((i / 24) % 100 + 1);
+}
+
+/* 1000 distinct values twice each, then 4 heavy hitters */
+static int late_heavy(int i)
+{
+   static const int heavy[10] = {4000, 3000, 4000, 2500, 4000, 3000, 1500,
+      4000, 3000, 2500};
+
+   if(i < 2000)
+      return(i % 1000 + 1);
+   return(heavy[(i - 2000) % 10]);
+}
+
+static int run_stream(FILE *expected, const char *name, int (*gen)(int),
+   int nops, int stride_flag)
+{
+   static int counts[MAX_VAL+1];
+   char file[300];
+   off_t offset = 0;
+   int fd;
+   int i, j;
+   int val, best;
+   int ret;
+
+   sprintf(file, "%s.%s", opt_file, name);
+   fd = open(file, O_WRONLY|O_TRUNC|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+   if(fd<0)
+   {
+      perror("open");
+      return(-1);
+   }
+
+   memset(counts, 0, sizeof(counts));
+   for(i=0; i<nops; i++)
+   {
+      val = gen(i);
+      if(stride_flag)
+      {
+         /* write single bytes separated by a gap of 'val' bytes */
+         if(i > 0)
+            offset += val;
+         ret = pwrite(fd, buffer, 1, offset);
+         offset++;
+         if(ret != 1)
+         {
+            perror("pwrite");
+            close(fd);
+            return(-1);
+         }
+         /* the first write has no stride */
+         if(i > 0)
+            counts[val]++;
+      }
+      else
+      {
+         ret = write(fd, buffer, val);
+         if(ret != val)
+         {
+            perror("write");
+            close(fd);
+            return(-1);
+         }
+         counts[val]++;
+      }
+   }
+   close(fd);
+
+   /* report the 4 most common values, ordered by decreasing count and
+    * then decreasing value, just as Darshan does
+    */
+   for(j=1; j<=4; j++)
+   {
+      best = 0;
+      for(val=1; val<=MAX_VAL; val++)
+      {
+         if(counts[val] && counts[val] >= counts[best])
+            best = val;
+      }
+      if(!best)
+         break;
+      fprintf(expected, "%s %s %d %d %d %d\n", file,
+         stride_flag ? "POSIX_STRIDE" : "POSIX_ACCESS", j, best,
+         counts[best], nops / TRACKED_VALS);
+      counts[best] = 0;
+   }
+
+   return(0);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "f:")) != EOF) {
+      switch (c) {
+         case 'f': /* filename */
+            strncpy(opt_file, optarg, 255);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: common-access-accuracy-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -f       filename prefix [default: test.out]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
@@ -0,0 +1,270 @@
+/*
+ * (C) 1995-2001 Clemson University and Argonne National Laboratory.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Has many threads on every process hammer a single shared file
+ * descriptor with concurrent reads and writes of varying sizes, and
+ * records the exact totals Darshan should report for the file in
+ * "<filename>.expected", so that counters updated outside of the POSIX
+ * module lock can be checked for lost updates.
+ *
+ * Each line of the expected file has the form:
+ * <file> <counter> <exact value>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <mpi.h>
+#include <errno.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define NSIZES 4
+#define MAX_SIZE 16384
+#define WINDOW (64 * 1024)
+
+/* one size from each of the smallest four access size histogram buckets */
+static const int sizes[NSIZES] = {64, 512, 4096, MAX_SIZE};
+static const char *read_buckets[NSIZES] = {"POSIX_SIZE_READ_0_100",
+   "POSIX_SIZE_READ_100_1K", "POSIX_SIZE_READ_1K_10K",
+   "POSIX_SIZE_READ_10K_100K"};
+static const char *write_buckets[NSIZES] = {"POSIX_SIZE_WRITE_0_100",
+   "POSIX_SIZE_WRITE_100_1K", "POSIX_SIZE_WRITE_1K_10K",
+   "POSIX_SIZE_WRITE_10K_100K"};
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_file[256] = "test.out";
+static int     opt_threads = 16;
+static int     opt_ops = 2000;
+
+struct thread_args
+{
+   int fd;
+   int id;
+   int64_t reads[NSIZES];
+   int64_t writes[NSIZES];
+   int err;
+};
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+static void *thread_main(void *arg);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   int namelen;
+   char processor_name[MPI_MAX_PROCESSOR_NAME];
+   char expected_file[300];
+   FILE *expected;
+   pthread_t *threads;
+   struct thread_args *args;
+   int64_t local[2*NSIZES+1], global[2*NSIZES+1];
+   int64_t reads = 0, writes = 0, bytes_read = 0, bytes_written = 0;
+   int fd;
+   int i, j;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+   MPI_Get_processor_name(processor_name, &namelen);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   fd = open(opt_file, O_RDWR|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+   if(fd<0)
+   {
+      perror("open");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   /* size the file up front so that no read comes up short */
+   if(mynod == 0 && ftruncate(fd, WINDOW + MAX_SIZE) < 0)
+   {
+      perror("ftruncate");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   MPI_Barrier(MPI_COMM_WORLD);
+
+   threads = malloc(opt_threads * sizeof(*threads));
+   args = calloc(opt_threads, sizeof(*args));
+   if(!threads || !args)
+   {
+      perror("malloc");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   for(i=0; i<opt_threads; i++)
+   {
+      args[i].fd = fd;
+      args[i].id = mynod * opt_threads + i;
+      if(pthread_create(&threads[i], NULL, thread_main, &args[i]) != 0)
+      {
+         perror("pthread_create");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+
+   /* tally up what every thread did */
+   memset(local, 0, sizeof(local));
+   for(i=0; i<opt_threads; i++)
+   {
+      pthread_join(threads[i], NULL);
+      for(j=0; j<NSIZES; j++)
+      {
+         local[j] += args[i].reads[j];
+         local[NSIZES+j] += args[i].writes[j];
+      }
+      local[2*NSIZES] += args[i].err;
+   }
+   close(fd);
+
+   MPI_Reduce(local, global, 2*NSIZES+1, MPI_INT64_T, MPI_SUM, 0,
+      MPI_COMM_WORLD);
+
+   if(mynod == 0)
+   {
+      if(global[2*NSIZES])
+      {
+         fprintf(stderr, "Error: %" PRId64 " operations failed\n",
+            global[2*NSIZES]);
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+
+      sprintf(expected_file, "%s.expected", opt_file);
+      expected = fopen(expected_file, "w");
+      if(!expected)
+      {
+         perror("fopen");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+
+      for(j=0; j<NSIZES; j++)
+      {
+         reads += global[j];
+         writes += global[NSIZES+j];
+         bytes_read += global[j] * sizes[j];
+         bytes_written += global[NSIZES+j] * sizes[j];
+         fprintf(expected, "%s %s %" PRId64 "\n", opt_file, read_buckets[j],
+            global[j]);
+         fprintf(expected, "%s %s %" PRId64 "\n", opt_file, write_buckets[j],
+            global[NSIZES+j]);
+      }
+      fprintf(expected, "%s POSIX_READS %" PRId64 "\n", opt_file, reads);
+      fprintf(expected, "%s POSIX_WRITES %" PRId64 "\n", opt_file, writes);
+      fprintf(expected, "%s POSIX_BYTES_READ %" PRId64 "\n", opt_file,
+         bytes_read);
+      fprintf(expected, "%s POSIX_BYTES_WRITTEN %" PRId64 "\n", opt_file,
+         bytes_written);
+
+      fclose(expected);
+   }
+
+   free(threads);
+   free(args);
+   MPI_Finalize();
+   return(0);
+}
+
+/* issue an interleaved mix of reads and writes of every size, all within
+ * a small window of the file so that it stays small
+ */
+static void *thread_main(void *arg)
+{
+   struct thread_args *targs = (struct thread_args *)arg;
+   char *buffer;
+   off_t offset;
+   int size_ndx;
+   int i;
+   ssize_t ret;
+
+   buffer = malloc(MAX_SIZE);
+   if(!buffer)
+   {
+      targs->err++;
+      return(NULL);
+   }
+   memset(buffer, targs->id, MAX_SIZE);
+
+   for(i=0; i<opt_ops; i++)
+   {
+      size_ndx = (i + targs->id) % NSIZES;
+      offset = ((off_t)(i * 7 + targs->id) * 512) % WINDOW;
+
+      ret = pwrite(targs->fd, buffer, sizes[size_ndx], offset);
+      if(ret != sizes[size_ndx])
+         targs->err++;
+      else
+         targs->writes[size_ndx]++;
+
+      size_ndx = (size_ndx + 1) % NSIZES;
+      ret = pread(targs->fd, buffer, sizes[size_ndx], offset);
+      if(ret != sizes[size_ndx])
+         targs->err++;
+      else
+         targs->reads[size_ndx]++;
+   }
+
+   free(buffer);
+   return(NULL);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "f:t:n:")) != EOF) {
+      switch (c) {
+         case 'f': /* filename */
+            strncpy(opt_file, optarg, 255);
+            break;
+         case 't': /* threads per process */
+            opt_threads = atoi(optarg);
+            break;
+         case 'n': /* operations per thread */
+            opt_ops = atoi(optarg);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: posix-concurrent-counter-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -f       filename [default: test.out]\n");
+    printf(" -t       threads per process [default: 16]\n");
+    printf(" -n       read/write pairs per thread [default: 2000]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
@@ -0,0 +1,188 @@
+/*
+ * (C) 1995-2001 Clemson University and Argonne National Laboratory.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Splits the processes into pairs, each of which writes its own files
+ * with both POSIX and MPI-IO (on the pair's communicator), and has every
+ * process write one more file shared by all of them. The values Darshan
+ * should report for each file's reduced record are written to
+ * "<filename>.expected", so that records shared by a subset of the
+ * processes can be checked for having been reduced just like records
+ * shared by all of them.
+ *
+ * Each line of the expected file has the form:
+ * <file> <counter> <exact value>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <mpi.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define POSIX_SIZE 1000
+#define MPIIO_SIZE 100
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_file[256] = "test.out";
+static int     opt_group = 2;
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+static void posix_write(const char *file, int rank);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   char file[300];
+   char expected_file[300];
+   char buffer[MPIIO_SIZE];
+   FILE *expected;
+   MPI_Comm group_comm;
+   MPI_File fh;
+   int group, group_rank, group_size;
+   int i;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   group = mynod / opt_group;
+   MPI_Comm_split(MPI_COMM_WORLD, group, mynod, &group_comm);
+   MPI_Comm_rank(group_comm, &group_rank);
+   MPI_Comm_size(group_comm, &group_size);
+
+   /* a file shared by every process */
+   sprintf(file, "%s.all", opt_file);
+   posix_write(file, mynod);
+
+   /* files shared by just this process's group */
+   sprintf(file, "%s.posix.%d", opt_file, group);
+   posix_write(file, group_rank);
+
+   sprintf(file, "%s.mpiio.%d", opt_file, group);
+   memset(buffer, mynod, MPIIO_SIZE);
+   if(MPI_File_open(group_comm, file, MPI_MODE_CREATE|MPI_MODE_WRONLY,
+      MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+   {
+      fprintf(stderr, "Error: failed to open %s\n", file);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   MPI_File_write_at_all(fh, (MPI_Offset)group_rank * MPIIO_SIZE, buffer,
+      MPIIO_SIZE, MPI_BYTE, MPI_STATUS_IGNORE);
+   MPI_File_close(&fh);
+
+   if(mynod == 0)
+   {
+      sprintf(expected_file, "%s.expected", opt_file);
+      expected = fopen(expected_file, "w");
+      if(!expected)
+      {
+         perror("fopen");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+
+      fprintf(expected, "%s.all POSIX_SHARED_RANKS %d\n", opt_file, nprocs);
+      fprintf(expected, "%s.all POSIX_BYTES_WRITTEN %d\n", opt_file,
+         nprocs * POSIX_SIZE);
+      for(i=0; i*opt_group<nprocs; i++)
+      {
+         group_size = (nprocs - i*opt_group < opt_group) ?
+            nprocs - i*opt_group : opt_group;
+         fprintf(expected, "%s.posix.%d POSIX_SHARED_RANKS %d\n", opt_file,
+            i, group_size);
+         fprintf(expected, "%s.posix.%d POSIX_WRITES %d\n", opt_file, i,
+            group_size);
+         fprintf(expected, "%s.posix.%d POSIX_BYTES_WRITTEN %d\n", opt_file,
+            i, group_size * POSIX_SIZE);
+         fprintf(expected, "%s.mpiio.%d MPIIO_SHARED_RANKS %d\n", opt_file,
+            i, group_size);
+         fprintf(expected, "%s.mpiio.%d MPIIO_COLL_WRITES %d\n", opt_file,
+            i, group_size);
+         fprintf(expected, "%s.mpiio.%d MPIIO_BYTES_WRITTEN %d\n", opt_file,
+            i, group_size * MPIIO_SIZE);
+      }
+
+      fclose(expected);
+   }
+
+   MPI_Comm_free(&group_comm);
+   MPI_Finalize();
+   return(0);
+}
+
+/* write one block of the given file, at an offset set by rank */
+static void posix_write(const char *file, int rank)
+{
+   char buffer[POSIX_SIZE];
+   int fd;
+
+   memset(buffer, rank, POSIX_SIZE);
+   fd = open(file, O_WRONLY|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+   if(fd<0)
+   {
+      perror("open");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   if(pwrite(fd, buffer, POSIX_SIZE, (off_t)rank * POSIX_SIZE) != POSIX_SIZE)
+   {
+      perror("pwrite");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   close(fd);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "f:g:")) != EOF) {
+      switch (c) {
+         case 'f': /* filename */
+            strncpy(opt_file, optarg, 255);
+            break;
+         case 'g': /* processes per group */
+            opt_group = atoi(optarg);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: shared-subset-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -f       filename prefix [default: test.out]\n");
+    printf(" -g       processes per group [default: 2]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
@@ -0,0 +1,213 @@
+/*
+ * (C) 1995-2001 Clemson University and Argonne National Laboratory.
+ *
+ * See COPYING in top-level directory.
+ */
+
+/* Has every process write a file of its own and one block of a file
+ * shared by all of them, then wait long enough for Darshan to snapshot
+ * its records (DARSHAN_SNAPSHOT_INTERVAL must be set to less than the
+ * wait) and keep a hard link to its snapshot, which would otherwise be
+ * removed at shutdown. The values Darshan should report for each file
+ * once the kept snapshots are merged are written to "<filename>.expected".
+ *
+ * Each line of the expected file has the form:
+ * <file> <counter> <exact value>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <dirent.h>
+#include <mpi.h>
+#include <getopt.h>
+#include <sys/stat.h>
+
+#define BLOCK_SIZE 1000
+#define BLOCK_COUNT 10
+
+/* DEFAULT VALUES FOR OPTIONS */
+static char    opt_file[256] = "test.out";
+static int     opt_wait = 3;
+
+/* function prototypes */
+static int parse_args(int argc, char **argv);
+static void usage(void);
+static void posix_write(const char *file, int count, off_t off);
+static void keep_snapshot(void);
+
+/* global vars */
+static int mynod = 0;
+static int nprocs = 1;
+
+int main(int argc, char **argv)
+{
+   char file[300];
+   char expected_file[300];
+   FILE *expected;
+   int i;
+
+   /* startup MPI and determine the rank of this process */
+   MPI_Init(&argc,&argv);
+   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+   MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+
+   /* parse the command line arguments */
+   parse_args(argc, argv);
+
+   sprintf(file, "%s.%d", opt_file, mynod);
+   posix_write(file, BLOCK_COUNT, 0);
+
+   sprintf(file, "%s.all", opt_file);
+   posix_write(file, 1, (off_t)mynod * BLOCK_SIZE);
+
+   /* give Darshan time to snapshot the records above */
+   sleep(opt_wait);
+   keep_snapshot();
+
+   if(mynod == 0)
+   {
+      sprintf(expected_file, "%s.expected", opt_file);
+      expected = fopen(expected_file, "w");
+      if(!expected)
+      {
+         perror("fopen");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+
+      for(i=0; i<nprocs; i++)
+      {
+         fprintf(expected, "%s.%d POSIX_WRITES %d\n", opt_file, i,
+            BLOCK_COUNT);
+         fprintf(expected, "%s.%d POSIX_BYTES_WRITTEN %d\n", opt_file, i,
+            BLOCK_COUNT * BLOCK_SIZE);
+      }
+      fprintf(expected, "%s.all POSIX_WRITES %d\n", opt_file, nprocs);
+      fprintf(expected, "%s.all POSIX_BYTES_WRITTEN %d\n", opt_file,
+         nprocs * BLOCK_SIZE);
+
+      fclose(expected);
+   }
+
+   MPI_Barrier(MPI_COMM_WORLD);
+   MPI_Finalize();
+   return(0);
+}
+
+/* write 'count' blocks of the given file, starting at 'off' */
+static void posix_write(const char *file, int count, off_t off)
+{
+   char buffer[BLOCK_SIZE];
+   int fd;
+   int i;
+
+   memset(buffer, mynod, BLOCK_SIZE);
+   fd = open(file, O_WRONLY|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+   if(fd<0)
+   {
+      perror("open");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   for(i=0; i<count; i++)
+   {
+      if(pwrite(fd, buffer, BLOCK_SIZE, off + i * BLOCK_SIZE) != BLOCK_SIZE)
+      {
+         perror("pwrite");
+         MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+   }
+   close(fd);
+}
+
+/* link this process's snapshot to "<filename>.snapshot.<rank>.darshan" */
+static void keep_snapshot(void)
+{
+   char *snapshot_path;
+   char suffix[64];
+   char snapshot[600];
+   char kept[300];
+   struct dirent *entry;
+   DIR *dir;
+   int len;
+
+   snapshot_path = getenv("DARSHAN_SNAPSHOT_PATH");
+   if(!snapshot_path)
+   {
+      fprintf(stderr, "Error: DARSHAN_SNAPSHOT_PATH is not set\n");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   dir = opendir(snapshot_path);
+   if(!dir)
+   {
+      perror("opendir");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   sprintf(suffix, "-%d.darshan", mynod);
+   while((entry = readdir(dir)))
+   {
+      len = strlen(entry->d_name);
+      if(strstr(entry->d_name, "_snapshot-") && len > strlen(suffix) &&
+         strcmp(entry->d_name + len - strlen(suffix), suffix) == 0)
+         break;
+   }
+   if(!entry)
+   {
+      fprintf(stderr, "Error: no snapshot found for rank %d\n", mynod);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+
+   sprintf(snapshot, "%s/%s", snapshot_path, entry->d_name);
+   sprintf(kept, "%s.snapshot.%d.darshan", opt_file, mynod);
+   unlink(kept);
+   if(link(snapshot, kept) < 0)
+   {
+      perror("link");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+   }
+   closedir(dir);
+}
+
+static int parse_args(int argc, char **argv)
+{
+   int c;
+
+   while ((c = getopt(argc, argv, "f:w:")) != EOF) {
+      switch (c) {
+         case 'f': /* filename */
+            strncpy(opt_file, optarg, 255);
+            break;
+         case 'w': /* seconds to wait for a snapshot */
+            opt_wait = atoi(optarg);
+            break;
+         case '?': /* unknown */
+            if (mynod == 0)
+                usage();
+            exit(1);
+         default:
+            break;
+      }
+   }
+   return(0);
+}
+
+static void usage(void)
+{
+    printf("Usage: snapshot-test [<OPTIONS>...]\n");
+    printf("\n<OPTIONS> is one of\n");
+    printf(" -f       filename prefix [default: test.out]\n");
+    printf(" -w       seconds to wait for a snapshot [default: 3]\n");
+    printf(" -h       print this help\n");
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 3
+ *  c-basic-offset: 3
+ *  tab-width: 3
+ *
+ * vim: ts=3
+ * End:
+ */
@@ -0,0 +1,173 @@
+/*
+ *  (C) 2021 by Argonne National Laboratory.
+ *      See COPYRIGHT in top-level directory.
+ */
+
+/* Benchmark to measure the overhead of the timers available to the Darshan
+ * runtime (see the --with-timer configure option and the DARSHAN_TIMER
+ * environment variable).  This is an MPI program that uses exactly one
+ * process.  It reports the per-call cost of each timer backend, of
+ * darshan_core_wtime() itself (if the Darshan runtime library is preloaded
+ * or linked in), and of a 4 KiB pread() for comparison, since every
+ * instrumented I/O operation takes at least two timestamps.
+ */
+
+/* Arguments: a file name to read from (e.g., /dev/zero), and the number of
+ * iterations to run of each test phase
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <mpi.h>
+
+#define READ_SIZE 4096
+
+typedef double (*wtime_fn)(void);
+
+static volatile double sink;
+
+static double gettimeofday_wtime(void)
+{
+    struct timeval tval;
+    gettimeofday(&tval, NULL);
+    return(tval.tv_sec + (tval.tv_usec / 1000000.0));
+}
+
+static double mpi_wtime(void)
+{
+    return(MPI_Wtime());
+}
+
+static double monotonic_wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return(tp.tv_sec + (tp.tv_nsec / 1000000000.0));
+}
+
+#ifdef CLOCK_MONOTONIC_COARSE
+static double coarse_wtime(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &tp);
+    return(tp.tv_sec + (tp.tv_nsec / 1000000000.0));
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+static double tsc_wtime(void)
+{
+    return((double)__rdtsc());
+}
+#endif
+
+static void bench_timer(const char *name, wtime_fn fn, int iters)
+{
+    double time1, time2;
+    int i;
+
+    time1 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+        sink += fn();
+    time2 = MPI_Wtime();
+
+    printf("%s\t%d\t%.9f\t%.9f\n", name, iters, time2-time1,
+        (time2-time1)/(double)iters);
+
+    return;
+}
+
+int main(int argc, char **argv)
+{
+    int nprocs;
+    int mynod;
+    int i;
+    int ret;
+    int fd;
+    int iters;
+    double time1, time2;
+    char buf[READ_SIZE];
+    wtime_fn darshan_wtime;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &mynod);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    /* we only want one proc */
+    if(nprocs > 1)
+    {
+        if(mynod == 0)
+        {
+            fprintf(stderr, "Error: this benchmark should be run with exactly one process.\n");
+        }
+        MPI_Finalize();
+        return(-1);
+    }
+
+    if(argc != 3 || sscanf(argv[2], "%d", &iters) != 1 || iters < 1)
+    {
+        fprintf(stderr, "Usage: %s <filename> <number of iterations>\n", argv[0]);
+        MPI_Finalize();
+        return(-1);
+    }
+
+    fd = open(argv[1], O_RDONLY);
+    if(fd < 0)
+    {
+        perror("open");
+        MPI_Finalize();
+        return(-1);
+    }
+
+    printf("#<op>\t<iters>\t<total (s)>\t<per op (s)>\n");
+
+    bench_timer("gettimeofday", gettimeofday_wtime, iters);
+    bench_timer("MPI_Wtime", mpi_wtime, iters);
+    bench_timer("CLOCK_MONOTONIC", monotonic_wtime, iters);
+#ifdef CLOCK_MONOTONIC_COARSE
+    bench_timer("CLOCK_MONOTONIC_COARSE", coarse_wtime, iters);
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    bench_timer("rdtsc", tsc_wtime, iters);
+#endif
+
+    /* the timer darshan actually uses, as selected by DARSHAN_TIMER */
+    darshan_wtime = (wtime_fn)dlsym(RTLD_DEFAULT, "darshan_core_wtime");
+    if(darshan_wtime)
+        bench_timer("darshan_core_wtime", darshan_wtime, iters);
+
+    time1 = MPI_Wtime();
+    for(i=0; i<iters; i++)
+    {
+        ret = pread(fd, buf, READ_SIZE, 0);
+        if(ret < 0)
+        {
+            perror("pread");
+            close(fd);
+            MPI_Finalize();
+            return(-1);
+        }
+    }
+    time2 = MPI_Wtime();
+    printf("pread_4KiB\t%d\t%.9f\t%.9f\n", iters, time2-time1,
+        (time2-time1)/(double)iters);
+
+    close(fd);
+
+    MPI_Finalize();
+    return(0);
+}
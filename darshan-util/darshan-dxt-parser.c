@@ -95,6 +95,8 @@ int main(int argc, char **argv)
         comp_str = "BZIP2";
     else if (fd->comp_type == DARSHAN_NO_COMP)
         comp_str = "NONE";
+    else if (fd->comp_type == DARSHAN_ZSTD_COMP)
+        comp_str = "ZSTD";
     else
         comp_str = "UNKNOWN";
 
@@ -139,7 +141,7 @@ int main(int argc, char **argv)
     /* print breakdown of each log file region's contribution to file size */
     printf("\n# log file regions\n");
     printf("# -------------------------------------------------------\n");
-    printf("# header: %zu bytes (uncompressed)\n", sizeof(struct darshan_header));
+    printf("# header: %zu bytes (uncompressed)\n", fd->job_map.off);
     printf("# job data: %zu bytes (compressed)\n", fd->job_map.len);
     printf("# record table: %zu bytes (compressed)\n", fd->name_map.len);
     for (i = 0; i < DARSHAN_MAX_MODS; i++)
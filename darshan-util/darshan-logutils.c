@@ -10,6 +10,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <sys/types.h>
@@ -46,6 +47,23 @@ struct darshan_dz_state
     int prev_reg_id;
 };
 
+#ifdef HAVE_LIBZSTD
+/* zstd streams don't track their own input/output buffers like libz and
+ * bzip2 streams do, so we keep them alongside the stream
+ */
+struct darshan_zstd_state
+{
+    ZSTD_CStream *cstrm;
+    ZSTD_DStream *dstrm;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    /* for reading logs, flag indicating the decompression stream may be
+     * holding decompressed data that did not fit in the last output buffer
+     */
+    int out_pending;
+};
+#endif
+
 /* internal fd data structure */
 struct darshan_fd_int_state
 {
@@ -64,10 +82,21 @@ struct darshan_fd_int_state
     /* log format version-specific function calls for getting
      * data from the log file
      */
-    int (*get_namerecs)(void *, int, int, struct darshan_name_record_ref **);
+    int (*get_namerecs)(void *, int, int, char *,
+        struct darshan_name_record_ref **);
 
     /* compression/decompression stream read/write state */
     struct darshan_dz_state dz;
+    /* buffer for reading sparse encoded records */
+    unsigned char *sparse_buf;
+    int sparse_buf_sz;
+    /* the columns of records stored by one process, for reading records
+     * stored in columns, and the next record to read from them
+     */
+    uint64_t *col_buf;
+    uint64_t col_buf_sz;
+    uint64_t col_rec_cnt;
+    uint64_t col_rec_idx;
 };
 
 /* each module's implementation of the darshan logutil functions */
@@ -81,7 +110,7 @@ struct darshan_mod_logutil_funcs *mod_logutils[DARSHAN_MAX_MODS] =
 /* internal helper functions */
 static int darshan_mnt_info_cmp(const void *a, const void *b);
 static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash);
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
 static int darshan_log_get_header(darshan_fd fd);
 static int darshan_log_put_header(darshan_fd fd);
 static int darshan_log_seek(darshan_fd fd, off_t offset);
@@ -103,19 +132,27 @@ static int darshan_log_bzip2_write(darshan_fd fd, struct darshan_log_map *map_p,
     void *buf, int len, int flush_strm_flag);
 static int darshan_log_bzip2_flush(darshan_fd fd, int region_id);
 #endif
+#ifdef HAVE_LIBZSTD
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map, 
+    void *buf, int len, int reset_strm_flag);
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag);
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id);
+#endif
 static int darshan_log_dzload(darshan_fd fd, struct darshan_log_map map);
 static int darshan_log_dzunload(darshan_fd fd, struct darshan_log_map *map_p);
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag);
+int whitelist_filter(darshan_record_id val, darshan_record_id *whitelist,
+    int whitelist_count);
 
 
-/* filtered namerecs test */
-static int darshan_log_get_filtered_namerecs(void *name_rec_buf, int buf_len, int swap_flag, struct darshan_name_record_ref **hash, darshan_record_id *whitelist, int whitelist_count);
-
 
 /* backwards compatibility functions */
 int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash);
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
+int darshan_log_get_namerecs_3_22(void *name_rec_buf, int buf_len,
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash);
 
 static char *darshan_util_lib_ver = PACKAGE_VERSION;
 
@@ -569,6 +606,7 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
 {
     struct darshan_fd_int_state *state;
     char *name_rec_buf;
+    char *prev_name;
     int name_rec_buf_sz;
     int read;
     int read_req_sz;
@@ -593,9 +631,15 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
     /* default to buffer twice as big as default compression buf */
     name_rec_buf_sz = DARSHAN_DEF_COMP_BUF_SZ * 2;
     name_rec_buf = malloc(name_rec_buf_sz);
-    if(!name_rec_buf)
+    prev_name = malloc(PATH_MAX);
+    if(!name_rec_buf || !prev_name)
+    {
+        free(name_rec_buf);
+        free(prev_name);
         return(-1);
+    }
     memset(name_rec_buf, 0, name_rec_buf_sz);
+    prev_name[0] = '\0';
 
     do
     {
@@ -609,12 +653,21 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
         {
             fprintf(stderr, "Error: failed to read name hash from darshan log file.\n");
             free(name_rec_buf);
+            free(prev_name);
             return(-1);
         }
         buf_len += read;
 
         /* extract any name records in the buffer */
-        buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag, hash);
+        buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag,
+            prev_name, hash);
+        if(buf_processed < 0)
+        {
+            fprintf(stderr, "Error: failed to parse name hash from darshan log file.\n");
+            free(name_rec_buf);
+            free(prev_name);
+            return(-1);
+        }
 
         /* copy any leftover data to beginning of buffer to parse next */
         memcpy(name_rec_buf, name_rec_buf + buf_processed, buf_len - buf_processed);
@@ -627,6 +680,7 @@ int darshan_log_get_namehash(darshan_fd fd, struct darshan_name_record_ref **has
     assert(buf_len == 0);
 
     free(name_rec_buf);
+    free(prev_name);
     return(0);
 }
 
@@ -646,7 +700,10 @@ int darshan_log_get_filtered_namehash(darshan_fd fd,
         )
 {
     struct darshan_fd_int_state *state;
+    struct darshan_name_record_ref *chunk_hash;
+    struct darshan_name_record_ref *ref, *tmp_ref, *old_ref;
     char *name_rec_buf;
+    char *prev_name;
     int name_rec_buf_sz;
     int read;
     int read_req_sz;
@@ -671,9 +728,15 @@ int darshan_log_get_filtered_namehash(darshan_fd fd,
     /* default to buffer twice as big as default compression buf */
     name_rec_buf_sz = DARSHAN_DEF_COMP_BUF_SZ * 2;
     name_rec_buf = malloc(name_rec_buf_sz);
-    if(!name_rec_buf)
+    prev_name = malloc(PATH_MAX);
+    if(!name_rec_buf || !prev_name)
+    {
+        free(name_rec_buf);
+        free(prev_name);
         return(-1);
+    }
     memset(name_rec_buf, 0, name_rec_buf_sz);
+    prev_name[0] = '\0';
 
     do
     {
@@ -687,14 +750,41 @@ int darshan_log_get_filtered_namehash(darshan_fd fd,
         {
             fprintf(stderr, "Error: failed to read name hash from darshan log file.\n");
             free(name_rec_buf);
+            free(prev_name);
             return(-1);
         }
         buf_len += read;
 
-        /* extract any name records in the buffer */
-        //buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag, hash);
-        //buf_processed = state->get_filtered_namerecs(name_rec_buf, buf_len, fd->swap_flag, hash);
-        buf_processed = darshan_log_get_filtered_namerecs(name_rec_buf, buf_len, fd->swap_flag, hash, whitelist, whitelist_count);
+        /* extract any name records in the buffer, keeping only those
+         * that are in the whitelist
+         */
+        chunk_hash = NULL;
+        buf_processed = state->get_namerecs(name_rec_buf, buf_len, fd->swap_flag,
+            prev_name, &chunk_hash);
+        HASH_ITER(hlink, chunk_hash, ref, tmp_ref)
+        {
+            HASH_DELETE(hlink, chunk_hash, ref);
+            HASH_FIND(hlink, *hash, &(ref->name_record->id),
+                sizeof(darshan_record_id), old_ref);
+            if(!old_ref && whitelist_filter(ref->name_record->id, whitelist,
+                whitelist_count))
+            {
+                HASH_ADD(hlink, *hash, name_record->id,
+                    sizeof(darshan_record_id), ref);
+            }
+            else
+            {
+                free(ref->name_record);
+                free(ref);
+            }
+        }
+        if(buf_processed < 0)
+        {
+            fprintf(stderr, "Error: failed to parse name hash from darshan log file.\n");
+            free(name_rec_buf);
+            free(prev_name);
+            return(-1);
+        }
 
         /* copy any leftover data to beginning of buffer to parse next */
         memcpy(name_rec_buf, name_rec_buf + buf_processed, buf_len - buf_processed);
@@ -707,6 +797,7 @@ int darshan_log_get_filtered_namehash(darshan_fd fd,
     assert(buf_len == 0);
 
     free(name_rec_buf);
+    free(prev_name);
     return(0);
 }
 
@@ -728,7 +819,12 @@ int darshan_log_put_namehash(darshan_fd fd, struct darshan_name_record_ref *hash
 {
     struct darshan_fd_int_state *state;
     struct darshan_name_record_ref *ref, *tmp;
-    struct darshan_name_record *name_rec;
+    struct darshan_fc_name_record *fc_rec, *tmp_rec;
+    char *prev_name;
+    char *name;
+    int fc_rec_sz;
+    int name_len;
+    int prefix_len;
     int name_rec_len;
     int wrote;
 
@@ -740,31 +836,73 @@ int darshan_log_put_namehash(darshan_fd fd, struct darshan_name_record_ref *hash
     state = fd->state;
     assert(state);
 
-    /* allocate memory for largest possible hash record */
-    name_rec = malloc(sizeof(darshan_record_id) + PATH_MAX + 1);
-    if(!name_rec)
+    /* allocate memory for a typical front coded hash record, growing it
+     * later if needed
+     */
+    fc_rec_sz = DARSHAN_FC_NAME_RECORD_SIZE(PATH_MAX);
+    fc_rec = malloc(fc_rec_sz);
+    prev_name = malloc(PATH_MAX);
+    if(!fc_rec || !prev_name)
+    {
+        free(fc_rec);
+        free(prev_name);
         return(-1);
-    memset(name_rec, 0, sizeof(darshan_record_id) + PATH_MAX + 1);
+    }
+    memset(fc_rec, 0, fc_rec_sz);
+    prev_name[0] = '\0';
 
-    /* individually serialize each hash record and write to log file */
+    /* individually serialize each hash record and write to log file, front
+     * coding each name against the one written before it
+     */
     HASH_ITER(hlink, hash, ref, tmp)
     {
-        name_rec_len = sizeof(darshan_record_id) + strlen(ref->name_record->name) + 1;
-        memcpy(name_rec, ref->name_record, name_rec_len);
+        name = ref->name_record->name;
+        name_len = strlen(name);
+        prefix_len = 0;
+        if(name_len < PATH_MAX)
+        {
+            while(prev_name[prefix_len] && prev_name[prefix_len] == name[prefix_len])
+                prefix_len++;
+        }
+
+        name_rec_len = DARSHAN_FC_NAME_RECORD_SIZE(name_len - prefix_len);
+        if(name_rec_len > fc_rec_sz)
+        {
+            tmp_rec = realloc(fc_rec, name_rec_len);
+            if(!tmp_rec)
+            {
+                free(fc_rec);
+                free(prev_name);
+                return(-1);
+            }
+            fc_rec = tmp_rec;
+            fc_rec_sz = name_rec_len;
+        }
+        fc_rec->id = ref->name_record->id;
+        fc_rec->prefix_len = prefix_len;
+        strcpy(fc_rec->suffix, name + prefix_len);
+
+        /* names too long to keep are never used as a prefix */
+        if(name_len < PATH_MAX)
+            strcpy(prev_name + prefix_len, name + prefix_len);
+        else
+            prev_name[0] = '\0';
 
         /* write this hash entry to log file */
         wrote = darshan_log_dzwrite(fd, DARSHAN_NAME_MAP_REGION_ID,
-            name_rec, name_rec_len);
+            fc_rec, name_rec_len);
         if(wrote != name_rec_len)
         {
             state->err = -1;
             fprintf(stderr, "Error: failed to write name hash to darshan log file.\n");
-            free(name_rec);
+            free(fc_rec);
+            free(prev_name);
             return(-1);
         }
     }
 
-    free(name_rec);
+    free(fc_rec);
+    free(prev_name);
     return(0);
 }
 
@@ -821,6 +959,425 @@ int darshan_log_get_mod(darshan_fd fd, darshan_module_id mod_id,
     return(ret);
 }
 
+/* darshan_log_get_sparse_rec()
+ *
+ * get the next sparse encoded record of a module from the darshan log file
+ * (see darshan-log-format.h), decoding it into 'rec_buf' as a base record
+ * followed by 'counter_cnt' int64_t counters and 'fcounter_cnt' double
+ * counters. The decoded record is left in the byte order of the log file,
+ * just as if it had been stored as is.
+ *
+ * returns size of the decoded record on success, 0 if there are no more
+ * records, -1 on failure
+ */
+int darshan_log_get_sparse_rec(darshan_fd fd, darshan_module_id mod_id,
+    void *rec_buf, int counter_cnt, int fcounter_cnt)
+{
+    struct darshan_fd_int_state *state;
+    int field_cnt = counter_cnt + fcounter_cnt;
+    int bitmap_sz = DARSHAN_SPARSE_BITMAP_SIZE(field_cnt);
+    int max_len = DARSHAN_SPARSE_REC_MAX_SIZE(counter_cnt, fcounter_cnt) -
+        DARSHAN_SPARSE_REC_HDR_SIZE;
+    unsigned char *p, *end;
+    unsigned char byte;
+    int64_t *fields;
+    uint64_t val;
+    uint32_t len;
+    int shift;
+    int ret;
+    int i;
+
+    if(!fd)
+    {
+        fprintf(stderr, "Error: invalid Darshan log file handle.\n");
+        return(-1);
+    }
+    state = fd->state;
+    assert(state);
+
+    ret = darshan_log_get_mod(fd, mod_id, rec_buf,
+        sizeof(struct darshan_base_record));
+    if(ret <= 0)
+        return(ret);
+    if(ret == sizeof(struct darshan_base_record))
+        ret = darshan_log_get_mod(fd, mod_id, &len, sizeof(len));
+    if(ret != sizeof(len))
+        goto corrupt;
+    if(fd->swap_flag)
+        DARSHAN_BSWAP32(&len);
+    if(len < bitmap_sz || len > max_len)
+        goto corrupt;
+
+    if(state->sparse_buf_sz < len)
+    {
+        p = realloc(state->sparse_buf, len);
+        if(!p)
+        {
+            fprintf(stderr, "Error: unable to allocate sparse record buffer.\n");
+            return(-1);
+        }
+        state->sparse_buf = p;
+        state->sparse_buf_sz = len;
+    }
+    ret = darshan_log_get_mod(fd, mod_id, state->sparse_buf, len);
+    if(ret != len)
+        goto corrupt;
+
+    fields = (int64_t *)((char *)rec_buf + sizeof(struct darshan_base_record));
+    memset(fields, 0, field_cnt * sizeof(int64_t));
+    p = state->sparse_buf + bitmap_sz;
+    end = state->sparse_buf + len;
+    for(i = 0; i < field_cnt; i++)
+    {
+        if(!(state->sparse_buf[i / 8] & (1 << (i % 8))))
+            continue;
+
+        if(i < counter_cnt)
+        {
+            val = 0;
+            shift = 0;
+            do
+            {
+                if(p == end || shift > 63)
+                    goto corrupt;
+                byte = *p++;
+                val |= (uint64_t)(byte & 0x7f) << shift;
+                shift += 7;
+            } while(byte & 0x80);
+
+            /* undo the zig-zag encoding */
+            fields[i] = (int64_t)((val >> 1) ^ (~(val & 1) + 1));
+            if(fd->swap_flag)
+                DARSHAN_BSWAP64(&fields[i]);
+        }
+        else
+        {
+            if(end - p < sizeof(double))
+                goto corrupt;
+            memcpy(&fields[i], p, sizeof(double));
+            p += sizeof(double);
+        }
+    }
+    if(p != end)
+        goto corrupt;
+
+    return(sizeof(struct darshan_base_record) + field_cnt * sizeof(int64_t));
+
+corrupt:
+    fprintf(stderr, "Error: invalid sparse encoded %s module record.\n",
+        darshan_module_names[mod_id]);
+    return(-1);
+}
+
+/* read in the columns of the next process's records of a module stored
+ * in columns, made of 'field_cnt' 8-byte fields each; if 'field' is not
+ * negative, only the id, rank, and 'field' columns are kept, in that order
+ */
+static int darshan_log_get_mod_columns(darshan_fd fd,
+    darshan_module_id mod_id, int field_cnt, int field)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    uint64_t rec_cnt;
+    uint64_t buf_cnt;
+    uint64_t *col;
+    int col_sz;
+    int ret;
+    int i;
+
+    state->col_rec_cnt = state->col_rec_idx = 0;
+    ret = darshan_log_get_mod(fd, mod_id, &rec_cnt, sizeof(rec_cnt));
+    if(ret <= 0)
+        return(ret);
+    if(ret != sizeof(rec_cnt))
+        goto corrupt;
+    if(fd->swap_flag)
+        DARSHAN_BSWAP64(&rec_cnt);
+    if(rec_cnt == 0 || rec_cnt > INT_MAX / sizeof(uint64_t))
+        goto corrupt;
+    col_sz = rec_cnt * sizeof(uint64_t);
+
+    /* columns that are not kept are read into a scratch column at the end */
+    buf_cnt = rec_cnt * ((field < 0) ? field_cnt : 4);
+    if(state->col_buf_sz < buf_cnt)
+    {
+        col = realloc(state->col_buf, buf_cnt * sizeof(uint64_t));
+        if(!col)
+        {
+            fprintf(stderr, "Error: unable to allocate record column buffer.\n");
+            return(-1);
+        }
+        state->col_buf = col;
+        state->col_buf_sz = buf_cnt;
+    }
+
+    for(i = 0; i < field_cnt; i++)
+    {
+        if(field < 0 || i < 2)
+            col = state->col_buf + (i * rec_cnt);
+        else if(i == field)
+            col = state->col_buf + (2 * rec_cnt);
+        else
+            col = state->col_buf + (3 * rec_cnt);
+        ret = darshan_log_get_mod(fd, mod_id, col, col_sz);
+        if(ret != col_sz)
+            goto corrupt;
+    }
+    state->col_rec_cnt = rec_cnt;
+
+    return(1);
+
+corrupt:
+    fprintf(stderr, "Error: corrupt %s module record columns.\n",
+        darshan_module_names[mod_id]);
+    return(-1);
+}
+
+/* get the number of counters and fcounters following the base record of a
+ * module's records, for modules whose records are laid out that way
+ */
+static int darshan_log_get_rec_layout(darshan_module_id mod_id,
+    int *counter_cnt, int *fcounter_cnt)
+{
+    switch(mod_id)
+    {
+        case DARSHAN_POSIX_MOD:
+            *counter_cnt = POSIX_NUM_INDICES;
+            *fcounter_cnt = POSIX_F_NUM_INDICES;
+            break;
+        case DARSHAN_MPIIO_MOD:
+            *counter_cnt = MPIIO_NUM_INDICES;
+            *fcounter_cnt = MPIIO_F_NUM_INDICES;
+            break;
+        case DARSHAN_H5F_MOD:
+            *counter_cnt = H5F_NUM_INDICES;
+            *fcounter_cnt = H5F_F_NUM_INDICES;
+            break;
+        case DARSHAN_PNETCDF_MOD:
+            *counter_cnt = PNETCDF_NUM_INDICES;
+            *fcounter_cnt = PNETCDF_F_NUM_INDICES;
+            break;
+        case DARSHAN_STDIO_MOD:
+            *counter_cnt = STDIO_NUM_INDICES;
+            *fcounter_cnt = STDIO_F_NUM_INDICES;
+            break;
+        default:
+            return(-1);
+    }
+
+    return(0);
+}
+
+/* darshan_log_get_columnar_rec()
+ *
+ * get the next record of a module whose records are stored in columns in
+ * the darshan log file (see darshan-log-format.h), as a base record
+ * followed by 'counter_cnt' int64_t counters and 'fcounter_cnt' double
+ * counters. The record is left in the byte order of the log file, just as
+ * if it had been stored as is.
+ *
+ * returns size of the record on success, 0 if there are no more records,
+ * -1 on failure
+ */
+int darshan_log_get_columnar_rec(darshan_fd fd, darshan_module_id mod_id,
+    void *rec_buf, int counter_cnt, int fcounter_cnt)
+{
+    struct darshan_fd_int_state *state;
+    int field_cnt = DARSHAN_COLUMNAR_FIELD_CNT(counter_cnt, fcounter_cnt);
+    uint64_t *fields = (uint64_t *)rec_buf;
+    uint64_t *col;
+    int i;
+
+    if(!fd)
+    {
+        fprintf(stderr, "Error: invalid Darshan log file handle.\n");
+        return(-1);
+    }
+    state = fd->state;
+    assert(state);
+
+    /* read in the columns of the next process's records once we are
+     * through with the last one's
+     */
+    if(state->col_rec_idx == state->col_rec_cnt)
+    {
+        if(darshan_log_get_mod_columns(fd, mod_id, field_cnt, -1) < 0)
+            return(-1);
+        if(state->col_rec_cnt == 0)
+            return(0);
+    }
+
+    col = state->col_buf + state->col_rec_idx;
+    for(i = 0; i < field_cnt; i++)
+    {
+        fields[i] = *col;
+        col += state->col_rec_cnt;
+    }
+    state->col_rec_idx++;
+
+    return(field_cnt * sizeof(uint64_t));
+}
+
+/* darshan_log_get_mod_column()
+ *
+ * get counter 'counter' of every record of a module, or fcounter 'counter'
+ * if 'fcounter_flag' is set, along with the id and rank of each record if
+ * 'ids' and 'ranks' are given. The values are returned in the host's byte
+ * order, in arrays allocated with malloc() that the caller must free:
+ * int64_t values for counters and double values for fcounters. If the
+ * module's records are stored in columns, only the requested columns are
+ * read out of the log; otherwise, every record is read. Only modules whose
+ * records are made of a base record, int64_t counters, and double counters
+ * are supported. Reading of the module's records is restarted from the
+ * first record afterwards.
+ *
+ * returns the number of records on success, -1 on failure
+ */
+int darshan_log_get_mod_column(darshan_fd fd, darshan_module_id mod_id,
+    int counter, int fcounter_flag, darshan_record_id **ids,
+    int64_t **ranks, void **values)
+{
+    struct darshan_fd_int_state *state;
+    struct darshan_base_record *base_rec;
+    int counter_cnt, fcounter_cnt;
+    int field_cnt;
+    int field;
+    char *rec_buf = NULL;
+    uint64_t *fields;
+    uint64_t *out[3] = {NULL};
+    int64_t rec_cnt = 0;
+    int64_t max_cnt = 0;
+    uint64_t *tmp;
+    int ret = -1;
+    int64_t i;
+    int j;
+
+    if(!fd)
+    {
+        fprintf(stderr, "Error: invalid Darshan log file handle.\n");
+        return(-1);
+    }
+    state = fd->state;
+    assert(state);
+
+    if(mod_id < 0 || mod_id >= DARSHAN_MAX_MODS ||
+       darshan_log_get_rec_layout(mod_id, &counter_cnt, &fcounter_cnt) < 0)
+    {
+        fprintf(stderr, "Error: counter columns not supported for this module.\n");
+        return(-1);
+    }
+    if(counter < 0 ||
+       counter >= (fcounter_flag ? fcounter_cnt : counter_cnt))
+    {
+        fprintf(stderr, "Error: invalid counter index.\n");
+        return(-1);
+    }
+    field_cnt = DARSHAN_COLUMNAR_FIELD_CNT(counter_cnt, fcounter_cnt);
+    field = 2 + counter + (fcounter_flag ? counter_cnt : 0);
+
+    /* read the module's records from the start */
+    state->dz.prev_reg_id = DARSHAN_HEADER_REGION_ID;
+
+    if(DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, mod_id) &&
+       fd->mod_ver[mod_id] == darshan_module_versions[mod_id])
+    {
+        /* pick out the requested columns of each process's records */
+        while(1)
+        {
+            if(darshan_log_get_mod_columns(fd, mod_id, field_cnt, field) < 0)
+                goto exit;
+            if(state->col_rec_cnt == 0)
+                break;
+
+            if(rec_cnt + state->col_rec_cnt > max_cnt)
+            {
+                max_cnt = (rec_cnt + state->col_rec_cnt) * 2;
+                for(j = 0; j < 3; j++)
+                {
+                    tmp = realloc(out[j], max_cnt * sizeof(uint64_t));
+                    if(!tmp)
+                        goto exit;
+                    out[j] = tmp;
+                }
+            }
+            memcpy(&out[0][rec_cnt], state->col_buf,
+                state->col_rec_cnt * sizeof(uint64_t));
+            memcpy(&out[1][rec_cnt], state->col_buf + state->col_rec_cnt,
+                state->col_rec_cnt * sizeof(uint64_t));
+            memcpy(&out[2][rec_cnt], state->col_buf + (2 * state->col_rec_cnt),
+                state->col_rec_cnt * sizeof(uint64_t));
+            rec_cnt += state->col_rec_cnt;
+            state->col_rec_idx = state->col_rec_cnt;
+        }
+
+        if(fd->swap_flag)
+        {
+            for(j = 0; j < 3; j++)
+                for(i = 0; i < rec_cnt; i++)
+                    DARSHAN_BSWAP64(&out[j][i]);
+        }
+    }
+    else
+    {
+        /* otherwise, go through the module's records one by one */
+        if(!mod_logutils[mod_id])
+            goto exit;
+        rec_buf = malloc(DEF_MOD_BUF_SIZE);
+        if(!rec_buf)
+            goto exit;
+        while(1)
+        {
+            ret = mod_logutils[mod_id]->log_get_record(fd, (void **)&rec_buf);
+            if(ret < 0)
+                goto exit;
+            if(ret == 0)
+                break;
+            ret = -1;
+
+            if(rec_cnt == max_cnt)
+            {
+                max_cnt = max_cnt ? max_cnt * 2 : 1024;
+                for(j = 0; j < 3; j++)
+                {
+                    tmp = realloc(out[j], max_cnt * sizeof(uint64_t));
+                    if(!tmp)
+                        goto exit;
+                    out[j] = tmp;
+                }
+            }
+            base_rec = (struct darshan_base_record *)rec_buf;
+            fields = (uint64_t *)rec_buf;
+            out[0][rec_cnt] = base_rec->id;
+            out[1][rec_cnt] = base_rec->rank;
+            out[2][rec_cnt] = fields[field];
+            rec_cnt++;
+        }
+    }
+
+    if(ids)
+    {
+        *ids = (darshan_record_id *)out[0];
+        out[0] = NULL;
+    }
+    if(ranks)
+    {
+        *ranks = (int64_t *)out[1];
+        out[1] = NULL;
+    }
+    *values = out[2];
+    out[2] = NULL;
+    if(*values == NULL)
+        *values = malloc(1);
+    ret = (*values) ? rec_cnt : -1;
+
+exit:
+    for(j = 0; j < 3; j++)
+        free(out[j]);
+    free(rec_buf);
+    /* leave the module to be read again from the start */
+    state->dz.prev_reg_id = DARSHAN_HEADER_REGION_ID;
+    return(ret);
+}
+
 /* darshan_log_put_mod()
  *
  * write a chunk of module data to the darshan log file
@@ -905,6 +1462,12 @@ void darshan_log_close(darshan_fd fd)
                 if(ret == 0)
                     break;
 #endif 
+#ifdef HAVE_LIBZSTD
+            case DARSHAN_ZSTD_COMP:
+                ret = darshan_log_zstd_flush(fd, state->dz.prev_reg_id);
+                if(ret == 0)
+                    break;
+#endif
             default:
                 /* if flush fails, remove the output log file */
                 state->err = -1;
@@ -934,6 +1497,8 @@ void darshan_log_close(darshan_fd fd)
     darshan_log_dzdestroy(fd);
     if(state->exe_mnt_data)
         free(state->exe_mnt_data);
+    free(state->sparse_buf);
+    free(state->col_buf);
     free(state);
     free(fd);
 
@@ -957,177 +1522,176 @@ char *darshan_log_get_lib_version(void)
     return darshan_util_lib_ver;
 }
 
-/********************************************************
- *             internal helper functions                *
- ********************************************************/
-
-static int darshan_mnt_info_cmp(const void *a, const void *b)
+/* sum each run of 'factor' adjacent activity bins into a single bin */
+static void darshan_log_rescale_activity_bins(int64_t *bins, int64_t factor)
 {
-    struct darshan_mnt_info *m_a = (struct darshan_mnt_info *)a;
-    struct darshan_mnt_info *m_b = (struct darshan_mnt_info *)b;
-
-    if(strlen(m_a->mnt_path) > strlen(m_b->mnt_path))
-        return(-1);
-    else if(strlen(m_a->mnt_path) < strlen(m_b->mnt_path))
-        return(1);
-    else
-        return(0);
-}
+    int64_t sum;
+    int i, j;
 
-static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash)
-{
-    struct darshan_name_record_ref *ref;
-    struct darshan_name_record *name_rec;
-    char *tmp_p;
-    int buf_processed = 0;
-    int rec_len;
+    if(factor > DARSHAN_ACTIVITY_BINS)
+        factor = DARSHAN_ACTIVITY_BINS;
 
-    /* work through the name record buffer -- deserialize the record data
-     * and add to the output hash table
-     * NOTE: these mapping pairs are variable in length, so we have to be able
-     * to handle incomplete mappings temporarily here
-     */
-    name_rec = (struct darshan_name_record *)name_rec_buf;
-    while(buf_len > sizeof(darshan_record_id) + 1)
+    for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
     {
-        if(strnlen(name_rec->name, buf_len - sizeof(darshan_record_id)) ==
-            (buf_len - sizeof(darshan_record_id)))
-        {
-            /* if this record name's terminating null character is not
-             * present, we need to read more of the buffer before continuing
-             */
-            break;
-        }
-        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+        sum = 0;
+        for(j = i * factor; j < (i + 1) * factor && j < DARSHAN_ACTIVITY_BINS; j++)
+            sum += bins[j];
+        bins[i] = sum;
+    }
 
-        if(swap_flag)
-        {
-            /* we need to sort out endianness issues before deserializing */
-            DARSHAN_BSWAP64(&(name_rec->id));
-        }
+    return;
+}
 
-        HASH_FIND(hlink, *hash, &(name_rec->id), sizeof(darshan_record_id), ref);
-        if(!ref)
-        {
-            ref = malloc(sizeof(*ref));
-            if(!ref)
-                return(-1);
+void darshan_log_agg_activity_bins(int64_t *agg_read_bins,
+    int64_t *agg_write_bins, double *agg_width, int64_t *read_bins,
+    int64_t *write_bins, double width)
+{
+    int64_t factor = 1;
+    int i;
 
-            ref->name_record = malloc(rec_len);
-            if(!ref->name_record)
-            {
-                free(ref);
-                return(-1);
-            }
+    /* bins of logs that predate activity bins are invalid (-1) */
+    if(width < 0 || *agg_width < 0)
+    {
+        for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
+            agg_read_bins[i] = agg_write_bins[i] = -1;
+        *agg_width = -1;
+        return;
+    }
 
-            /* copy the name record over from the hash buffer */
-            memcpy(ref->name_record, name_rec, rec_len);
+    /* a width of 0 denotes a record without any activity */
+    if(width == 0)
+        return;
+    if(*agg_width == 0)
+    {
+        memcpy(agg_read_bins, read_bins, DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        memcpy(agg_write_bins, write_bins, DARSHAN_ACTIVITY_BINS * sizeof(int64_t));
+        *agg_width = width;
+        return;
+    }
 
-            /* add this record to the hash */
-            HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
-        }
+    /* coarsen the finer set of bins to the width of the other */
+    if(width > *agg_width)
+    {
+        darshan_log_rescale_activity_bins(agg_read_bins,
+            (int64_t)(width / *agg_width + 0.5));
+        darshan_log_rescale_activity_bins(agg_write_bins,
+            (int64_t)(width / *agg_width + 0.5));
+        *agg_width = width;
+    }
+    else
+        factor = (int64_t)(*agg_width / width + 0.5);
+    if(factor > DARSHAN_ACTIVITY_BINS)
+        factor = DARSHAN_ACTIVITY_BINS;
 
-        tmp_p = (char *)name_rec + rec_len;
-        name_rec = (struct darshan_name_record *)tmp_p;
-        buf_len -= rec_len;
-        buf_processed += rec_len;
+    for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
+    {
+        agg_read_bins[i / factor] += read_bins[i];
+        agg_write_bins[i / factor] += write_bins[i];
     }
 
-    return(buf_processed);
+    return;
 }
 
+/********************************************************
+ *             internal helper functions                *
+ ********************************************************/
 
+static int darshan_mnt_info_cmp(const void *a, const void *b)
+{
+    struct darshan_mnt_info *m_a = (struct darshan_mnt_info *)a;
+    struct darshan_mnt_info *m_b = (struct darshan_mnt_info *)b;
 
-
-
-
-
-/* whitelist_filter
- *
- * A simple filter function, that tests if a provided value is in 
- *
- */
-int whitelist_filter(darshan_record_id val, darshan_record_id *whitelist, int whitelist_count){
-    int i;
-    for(i = 0; i < whitelist_count; i++)
-    {
-        if (whitelist[i] == val)
-        {
-            return 1;
-        }
-    }
-    return 0;
+    if(strlen(m_a->mnt_path) > strlen(m_b->mnt_path))
+        return(-1);
+    else if(strlen(m_a->mnt_path) < strlen(m_b->mnt_path))
+        return(1);
+    else
+        return(0);
 }
 
-/* darshan_log_get_filtered_namerecs
- *
- * Buffered reader to to reconstruct name records from logfile
- *
- */
-static int darshan_log_get_filtered_namerecs(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash,
-    darshan_record_id *whitelist, int whitelist_count
-    )
-// JL: would change interface to allow filter callback function instead of whitelist for more flexibility
+static int darshan_log_get_namerecs(void *name_rec_buf, int buf_len,
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
 {
     struct darshan_name_record_ref *ref;
-    struct darshan_name_record *name_rec;
+    struct darshan_fc_name_record *fc_rec;
+    char *name;
     char *tmp_p;
     int buf_processed = 0;
+    int suffix_len;
+    int name_len;
     int rec_len;
 
-    /* work through the name record buffer -- deserialize the record data
-     * and add to the output hash table
-     * NOTE: these mapping pairs are variable in length, so we have to be able
-     * to handle incomplete mappings temporarily here
+    /* work through the name record buffer -- decode each front coded
+     * record against the name in the record before it, and add it to
+     * the output hash table
+     * NOTE: these records are variable in length, so we have to be able
+     * to handle incomplete records temporarily here
      */
-    name_rec = (struct darshan_name_record *)name_rec_buf;
-    while(buf_len > sizeof(darshan_record_id) + 1)
+    fc_rec = (struct darshan_fc_name_record *)name_rec_buf;
+    while(buf_len > DARSHAN_FC_NAME_RECORD_HDR_SIZE)
     {
-        if(strnlen(name_rec->name, buf_len - sizeof(darshan_record_id)) ==
-            (buf_len - sizeof(darshan_record_id)))
+        suffix_len = strnlen(fc_rec->suffix,
+            buf_len - DARSHAN_FC_NAME_RECORD_HDR_SIZE);
+        if(suffix_len == (buf_len - DARSHAN_FC_NAME_RECORD_HDR_SIZE))
         {
-            /* if this record name's terminating null character is not
+            /* if this record suffix's terminating null character is not
              * present, we need to read more of the buffer before continuing
              */
             break;
         }
-        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+        rec_len = DARSHAN_FC_NAME_RECORD_SIZE(suffix_len);
 
         if(swap_flag)
         {
             /* we need to sort out endianness issues before deserializing */
-            DARSHAN_BSWAP64(&(name_rec->id));
+            DARSHAN_BSWAP64(&(fc_rec->id));
+            DARSHAN_BSWAP16(&(fc_rec->prefix_len));
         }
 
-        HASH_FIND(hlink, *hash, &(name_rec->id), sizeof(darshan_record_id), ref);
+        /* rebuild the full name of this record */
+        if(fc_rec->prefix_len > strlen(prev_name))
+            return(-1);
+        name_len = fc_rec->prefix_len + suffix_len;
+        if(name_len < PATH_MAX)
+        {
+            strcpy(prev_name + fc_rec->prefix_len, fc_rec->suffix);
+            name = prev_name;
+        }
+        else
+        {
+            /* names too long to keep are stored whole and never used
+             * as a prefix
+             */
+            if(fc_rec->prefix_len != 0)
+                return(-1);
+            prev_name[0] = '\0';
+            name = fc_rec->suffix;
+        }
 
-        if ( whitelist_filter(name_rec->id, whitelist, whitelist_count) ) {  
+        HASH_FIND(hlink, *hash, &(fc_rec->id), sizeof(darshan_record_id), ref);
+        if(!ref)
+        {
+            ref = malloc(sizeof(*ref));
             if(!ref)
-            {
-                ref = malloc(sizeof(*ref));
-                if(!ref)
-                    return(-1);
-
-                ref->name_record = malloc(rec_len);
-                if(!ref->name_record)
-                {
-                    free(ref);
-                    return(-1);
-                }
+                return(-1);
 
-                /* copy the name record over from the hash buffer */
-                memcpy(ref->name_record, name_rec, rec_len);
+            ref->name_record = malloc(sizeof(darshan_record_id) + name_len + 1);
+            if(!ref->name_record)
+            {
+                free(ref);
+                return(-1);
+            }
 
-                /* add this record to the hash */
+            /* copy the decoded name record over */
+            ref->name_record->id = fc_rec->id;
+            strcpy(ref->name_record->name, name);
 
-                    HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
-            }
+            /* add this record to the hash */
+            HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
         }
 
-        tmp_p = (char *)name_rec + rec_len;
-        name_rec = (struct darshan_name_record *)tmp_p;
+        tmp_p = (char *)fc_rec + rec_len;
+        fc_rec = (struct darshan_fc_name_record *)tmp_p;
         buf_len -= rec_len;
         buf_processed += rec_len;
     }
@@ -1135,6 +1699,24 @@ static int darshan_log_get_filtered_namerecs(void *name_rec_buf, int buf_len,
     return(buf_processed);
 }
 
+/* whitelist_filter
+ *
+ * A simple filter function, that tests if a provided value is in 
+ *
+ */
+int whitelist_filter(darshan_record_id val, darshan_record_id *whitelist, int whitelist_count){
+    int i;
+    for(i = 0; i < whitelist_count; i++)
+    {
+        if (whitelist[i] == val)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
 
 
 
@@ -1147,6 +1729,7 @@ static int darshan_log_get_filtered_namerecs(void *name_rec_buf, int buf_len,
 static int darshan_log_get_header(darshan_fd fd)
 {
     struct darshan_header header;
+    size_t header_size = sizeof(header);
     double log_ver_val;
     int i;
     int ret;
@@ -1173,7 +1756,16 @@ static int darshan_log_get_header(darshan_fd fd)
     }
     else if((strcmp(fd->version, "3.10") == 0) ||
             (strcmp(fd->version, "3.20") == 0) ||
-            (strcmp(fd->version, "3.21") == 0))
+            (strcmp(fd->version, "3.21") == 0) ||
+            (strcmp(fd->version, "3.22") == 0))
+    {
+        fd->state->get_namerecs = darshan_log_get_namerecs_3_22;
+    }
+    else if((strcmp(fd->version, "3.23") == 0) ||
+            (strcmp(fd->version, "3.24") == 0) ||
+            (strcmp(fd->version, "3.25") == 0) ||
+            (strcmp(fd->version, "3.26") == 0) ||
+            (strcmp(fd->version, "3.27") == 0))
     {
         fd->state->get_namerecs = darshan_log_get_namerecs;
     }
@@ -1193,9 +1785,27 @@ static int darshan_log_get_header(darshan_fd fd)
         return(-1);
     }
 
+    /* module memory usage was added to the header in version 3.22,
+     * module sampling periods in version 3.24, sparse record flags in
+     * version 3.25, columnar record flags in version 3.26, and common
+     * value estimate flags in version 3.27
+     */
+    log_ver_val = atof(fd->version);
+    if(log_ver_val < 3.22)
+        header_size = offsetof(struct darshan_header, mod_mem);
+    else if(log_ver_val < 3.24)
+        header_size = offsetof(struct darshan_header, mod_sample);
+    else if(log_ver_val < 3.25)
+        header_size = offsetof(struct darshan_header, sparse_flag);
+    else if(log_ver_val < 3.26)
+        header_size = offsetof(struct darshan_header, columnar_flag);
+    else if(log_ver_val < 3.27)
+        header_size = offsetof(struct darshan_header, estimate_flag);
+
     /* read uncompressed header from log file */
-    ret = darshan_log_read(fd, &header, sizeof(header));
-    if(ret != (int)sizeof(header))
+    memset(&header, 0, sizeof(header));
+    ret = darshan_log_read(fd, &header, header_size);
+    if(ret != (int)header_size)
     {
         fprintf(stderr, "Error: failed to read darshan log file header.\n");
         return(-1);
@@ -1222,7 +1832,12 @@ static int darshan_log_get_header(darshan_fd fd)
                 DARSHAN_BSWAP64(&(header.mod_map[i].off));
                 DARSHAN_BSWAP64(&(header.mod_map[i].len));
                 DARSHAN_BSWAP32(&(header.mod_ver[i]));
+                DARSHAN_BSWAP64(&(header.mod_mem[i]));
+                DARSHAN_BSWAP32(&(header.mod_sample[i]));
             }
+            DARSHAN_BSWAP32(&(header.sparse_flag));
+            DARSHAN_BSWAP32(&(header.columnar_flag));
+            DARSHAN_BSWAP32(&(header.estimate_flag));
         }
         else
         {
@@ -1236,12 +1851,16 @@ static int darshan_log_get_header(darshan_fd fd)
     fd->comp_type = header.comp_type;
     fd->partial_flag = header.partial_flag;
     memcpy(fd->mod_ver, header.mod_ver, DARSHAN_MAX_MODS * sizeof(uint32_t));
+    memcpy(fd->mod_mem, header.mod_mem, DARSHAN_MAX_MODS * sizeof(uint64_t));
+    memcpy(fd->mod_sample, header.mod_sample, DARSHAN_MAX_MODS * sizeof(uint32_t));
+    fd->sparse_flag = header.sparse_flag;
+    fd->columnar_flag = header.columnar_flag;
+    fd->estimate_flag = header.estimate_flag;
 
     /* save the mapping of data within log file to this file descriptor */
     memcpy(&fd->name_map, &(header.name_map), sizeof(struct darshan_log_map));
     memcpy(&fd->mod_map, &(header.mod_map), DARSHAN_MAX_MODS * sizeof(struct darshan_log_map));
 
-    log_ver_val = atof(fd->version);
     if(log_ver_val < 3.2)
     {
         /* perform module index shift to account for H5D module from 3.2.0 */
@@ -1254,7 +1873,7 @@ static int darshan_log_get_header(darshan_fd fd)
     }
 
     /* there may be nothing following the job data, so safety check map */
-    fd->job_map.off = sizeof(struct darshan_header);
+    fd->job_map.off = header_size;
     if(fd->name_map.off == 0)
     {
         for(i = 0; i < DARSHAN_MAX_MODS; i++)
@@ -1309,6 +1928,9 @@ static int darshan_log_put_header(darshan_fd fd)
     memcpy(&header.name_map, &fd->name_map, sizeof(struct darshan_log_map));
     memcpy(header.mod_map, fd->mod_map, DARSHAN_MAX_MODS * sizeof(struct darshan_log_map));
     memcpy(header.mod_ver, fd->mod_ver, DARSHAN_MAX_MODS * sizeof(uint32_t));
+    memcpy(header.mod_mem, fd->mod_mem, DARSHAN_MAX_MODS * sizeof(uint64_t));
+    memcpy(header.mod_sample, fd->mod_sample, DARSHAN_MAX_MODS * sizeof(uint32_t));
+    header.estimate_flag = fd->estimate_flag;
 
     /* write header to file */
     ret = darshan_log_write(fd, &header, sizeof(header));
@@ -1473,6 +2095,52 @@ static int darshan_log_dzinit(darshan_fd fd)
             state->dz.comp_dat = tmp_bzstrm;
             break;
         }
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+        {
+            struct darshan_zstd_state *tmp_zstd = malloc(sizeof(*tmp_zstd));
+            if(!tmp_zstd)
+            {
+                free(state->dz.buf);
+                return(-1);
+            }
+            memset(tmp_zstd, 0, sizeof(*tmp_zstd));
+
+            if(!(state->creat_flag))
+            {
+                /* read only file, init decompression stream */
+                tmp_zstd->dstrm = ZSTD_createDStream();
+                ret = (tmp_zstd->dstrm != NULL);
+            }
+            else
+            {
+                /* write only file, init compression stream */
+                tmp_zstd->cstrm = ZSTD_createCStream();
+                ret = (tmp_zstd->cstrm != NULL) && !ZSTD_isError(
+                    ZSTD_CCtx_setParameter(tmp_zstd->cstrm,
+                    ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT));
+                tmp_zstd->out.dst = state->dz.buf;
+                tmp_zstd->out.size = DARSHAN_DEF_COMP_BUF_SZ;
+                tmp_zstd->out.pos = 0;
+            }
+            if(!ret)
+            {
+                ZSTD_freeDStream(tmp_zstd->dstrm);
+                ZSTD_freeCStream(tmp_zstd->cstrm);
+                free(tmp_zstd);
+                free(state->dz.buf);
+                return(-1);
+            }
+            state->dz.comp_dat = tmp_zstd;
+            break;
+        }
+#else
+        case DARSHAN_ZSTD_COMP:
+            fprintf(stderr, "Error: darshan-util was built without "
+                "zstd compression support.\n");
+            free(state->dz.buf);
+            return(-1);
 #endif
         case DARSHAN_NO_COMP:
         {
@@ -1509,6 +2177,16 @@ static void darshan_log_dzdestroy(darshan_fd fd)
             else
                 BZ2_bzCompressEnd((bz_stream *)state->dz.comp_dat);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+        {
+            struct darshan_zstd_state *zstd_statep =
+                (struct darshan_zstd_state *)state->dz.comp_dat;
+            ZSTD_freeDStream(zstd_statep->dstrm);
+            ZSTD_freeCStream(zstd_statep->cstrm);
+            break;
+        }
 #endif
         case DARSHAN_NO_COMP:
             /* do nothing */
@@ -1534,7 +2212,9 @@ static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
     {
         state->dz.eor = 0;
         state->dz.size = 0;
-        reset_strm_flag = 1; /* reset libz/bzip2 streams */
+        reset_strm_flag = 1; /* reset libz/bzip2/zstd streams */
+        /* drop columns read from the previous region */
+        state->col_rec_cnt = state->col_rec_idx = 0;
     }
 
     if(region_id == DARSHAN_JOB_REGION_ID)
@@ -1553,6 +2233,11 @@ static int darshan_log_dzread(darshan_fd fd, int region_id, void *buf, int len)
         case DARSHAN_BZIP2_COMP:
             ret = darshan_log_bzip2_read(fd, map, buf, len, reset_strm_flag);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            ret = darshan_log_zstd_read(fd, map, buf, len, reset_strm_flag);
+            break;
 #endif
         case DARSHAN_NO_COMP:
             ret = darshan_log_noz_read(fd, map, buf, len, reset_strm_flag);
@@ -1602,6 +2287,11 @@ static int darshan_log_dzwrite(darshan_fd fd, int region_id, void *buf, int len)
         case DARSHAN_BZIP2_COMP:
             ret = darshan_log_bzip2_write(fd, map_p, buf, len, flush_strm_flag);
             break;
+#endif
+#ifdef HAVE_LIBZSTD
+        case DARSHAN_ZSTD_COMP:
+            ret = darshan_log_zstd_write(fd, map_p, buf, len, flush_strm_flag);
+            break;
 #endif
         case DARSHAN_NO_COMP:
             fprintf(stderr,
@@ -1944,6 +2634,163 @@ static int darshan_log_bzip2_flush(darshan_fd fd, int region_id)
 }
 #endif
 
+#ifdef HAVE_LIBZSTD
+static int darshan_log_zstd_read(darshan_fd fd, struct darshan_log_map map,
+    void *buf, int len, int reset_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_zstd_state *zstd_statep =
+        (struct darshan_zstd_state *)state->dz.comp_dat;
+
+    assert(zstd_statep);
+
+    if(reset_strm_flag)
+    {
+        zstd_statep->in.size = 0;
+        zstd_statep->in.pos = 0;
+        zstd_statep->out_pending = 0;
+        ZSTD_DCtx_reset(zstd_statep->dstrm, ZSTD_reset_session_only);
+    }
+
+    zstd_statep->out.dst = buf;
+    zstd_statep->out.size = len;
+    zstd_statep->out.pos = 0;
+
+    /* we just decompress until the output buffer is full, assuming there
+     * is enough compressed data in file to satisfy the request size. zstd
+     * moves on to the next frame of a region on its own.
+     */
+    while(zstd_statep->out.pos < zstd_statep->out.size)
+    {
+        /* check if we need more compressed data */
+        if(zstd_statep->in.pos == zstd_statep->in.size &&
+            !zstd_statep->out_pending)
+        {
+            /* if the eor flag is set, clear it and return -- future
+             * reads of this log region will restart at the beginning
+             */
+            if(state->dz.eor)
+            {
+                state->dz.eor = 0;
+                break;
+            }
+
+            /* read more data from input file */
+            if(darshan_log_dzload(fd, map) < 0)
+                return(-1);
+            assert(state->dz.size > 0);
+
+            zstd_statep->in.src = state->dz.buf;
+            zstd_statep->in.size = state->dz.size;
+            zstd_statep->in.pos = 0;
+        }
+
+        ret = ZSTD_decompressStream(zstd_statep->dstrm, &zstd_statep->out,
+            &zstd_statep->in);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to decompress darshan log data.\n");
+            return(-1);
+        }
+        zstd_statep->out_pending =
+            (zstd_statep->out.pos == zstd_statep->out.size);
+    }
+
+    return(zstd_statep->out.pos);
+}
+
+static int darshan_log_zstd_write(darshan_fd fd, struct darshan_log_map *map_p,
+    void *buf, int len, int flush_strm_flag)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_zstd_state *zstd_statep =
+        (struct darshan_zstd_state *)state->dz.comp_dat;
+
+    assert(zstd_statep);
+
+    /* flush compressed output buffer if we are moving to a new log region */
+    if(flush_strm_flag)
+    {
+        if(darshan_log_zstd_flush(fd, state->dz.prev_reg_id) < 0)
+            return(-1);
+    }
+
+    zstd_statep->in.src = buf;
+    zstd_statep->in.size = len;
+    zstd_statep->in.pos = 0;
+
+    /* compress input data until none left */
+    while(zstd_statep->in.pos < zstd_statep->in.size)
+    {
+        /* if we are out of output, flush to log file */
+        if(zstd_statep->out.pos == zstd_statep->out.size)
+        {
+            state->dz.size = zstd_statep->out.pos;
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+            zstd_statep->out.pos = 0;
+        }
+
+        ret = ZSTD_compressStream2(zstd_statep->cstrm, &zstd_statep->out,
+            &zstd_statep->in, ZSTD_e_continue);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = zstd_statep->out.pos;
+    }
+
+    return(zstd_statep->in.pos);
+}
+
+static int darshan_log_zstd_flush(darshan_fd fd, int region_id)
+{
+    struct darshan_fd_int_state *state = fd->state;
+    size_t ret;
+    struct darshan_log_map *map_p;
+    struct darshan_zstd_state *zstd_statep =
+        (struct darshan_zstd_state *)state->dz.comp_dat;
+
+    assert(zstd_statep);
+
+    if(region_id == DARSHAN_JOB_REGION_ID)
+        map_p = &(fd->job_map);
+    else if(region_id == DARSHAN_NAME_MAP_REGION_ID)
+        map_p = &(fd->name_map);
+    else
+        map_p = &(fd->mod_map[region_id]);
+
+    /* make sure zstd finishes this frame; the next write starts a new one */
+    zstd_statep->in.src = NULL;
+    zstd_statep->in.size = 0;
+    zstd_statep->in.pos = 0;
+    do
+    {
+        ret = ZSTD_compressStream2(zstd_statep->cstrm, &zstd_statep->out,
+            &zstd_statep->in, ZSTD_e_end);
+        if(ZSTD_isError(ret))
+        {
+            fprintf(stderr, "Error: unable to compress darshan log data.\n");
+            return(-1);
+        }
+        state->dz.size = zstd_statep->out.pos;
+
+        if(state->dz.size)
+        {
+            /* flush to file */
+            if(darshan_log_dzunload(fd, map_p) < 0)
+                return(-1);
+            zstd_statep->out.pos = 0;
+        }
+    } while(ret != 0);
+
+    return(0);
+}
+#endif
+
 static int darshan_log_noz_read(darshan_fd fd, struct darshan_log_map map,
     void *buf, int len, int reset_strm_flag)
 {
@@ -2055,7 +2902,7 @@ static int darshan_log_dzunload(darshan_fd fd, struct darshan_log_map *map_p)
  ********************************************************/
 
 int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
-    int swap_flag, struct darshan_name_record_ref **hash)
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
 {
     struct darshan_name_record_ref *ref;
     char *buf_ptr;
@@ -2127,6 +2974,69 @@ int darshan_log_get_namerecs_3_00(void *name_rec_buf, int buf_len,
     return(buf_processed);
 }
 
+int darshan_log_get_namerecs_3_22(void *name_rec_buf, int buf_len,
+    int swap_flag, char *prev_name, struct darshan_name_record_ref **hash)
+{
+    struct darshan_name_record_ref *ref;
+    struct darshan_name_record *name_rec;
+    char *tmp_p;
+    int buf_processed = 0;
+    int rec_len;
+
+    /* work through the name record buffer -- deserialize the record data
+     * and add to the output hash table
+     * NOTE: these mapping pairs are variable in length, so we have to be able
+     * to handle incomplete mappings temporarily here
+     */
+    name_rec = (struct darshan_name_record *)name_rec_buf;
+    while(buf_len > sizeof(darshan_record_id) + 1)
+    {
+        if(strnlen(name_rec->name, buf_len - sizeof(darshan_record_id)) ==
+            (buf_len - sizeof(darshan_record_id)))
+        {
+            /* if this record name's terminating null character is not
+             * present, we need to read more of the buffer before continuing
+             */
+            break;
+        }
+        rec_len = sizeof(darshan_record_id) + strlen(name_rec->name) + 1;
+
+        if(swap_flag)
+        {
+            /* we need to sort out endianness issues before deserializing */
+            DARSHAN_BSWAP64(&(name_rec->id));
+        }
+
+        HASH_FIND(hlink, *hash, &(name_rec->id), sizeof(darshan_record_id), ref);
+        if(!ref)
+        {
+            ref = malloc(sizeof(*ref));
+            if(!ref)
+                return(-1);
+
+            ref->name_record = malloc(rec_len);
+            if(!ref->name_record)
+            {
+                free(ref);
+                return(-1);
+            }
+
+            /* copy the name record over from the hash buffer */
+            memcpy(ref->name_record, name_rec, rec_len);
+
+            /* add this record to the hash */
+            HASH_ADD(hlink, *hash, name_record->id, sizeof(darshan_record_id), ref);
+        }
+
+        tmp_p = (char *)name_rec + rec_len;
+        name_rec = (struct darshan_name_record *)tmp_p;
+        buf_len -= rec_len;
+        buf_processed += rec_len;
+    }
+
+    return(buf_processed);
+}
+
 /*
  * Support functions for use with other languages
  */
@@ -12,6 +12,9 @@
 #ifdef HAVE_LIBBZ2
 #include <bzlib.h>
 #endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
 
 #include "uthash-1.9.2/src/uthash.h"
 
@@ -43,6 +46,24 @@ struct darshan_fd_s
     struct darshan_log_map mod_map[DARSHAN_MAX_MODS];
     /* module-specific log-format versions contained in log */
     uint32_t mod_ver[DARSHAN_MAX_MODS];
+    /* runtime memory used for each module's records (max across
+     * processes), or 0 if not recorded in the log
+     */
+    uint64_t mod_mem[DARSHAN_MAX_MODS];
+    /* period N with which each module sampled operations (1 in N), or 0
+     * if the module did not sample
+     */
+    uint32_t mod_sample[DARSHAN_MAX_MODS];
+    /* flags for the modules whose records are sparse encoded in the log
+     * (decoded by the module's get_record function)
+     */
+    uint32_t sparse_flag;
+    /* flags for the modules whose records are stored in columns in the log
+     * (decoded by the module's get_record function)
+     */
+    uint32_t columnar_flag;
+    /* flags for the modules whose common value counts are estimates */
+    uint32_t estimate_flag;
 
     /* KEEP OUT -- remaining state hidden in logutils source */
     struct darshan_fd_int_state *state;
@@ -179,6 +200,13 @@ int darshan_log_get_mod(darshan_fd fd, darshan_module_id mod_id,
     void *mod_buf, int mod_buf_sz);
 int darshan_log_put_mod(darshan_fd fd, darshan_module_id mod_id,
     void *mod_buf, int mod_buf_sz, int ver);
+int darshan_log_get_sparse_rec(darshan_fd fd, darshan_module_id mod_id,
+    void *rec_buf, int counter_cnt, int fcounter_cnt);
+int darshan_log_get_columnar_rec(darshan_fd fd, darshan_module_id mod_id,
+    void *rec_buf, int counter_cnt, int fcounter_cnt);
+int darshan_log_get_mod_column(darshan_fd fd, darshan_module_id mod_id,
+    int counter, int fcounter_flag, darshan_record_id **ids,
+    int64_t **ranks, void **values);
 void darshan_log_close(darshan_fd file);
 void darshan_log_print_version_warnings(const char *version_string);
 char *darshan_log_get_lib_version(void);
@@ -188,6 +216,15 @@ void darshan_log_get_name_records(darshan_fd fd,
                               int* count);
 int darshan_log_get_record (darshan_fd fd, int mod_idx, void **buf);
 
+/* sums the activity bins 'read_bins'/'write_bins' of a record, 'width'
+ * seconds wide, into the bins 'agg_read_bins'/'agg_write_bins' of an
+ * aggregate record, '*agg_width' seconds wide, after coarsening the finer
+ * of the two to the width of the other
+ */
+void darshan_log_agg_activity_bins(int64_t *agg_read_bins,
+    int64_t *agg_write_bins, double *agg_width, int64_t *read_bins,
+    int64_t *write_bins, double width);
+
 void darshan_log_get_filtered_name_records(darshan_fd fd,
                               struct darshan_name_record_info **mods,
                               int* count,
@@ -263,5 +300,12 @@ void darshan_log_get_filtered_name_records(darshan_fd fd,
     __dst_char[3] = __src_char[0]; \
     memcpy(__ptr, __dst_char, 4); \
 } while(0)
+#define DARSHAN_BSWAP16(__ptr) do {\
+    char __dst_char[2]; \
+    char* __src_char = (char*)__ptr; \
+    __dst_char[0] = __src_char[1]; \
+    __dst_char[1] = __src_char[0]; \
+    memcpy(__ptr, __dst_char, 2); \
+} while(0)
 
 #endif
@@ -188,6 +188,9 @@ int main(int argc, char *argv[])
     int n_infiles;
     int shared_redux;
     int64_t job_end_time = 0;
+    int partial_flag = 0;
+    uint32_t merge_sample[DARSHAN_MAX_MODS] = {0};
+    uint32_t estimate_flag = 0;
     char *outlog_path;
     darshan_fd in_fd, merge_fd;
     struct darshan_job in_job, merge_job;
@@ -288,6 +291,23 @@ int main(int argc, char *argv[])
                 merge_job.end_time = in_job.end_time;
         }
 
+        /* modules that ran out of memory in any input log are incomplete
+         * in the output log
+         */
+        partial_flag |= in_fd->partial_flag;
+
+        /* likewise for modules with estimated common value counts */
+        estimate_flag |= in_fd->estimate_flag;
+
+        /* modules sampled in any input log have estimated counters in the
+         * output log, at the largest sampling period of the inputs
+         */
+        for(j = 0; j < DARSHAN_MAX_MODS; j++)
+        {
+            if(in_fd->mod_sample[j] > merge_sample[j])
+                merge_sample[j] = in_fd->mod_sample[j];
+        }
+
         /* read the hash of ids->names for the input log */
         ret = darshan_log_get_namehash(in_fd, &in_hash);
         if(ret < 0)
@@ -328,12 +348,14 @@ int main(int argc, char *argv[])
         merge_job.end_time = job_end_time;
 
     /* create the output "merged" log */
-    merge_fd = darshan_log_create(outlog_path, DARSHAN_ZLIB_COMP, 1);
+    merge_fd = darshan_log_create(outlog_path, DARSHAN_ZLIB_COMP, partial_flag);
     if(merge_fd == NULL)
     {
         fprintf(stderr, "Error: unable to create output darshan log.\n");
         return(-1);
     }
+    memcpy(merge_fd->mod_sample, merge_sample, sizeof(merge_sample));
+    merge_fd->estimate_flag = estimate_flag;
 
     /* write the darshan job info, exe string, and mount data to output file */
     ret = darshan_log_put_job(merge_fd, &merge_job);
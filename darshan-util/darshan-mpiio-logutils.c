@@ -31,6 +31,13 @@ char *mpiio_f_counter_names[] = {
 #undef X
 
 #define DARSHAN_MPIIO_FILE_SIZE_1 544
+#define DARSHAN_MPIIO_FILE_SIZE_3 560
+#define DARSHAN_MPIIO_FILE_SIZE_4 568
+
+/* first version of the module whose records may have been sparse encoded
+ * or stored in columns
+ */
+#define DARSHAN_MPIIO_ENC_VER 5
 
 static int darshan_log_get_mpiio_file(darshan_fd fd, void** mpiio_buf_p);
 static int darshan_log_put_mpiio_file(darshan_fd fd, void* mpiio_buf);
@@ -51,6 +58,34 @@ struct darshan_mod_logutil_funcs mpiio_logutils =
     .log_agg_records = &darshan_log_agg_mpiio_files
 };
 
+/* read the next MPIIO record, 'rec_len' bytes long in the layout of the
+ * version it was stored in. if the module's records were sparse encoded or
+ * stored in columns, it is decoded from that form assuming the stored
+ * version has 'counter_cnt' counters and 'fcounter_cnt' fcounters
+ */
+static int darshan_log_get_mpiio_rec(darshan_fd fd, void *buf, int rec_len,
+    int counter_cnt, int fcounter_cnt)
+{
+    int sparse = DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_MPIIO_MOD);
+    int columnar = DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_MPIIO_MOD);
+
+    if((sparse || columnar) && (counter_cnt == 0 || fcounter_cnt == 0))
+    {
+        fprintf(stderr, "Error: unable to decode MPIIO records of module "
+            "version %d\n", fd->mod_ver[DARSHAN_MPIIO_MOD]);
+        return(-1);
+    }
+
+    if(sparse)
+        return(darshan_log_get_sparse_rec(fd, DARSHAN_MPIIO_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else if(columnar)
+        return(darshan_log_get_columnar_rec(fd, DARSHAN_MPIIO_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else
+        return(darshan_log_get_mod(fd, DARSHAN_MPIIO_MOD, buf, rec_len));
+}
+
 static int darshan_log_get_mpiio_file(darshan_fd fd, void** mpiio_buf_p)
 {
     struct darshan_mpiio_file *file = *((struct darshan_mpiio_file **)mpiio_buf_p);
@@ -69,6 +104,19 @@ static int darshan_log_get_mpiio_file(darshan_fd fd, void** mpiio_buf_p)
         return(-1);
     }
 
+    /* only records stored as of DARSHAN_MPIIO_ENC_VER may have been sparse
+     * encoded or stored in columns. they are decoded into the layout of the
+     * version they were stored in, then upconverted like any other record
+     */
+    if((DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_MPIIO_MOD) ||
+        DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_MPIIO_MOD)) &&
+        fd->mod_ver[DARSHAN_MPIIO_MOD] < DARSHAN_MPIIO_ENC_VER)
+    {
+        fprintf(stderr, "Error: Invalid encoding of MPIIO module version %d "
+            "records\n", fd->mod_ver[DARSHAN_MPIIO_MOD]);
+        return(-1);
+    }
+
     if(*mpiio_buf_p == NULL)
     {
         file = malloc(sizeof(*file));
@@ -82,28 +130,72 @@ static int darshan_log_get_mpiio_file(darshan_fd fd, void** mpiio_buf_p)
          * translation of counters while reading
          */
         rec_len = sizeof(struct darshan_mpiio_file);
-        ret = darshan_log_get_mod(fd, DARSHAN_MPIIO_MOD, file, rec_len);
+        ret = darshan_log_get_mpiio_rec(fd, file, rec_len,
+            MPIIO_NUM_INDICES, MPIIO_F_NUM_INDICES);
     }
     else
     {
-        char scratch[1024] = {0};
+        char scratch[sizeof(struct darshan_mpiio_file)] = {0};
         char *src_p, *dest_p;
         int len;
 
-        rec_len = DARSHAN_MPIIO_FILE_SIZE_1;
-        ret = darshan_log_get_mod(fd, DARSHAN_MPIIO_MOD, scratch, rec_len);
-        if(ret != rec_len)
-            goto exit;
-
-        /* upconvert versions 1/2 to version 3 in-place */
-        dest_p = scratch + (sizeof(struct darshan_base_record) +
-            (51 * sizeof(int64_t)) + (5 * sizeof(double)));
-        src_p = dest_p - (2 * sizeof(double));
-        len = (12 * sizeof(double));
-        memmove(dest_p, src_p, len);
-        /* set F_CLOSE_START and F_OPEN_END to -1 */
-        *((double *)src_p) = -1;
-        *((double *)(src_p + sizeof(double))) = -1;
+        if(fd->mod_ver[DARSHAN_MPIIO_MOD] <= 2)
+        {
+            rec_len = DARSHAN_MPIIO_FILE_SIZE_1;
+            ret = darshan_log_get_mpiio_rec(fd, scratch, rec_len, 0, 0);
+            if(ret != rec_len)
+                goto exit;
+
+            /* upconvert versions 1/2 to version 3 in-place */
+            dest_p = scratch + (sizeof(struct darshan_base_record) +
+                (51 * sizeof(int64_t)) + (5 * sizeof(double)));
+            src_p = dest_p - (2 * sizeof(double));
+            len = (12 * sizeof(double));
+            memmove(dest_p, src_p, len);
+            /* set F_CLOSE_START and F_OPEN_END to -1 */
+            *((double *)src_p) = -1;
+            *((double *)(src_p + sizeof(double))) = -1;
+        }
+        if(fd->mod_ver[DARSHAN_MPIIO_MOD] <= 3)
+        {
+            if(fd->mod_ver[DARSHAN_MPIIO_MOD] == 3)
+            {
+                rec_len = DARSHAN_MPIIO_FILE_SIZE_3;
+                ret = darshan_log_get_mpiio_rec(fd, scratch, rec_len, 0, 0);
+                if(ret != rec_len)
+                    goto exit;
+            }
+
+            /* upconvert version 3 to version 4 in-place */
+            dest_p = scratch + sizeof(struct darshan_base_record) +
+                (52 * sizeof(int64_t));
+            src_p = dest_p - sizeof(int64_t);
+            len = (17 * sizeof(double));
+            memmove(dest_p, src_p, len);
+            /* set SHARED_RANKS to -1 */
+            *((int64_t *)src_p) = -1;
+        }
+        if(fd->mod_ver[DARSHAN_MPIIO_MOD] <= 4)
+        {
+            if(fd->mod_ver[DARSHAN_MPIIO_MOD] == 4)
+            {
+                rec_len = DARSHAN_MPIIO_FILE_SIZE_4;
+                ret = darshan_log_get_mpiio_rec(fd, scratch, rec_len, 0, 0);
+                if(ret != rec_len)
+                    goto exit;
+            }
+
+            /* upconvert version 4 to version 5 in-place */
+            dest_p = scratch + sizeof(struct darshan_base_record) +
+                (MPIIO_NUM_INDICES * sizeof(int64_t));
+            src_p = scratch + sizeof(struct darshan_base_record) +
+                (52 * sizeof(int64_t));
+            len = (17 * sizeof(double));
+            memmove(dest_p, src_p, len);
+            /* set ACTIVITY_* and F_ACTIVITY_BIN_WIDTH to -1 */
+            memset(src_p, 0xff, dest_p - src_p);
+            *((double *)(dest_p + len)) = -1;
+        }
 
         memcpy(file, scratch, sizeof(struct darshan_mpiio_file));
     }
@@ -139,6 +231,9 @@ exit:
                     ((i == MPIIO_F_CLOSE_START_TIMESTAMP) ||
                      (i == MPIIO_F_OPEN_END_TIMESTAMP)))
                     continue;
+                if((fd->mod_ver[DARSHAN_MPIIO_MOD] < 5) &&
+                    (i == MPIIO_F_ACTIVITY_BIN_WIDTH))
+                    continue;
                 DARSHAN_BSWAP64(&file->fcounters[i]);
             }
         }
@@ -206,12 +301,15 @@ static void darshan_log_print_mpiio_description(int ver)
     printf("#   MPIIO_ACCESS*_COUNT: count of the four most common total access sizes.\n");
     printf("#   MPIIO_*_RANK: rank of the processes that were the fastest and slowest at I/O (for shared files).\n");
     printf("#   MPIIO_*_RANK_BYTES: total bytes transferred at MPI-IO layer by the fastest and slowest ranks (for shared files).\n");
+    printf("#   MPIIO_SHARED_RANKS: number of ranks whose accesses a record covers (more than 1 for shared files).\n");
+    printf("#   MPIIO_ACTIVITY_READ/WRITE_*: bytes read and written at MPI-IO layer by accesses starting in each activity time bin.\n");
     printf("#   MPIIO_F_*_START_TIMESTAMP: timestamp of first MPI-IO open/read/write/close.\n");
     printf("#   MPIIO_F_*_END_TIMESTAMP: timestamp of last MPI-IO open/read/write/close.\n");
     printf("#   MPIIO_F_READ/WRITE/META_TIME: cumulative time spent in MPI-IO read, write, or metadata operations.\n");
     printf("#   MPIIO_F_MAX_*_TIME: duration of the slowest MPI-IO read and write operations.\n");
     printf("#   MPIIO_F_*_RANK_TIME: fastest and slowest I/O time for a single rank (for shared files).\n");
     printf("#   MPIIO_F_VARIANCE_RANK_*: variance of total I/O time and bytes moved for all ranks (for shared files).\n");
+    printf("#   MPIIO_F_ACTIVITY_BIN_WIDTH: width of each activity time bin (bin i covers [i*width, (i+1)*width) seconds).\n");
 
     if(ver == 1)
     {
@@ -224,6 +322,19 @@ static void darshan_log_print_mpiio_description(int ver)
         printf("# - MPIIO_F_CLOSE_START_TIMESTAMP\n");
         printf("# - MPIIO_F_OPEN_END_TIMESTAMP\n");
     }
+    if(ver <= 3)
+    {
+        printf("\n# WARNING: MPIIO module log format version <=3 does not support the following counters:\n");
+        printf("# - MPIIO_SHARED_RANKS\n");
+        printf("# Only files shared by all ranks were reduced to a single record (with rank -1).\n");
+    }
+    if(ver <= 4)
+    {
+        printf("\n# WARNING: MPIIO module log format version <=4 does not support the following counters:\n");
+        printf("# - MPIIO_ACTIVITY_READ_*\n");
+        printf("# - MPIIO_ACTIVITY_WRITE_*\n");
+        printf("# - MPIIO_F_ACTIVITY_BIN_WIDTH\n");
+    }
 
     return;
 }
@@ -371,6 +482,12 @@ static void darshan_log_agg_mpiio_files(void *rec, void *agg_rec, int init_flag)
                 /* sum */
                 agg_mpi_rec->counters[i] += mpi_rec->counters[i];
                 break;
+            case MPIIO_SHARED_RANKS:
+                /* sum */
+                agg_mpi_rec->counters[i] += mpi_rec->counters[i];
+                if(agg_mpi_rec->counters[i] < 0) /* make sure invalid counters are -1 exactly */
+                    agg_mpi_rec->counters[i] = -1;
+                break;
             case MPIIO_MODE:
                 /* just set to the input value */
                 agg_mpi_rec->counters[i] = mpi_rec->counters[i];
@@ -381,6 +498,38 @@ static void darshan_log_agg_mpiio_files(void *rec, void *agg_rec, int init_flag)
             case MPIIO_FASTEST_RANK_BYTES:
             case MPIIO_SLOWEST_RANK:
             case MPIIO_SLOWEST_RANK_BYTES:
+            case MPIIO_ACTIVITY_READ_0:
+            case MPIIO_ACTIVITY_READ_1:
+            case MPIIO_ACTIVITY_READ_2:
+            case MPIIO_ACTIVITY_READ_3:
+            case MPIIO_ACTIVITY_READ_4:
+            case MPIIO_ACTIVITY_READ_5:
+            case MPIIO_ACTIVITY_READ_6:
+            case MPIIO_ACTIVITY_READ_7:
+            case MPIIO_ACTIVITY_READ_8:
+            case MPIIO_ACTIVITY_READ_9:
+            case MPIIO_ACTIVITY_READ_10:
+            case MPIIO_ACTIVITY_READ_11:
+            case MPIIO_ACTIVITY_READ_12:
+            case MPIIO_ACTIVITY_READ_13:
+            case MPIIO_ACTIVITY_READ_14:
+            case MPIIO_ACTIVITY_READ_15:
+            case MPIIO_ACTIVITY_WRITE_0:
+            case MPIIO_ACTIVITY_WRITE_1:
+            case MPIIO_ACTIVITY_WRITE_2:
+            case MPIIO_ACTIVITY_WRITE_3:
+            case MPIIO_ACTIVITY_WRITE_4:
+            case MPIIO_ACTIVITY_WRITE_5:
+            case MPIIO_ACTIVITY_WRITE_6:
+            case MPIIO_ACTIVITY_WRITE_7:
+            case MPIIO_ACTIVITY_WRITE_8:
+            case MPIIO_ACTIVITY_WRITE_9:
+            case MPIIO_ACTIVITY_WRITE_10:
+            case MPIIO_ACTIVITY_WRITE_11:
+            case MPIIO_ACTIVITY_WRITE_12:
+            case MPIIO_ACTIVITY_WRITE_13:
+            case MPIIO_ACTIVITY_WRITE_14:
+            case MPIIO_ACTIVITY_WRITE_15:
                 /* these are set with the FP counters */
                 break;
             case MPIIO_ACCESS1_ACCESS:
@@ -588,6 +737,16 @@ static void darshan_log_agg_mpiio_files(void *rec, void *agg_rec, int init_flag)
                         var_bytes_p->S / var_bytes_p->n;
                 }
                 break;
+            case MPIIO_F_ACTIVITY_BIN_WIDTH:
+                /* sum activity bins, at the coarser of the two bin widths */
+                darshan_log_agg_activity_bins(
+                    &(agg_mpi_rec->counters[MPIIO_ACTIVITY_READ_0]),
+                    &(agg_mpi_rec->counters[MPIIO_ACTIVITY_WRITE_0]),
+                    &(agg_mpi_rec->fcounters[i]),
+                    &(mpi_rec->counters[MPIIO_ACTIVITY_READ_0]),
+                    &(mpi_rec->counters[MPIIO_ACTIVITY_WRITE_0]),
+                    mpi_rec->fcounters[i]);
+                break;
             default:
                 agg_mpi_rec->fcounters[i] = -1;
                 break;
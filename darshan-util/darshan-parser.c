@@ -30,6 +30,7 @@
 #define OPTION_FILE_LIST  (1 << 4)  /* per-file summaries */
 #define OPTION_FILE_LIST_DETAILED  (1 << 6)  /* per-file summaries with extra detail */
 #define OPTION_SHOW_INCOMPLETE  (1 << 7)  /* show what we have, even if log is incomplete */
+#define OPTION_ACTIVITY  (1 << 8)  /* per-record activity time series */
 #define OPTION_ALL (\
   OPTION_BASE|\
   OPTION_TOTAL|\
@@ -37,7 +38,8 @@
   OPTION_FILE|\
   OPTION_FILE_LIST|\
   OPTION_FILE_LIST_DETAILED|\
-  OPTION_SHOW_INCOMPLETE)
+  OPTION_SHOW_INCOMPLETE|\
+  OPTION_ACTIVITY)
 
 #define FILETYPE_SHARED (1 << 0)
 #define FILETYPE_UNIQUE (1 << 1)
@@ -123,6 +125,10 @@ void stdio_print_total_file(struct darshan_stdio_file *pfile, int stdio_ver);
 
 void calc_perf(perf_data_t *pdata, int64_t nprocs);
 
+void print_activity_header(void);
+void print_activity(char *mod_name, struct darshan_base_record *base_rec,
+    int64_t *read_bins, int64_t *write_bins, double width, char *rec_name);
+
 int usage (char *exename)
 {
     fprintf(stderr, "Usage: %s [options] <filename>\n", exename);
@@ -134,6 +140,7 @@ int usage (char *exename)
     fprintf(stderr, "    --perf  : derived perf data\n");
     fprintf(stderr, "    --total : aggregated darshan field data\n");
     fprintf(stderr, "    --show-incomplete : display results even if log is incomplete\n");
+    fprintf(stderr, "    --activity : per-record POSIX and MPI-IO activity time series\n");
 
     exit(1);
 }
@@ -152,6 +159,7 @@ int parse_args (int argc, char **argv, char **filename)
         {"perf",  0, NULL, OPTION_PERF},
         {"total", 0, NULL, OPTION_TOTAL},
         {"show-incomplete", 0, NULL, OPTION_SHOW_INCOMPLETE},
+        {"activity", 0, NULL, OPTION_ACTIVITY},
         {"help",  0, NULL, 0},
         {0, 0, 0, 0}
     };
@@ -174,6 +182,7 @@ int parse_args (int argc, char **argv, char **filename)
             case OPTION_PERF:
             case OPTION_TOTAL:
             case OPTION_SHOW_INCOMPLETE:
+            case OPTION_ACTIVITY:
                 mask |= c;
                 break;
             case 0:
@@ -282,6 +291,8 @@ int main(int argc, char **argv)
         comp_str = "BZIP2";
     else if (fd->comp_type == DARSHAN_NO_COMP)
         comp_str = "NONE";
+    else if (fd->comp_type == DARSHAN_ZSTD_COMP)
+        comp_str = "ZSTD";
     else
         comp_str = "UNKNOWN";
 
@@ -326,7 +337,7 @@ int main(int argc, char **argv)
     /* print breakdown of each log file region's contribution to file size */
     printf("\n# log file regions\n");
     printf("# -------------------------------------------------------\n");
-    printf("# header: %zu bytes (uncompressed)\n", sizeof(struct darshan_header));
+    printf("# header: %zu bytes (uncompressed)\n", fd->job_map.off);
     printf("# job data: %zu bytes (compressed)\n", fd->job_map.len);
     printf("# record table: %zu bytes (compressed)\n", fd->name_map.len);
     for(i=0; i<DARSHAN_MAX_MODS; i++)
@@ -338,6 +349,56 @@ int main(int argc, char **argv)
         }
     }
 
+    /* print record memory used by each module at runtime, if known */
+    for(i=0; i<DARSHAN_MAX_MODS; i++)
+    {
+        if(fd->mod_mem[i])
+            break;
+    }
+    if(i < DARSHAN_MAX_MODS)
+    {
+        printf("\n# runtime memory usage (max per process)\n");
+        printf("# -------------------------------------------------------\n");
+        for(i=0; i<DARSHAN_MAX_MODS; i++)
+        {
+            if(fd->mod_mem[i])
+            {
+                printf("# %s module: %" PRIu64 " bytes\n",
+                    darshan_module_names[i], fd->mod_mem[i]);
+            }
+        }
+    }
+
+    /* note any modules whose counters were estimated from samples */
+    for(i=0; i<DARSHAN_MAX_MODS; i++)
+    {
+        if(fd->mod_map[i].len > 0 && fd->mod_sample[i] > 1)
+        {
+            printf("\n# WARNING: %s module sampled 1 in %" PRIu32 " operations\n",
+                darshan_module_names[i], fd->mod_sample[i]);
+            if(i == DARSHAN_POSIX_MOD)
+                printf("# \t- Estimated counters include: F_{READ|WRITE}_TIME,"
+                    " ACCESS*_COUNT, STRIDE*_COUNT\n");
+            else if(i == DARSHAN_STDIO_MOD)
+                printf("# \t- Estimated counters include: F_{READ|WRITE}_TIME\n");
+            else if(i == DXT_POSIX_MOD || i == DXT_MPIIO_MOD)
+                printf("# \t- Only the sampled operations are traced\n");
+        }
+    }
+
+    /* note any modules whose common value counts are estimates */
+    for(i=0; i<DARSHAN_MAX_MODS; i++)
+    {
+        if(fd->mod_map[i].len > 0 && DARSHAN_MOD_FLAG_ISSET(fd->estimate_flag, i))
+        {
+            printf("\n# WARNING: %s module common value counts are estimates\n",
+                darshan_module_names[i]);
+            printf("# \t- Some records saw more distinct access sizes or strides"
+                " than could be tracked exactly\n");
+            printf("# \t- Their ACCESS*_COUNT and STRIDE*_COUNT may be overestimated\n");
+        }
+    }
+
     /* print table of mounted file systems */
     printf("\n# mounted file systems (mount point and fs type)\n");
     printf("# -------------------------------------------------------\n");
@@ -466,6 +527,12 @@ int main(int argc, char **argv)
             }
         }
 
+        if((mask & OPTION_ACTIVITY) &&
+           (i == DARSHAN_POSIX_MOD || i == DARSHAN_MPIIO_MOD))
+        {
+            print_activity_header();
+        }
+
         /* loop over each of this module's records and print them */
         while(1)
         {
@@ -551,6 +618,23 @@ int main(int argc, char **argv)
                 HASH_ADD(hlink, file_hash,rec_id, sizeof(darshan_record_id), hfile);
             }
 
+            if((mask & OPTION_ACTIVITY) && i == DARSHAN_POSIX_MOD)
+            {
+                struct darshan_posix_file *pfile = (struct darshan_posix_file*)mod_buf;
+                print_activity("POSIX", base_rec,
+                    &(pfile->counters[POSIX_ACTIVITY_READ_0]),
+                    &(pfile->counters[POSIX_ACTIVITY_WRITE_0]),
+                    pfile->fcounters[POSIX_F_ACTIVITY_BIN_WIDTH], rec_name);
+            }
+            else if((mask & OPTION_ACTIVITY) && i == DARSHAN_MPIIO_MOD)
+            {
+                struct darshan_mpiio_file *mfile = (struct darshan_mpiio_file*)mod_buf;
+                print_activity("MPI-IO", base_rec,
+                    &(mfile->counters[MPIIO_ACTIVITY_READ_0]),
+                    &(mfile->counters[MPIIO_ACTIVITY_WRITE_0]),
+                    mfile->fcounters[MPIIO_F_ACTIVITY_BIN_WIDTH], rec_name);
+            }
+
             if(i == DARSHAN_POSIX_MOD)
             {
                 posix_accum_file((struct darshan_posix_file*)mod_buf, &total, job.nprocs);
@@ -891,7 +975,16 @@ void posix_accum_file(struct darshan_posix_file *pfile,
             pfile->fcounters[POSIX_F_WRITE_TIME]));
     }
 
-    if(pfile->base_rec.rank == -1)
+    if(pfile->base_rec.rank == -1 &&
+       pfile->counters[POSIX_SHARED_RANKS] > 1 &&
+       pfile->counters[POSIX_SHARED_RANKS] < nprocs)
+    {
+        /* reduced record for a file shared by a subset of ranks */
+        hfile->procs = pfile->counters[POSIX_SHARED_RANKS];
+        hfile->type &= (~FILETYPE_UNIQUE);
+        hfile->type |= FILETYPE_PARTSHARED;
+    }
+    else if(pfile->base_rec.rank == -1)
     {
         hfile->procs = nprocs;
         hfile->type |= FILETYPE_SHARED;
@@ -1096,7 +1189,16 @@ void mpiio_accum_file(struct darshan_mpiio_file *mfile,
             mfile->fcounters[MPIIO_F_WRITE_TIME]));
     }
 
-    if(mfile->base_rec.rank == -1)
+    if(mfile->base_rec.rank == -1 &&
+       mfile->counters[MPIIO_SHARED_RANKS] > 1 &&
+       mfile->counters[MPIIO_SHARED_RANKS] < nprocs)
+    {
+        /* reduced record for a file shared by a subset of ranks */
+        hfile->procs = mfile->counters[MPIIO_SHARED_RANKS];
+        hfile->type &= (~FILETYPE_UNIQUE);
+        hfile->type |= FILETYPE_PARTSHARED;
+    }
+    else if(mfile->base_rec.rank == -1)
     {
         hfile->procs = nprocs;
         hfile->type |= FILETYPE_SHARED;
@@ -2065,6 +2167,37 @@ void mpiio_file_list(hash_entry_t *file_hash,
     return;
 }
 
+void print_activity_header(void)
+{
+    printf("\n# activity time series (bytes moved by accesses starting in each bin)\n");
+    printf("# ----------------------\n");
+    printf("#<module>\t<rank>\t<record id>\t<bin start>\t<bin end>\t<bytes read>\t<bytes written>\t<file name>\n");
+
+    return;
+}
+
+void print_activity(char *mod_name, struct darshan_base_record *base_rec,
+    int64_t *read_bins, int64_t *write_bins, double width, char *rec_name)
+{
+    int i;
+
+    /* nothing recorded, or a log that predates activity bins */
+    if(width <= 0)
+        return;
+
+    for(i = 0; i < DARSHAN_ACTIVITY_BINS; i++)
+    {
+        if(read_bins[i] == 0 && write_bins[i] == 0)
+            continue;
+
+        printf("%s\t%" PRId64 "\t%" PRIu64 "\t%f\t%f\t%" PRId64 "\t%" PRId64 "\t%s\n",
+            mod_name, base_rec->rank, base_rec->id, i * width, (i + 1) * width,
+            read_bins[i], write_bins[i], rec_name ? rec_name : "UNKNOWN");
+    }
+
+    return;
+}
+
 /*
  * Local variables:
  *  c-indent-level: 4
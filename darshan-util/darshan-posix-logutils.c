@@ -33,6 +33,13 @@ char *posix_f_counter_names[] = {
 #define DARSHAN_POSIX_FILE_SIZE_1 680
 #define DARSHAN_POSIX_FILE_SIZE_2 648
 #define DARSHAN_POSIX_FILE_SIZE_3 664
+#define DARSHAN_POSIX_FILE_SIZE_4 704
+#define DARSHAN_POSIX_FILE_SIZE_5 712
+
+/* first version of the module whose records may have been sparse encoded
+ * or stored in columns
+ */
+#define DARSHAN_POSIX_ENC_VER 6
 
 static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p);
 static int darshan_log_put_posix_file(darshan_fd fd, void* posix_buf);
@@ -53,6 +60,34 @@ struct darshan_mod_logutil_funcs posix_logutils =
     .log_agg_records = &darshan_log_agg_posix_files,
 };
 
+/* read the next POSIX record, 'rec_len' bytes long in the layout of the
+ * version it was stored in. if the module's records were sparse encoded or
+ * stored in columns, it is decoded from that form assuming the stored
+ * version has 'counter_cnt' counters and 'fcounter_cnt' fcounters
+ */
+static int darshan_log_get_posix_rec(darshan_fd fd, void *buf, int rec_len,
+    int counter_cnt, int fcounter_cnt)
+{
+    int sparse = DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_POSIX_MOD);
+    int columnar = DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_POSIX_MOD);
+
+    if((sparse || columnar) && (counter_cnt == 0 || fcounter_cnt == 0))
+    {
+        fprintf(stderr, "Error: unable to decode POSIX records of module "
+            "version %d\n", fd->mod_ver[DARSHAN_POSIX_MOD]);
+        return(-1);
+    }
+
+    if(sparse)
+        return(darshan_log_get_sparse_rec(fd, DARSHAN_POSIX_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else if(columnar)
+        return(darshan_log_get_columnar_rec(fd, DARSHAN_POSIX_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else
+        return(darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, buf, rec_len));
+}
+
 static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
 {
     struct darshan_posix_file *file = *((struct darshan_posix_file **)posix_buf_p);
@@ -71,6 +106,19 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
         return(-1);
     }
 
+    /* only records stored as of DARSHAN_POSIX_ENC_VER may have been sparse
+     * encoded or stored in columns. they are decoded into the layout of the
+     * version they were stored in, then upconverted like any other record
+     */
+    if((DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_POSIX_MOD) ||
+        DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_POSIX_MOD)) &&
+        fd->mod_ver[DARSHAN_POSIX_MOD] < DARSHAN_POSIX_ENC_VER)
+    {
+        fprintf(stderr, "Error: Invalid encoding of POSIX module version %d "
+            "records\n", fd->mod_ver[DARSHAN_POSIX_MOD]);
+        return(-1);
+    }
+
     if(*posix_buf_p == NULL)
     {
         file = malloc(sizeof(*file));
@@ -84,11 +132,12 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
          * translation of counters while reading
          */
         rec_len = sizeof(struct darshan_posix_file);
-        ret = darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, file, rec_len);
+        ret = darshan_log_get_posix_rec(fd, file, rec_len,
+            POSIX_NUM_INDICES, POSIX_F_NUM_INDICES);
     }
     else
     {
-        char scratch[1024] = {0};
+        char scratch[sizeof(struct darshan_posix_file)] = {0};
         char *src_p, *dest_p;
         int len;
 
@@ -110,7 +159,7 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
             do
             {
                 /* pull POSIX records until we find one that doesn't have STDIO data */
-                ret = darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, scratch, rec_len);
+                ret = darshan_log_get_posix_rec(fd, scratch, rec_len, 0, 0);
             } while(ret == rec_len && *fopen_counter > 0);
             if(ret != rec_len)
                 goto exit;
@@ -125,7 +174,7 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
             if(fd->mod_ver[DARSHAN_POSIX_MOD] == 2)
             {
                 rec_len = DARSHAN_POSIX_FILE_SIZE_2;
-                ret = darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, scratch, rec_len);
+                ret = darshan_log_get_posix_rec(fd, scratch, rec_len, 0, 0);
                 if(ret != rec_len)
                     goto exit;
             }
@@ -145,7 +194,7 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
             if(fd->mod_ver[DARSHAN_POSIX_MOD] == 3)
             {
                 rec_len = DARSHAN_POSIX_FILE_SIZE_3;
-                ret = darshan_log_get_mod(fd, DARSHAN_POSIX_MOD, scratch, rec_len);
+                ret = darshan_log_get_posix_rec(fd, scratch, rec_len, 0, 0);
                 if(ret != rec_len)
                     goto exit;
             }
@@ -171,6 +220,46 @@ static int darshan_log_get_posix_file(darshan_fd fd, void** posix_buf_p)
             /* set RENAMED_FROM to 0 (-1 not possible since this is a uint) */
             *((int64_t *)(src_p + (2 * sizeof(int64_t)))) = 0;
         }
+        if(fd->mod_ver[DARSHAN_POSIX_MOD] <= 4)
+        {
+            if(fd->mod_ver[DARSHAN_POSIX_MOD] == 4)
+            {
+                rec_len = DARSHAN_POSIX_FILE_SIZE_4;
+                ret = darshan_log_get_posix_rec(fd, scratch, rec_len, 0, 0);
+                if(ret != rec_len)
+                    goto exit;
+            }
+
+            /* upconvert version 4 to version 5 in-place */
+            dest_p = scratch + sizeof(struct darshan_base_record) +
+                (70 * sizeof(int64_t));
+            src_p = dest_p - sizeof(int64_t);
+            len = (17 * sizeof(double));
+            memmove(dest_p, src_p, len);
+            /* set SHARED_RANKS to -1 */
+            *((int64_t *)src_p) = -1;
+        }
+        if(fd->mod_ver[DARSHAN_POSIX_MOD] <= 5)
+        {
+            if(fd->mod_ver[DARSHAN_POSIX_MOD] == 5)
+            {
+                rec_len = DARSHAN_POSIX_FILE_SIZE_5;
+                ret = darshan_log_get_posix_rec(fd, scratch, rec_len, 0, 0);
+                if(ret != rec_len)
+                    goto exit;
+            }
+
+            /* upconvert version 5 to version 6 in-place */
+            dest_p = scratch + sizeof(struct darshan_base_record) +
+                (POSIX_NUM_INDICES * sizeof(int64_t));
+            src_p = scratch + sizeof(struct darshan_base_record) +
+                (70 * sizeof(int64_t));
+            len = (17 * sizeof(double));
+            memmove(dest_p, src_p, len);
+            /* set ACTIVITY_* and F_ACTIVITY_BIN_WIDTH to -1 */
+            memset(src_p, 0xff, dest_p - src_p);
+            *((double *)(dest_p + len)) = -1;
+        }
         
         memcpy(file, scratch, sizeof(struct darshan_posix_file));
     }
@@ -210,6 +299,9 @@ exit:
                      ((i == POSIX_RENAME_SOURCES) || (i == POSIX_RENAME_TARGETS) ||
                       (i == POSIX_RENAMED_FROM)))
                     continue;
+                if((fd->mod_ver[DARSHAN_POSIX_MOD] < 6) &&
+                    (i == POSIX_F_ACTIVITY_BIN_WIDTH))
+                    continue;
                 DARSHAN_BSWAP64(&file->fcounters[i]);
             }
         }
@@ -286,12 +378,15 @@ static void darshan_log_print_posix_description(int ver)
     printf("#   POSIX_ACCESS*_COUNT: count of the four most common access sizes.\n");
     printf("#   POSIX_*_RANK: rank of the processes that were the fastest and slowest at I/O (for shared files).\n");
     printf("#   POSIX_*_RANK_BYTES: bytes transferred by the fastest and slowest ranks (for shared files).\n");
+    printf("#   POSIX_SHARED_RANKS: number of ranks whose accesses a record covers (more than 1 for shared files).\n");
+    printf("#   POSIX_ACTIVITY_READ/WRITE_*: bytes read and written by accesses starting in each activity time bin.\n");
     printf("#   POSIX_F_*_START_TIMESTAMP: timestamp of first open/read/write/close.\n");
     printf("#   POSIX_F_*_END_TIMESTAMP: timestamp of last open/read/write/close.\n");
     printf("#   POSIX_F_READ/WRITE/META_TIME: cumulative time spent in read, write, or metadata operations.\n");
     printf("#   POSIX_F_MAX_*_TIME: duration of the slowest read and write operations.\n");
     printf("#   POSIX_F_*_RANK_TIME: fastest and slowest I/O time for a single rank (for shared files).\n");
     printf("#   POSIX_F_VARIANCE_RANK_*: variance of total I/O time and bytes moved for all ranks (for shared files).\n");
+    printf("#   POSIX_F_ACTIVITY_BIN_WIDTH: width of each activity time bin (bin i covers [i*width, (i+1)*width) seconds).\n");
 
     if(ver == 1)
     {
@@ -317,6 +412,19 @@ static void darshan_log_print_posix_description(int ver)
         printf("# \t- POSIX_RENAME_TARGETS\n");
         printf("# \t- POSIX_RENAMED_FROM\n");
     }
+    if(ver <= 4)
+    {
+        printf("\n# WARNING: POSIX module log format version <=4 does not support the following counters:\n");
+        printf("# \t- POSIX_SHARED_RANKS\n");
+        printf("# Only files shared by all ranks were reduced to a single record (with rank -1).\n");
+    }
+    if(ver <= 5)
+    {
+        printf("\n# WARNING: POSIX module log format version <=5 does not support the following counters:\n");
+        printf("# \t- POSIX_ACTIVITY_READ_*\n");
+        printf("# \t- POSIX_ACTIVITY_WRITE_*\n");
+        printf("# \t- POSIX_F_ACTIVITY_BIN_WIDTH\n");
+    }
 
     if(ver >= 4)
     {
@@ -493,6 +601,7 @@ static void darshan_log_agg_posix_files(void *rec, void *agg_rec, int init_flag)
             case POSIX_SIZE_WRITE_10M_100M:
             case POSIX_SIZE_WRITE_100M_1G:
             case POSIX_SIZE_WRITE_1G_PLUS:
+            case POSIX_SHARED_RANKS:
                 /* sum */
                 agg_psx_rec->counters[i] += psx_rec->counters[i];
                 if(agg_psx_rec->counters[i] < 0) /* make sure invalid counters are -1 exactly */
@@ -519,6 +628,38 @@ static void darshan_log_agg_posix_files(void *rec, void *agg_rec, int init_flag)
             case POSIX_FASTEST_RANK_BYTES:
             case POSIX_SLOWEST_RANK:
             case POSIX_SLOWEST_RANK_BYTES:
+            case POSIX_ACTIVITY_READ_0:
+            case POSIX_ACTIVITY_READ_1:
+            case POSIX_ACTIVITY_READ_2:
+            case POSIX_ACTIVITY_READ_3:
+            case POSIX_ACTIVITY_READ_4:
+            case POSIX_ACTIVITY_READ_5:
+            case POSIX_ACTIVITY_READ_6:
+            case POSIX_ACTIVITY_READ_7:
+            case POSIX_ACTIVITY_READ_8:
+            case POSIX_ACTIVITY_READ_9:
+            case POSIX_ACTIVITY_READ_10:
+            case POSIX_ACTIVITY_READ_11:
+            case POSIX_ACTIVITY_READ_12:
+            case POSIX_ACTIVITY_READ_13:
+            case POSIX_ACTIVITY_READ_14:
+            case POSIX_ACTIVITY_READ_15:
+            case POSIX_ACTIVITY_WRITE_0:
+            case POSIX_ACTIVITY_WRITE_1:
+            case POSIX_ACTIVITY_WRITE_2:
+            case POSIX_ACTIVITY_WRITE_3:
+            case POSIX_ACTIVITY_WRITE_4:
+            case POSIX_ACTIVITY_WRITE_5:
+            case POSIX_ACTIVITY_WRITE_6:
+            case POSIX_ACTIVITY_WRITE_7:
+            case POSIX_ACTIVITY_WRITE_8:
+            case POSIX_ACTIVITY_WRITE_9:
+            case POSIX_ACTIVITY_WRITE_10:
+            case POSIX_ACTIVITY_WRITE_11:
+            case POSIX_ACTIVITY_WRITE_12:
+            case POSIX_ACTIVITY_WRITE_13:
+            case POSIX_ACTIVITY_WRITE_14:
+            case POSIX_ACTIVITY_WRITE_15:
                 /* these are set with the FP counters */
                 break;
             case POSIX_STRIDE1_STRIDE:
@@ -733,6 +874,16 @@ static void darshan_log_agg_posix_files(void *rec, void *agg_rec, int init_flag)
                         var_bytes_p->S / var_bytes_p->n;
                 }
                 break;
+            case POSIX_F_ACTIVITY_BIN_WIDTH:
+                /* sum activity bins, at the coarser of the two bin widths */
+                darshan_log_agg_activity_bins(
+                    &(agg_psx_rec->counters[POSIX_ACTIVITY_READ_0]),
+                    &(agg_psx_rec->counters[POSIX_ACTIVITY_WRITE_0]),
+                    &(agg_psx_rec->fcounters[i]),
+                    &(psx_rec->counters[POSIX_ACTIVITY_READ_0]),
+                    &(psx_rec->counters[POSIX_ACTIVITY_WRITE_0]),
+                    psx_rec->fcounters[i]);
+                break;
             default:
                 agg_psx_rec->fcounters[i] = -1;
                 break;
@@ -33,6 +33,11 @@ char *stdio_f_counter_names[] = {
 
 #define DARSHAN_STDIO_FILE_SIZE_1 240
 
+/* first version of the module whose records may have been sparse encoded
+ * or stored in columns
+ */
+#define DARSHAN_STDIO_ENC_VER 2
+
 /* prototypes for each of the STDIO module's logutil functions */
 static int darshan_log_get_stdio_record(darshan_fd fd, void** stdio_buf_p);
 static int darshan_log_put_stdio_record(darshan_fd fd, void* stdio_buf);
@@ -57,6 +62,34 @@ struct darshan_mod_logutil_funcs stdio_logutils =
     .log_agg_records = &darshan_log_agg_stdio_records
 };
 
+/* read the next STDIO record, 'rec_len' bytes long in the layout of the
+ * version it was stored in. if the module's records were sparse encoded or
+ * stored in columns, it is decoded from that form assuming the stored
+ * version has 'counter_cnt' counters and 'fcounter_cnt' fcounters
+ */
+static int darshan_log_get_stdio_rec(darshan_fd fd, void *buf, int rec_len,
+    int counter_cnt, int fcounter_cnt)
+{
+    int sparse = DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_STDIO_MOD);
+    int columnar = DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_STDIO_MOD);
+
+    if((sparse || columnar) && (counter_cnt == 0 || fcounter_cnt == 0))
+    {
+        fprintf(stderr, "Error: unable to decode STDIO records of module "
+            "version %d\n", fd->mod_ver[DARSHAN_STDIO_MOD]);
+        return(-1);
+    }
+
+    if(sparse)
+        return(darshan_log_get_sparse_rec(fd, DARSHAN_STDIO_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else if(columnar)
+        return(darshan_log_get_columnar_rec(fd, DARSHAN_STDIO_MOD, buf,
+            counter_cnt, fcounter_cnt));
+    else
+        return(darshan_log_get_mod(fd, DARSHAN_STDIO_MOD, buf, rec_len));
+}
+
 /* retrieve a STDIO record from log file descriptor 'fd', storing the
  * data in the buffer address pointed to by 'stdio_buf_p'. Return 1 on
  * successful record read, 0 on no more data, and -1 on error.
@@ -79,6 +112,19 @@ static int darshan_log_get_stdio_record(darshan_fd fd, void** stdio_buf_p)
         return(-1);
     }
 
+    /* only records stored as of DARSHAN_STDIO_ENC_VER may have been sparse
+     * encoded or stored in columns. they are decoded into the layout of the
+     * version they were stored in, then upconverted like any other record
+     */
+    if((DARSHAN_MOD_FLAG_ISSET(fd->sparse_flag, DARSHAN_STDIO_MOD) ||
+        DARSHAN_MOD_FLAG_ISSET(fd->columnar_flag, DARSHAN_STDIO_MOD)) &&
+        fd->mod_ver[DARSHAN_STDIO_MOD] < DARSHAN_STDIO_ENC_VER)
+    {
+        fprintf(stderr, "Error: Invalid encoding of STDIO module version %d "
+            "records\n", fd->mod_ver[DARSHAN_STDIO_MOD]);
+        return(-1);
+    }
+
     if(*stdio_buf_p == NULL)
     {
         file = malloc(sizeof(*file));
@@ -92,7 +138,8 @@ static int darshan_log_get_stdio_record(darshan_fd fd, void** stdio_buf_p)
          * translation of counters while reading
          */
         rec_len = sizeof(struct darshan_stdio_file);
-        ret = darshan_log_get_mod(fd, DARSHAN_STDIO_MOD, file, rec_len);
+        ret = darshan_log_get_stdio_rec(fd, file, rec_len,
+            STDIO_NUM_INDICES, STDIO_F_NUM_INDICES);
     }
     else
     {
@@ -103,7 +150,7 @@ static int darshan_log_get_stdio_record(darshan_fd fd, void** stdio_buf_p)
         if(fd->mod_ver[DARSHAN_STDIO_MOD] == 1)
         {
             rec_len = DARSHAN_STDIO_FILE_SIZE_1;
-            ret = darshan_log_get_mod(fd, DARSHAN_STDIO_MOD, scratch, rec_len);
+            ret = darshan_log_get_stdio_rec(fd, scratch, rec_len, 0, 0);
             if(ret != rec_len)
                 goto exit;
 
@@ -50,8 +50,8 @@ struct darshan_name_record
 struct darshan_posix_file
 {
     struct darshan_base_record base_rec;
-    int64_t counters[69];
-    double fcounters[17];
+    int64_t counters[102];
+    double fcounters[18];
 };
 
 struct darshan_stdio_file
@@ -64,8 +64,8 @@ struct darshan_stdio_file
 struct darshan_mpiio_file
 {
     struct darshan_base_record base_rec;
-    int64_t counters[51];
-    double fcounters[17];
+    int64_t counters[84];
+    double fcounters[18];
 };
 
 struct darshan_hdf5_file
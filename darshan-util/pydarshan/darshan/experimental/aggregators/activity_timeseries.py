@@ -0,0 +1,59 @@
+from darshan.report import *
+
+def activity_timeseries(self, mod="POSIX", mode='append'):
+    """
+    Build a time series of bytes moved per record from the activity bins.
+
+    Args:
+        mod (str): Module to use, either 'POSIX' or 'MPI-IO'.
+        mode (str): Whether to 'append' (default) or to 'return' aggregation.
+
+    Return:
+        pandas.DataFrame: one row per non-empty bin of each record
+    """
+
+    # sanitation and guards
+    supported = ["POSIX", "MPI-IO"]
+    if mod not in supported:
+        raise Exception("Unsupported mod_name for activity time series.")
+
+
+    # convienience
+    recs = self.records
+    prefix = "MPIIO" if mod == "MPI-IO" else mod
+    cn = backend.counter_names(mod)
+    fcn = backend.fcounter_names(mod)
+    read_idx = cn.index("%s_ACTIVITY_READ_0" % prefix)
+    write_idx = cn.index("%s_ACTIVITY_WRITE_0" % prefix)
+    width_idx = fcn.index("%s_F_ACTIVITY_BIN_WIDTH" % prefix)
+    nbins = write_idx - read_idx
+
+    rows = []
+
+
+    # check records for module are present
+    if mod in recs:
+        for rec in recs[mod]:
+            width = rec['fcounters'][width_idx]
+            # nothing recorded, or a log that predates activity bins
+            if width <= 0:
+                continue
+
+            for i in range(nbins):
+                rd = rec['counters'][read_idx + i]
+                wr = rec['counters'][write_idx + i]
+                if rd == 0 and wr == 0:
+                    continue
+                rows.append([rec['id'], rec['rank'], i * width, (i + 1) * width, rd, wr])
+
+
+    ctx = pd.DataFrame(rows, columns=['id', 'rank', 'bin_start', 'bin_end',
+        'bytes_read', 'bytes_written'])
+
+
+    if mode == 'append':
+        if 'activity_timeseries' not in self.summary:
+            self.summary['activity_timeseries'] = {}
+        self.summary['activity_timeseries'][mod] = ctx
+
+    return ctx
@@ -0,0 +1,88 @@
+dnl @synopsis CHECK_ZSTD()
+dnl
+dnl This macro searches for an installed zstd library. If nothing was
+dnl specified when calling configure, it searches first in /usr/local
+dnl and then in /usr. If the --with-zstd=DIR is specified, it will try
+dnl to find it in DIR/include/zstd.h and DIR/lib/libzstd.a. If
+dnl --without-zstd is specified, the library is not searched at all.
+dnl
+dnl zstd is optional in Darshan: if either the header file (zstd.h) or
+dnl the library (libzstd) is not found, configure just warns and carries
+dnl on without it.
+dnl
+dnl The macro defines the symbol HAVE_LIBZSTD if the library is found, and
+dnl substitutes LIBZSTD with the flags needed to link against it. Sample
+dnl usage in a C/C++ source is as follows:
+dnl
+dnl   #ifdef HAVE_LIBZSTD
+dnl   #include <zstd.h>
+dnl   #endif /* HAVE_LIBZSTD */
+dnl
+dnl Adapted from CHECK_BZLIB.
+
+AC_DEFUN([CHECK_ZSTD],
+#
+# Handle user hints
+#
+[AC_MSG_CHECKING(if zstd is wanted)
+AC_ARG_WITH(zstd,
+[  --with-zstd=DIR root directory path of zstd installation [defaults to
+                    /usr/local or /usr if not found in /usr/local]
+  --without-zstd to disable zstd usage completely],
+[if test "$withval" != no ; then
+  if test -d "$withval"
+  then
+    ZSTD_HOME="$withval"
+  else
+    ZSTD_HOME=/usr/local
+    AC_MSG_WARN([Sorry, $withval does not exist, checking usual places])
+  fi
+else
+  DISABLE_ZSTD=1
+  AC_MSG_RESULT(no)
+fi])
+
+#
+# Locate zstd, if wanted
+#
+if test -z "${DISABLE_ZSTD}"
+then
+        if test ! -f "${ZSTD_HOME}/include/zstd.h"
+        then
+            ZSTD_HOME=/usr
+        fi
+
+        AC_MSG_RESULT(yes)
+        ZSTD_OLD_LDFLAGS=$LDFLAGS
+        ZSTD_OLD_CPPFLAGS=$CPPFLAGS
+        LDFLAGS="$LDFLAGS -L${ZSTD_HOME}/lib"
+        CPPFLAGS="$CPPFLAGS -I${ZSTD_HOME}/include"
+        AC_LANG_SAVE
+        AC_LANG_C
+        AC_CHECK_LIB(zstd, ZSTD_compressStream2, [zstd_cv_libzstd=yes], [zstd_cv_libzstd=no])
+        AC_CHECK_HEADER(zstd.h, [zstd_cv_zstd_h=yes], [zstd_cv_zstd_h=no])
+        AC_LANG_RESTORE
+        if test "$zstd_cv_libzstd" = "yes" -a "$zstd_cv_zstd_h" = "yes"
+        then
+                #
+                # If both library and header were found, use them
+                #
+                AC_CHECK_LIB(zstd, ZSTD_compressStream2)
+                AC_MSG_CHECKING(zstd in ${ZSTD_HOME})
+                AC_MSG_RESULT(ok)
+                LIBZSTD=-lzstd
+                AC_SUBST(LIBZSTD)
+        else
+                #
+                # If either header or library was not found, revert and
+                # carry on without it
+                #
+                AC_MSG_CHECKING(zstd in ${ZSTD_HOME})
+                LDFLAGS="$ZSTD_OLD_LDFLAGS"
+                CPPFLAGS="$ZSTD_OLD_CPPFLAGS"
+                AC_MSG_RESULT(failed)
+                AC_MSG_WARN(libzstd (>= 1.4.0) not found; zstd log compression will not be supported.)
+        fi
+fi
+
+])